@@ -1,4 +1,7 @@
-uniform mat4 u_jointTrans[230];
+// Filled by SkinningBuffer once a frame, and shared by every pass.
+layout (std140) uniform JointTransforms {
+    mat4 u_jointTrans[230];
+};
 
 
 mat4 makeJointTransform(ivec3 jointIDs, vec3 weights) {
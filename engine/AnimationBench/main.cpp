@@ -0,0 +1,607 @@
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+#include <d_workerpool.h>
+#include <u_objparser.h>
+#include <p_animation.h>
+#include <p_animbake.h>
+
+
+// Samples every animation of a model as it would be for one character per frame.
+// Walking parent chain from every joint, which is how poses used to be evaluated, is compared with
+// single parent first pass of Animation::sample2. Both must give the same joint transforms.
+// Keyframe lookup is measured on clips of growing length, where searching from scratch every frame is
+// compared with keyframe cursors, which must find the same keyframes.
+// Each animation is compressed as the loader does, and poses sampled from it must stay close to uncompressed ones.
+// A crowd of characters is sampled over worker threads as SceneGraph does, which must match sampling them one by one.
+// Each level of detail is timed against full pose, and joints it didn't sample are counted.
+// Cross-fade and layers are timed against a single clip, and vectorized blending must match scalar one.
+// Each clip is baked as the loader does, and a crowd playing baked frames is timed against sampling it.
+// Skinning of a crowd is run against GL functions that only count calls, where transforms must be uploaded once a frame
+// and no matrix uniforms sent. This needs GL functions to be pointers like glad makes, which need no context then.
+
+namespace {
+
+    constexpr unsigned NUM_SAMPLES = 20000;
+    // Products are associated differently, so results differ by rounding errors.
+    constexpr float MAX_ERROR = 0.001f;
+    constexpr unsigned CLIP_LENGTHS[] = { 10, 100, 1000, 10000 };
+    // Errors of joints add up along chains, so this is looser than tolerances of each channel.
+    constexpr float MAX_COMPRESSED_POSE_ERROR = 0.01f;
+    constexpr unsigned CROWD_SIZE = 64;
+    constexpr unsigned NUM_CROWD_FRAMES = 200;
+    constexpr unsigned THREAD_COUNTS[] = { 1, 2, 4, 8 };
+    // Same as SceneGraph.
+    constexpr size_t ANIMATION_MIN_RANGE_SIZE = 4;
+
+    const dal::AnimationLOD fullLOD;
+
+    // Long enough that fade never ends while measured.
+    constexpr float BENCH_FADE_SECONDS = 1000000.f;
+    constexpr float BENCH_FRAME_SECONDS = 1.f / 60.f;
+    constexpr unsigned NUM_BLEND_REPEATS = 1000;
+
+    constexpr float BAKE_FRAMES_PER_SEC = 30.f;
+    constexpr unsigned BAKED_CROWD_SIZE = 256;
+
+    constexpr size_t SKINNED_CROWD_SIZE = 16;
+    constexpr size_t NUM_SKINNED_FRAMES = 10;
+    // Main pass, 3 shadow maps, 2 water views and 6 envmap faces.
+    constexpr size_t NUM_SKINNED_PASSES = 12;
+
+
+    template <typename F>
+    double measure(F func) {
+        const auto before = std::chrono::steady_clock::now();
+        func();
+        const auto after = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(after - before).count();
+    }
+
+    std::vector<uint8_t> readFile(const char* const path) {
+        std::ifstream file{ path, std::ios::binary };
+        return std::vector<uint8_t>{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+    }
+
+    unsigned calcMaxDepth(const dal::SkeletonInterface& skeleton) {
+        unsigned result = 0;
+
+        for ( dal::jointID_t i = 0; i < skeleton.getSize(); ++i ) {
+            unsigned depth = 0;
+            for ( auto j = i; j >= 0; j = skeleton.at(j).parentIndex() ) {
+                ++depth;
+            }
+            result = std::max(result, depth);
+        }
+
+        return result;
+    }
+
+    // Every joint multiplies transforms of all of its ancestors again, so cost grows with depth of skeleton.
+    void sampleChainWalk(const dal::Animation& anim, const float animTick, const dal::SkeletonInterface& skeleton,
+        std::vector<glm::mat4>& boneTransforms, std::vector<glm::mat4>& result)
+    {
+        const auto numBones = skeleton.getSize();
+        boneTransforms.resize(numBones);
+        result.resize(numBones);
+
+        for ( dal::jointID_t i = 0; i < numBones; ++i ) {
+            boneTransforms[i] = anim.getJoints()[i].makeTransform(animTick);
+        }
+
+        for ( dal::jointID_t i = 0; i < numBones; ++i ) {
+            auto totalTrans = skeleton.at(i).offsetInv();
+            for ( auto curBone = i; curBone != -1; curBone = skeleton.at(curBone).parentIndex() ) {
+                totalTrans = skeleton.at(curBone).toParent() * boneTransforms[curBone] * totalTrans;
+            }
+            result[i] = totalTrans;
+        }
+    }
+
+    float calcMaxError(const glm::mat4& a, const glm::mat4& b) {
+        float result = 0;
+
+        for ( int col = 0; col < 4; ++col ) {
+            for ( int row = 0; row < 4; ++row ) {
+                result = std::max(result, std::abs(a[col][row] - b[col][row]));
+            }
+        }
+
+        return result;
+    }
+
+    float calcMaxError(const std::vector<glm::mat4>& reference, const dal::JointTransformArray& transforms) {
+        float result = 0;
+
+        for ( dal::jointID_t i = 0; i < transforms.getSize(); ++i ) {
+            result = std::max(result, ::calcMaxError(reference[i], transforms.at(i)));
+        }
+
+        return result;
+    }
+
+
+    struct LookupReport {
+        double m_search = 0, m_cursor = 0;
+        size_t m_mismatches = 0;
+    };
+
+    // Joint with a keyframe at every tick, played forward frame by frame for a few loops.
+    LookupReport compareKeyframeLookup(const unsigned numKeyframes) {
+        dal::Animation::JointNode joint;
+        for ( unsigned i = 0; i < numKeyframes; ++i ) {
+            const auto t = static_cast<float>(i);
+            joint.addPos(t, glm::vec3{ t, 0, 0 });
+            joint.addRotation(t, glm::quat{ 1, 0, 0, 0 });
+            joint.addScale(t, 1.f + t);
+        }
+
+        const auto duration = static_cast<float>(numKeyframes);
+        const auto tickAt = [&](const unsigned i) {
+            // About 3 frames per keyframe, and looping 4 times.
+            return std::fmod(static_cast<float>(i) / 3.f, duration);
+        };
+        const auto numFrames = numKeyframes * 12;
+
+        LookupReport report;
+        dal::KeyframeCursor cursor;
+        glm::vec4 sink{ 0 };
+
+        for ( unsigned i = 0; i < numFrames; ++i ) {
+            const auto error = ::calcMaxError(joint.makeTransform(tickAt(i)), joint.makeTransform(tickAt(i), cursor));
+            report.m_mismatches += error > 0 ? 1 : 0;
+        }
+
+        report.m_search = ::measure([&]() {
+            for ( unsigned i = 0; i < numFrames; ++i ) {
+                sink += joint.makeTransform(tickAt(i))[3];
+            }
+        }) * 1000000.0 / numFrames;
+        report.m_cursor = ::measure([&]() {
+            for ( unsigned i = 0; i < numFrames; ++i ) {
+                sink += joint.makeTransform(tickAt(i), cursor)[3];
+            }
+        }) * 1000000.0 / numFrames;
+
+        // Keeps the compiler from skipping the loops.
+        report.m_mismatches += std::isnan(sink.x) ? 1 : 0;
+        return report;
+    }
+
+
+    bool isSamePose(const dal::LocalPose& a, const dal::LocalPose& b) {
+        for ( size_t i = 0; i < a.size(); ++i ) {
+            if ( a.pos(i) != b.pos(i) || a.rotate(i) != b.rotate(i) || a.scale(i) != b.scale(i) ) {
+                return false;
+            }
+        }
+        return a.size() == b.size();
+    }
+
+    // Milliseconds to sample state NUM_SAMPLES times, a frame apart.
+    double measureState(dal::AnimationState& state, const std::vector<dal::Animation>& anims, const dal::SkeletonInterface& skeleton) {
+        dal::JointTransformArray transforms;
+        return ::measure([&]() {
+            for ( unsigned i = 0; i < NUM_SAMPLES; ++i ) {
+                dal::sampleAnimeState(state, anims, skeleton, static_cast<float>(i) * BENCH_FRAME_SECONDS, transforms, fullLOD);
+            }
+        });
+    }
+
+
+    struct Character {
+        dal::PoseWorkspace m_workspace;
+        dal::JointTransformArray m_transforms;
+    };
+
+    // Characters play the same animation out of phase with each other. Returns milliseconds per frame.
+    double sampleCrowd(std::vector<Character>& crowd, const dal::Animation& anim, const dal::SkeletonInterface& skeleton, dal::WorkerPool* const pool) {
+        const dal::jointModifierRegistry_t noModifiers;
+        const auto duration = anim.getDurationInTick();
+
+        const auto total = ::measure([&]() {
+            for ( unsigned frame = 0; frame < NUM_CROWD_FRAMES; ++frame ) {
+                const auto sampleRange = [&](const size_t begin, const size_t end) {
+                    for ( size_t i = begin; i < end; ++i ) {
+                        const auto tick = std::fmod(static_cast<float>(frame) * 0.5f + static_cast<float>(i) * 0.37f, duration);
+                        anim.sample2(0, tick, skeleton, crowd[i].m_transforms, noModifiers, crowd[i].m_workspace, fullLOD);
+                    }
+                };
+
+                if ( nullptr == pool ) {
+                    sampleRange(0, crowd.size());
+                }
+                else {
+                    pool->parallelFor(crowd.size(), ANIMATION_MIN_RANGE_SIZE, sampleRange);
+                }
+            }
+        });
+
+        return total / NUM_CROWD_FRAMES;
+    }
+
+    // Same crowd as sampleCrowd on a single thread, but each character plays in its own phase. Returns milliseconds per frame.
+    template <typename F>
+    double playCrowd(const float durationSec, F playOne) {
+        const auto total = ::measure([&]() {
+            for ( unsigned frame = 0; frame < NUM_CROWD_FRAMES; ++frame ) {
+                for ( unsigned i = 0; i < BAKED_CROWD_SIZE; ++i ) {
+                    playOne(i, std::fmod(static_cast<float>(frame) * BENCH_FRAME_SECONDS + static_cast<float>(i) * 0.37f, durationSec));
+                }
+            }
+        });
+
+        return total / NUM_CROWD_FRAMES;
+    }
+
+
+#ifdef __glad_h_
+
+    struct SkinningCalls {
+        size_t m_genBuffers = 0, m_deleteBuffers = 0, m_bufferData = 0, m_bufferSubData = 0, m_bindBufferBase = 0, m_uniformMatrix = 0;
+    };
+
+    SkinningCalls g_skinningCalls;
+    GLuint g_nextBuffer = 1;
+
+    void APIENTRY recordGenBuffers(GLsizei n, GLuint* buffers) {
+        ++g_skinningCalls.m_genBuffers;
+        for ( GLsizei i = 0; i < n; ++i ) {
+            buffers[i] = g_nextBuffer++;
+        }
+    }
+    void APIENTRY recordDeleteBuffers(GLsizei, const GLuint*) {
+        ++g_skinningCalls.m_deleteBuffers;
+    }
+    void APIENTRY recordBindBuffer(GLenum, GLuint) {}
+    void APIENTRY recordBufferData(GLenum, GLsizeiptr, const void*, GLenum) {
+        ++g_skinningCalls.m_bufferData;
+    }
+    void APIENTRY recordBufferSubData(GLenum, GLintptr, GLsizeiptr, const void*) {
+        ++g_skinningCalls.m_bufferSubData;
+    }
+    void APIENTRY recordBindBufferBase(GLenum, GLuint, GLuint) {
+        ++g_skinningCalls.m_bindBufferBase;
+    }
+    void APIENTRY recordUniformMatrix4fv(GLint, GLsizei, GLboolean, const GLfloat*) {
+        ++g_skinningCalls.m_uniformMatrix;
+    }
+
+    // Crowd is played as SceneGraph does, which uploads joint transforms after sampling and binds them in every pass.
+    SkinningCalls recordSkinning(const std::vector<dal::Animation>& anims, const dal::SkeletonInterface& skeleton) {
+        glad_glGenBuffers = recordGenBuffers;
+        glad_glDeleteBuffers = recordDeleteBuffers;
+        glad_glBindBuffer = recordBindBuffer;
+        glad_glBufferData = recordBufferData;
+        glad_glBufferSubData = recordBufferSubData;
+        glad_glBindBufferBase = recordBindBufferBase;
+        glad_glUniformMatrix4fv = recordUniformMatrix4fv;
+        g_skinningCalls = SkinningCalls{};
+
+        {
+            std::vector<dal::AnimationState> states(SKINNED_CROWD_SIZE);
+            std::vector<dal::SkinningBuffer> buffers(SKINNED_CROWD_SIZE);
+            for ( auto& state : states ) {
+                state.setSelectedAnimeIndex(static_cast<unsigned>(anims.size() - 1));
+            }
+
+            for ( size_t frame = 0; frame < NUM_SKINNED_FRAMES; ++frame ) {
+                for ( size_t i = 0; i < SKINNED_CROWD_SIZE; ++i ) {
+                    dal::updateAnimeState(states[i], anims, skeleton);
+                    buffers[i].upload(states[i].getTransformArray());
+                }
+
+                for ( size_t pass = 0; pass < NUM_SKINNED_PASSES; ++pass ) {
+                    for ( const auto& buffer : buffers ) {
+                        buffer.bind();
+                    }
+                }
+            }
+        }
+
+        // No context was ever loaded, so they were null before.
+        glad_glGenBuffers = nullptr;
+        glad_glDeleteBuffers = nullptr;
+        glad_glBindBuffer = nullptr;
+        glad_glBufferData = nullptr;
+        glad_glBufferSubData = nullptr;
+        glad_glBindBufferBase = nullptr;
+        glad_glUniformMatrix4fv = nullptr;
+
+        return g_skinningCalls;
+    }
+
+#endif
+
+}
+
+
+int main(int argc, char* args[]) {
+    if ( argc < 2 ) {
+        std::printf("usage: %s <dmd file>\n", args[0]);
+        return 1;
+    }
+
+    const auto buffer = ::readFile(args[1]);
+    dal::ModelLoadInfo info;
+    if ( !dal::parseDalModel(buffer.data(), buffer.size(), info) ) {
+        std::printf("failed to parse model: %s\n", args[1]);
+        return 1;
+    }
+
+    const auto& skeleton = info.m_model.m_joints;
+    const dal::jointModifierRegistry_t noModifiers;
+    std::vector<glm::mat4> boneTransforms, reference;
+    dal::PoseWorkspace workspace;
+    dal::JointTransformArray transforms;
+    size_t mismatches = 0;
+
+    std::printf("joints: %d, max depth: %u\n", skeleton.getSize(), ::calcMaxDepth(skeleton));
+    std::printf("%-24s | %12s %12s %8s | %10s\n", "animation", "chain us", "single us", "speedup", "max error");
+
+    for ( auto& anim : info.m_animations ) {
+        if ( anim.getJoints().size() != static_cast<size_t>(skeleton.getSize()) ) {
+            continue;
+        }
+
+        const auto tickAt = [&](const unsigned i) {
+            return anim.getDurationInTick() * static_cast<float>(i) / static_cast<float>(NUM_SAMPLES);
+        };
+
+        float maxError = 0;
+        for ( unsigned i = 0; i < NUM_SAMPLES; i += NUM_SAMPLES / 100 ) {
+            ::sampleChainWalk(anim, tickAt(i), skeleton, boneTransforms, reference);
+            anim.sample2(0, tickAt(i), skeleton, transforms, noModifiers, workspace, fullLOD);
+            maxError = std::max(maxError, ::calcMaxError(reference, transforms));
+        }
+        mismatches += maxError > MAX_ERROR ? 1 : 0;
+
+        const auto chainTime = ::measure([&]() {
+            for ( unsigned i = 0; i < NUM_SAMPLES; ++i ) {
+                ::sampleChainWalk(anim, tickAt(i), skeleton, boneTransforms, reference);
+            }
+        });
+        const auto singleTime = ::measure([&]() {
+            for ( unsigned i = 0; i < NUM_SAMPLES; ++i ) {
+                anim.sample2(0, tickAt(i), skeleton, transforms, noModifiers, workspace, fullLOD);
+            }
+        });
+
+        std::printf("%-24s | %12.3f %12.3f %7.2fx | %10.2e\n", anim.getName().c_str(),
+            chainTime * 1000.0 / NUM_SAMPLES, singleTime * 1000.0 / NUM_SAMPLES, chainTime / singleTime, maxError);
+    }
+
+    dal::ModelLoadInfo compressedInfo;
+    dal::parseDalModel(buffer.data(), buffer.size(), compressedInfo);
+    size_t totalRaw = 0, totalCompressed = 0;
+    dal::PoseWorkspace compressedWorkspace;
+    dal::JointTransformArray compressedTransforms;
+
+    std::printf("\n%-24s | %12s %12s %8s | %10s\n", "animation", "raw bytes", "packed bytes", "ratio", "pose error");
+
+    for ( size_t i = 0; i < info.m_animations.size(); ++i ) {
+        auto& raw = info.m_animations[i];
+        auto& compressed = compressedInfo.m_animations[i];
+        if ( raw.getJoints().size() != static_cast<size_t>(skeleton.getSize()) ) {
+            continue;
+        }
+
+        compressed.compress(dal::AnimCompressConfig{});
+        totalRaw += raw.calcMemorySize();
+        totalCompressed += compressed.calcMemorySize();
+
+        float maxError = 0;
+        for ( unsigned k = 0; k < NUM_SAMPLES; k += NUM_SAMPLES / 1000 ) {
+            const auto tick = raw.getDurationInTick() * static_cast<float>(k) / static_cast<float>(NUM_SAMPLES);
+            raw.sample2(0, tick, skeleton, transforms, noModifiers, workspace, fullLOD);
+            compressed.sample2(0, tick, skeleton, compressedTransforms, noModifiers, compressedWorkspace, fullLOD);
+
+            for ( dal::jointID_t j = 0; j < skeleton.getSize(); ++j ) {
+                maxError = std::max(maxError, ::calcMaxError(transforms.at(j), compressedTransforms.at(j)));
+            }
+        }
+        mismatches += maxError > MAX_COMPRESSED_POSE_ERROR ? 1 : 0;
+
+        std::printf("%-24s | %12zu %12zu %7.2fx | %10.2e\n", raw.getName().c_str(), raw.calcMemorySize(), compressed.calcMemorySize(),
+            static_cast<double>(raw.calcMemorySize()) / static_cast<double>(std::max<size_t>(1, compressed.calcMemorySize())), maxError);
+    }
+    std::printf("%-24s | %12zu %12zu %7.2fx |\n", "total", totalRaw, totalCompressed,
+        static_cast<double>(totalRaw) / static_cast<double>(std::max<size_t>(1, totalCompressed)));
+
+    if ( !compressedInfo.m_animations.empty() && compressedInfo.m_animations.back().getJoints().size() == static_cast<size_t>(skeleton.getSize()) ) {
+        const auto& anim = compressedInfo.m_animations.back();
+        std::vector<Character> reference(CROWD_SIZE);
+        double serialTime = 0;
+
+        std::printf("\n%-24s | %12s %8s\n", "crowd threads", "frame ms", "speedup");
+
+        for ( const auto numThreads : THREAD_COUNTS ) {
+            std::unique_ptr<dal::WorkerPool> pool;
+            if ( numThreads > 1 ) {
+                pool.reset(new dal::WorkerPool{ numThreads });
+            }
+
+            std::vector<Character> crowd(CROWD_SIZE);
+            const auto frameTime = ::sampleCrowd(crowd, anim, skeleton, pool.get());
+            if ( 1 == numThreads ) {
+                serialTime = frameTime;
+                reference = std::move(crowd);
+            }
+            else {
+                for ( unsigned i = 0; i < CROWD_SIZE; ++i ) {
+                    for ( dal::jointID_t j = 0; j < skeleton.getSize(); ++j ) {
+                        mismatches += reference[i].m_transforms.at(j) == crowd[i].m_transforms.at(j) ? 0 : 1;
+                    }
+                }
+            }
+
+            std::printf("%-24u | %12.3f %7.2fx\n", numThreads, frameTime, serialTime / frameTime);
+        }
+    }
+
+    if ( !compressedInfo.m_animations.empty() && compressedInfo.m_animations.back().getJoints().size() == static_cast<size_t>(skeleton.getSize()) ) {
+        const auto& anim = compressedInfo.m_animations.back();
+        dal::AnimationLOD skipMinor, rootOnly;
+        skipMinor.m_skipMinorJoints = true;
+        rootOnly.m_rootOnly = true;
+        const std::pair<const char*, const dal::AnimationLOD*> levels[] = { { "full", &fullLOD }, { "skip minor", &skipMinor }, { "root only", &rootOnly } };
+        double fullTime = 0;
+
+        std::printf("\n%-24s | %12s %8s | %10s\n", "detail", "sample us", "speedup", "sampled");
+
+        for ( const auto& [name, lod] : levels ) {
+            dal::jointID_t numSampled = 0;
+            const auto time = ::measure([&]() {
+                for ( unsigned i = 0; i < NUM_SAMPLES; ++i ) {
+                    const auto tick = anim.getDurationInTick() * static_cast<float>(i) / static_cast<float>(NUM_SAMPLES);
+                    numSampled = anim.sample2(0, tick, skeleton, transforms, noModifiers, workspace, *lod);
+                }
+            }) * 1000.0 / NUM_SAMPLES;
+            if ( &fullLOD == lod ) {
+                fullTime = time;
+            }
+
+            std::printf("%-24s | %12.3f %7.2fx | %4d / %-3d\n", name, time, fullTime / time, numSampled, skeleton.getSize());
+        }
+    }
+
+    if ( compressedInfo.m_animations.size() >= 3 && compressedInfo.m_animations[2].getJoints().size() == static_cast<size_t>(skeleton.getSize()) ) {
+        const auto& anims = compressedInfo.m_animations;
+        const auto numJoints = static_cast<size_t>(skeleton.getSize());
+
+        dal::AnimationState single, fading, layered;
+        fading.setSelectedAnimeIndex(1);
+        fading.crossFade(0, BENCH_FADE_SECONDS);
+        layered.setSelectedAnimeIndex(1);
+        layered.crossFade(0, BENCH_FADE_SECONDS);
+
+        // Upper half of joints, as if arms were playing a different clip.
+        dal::AnimationLayer layer;
+        layer.m_animIndex = 2;
+        layer.m_mode = dal::BlendMode::additive;
+        layer.m_weight = 0.5f;
+        layer.m_mask.resize(numJoints);
+        for ( size_t i = 0; i < numJoints; ++i ) {
+            layer.m_mask[i] = i < numJoints / 2 ? 1.f : 0.f;
+        }
+        layered.getLayers().push_back(layer);
+
+        const std::pair<const char*, dal::AnimationState*> states[] = { { "single clip", &single }, { "cross-fade", &fading }, { "fade + masked additive", &layered } };
+        double singleTime = 0;
+
+        std::printf("\n%-24s | %12s %8s\n", "blend", "sample us", "cost");
+        for ( const auto& [name, state] : states ) {
+            const auto time = ::measureState(*state, anims, skeleton) * 1000.0 / NUM_SAMPLES;
+            if ( &single == state ) {
+                singleTime = time;
+            }
+            std::printf("%-24s | %12.3f %7.2fx\n", name, time, time / singleTime);
+        }
+
+        dal::LocalPose base, other;
+        std::vector<dal::KeyframeCursor> cursors;
+        anims[0].sampleLocal(0.f, skeleton, base, cursors, fullLOD, false, nullptr);
+        anims[1].sampleLocal(anims[1].getDurationInTick() * 0.5f, skeleton, other, cursors, fullLOD, false, nullptr);
+
+        auto vectorized = base, scalar = base;
+        const auto vectorTime = ::measure([&]() {
+            for ( unsigned i = 0; i < NUM_BLEND_REPEATS; ++i ) {
+                dal::blendPoses(vectorized, other, 0.3f, layer.m_mask.data());
+                dal::addPoses(vectorized, other, base, 0.2f, nullptr);
+            }
+        });
+        const auto scalarTime = ::measure([&]() {
+            for ( unsigned i = 0; i < NUM_BLEND_REPEATS; ++i ) {
+                dal::blendPoses_scalar(scalar, other, 0.3f, layer.m_mask.data());
+                dal::addPoses_scalar(scalar, other, base, 0.2f, nullptr);
+            }
+        });
+        mismatches += ::isSamePose(vectorized, scalar) ? 0 : 1;
+
+        std::printf("%-24s | %12.3f %7.2fx\n", dal::getPoseBlendBackendName(), vectorTime * 1000.0 / NUM_BLEND_REPEATS, scalarTime / vectorTime);
+        std::printf("%-24s | %12.3f\n", "scalar", scalarTime * 1000.0 / NUM_BLEND_REPEATS);
+    }
+
+    if ( !compressedInfo.m_animations.empty() && compressedInfo.m_animations.back().getJoints().size() == static_cast<size_t>(skeleton.getSize()) ) {
+        std::printf("\n%-24s | %8s %10s | %10s %10s\n", "baked", "frames", "bytes", "nearest", "interp");
+
+        std::vector<dal::BakedAnimation> baked(compressedInfo.m_animations.size());
+        for ( size_t i = 0; i < baked.size(); ++i ) {
+            const auto& anim = compressedInfo.m_animations[i];
+            if ( anim.getJoints().size() != static_cast<size_t>(skeleton.getSize()) ) {
+                continue;
+            }
+
+            baked[i].bake(anim, skeleton, BAKE_FRAMES_PER_SEC);
+            std::printf("%-24s | %8u %10zu | %10.2e %10.2e\n", anim.getName().c_str(), baked[i].numFrames(), baked[i].memorySize(),
+                baked[i].maxErrorNearest(), baked[i].maxErrorInterp());
+
+            // The first frame is sampled at 0 seconds, so they must be the same.
+            dal::JointTransformArray first;
+            baked[i].sample(0.f, false, first);
+            anim.sample2(0.f, 0.f, skeleton, transforms, noModifiers, workspace, fullLOD);
+            for ( dal::jointID_t j = 0; j < skeleton.getSize(); ++j ) {
+                mismatches += first.at(j) == transforms.at(j) ? 0 : 1;
+            }
+        }
+
+        const auto& anim = compressedInfo.m_animations.back();
+        const auto& bakedAnim = baked.back();
+        const auto durationSec = anim.getDurationInTick() / anim.getTickPerSec();
+        std::vector<Character> crowd(BAKED_CROWD_SIZE);
+
+        const auto sampledTime = ::playCrowd(durationSec, [&](const unsigned i, const float seconds) {
+            anim.sample2(seconds, anim.calcAnimTick(seconds), skeleton, crowd[i].m_transforms, noModifiers, crowd[i].m_workspace, fullLOD);
+        });
+        const auto nearestTime = ::playCrowd(durationSec, [&](const unsigned i, const float seconds) {
+            bakedAnim.sample(seconds, false, crowd[i].m_transforms);
+        });
+        const auto interpTime = ::playCrowd(durationSec, [&](const unsigned i, const float seconds) {
+            bakedAnim.sample(seconds, true, crowd[i].m_transforms);
+        });
+
+        std::printf("\n%-24s | %12s %8s\n", "baked crowd", "frame ms", "speedup");
+        std::printf("%-24s | %12.3f %7.2fx\n", "sampled", sampledTime, 1.0);
+        std::printf("%-24s | %12.3f %7.2fx\n", "baked nearest", nearestTime, sampledTime / nearestTime);
+        std::printf("%-24s | %12.3f %7.2fx\n", "baked interpolated", interpTime, sampledTime / interpTime);
+    }
+
+#ifdef __glad_h_
+    if ( !compressedInfo.m_animations.empty() && compressedInfo.m_animations.back().getJoints().size() == static_cast<size_t>(skeleton.getSize()) ) {
+        const auto calls = ::recordSkinning(compressedInfo.m_animations, skeleton);
+        const auto numUploads = SKINNED_CROWD_SIZE * NUM_SKINNED_FRAMES;
+        const auto numBinds = numUploads * NUM_SKINNED_PASSES;
+
+        mismatches += SKINNED_CROWD_SIZE == calls.m_genBuffers && SKINNED_CROWD_SIZE == calls.m_bufferData ? 0 : 1;
+        mismatches += SKINNED_CROWD_SIZE == calls.m_deleteBuffers ? 0 : 1;
+        mismatches += numUploads == calls.m_bufferSubData && numBinds == calls.m_bindBufferBase ? 0 : 1;
+        mismatches += 0 == calls.m_uniformMatrix ? 0 : 1;
+
+        std::printf("\n%-24s | %10s %10s\n", "skinning GL calls", "recorded", "expected");
+        std::printf("%-24s | %10zu %10zu\n", "glGenBuffers", calls.m_genBuffers, SKINNED_CROWD_SIZE);
+        std::printf("%-24s | %10zu %10zu\n", "glBufferSubData", calls.m_bufferSubData, numUploads);
+        std::printf("%-24s | %10zu %10zu\n", "glBindBufferBase", calls.m_bindBufferBase, numBinds);
+        std::printf("%-24s | %10zu %10zu\n", "glUniformMatrix4fv", calls.m_uniformMatrix, size_t{ 0 });
+        std::printf("%-24s | %10zu %10zu\n", "glDeleteBuffers", calls.m_deleteBuffers, SKINNED_CROWD_SIZE);
+        // Every joint of every character in every pass, which is what sending them as uniforms used to call.
+        std::printf("%-24s | %10zu\n", "per joint uniforms", numBinds * static_cast<size_t>(skeleton.getSize()));
+    }
+#endif
+
+    std::printf("\n%-24s | %12s %12s\n", "keyframes", "search ns", "cursor ns");
+    for ( const auto numKeyframes : CLIP_LENGTHS ) {
+        const auto report = ::compareKeyframeLookup(numKeyframes);
+        std::printf("%-24u | %12.1f %12.1f\n", numKeyframes, report.m_search, report.m_cursor);
+        mismatches += report.m_mismatches;
+    }
+
+    std::printf("mismatches: %zu\n", mismatches);
+    return 0 == mismatches ? 0 : 2;
+}
@@ -0,0 +1,633 @@
+#include <chrono>
+#include <random>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <d_mapparser.h>
+#include <d_geometrymath.h>
+#include <d_geometrysimd.h>
+#include <d_raybatch.h>
+#include <d_workerpool.h>
+#include <d_frustum.h>
+
+
+// Compares linear scan with BVH on mesh colliders of map chunks.
+// Queries mimic player collision (small boxes) and picking (long segments).
+// Batched triangle kernels are checked against their scalar references, which must match bit by bit.
+// Batched ray casting over whole map is checked against casting rays one by one.
+// Hits exactly at the end of a segment are checked on every path, with and without BVH.
+// Frustum culling of collider boxes from the same cameras is checked against testing boxes one by one.
+
+namespace {
+
+    constexpr unsigned NUM_QUERIES = 2000;
+    // Colliders are in model space and their scale varies a lot, so query sizes are relative to size of collider.
+    const glm::vec3 PLAYER_BOX_RATIO{ 0.03f, 0.1f, 0.03f };
+    constexpr float PICKING_RAY_RATIO = 1.f;
+    // Rays are shot from several camera positions in grids, like picking or visibility queries of many agents.
+    constexpr unsigned NUM_RAY_CAMERAS = 16;
+    constexpr unsigned RAY_GRID_SIZE = 128;
+    // Boxes of a map are few, so each frustum culls them many times to be measurable.
+    constexpr unsigned NUM_CULL_REPEATS = 2000;
+
+
+    struct SoupSet {
+        std::string m_name;
+        dal::TriangleSoup m_linear;
+        dal::TriangleSoup m_bvh;
+    };
+
+    struct Queries {
+        std::vector<dal::AABB> m_boxes;
+        std::vector<dal::Segment> m_segments;
+    };
+
+    std::vector<SoupSet> loadSoups(const std::string& mapDir) {
+        std::vector<SoupSet> result;
+
+        std::error_code err;
+        for ( auto& entry : std::filesystem::directory_iterator{ mapDir, err } ) {
+            if ( entry.path().extension() != ".dmc" ) {
+                continue;
+            }
+
+            std::ifstream file{ entry.path(), std::ios::binary };
+            const std::vector<uint8_t> buffer{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+
+            const auto chunk = dal::parseMapChunk(buffer.data(), buffer.size(), dal::v2::sectionBit(dal::v2::ChunkSection::colliders));
+            if ( !chunk ) {
+                std::printf("failed to parse: %s\n", entry.path().string().c_str());
+                continue;
+            }
+
+            for ( size_t i = 0; i < chunk->m_colliders.size(); ++i ) {
+                auto& collider = chunk->m_colliders[i];
+                if ( !collider.hasMeshCollider() ) {
+                    continue;
+                }
+
+                auto& set = result.emplace_back();
+                set.m_name = entry.path().filename().string() + " #" + std::to_string(i);
+
+                set.m_linear.resize(collider.numTriangles());
+                std::memcpy(set.m_linear.data(), collider.m_triangles.data(), collider.m_triangles.size() * sizeof(float));
+
+                set.m_bvh = set.m_linear;
+                set.m_bvh.buildBVH();
+            }
+        }
+
+        return result;
+    }
+
+    Queries makeQueries(const dal::TriangleSoup& soup, std::mt19937& rng) {
+        glm::vec3 boxMin{ std::numeric_limits<float>::max() }, boxMax{ -std::numeric_limits<float>::max() };
+        for ( auto& tri : soup ) {
+            for ( auto& p : tri.points() ) {
+                boxMin = glm::min(boxMin, p);
+                boxMax = glm::max(boxMax, p);
+            }
+        }
+
+        std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+        const auto randomPoint = [&](void) {
+            return glm::vec3{
+                boxMin.x + (boxMax.x - boxMin.x) * unit(rng),
+                boxMin.y + (boxMax.y - boxMin.y) * unit(rng),
+                boxMin.z + (boxMax.z - boxMin.z) * unit(rng)
+            };
+        };
+
+        const auto diagonal = glm::length(boxMax - boxMin);
+        const auto playerBoxSize = PLAYER_BOX_RATIO * diagonal;
+
+        Queries result;
+
+        for ( unsigned i = 0; i < NUM_QUERIES; ++i ) {
+            const auto center = randomPoint();
+            result.m_boxes.emplace_back(center - playerBoxSize * 0.5f, center + playerBoxSize * 0.5f);
+
+            const auto direc = glm::normalize(glm::vec3{ unit(rng) - 0.5f, unit(rng) - 0.5f, unit(rng) - 0.5f } + glm::vec3{ 0.f, 0.f, 0.001f });
+            result.m_segments.emplace_back(randomPoint(), direc * (PICKING_RAY_RATIO * diagonal));
+        }
+
+        return result;
+    }
+
+    template <typename F>
+    double measure(F func) {
+        const auto before = std::chrono::steady_clock::now();
+        func();
+        const auto after = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(after - before).count();
+    }
+
+
+    struct KernelReport {
+        double m_boxScalar = 0, m_boxBatch = 0, m_segScalar = 0, m_segBatch = 0;
+        size_t m_mismatches = 0;
+    };
+
+    // Runs every query against every triangle without BVH, so that kernels do most of the work.
+    KernelReport compareKernels(const dal::TriangleSoupSoA& soup, const Queries& queries) {
+        const auto numTriangles = static_cast<uint32_t>(soup.getSize());
+        const auto numBatches = (numTriangles + dal::TRI_BATCH_MAX - 1) / dal::TRI_BATCH_MAX;
+
+        KernelReport report;
+        std::vector<uint32_t> boxScalar, boxBatch;
+        std::vector<dal::SegTriBatchResult> segScalar(numBatches), segBatch(numBatches);
+
+        const auto runBox = [&](auto kernel, std::vector<uint32_t>& out) {
+            for ( auto& box : queries.m_boxes ) {
+                for ( uint32_t i = 0; i < numTriangles; i += dal::TRI_BATCH_MAX )
+                    out.push_back(kernel(soup, i, std::min(dal::TRI_BATCH_MAX, numTriangles - i), box));
+            }
+        };
+        const auto runSeg = [&](auto kernel, std::vector<dal::SegTriBatchResult>& out, std::vector<uint32_t>& hashes) {
+            for ( auto& seg : queries.m_segments ) {
+                for ( uint32_t i = 0; i < numTriangles; i += dal::TRI_BATCH_MAX ) {
+                    auto& batch = out[i / dal::TRI_BATCH_MAX];
+                    kernel(soup, i, std::min(dal::TRI_BATCH_MAX, numTriangles - i), seg, false, batch);
+
+                    // Only hit lanes are meaningful, so others are excluded from comparison.
+                    uint32_t hash = batch.m_hitMask ^ (batch.m_frontMask & batch.m_hitMask) * 31;
+                    for ( uint32_t j = 0; j < dal::TRI_BATCH_MAX; ++j ) {
+                        if ( batch.m_hitMask & (1u << j) ) {
+                            uint32_t bits;
+                            std::memcpy(&bits, &batch.m_t[j], sizeof(bits));
+                            hash = hash * 16777619 ^ bits;
+                        }
+                    }
+                    hashes.push_back(hash);
+                }
+            }
+        };
+
+        std::vector<uint32_t> segHashScalar, segHashBatch;
+        report.m_boxScalar = measure([&]() { runBox(dal::intersectTriBoxBatch_scalar, boxScalar); });
+        report.m_boxBatch = measure([&]() { runBox(dal::intersectTriBoxBatch, boxBatch); });
+        report.m_segScalar = measure([&]() { runSeg(dal::intersectSegTriBatch_scalar, segScalar, segHashScalar); });
+        report.m_segBatch = measure([&]() { runSeg(dal::intersectSegTriBatch, segBatch, segHashBatch); });
+
+        for ( size_t i = 0; i < boxScalar.size(); ++i ) {
+            if ( boxScalar[i] != boxBatch[i] )
+                ++report.m_mismatches;
+        }
+
+        // Query boxes against each other in groups of four.
+        for ( size_t i = 0; i + 4 <= queries.m_boxes.size(); i += 4 ) {
+            dal::AABB4 boxes;
+            for ( unsigned j = 0; j < 4; ++j )
+                boxes.set(j, queries.m_boxes[i + j]);
+
+            for ( size_t k = 0; k < queries.m_boxes.size(); k += 97 ) {
+                const auto& other = queries.m_boxes[k];
+                const auto mask = dal::intersectAABB4(boxes, other);
+
+                uint32_t expected = 0;
+                for ( unsigned j = 0; j < 4; ++j )
+                    expected |= (dal::isIntersecting(queries.m_boxes[i + j], other) ? 1u : 0u) << j;
+
+                if ( mask != expected || mask != dal::intersectAABB4_scalar(boxes, other) )
+                    ++report.m_mismatches;
+            }
+        }
+        for ( size_t i = 0; i < segHashScalar.size(); ++i ) {
+            if ( segHashScalar[i] != segHashBatch[i] )
+                ++report.m_mismatches;
+        }
+
+        return report;
+    }
+
+
+
+    // Mesh colliders of all static actors in world space, as MapChunk2 bakes them.
+    struct SceneSoups {
+        std::vector<dal::TriangleSoupSoA> m_soups;
+        dal::BVH m_bvh;
+        dal::AABB m_aabb;
+    };
+
+    SceneSoups loadScene(const std::string& mapDir) {
+        constexpr auto SECTIONS = dal::v2::sectionBit(dal::v2::ChunkSection::actors) | dal::v2::sectionBit(dal::v2::ChunkSection::colliders);
+
+        SceneSoups result;
+
+        std::error_code err;
+        for ( auto& entry : std::filesystem::directory_iterator{ mapDir, err } ) {
+            if ( entry.path().extension() != ".dmc" ) {
+                continue;
+            }
+
+            std::ifstream file{ entry.path(), std::ios::binary };
+            const std::vector<uint8_t> buffer{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+
+            const auto chunk = dal::parseMapChunk(buffer.data(), buffer.size(), SECTIONS);
+            if ( !chunk ) {
+                continue;
+            }
+
+            for ( auto& actor : chunk->m_staticActors ) {
+                if ( dal::v1::StaticActor::ColliderType::mesh != actor.m_colType ) {
+                    continue;
+                }
+                if ( actor.m_modelIndex < 0 || static_cast<size_t>(actor.m_modelIndex) >= chunk->m_colliders.size() ) {
+                    continue;
+                }
+
+                auto& collider = chunk->m_colliders[actor.m_modelIndex];
+                if ( !collider.hasMeshCollider() ) {
+                    continue;
+                }
+
+                dal::TriangleSoup soup;
+                soup.resize(collider.numTriangles());
+                std::memcpy(soup.data(), collider.m_triangles.data(), collider.m_triangles.size() * sizeof(float));
+
+                const auto& trans = actor.m_trans;
+                const auto mat = glm::translate(glm::mat4{ 1 }, trans.m_pos) * glm::mat4_cast(trans.m_quat) * glm::scale(glm::mat4{ 1 }, glm::vec3{ trans.m_scale });
+                result.m_soups.emplace_back(soup, mat);
+            }
+        }
+
+        std::vector<dal::BVH::Bounds> bounds;
+        glm::vec3 sceneMin{ std::numeric_limits<float>::max() }, sceneMax{ -std::numeric_limits<float>::max() };
+        for ( auto& soup : result.m_soups ) {
+            bounds.push_back(dal::BVH::Bounds{ soup.aabb().min(), soup.aabb().max() });
+            sceneMin = glm::min(sceneMin, soup.aabb().min());
+            sceneMax = glm::max(sceneMax, soup.aabb().max());
+        }
+        result.m_aabb = dal::AABB{ sceneMin, sceneMax };
+
+        std::vector<dal::TriangleSoupSoA> sorted;
+        for ( const auto index : result.m_bvh.build(bounds) ) {
+            sorted.push_back(std::move(result.m_soups[index]));
+        }
+        result.m_soups = std::move(sorted);
+
+        return result;
+    }
+
+    // Grids of rays from random points towards random directions, shuffled so that batched path must sort them itself.
+    std::vector<dal::Segment> makeSceneRays(const dal::AABB& aabb, std::mt19937& rng) {
+        std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+        const auto size = aabb.max() - aabb.min();
+        const auto rayLength = glm::length(size) * 0.5f;
+
+        std::vector<dal::Segment> result;
+        result.reserve(NUM_RAY_CAMERAS * RAY_GRID_SIZE * RAY_GRID_SIZE);
+
+        for ( unsigned c = 0; c < NUM_RAY_CAMERAS; ++c ) {
+            const auto origin = aabb.min() + size * glm::vec3{ unit(rng), unit(rng), unit(rng) };
+            const auto forward = glm::normalize(glm::vec3{ unit(rng) - 0.5f, unit(rng) - 0.5f, unit(rng) - 0.5f } + glm::vec3{ 0.f, 0.f, 0.001f });
+            const auto right = glm::normalize(glm::cross(forward, std::abs(forward.y) < 0.99f ? glm::vec3{ 0, 1, 0 } : glm::vec3{ 1, 0, 0 }));
+            const auto up = glm::cross(right, forward);
+
+            for ( unsigned y = 0; y < RAY_GRID_SIZE; ++y ) {
+                for ( unsigned x = 0; x < RAY_GRID_SIZE; ++x ) {
+                    const auto u = static_cast<float>(x) / RAY_GRID_SIZE - 0.5f;
+                    const auto v = static_cast<float>(y) / RAY_GRID_SIZE - 0.5f;
+                    result.emplace_back(origin, glm::normalize(forward + right * u + up * v) * rayLength);
+                }
+            }
+        }
+
+        std::shuffle(result.begin(), result.end(), rng);
+        return result;
+    }
+
+    std::optional<dal::SegIntersecInfo> castSingle(const SceneSoups& scene, const dal::Segment& ray) {
+        std::optional<dal::SegIntersecInfo> result;
+        const auto rayLength = ray.length();
+
+        scene.m_bvh.castSegment(ray.pos(), ray.rel(), [&](const uint32_t first, const uint32_t count, float& tMax) {
+            for ( uint32_t i = first; i < first + count; ++i ) {
+                const auto hit = dal::findIntersection(ray, scene.m_soups[i]);
+                if ( hit && hit->m_distance / rayLength < tMax ) {
+                    tMax = hit->m_distance / rayLength;
+                    result = hit;
+                }
+            }
+            return false;
+        });
+
+        return result;
+    }
+
+    // Same as SceneGraph::castRays with MapChunk2::castRaysToClosest, which need renderer to be constructed.
+    // Param pool may be null for casting on the calling thread only.
+    void castBatched(const SceneSoups& scene, const std::vector<dal::Segment>& rays, std::vector<std::optional<dal::SegIntersecInfo>>& results,
+        dal::WorkerPool* const pool)
+    {
+        std::vector<uint32_t> order;
+        dal::sortSegmentsCoherent(rays.data(), rays.size(), order);
+        results.assign(rays.size(), std::nullopt);
+
+        const auto numPackets = (rays.size() + dal::RAY_PACKET_SIZE - 1) / dal::RAY_PACKET_SIZE;
+
+        const auto castRange = [&](const size_t packetBegin, const size_t packetEnd) {
+            dal::Segment packet[dal::RAY_PACKET_SIZE];
+            std::optional<dal::SegIntersecInfo> packetResults[dal::RAY_PACKET_SIZE];
+            glm::vec3 pos[dal::RAY_PACKET_SIZE], rel[dal::RAY_PACKET_SIZE];
+            float lengths[dal::RAY_PACKET_SIZE], tMax[dal::RAY_PACKET_SIZE];
+
+            for ( size_t p = packetBegin; p < packetEnd; ++p ) {
+                const auto first = p * dal::RAY_PACKET_SIZE;
+                const auto packetSize = static_cast<uint32_t>(std::min<size_t>(dal::RAY_PACKET_SIZE, rays.size() - first));
+
+                for ( uint32_t i = 0; i < packetSize; ++i ) {
+                    packet[i] = rays[order[first + i]];
+                    packetResults[i] = std::nullopt;
+                    pos[i] = packet[i].pos();
+                    rel[i] = packet[i].rel();
+                    lengths[i] = packet[i].length();
+                    tMax[i] = dal::BVH::SEGMENT_T_LIMIT;
+                }
+
+                const auto fullMask = (1u << packetSize) - 1;
+                scene.m_bvh.castSegmentPacket(pos, rel, packetSize, tMax, fullMask, [&](const uint32_t firstSoup, const uint32_t numSoups, const uint32_t rayMask) {
+                    for ( uint32_t s = firstSoup; s < firstSoup + numSoups; ++s ) {
+                        dal::findIntersections(packet, packetSize, rayMask, scene.m_soups[s], packetResults);
+                    }
+                    for ( uint32_t i = 0; i < packetSize; ++i ) {
+                        if ( packetResults[i] )
+                            tMax[i] = std::min(tMax[i], packetResults[i]->m_distance / lengths[i]);
+                    }
+                });
+
+                for ( uint32_t i = 0; i < packetSize; ++i ) {
+                    results[order[first + i]] = packetResults[i];
+                }
+            }
+        };
+
+        if ( nullptr == pool ) {
+            castRange(0, numPackets);
+        }
+        else {
+            pool->parallelFor(numPackets, dal::RAY_PACKET_MIN_RANGE_SIZE, castRange);
+        }
+    }
+
+
+    // Segment ending exactly on a triangle, which every path must report at full length whether BVH was built or not.
+    // Another triangle off the segment keeps BVHs from being a single leaf.
+    size_t checkSegmentEndHits(void) {
+        const dal::Triangle onEnd{ glm::vec3{ -1, -1, 0 }, glm::vec3{ -1, 1, 0 }, glm::vec3{ 1, -1, 0 } };
+        const dal::Triangle offSegment{ glm::vec3{ 9, 9, 5 }, glm::vec3{ 9, 11, 5 }, glm::vec3{ 11, 9, 5 } };
+        const dal::Segment seg{ glm::vec3{ -0.5f, -0.5f, -2 }, glm::vec3{ 0, 0, 2 } };
+        const glm::mat4 identity{ 1 };
+
+        dal::TriangleSoup linear;
+        linear.addTriangle(onEnd);
+        linear.addTriangle(offSegment);
+        auto withBVH = linear;
+        withBVH.buildBVH();
+
+        dal::TriangleSoupSoA linearSoA;
+        linearSoA.addTriangle(onEnd);
+        linearSoA.addTriangle(offSegment);
+        const dal::TriangleSoupSoA soa{ linear, identity };
+
+        SceneSoups scene;
+        scene.m_soups.push_back(soa);
+        scene.m_bvh.build({ dal::BVH::Bounds{ soa.aabb().min(), soa.aabb().max() } });
+
+        std::optional<dal::SegIntersecInfo> linearPacket, packet;
+        dal::findIntersections(&seg, 1, 1, linearSoA, &linearPacket);
+        dal::findIntersections(&seg, 1, 1, soa, &packet);
+
+        std::vector<std::optional<dal::SegIntersecInfo>> batched;
+        castBatched(scene, { seg }, batched, nullptr);
+
+        const std::optional<dal::SegIntersecInfo> hits[] = {
+            dal::findIntersection(seg, linear, identity),
+            dal::findIntersection(seg, withBVH, identity),
+            dal::findIntersection(seg, linearSoA),
+            dal::findIntersection(seg, soa),
+            linearPacket,
+            packet,
+            castSingle(scene, seg),
+            batched[0],
+        };
+
+        size_t result = 0;
+        for ( auto& hit : hits ) {
+            if ( !hit || std::abs(hit->m_distance - seg.length()) > 0.001f ) {
+                ++result;
+            }
+        }
+
+        return result;
+    }
+
+
+    struct CullReport {
+        double m_single = 0, m_scalar = 0, m_batch = 0;
+        size_t m_numTested = 0, m_numVisible = 0, m_mismatches = 0;
+    };
+
+    // Perspective views from random cameras, like main pass, and orthographic views towards the ground, like directional light.
+    CullReport compareCulling(const SceneSoups& scene, std::mt19937& rng) {
+        std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+        const auto size = scene.m_aabb.max() - scene.m_aabb.min();
+        const auto radius = glm::length(size) * 0.5f;
+        const auto center = (scene.m_aabb.min() + scene.m_aabb.max()) * 0.5f;
+
+        dal::AABBArraySoA boxes;
+        for ( auto& soup : scene.m_soups ) {
+            boxes.push_back(soup.aabb());
+        }
+
+        CullReport report;
+        std::vector<uint8_t> visibleScalar, visibleBatch;
+
+        for ( unsigned c = 0; c < NUM_RAY_CAMERAS; ++c ) {
+            const auto origin = scene.m_aabb.min() + size * glm::vec3{ unit(rng), unit(rng), unit(rng) };
+            const auto forward = glm::normalize(glm::vec3{ unit(rng) - 0.5f, unit(rng) - 0.5f, unit(rng) - 0.5f } + glm::vec3{ 0.f, 0.f, 0.001f });
+            const auto isShadow = 1 == c % 2;
+
+            const auto projView = isShadow ?
+                glm::ortho(-radius * 0.5f, radius * 0.5f, -radius * 0.5f, radius * 0.5f, -radius, radius) * glm::lookAt(center, center + glm::vec3{ 0.3f, -1.f, 0.2f }, glm::vec3{ 0, 1, 0 }) :
+                glm::perspective(glm::radians(90.f), 16.f / 9.f, 0.01f, radius) * glm::lookAt(origin, origin + forward, glm::vec3{ 0, 1, 0 });
+            const dal::Frustum frustum{ projView, !isShadow };
+
+            size_t numSingle = 0;
+            report.m_single += measure([&]() {
+                for ( unsigned r = 0; r < NUM_CULL_REPEATS; ++r ) {
+                    numSingle = 0;
+                    for ( auto& soup : scene.m_soups ) {
+                        numSingle += frustum.isIntersecting(soup.aabb()) ? 1 : 0;
+                    }
+                }
+            });
+            report.m_scalar += measure([&]() {
+                for ( unsigned r = 0; r < NUM_CULL_REPEATS; ++r ) {
+                    dal::cullAABBs_scalar(frustum, boxes, visibleScalar);
+                }
+            });
+            size_t numBatch = 0;
+            report.m_batch += measure([&]() {
+                for ( unsigned r = 0; r < NUM_CULL_REPEATS; ++r ) {
+                    numBatch = dal::cullAABBs(frustum, boxes, visibleBatch);
+                }
+            });
+
+            report.m_numTested += boxes.size();
+            report.m_numVisible += numBatch;
+            report.m_mismatches += numSingle == numBatch ? 0 : 1;
+            for ( size_t i = 0; i < boxes.size(); ++i ) {
+                const uint8_t expected = frustum.isIntersecting(scene.m_soups[i].aabb()) ? 1 : 0;
+                report.m_mismatches += expected == visibleScalar[i] && expected == visibleBatch[i] ? 0 : 1;
+            }
+        }
+
+        return report;
+    }
+
+}
+
+
+// Usage: collision_bench <map folder>
+int main(int argc, char* args[]) {
+    if ( argc < 2 ) {
+        std::printf("usage: %s <map folder>\n", args[0]);
+        return 1;
+    }
+
+    const auto soups = loadSoups(args[1]);
+    const glm::mat4 identity{ 1 };
+    std::mt19937 rng{ 1234 };
+
+    double totalLinear[3] = { 0 }, totalBVH[3] = { 0 };
+    size_t mismatches = 0;
+
+    std::printf("%-36s %7s | %10s %10s | %10s %10s | %10s %10s\n", "collider", "tris", "box lin", "box bvh", "ray lin", "ray bvh", "any lin", "any bvh");
+
+    for ( auto& set : soups ) {
+        const auto queries = makeQueries(set.m_linear, rng);
+
+        std::vector<dal::Triangle> trisLinear, trisBVH;
+        std::vector<std::optional<dal::SegIntersecInfo>> hitsLinear, hitsBVH;
+        size_t anyLinear = 0, anyBVH = 0;
+
+        const double timings[6] = {
+            measure([&]() { for ( auto& box : queries.m_boxes ) dal::getIntersectingTriangles(box, set.m_linear, identity, trisLinear); }),
+            measure([&]() { for ( auto& box : queries.m_boxes ) dal::getIntersectingTriangles(box, set.m_bvh, identity, trisBVH); }),
+            measure([&]() { for ( auto& seg : queries.m_segments ) hitsLinear.push_back(dal::findIntersection(seg, set.m_linear, identity)); }),
+            measure([&]() { for ( auto& seg : queries.m_segments ) hitsBVH.push_back(dal::findIntersection(seg, set.m_bvh, identity)); }),
+            measure([&]() { for ( auto& seg : queries.m_segments ) anyLinear += dal::isIntersecting(seg, set.m_linear, identity); }),
+            measure([&]() { for ( auto& seg : queries.m_segments ) anyBVH += dal::isIntersecting(seg, set.m_bvh, identity); }),
+        };
+
+        for ( int i = 0; i < 3; ++i ) {
+            totalLinear[i] += timings[2 * i];
+            totalBVH[i] += timings[2 * i + 1];
+        }
+
+        // Results must be the same regardless of acceleration.
+        if ( trisLinear.size() != trisBVH.size() || anyLinear != anyBVH ) {
+            ++mismatches;
+        }
+        for ( size_t i = 0; i < hitsLinear.size(); ++i ) {
+            if ( hitsLinear[i].has_value() != hitsBVH[i].has_value() ) {
+                ++mismatches;
+            }
+            else if ( hitsLinear[i] && std::abs(hitsLinear[i]->m_distance - hitsBVH[i]->m_distance) > 0.001f ) {
+                ++mismatches;
+            }
+        }
+
+        std::printf(
+            "%-36s %7zu | %8.2fms %8.2fms | %8.2fms %8.2fms | %8.2fms %8.2fms\n",
+            set.m_name.c_str(), set.m_linear.getSize(), timings[0], timings[1], timings[2], timings[3], timings[4], timings[5]
+        );
+    }
+
+    std::printf(
+        "speedup: box %.1fx, closest hit %.1fx, any hit %.1fx, %zu mismatches\n",
+        totalLinear[0] / totalBVH[0], totalLinear[1] / totalBVH[1], totalLinear[2] / totalBVH[2], mismatches
+    );
+
+    std::printf("\nbatched kernels (%s) against scalar reference\n", dal::getTriBatchBackendName());
+    std::printf("%-36s %7s | %10s %10s | %10s %10s | %s\n", "collider", "tris", "box ref", "box simd", "seg ref", "seg simd", "mismatches");
+
+    KernelReport kernelTotal;
+    for ( auto& set : soups ) {
+        const auto queries = makeQueries(set.m_linear, rng);
+        const dal::TriangleSoupSoA soa{ set.m_linear, identity };
+        const auto report = compareKernels(soa, queries);
+
+        kernelTotal.m_boxScalar += report.m_boxScalar;
+        kernelTotal.m_boxBatch += report.m_boxBatch;
+        kernelTotal.m_segScalar += report.m_segScalar;
+        kernelTotal.m_segBatch += report.m_segBatch;
+        kernelTotal.m_mismatches += report.m_mismatches;
+
+        std::printf(
+            "%-36s %7zu | %8.2fms %8.2fms | %8.2fms %8.2fms | %zu\n",
+            set.m_name.c_str(), soa.getSize(), report.m_boxScalar, report.m_boxBatch, report.m_segScalar, report.m_segBatch, report.m_mismatches
+        );
+    }
+    mismatches += kernelTotal.m_mismatches;
+
+    std::printf(
+        "speedup: box %.1fx, segment %.1fx, %zu mismatches\n",
+        kernelTotal.m_boxScalar / kernelTotal.m_boxBatch, kernelTotal.m_segScalar / kernelTotal.m_segBatch, kernelTotal.m_mismatches
+    );
+
+    const auto scene = loadScene(args[1]);
+    const auto rays = makeSceneRays(scene.m_aabb, rng);
+    dal::WorkerPool pool{ std::max(1u, std::thread::hardware_concurrency()) };
+
+    std::vector<std::optional<dal::SegIntersecInfo>> hitsSingle, hitsBatched, hitsThreaded;
+    hitsSingle.reserve(rays.size());
+
+    const auto timeSingle = measure([&]() { for ( auto& ray : rays ) hitsSingle.push_back(castSingle(scene, ray)); });
+    const auto timeBatched = measure([&]() { castBatched(scene, rays, hitsBatched, nullptr); });
+    const auto timeThreaded = measure([&]() { castBatched(scene, rays, hitsThreaded, &pool); });
+
+    size_t rayMismatches = 0, numHits = 0;
+    for ( size_t i = 0; i < rays.size(); ++i ) {
+        numHits += hitsSingle[i].has_value();
+
+        for ( auto other : { &hitsBatched[i], &hitsThreaded[i] } ) {
+            if ( hitsSingle[i].has_value() != other->has_value() )
+                ++rayMismatches;
+            else if ( hitsSingle[i] && std::abs(hitsSingle[i]->m_distance - (*other)->m_distance) > 0.001f )
+                ++rayMismatches;
+        }
+    }
+    mismatches += rayMismatches;
+
+    const auto raysPerSec = [&](const double ms) { return static_cast<double>(rays.size()) / (ms / 1000.0); };
+    std::printf("\nscene rays over %zu mesh colliders, %zu rays, %zu hits\n", scene.m_soups.size(), rays.size(), numHits);
+    std::printf("single    %8.2fms %12.0f rays/s\n", timeSingle, raysPerSec(timeSingle));
+    std::printf("batched   %8.2fms %12.0f rays/s\n", timeBatched, raysPerSec(timeBatched));
+    std::printf("threaded  %8.2fms %12.0f rays/s (%u threads)\n", timeThreaded, raysPerSec(timeThreaded), pool.numThreads());
+    std::printf("%zu mismatches\n", rayMismatches);
+
+    const auto endMismatches = checkSegmentEndHits();
+    mismatches += endMismatches;
+    std::printf("%zu mismatches of hits at segment end\n", endMismatches);
+
+    const auto cull = compareCulling(scene, rng);
+    mismatches += cull.m_mismatches;
+
+    std::printf("\nfrustum culling (%s), %zu boxes tested, %zu visible, %u repeats\n", dal::getFrustumCullBackendName(), cull.m_numTested, cull.m_numVisible, NUM_CULL_REPEATS);
+    std::printf("single    %8.2fms\n", cull.m_single);
+    std::printf("scalar    %8.2fms\n", cull.m_scalar);
+    std::printf("batched   %8.2fms %.1fx\n", cull.m_batch, cull.m_scalar / cull.m_batch);
+    std::printf("%zu mismatches\n", cull.m_mismatches);
+
+    return 0 == mismatches ? 0 : 1;
+}
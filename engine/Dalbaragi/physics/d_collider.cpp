@@ -291,8 +291,10 @@ namespace dal {
             return isIntersecting(seg, newAABB);
         }
         case dal::ColliderType::triangle_soup:
-            assert(false && "Not implemented.");
-            return false;
+        {
+            const auto& soup = reinterpret_cast<const ColTriangleSoup&>(col);
+            return isIntersecting(seg, soup, transCol.getMat());
+        }
         default:
             assert(false && "Unkown collider type code");
             return false;
@@ -369,23 +371,19 @@ namespace dal {
         float maxDist = 0;
         glm::vec3 resolveDirec{ 0 };
 
-        for ( auto& tri : soup ) {
-            const auto newTri = tri.transform(transTwo.getMat());
-            if ( dal::isIntersecting(newTri, newAABB) ) {
-                dal::DebugViewGod::inst().addTriangle(
-                    newTri.point0(), newTri.point1(), newTri.point2(), glm::vec4{ 1, 0.3, 0.3, 0.2 }
-                );
-
-                const auto [dist, direc] = dal::calcIntersectingDepth(newAABB, newTri.plane());
-                if ( dist > maxDist ) {
-                    maxDist = dist;
-                    resolveDirec = direc;
-                }
-            }
-            else {
-                dal::DebugViewGod::inst().addTriangle(
-                    newTri.point0(), newTri.point1(), newTri.point2(), glm::vec4{ 0.3, 0, 0, 0.2 }
-                );
+        static thread_local std::vector<dal::Triangle> triangles;
+        triangles.clear();
+        dal::getIntersectingTriangles(newAABB, soup, transTwo.getMat(), triangles);
+
+        for ( auto& newTri : triangles ) {
+            dal::DebugViewGod::inst().addTriangle(
+                newTri.point0(), newTri.point1(), newTri.point2(), glm::vec4{ 1, 0.3, 0.3, 0.2 }
+            );
+
+            const auto [dist, direc] = dal::calcIntersectingDepth(newAABB, newTri.plane());
+            if ( dist > maxDist ) {
+                maxDist = dist;
+                resolveDirec = direc;
             }
         }
 
@@ -428,8 +426,8 @@ namespace dal {
         }
         case dal::ColliderType::triangle_soup:
         {
-            auto newSoup = reinterpret_cast<const ColTriangleSoup&>(col);
-            return dal::calcCollisionInfo(ray, newSoup, transCol);
+            const auto& soup = reinterpret_cast<const ColTriangleSoup&>(col);
+            return dal::calcCollisionInfo(ray, soup, transCol);
         }
         default:
             assert(false && "Unkown collider type code");
@@ -438,22 +436,8 @@ namespace dal {
         }
     }
 
-    std::optional<RayCastingResult> calcCollisionInfo(const Segment& ray, const ColTriangleSoup triSoup, const Transform& transTriSoup) {
-        std::optional<RayCastingResult> result{ std::nullopt };
-        float leastDistance = std::numeric_limits<float>::max();
-
-        for ( const auto& tri : triSoup ) {
-            const auto newTri = tri.transform(transTriSoup.getMat());
-            const auto info = dal::findIntersection(ray, newTri, triSoup.isFaceCullSet());
-            if ( info ) {
-                if ( info->m_distance < leastDistance ) {
-                    leastDistance = info->m_distance;
-                    result = info;
-                }
-            }
-        }
-
-        return result;
+    std::optional<RayCastingResult> calcCollisionInfo(const Segment& ray, const ColTriangleSoup& triSoup, const Transform& transTriSoup) {
+        return dal::findIntersection(ray, triSoup, transTriSoup.getMat());
     }
 
 }
@@ -173,6 +173,6 @@ namespace dal {
 
     std::optional<RayCastingResult> calcCollisionInfoAbs(const Segment& ray, const ICollider& col, const Transform& transCol);
 
-    std::optional<RayCastingResult> calcCollisionInfo(const Segment& ray, const ColTriangleSoup triSoup, const Transform& transTriSoup);
+    std::optional<RayCastingResult> calcCollisionInfo(const Segment& ray, const ColTriangleSoup& triSoup, const Transform& transTriSoup);
 
 }
@@ -0,0 +1,214 @@
+#include "d_forcebatch.h"
+
+#include <cmath>
+
+#include <d_workerpool.h>
+
+
+namespace {
+
+    using dal::float_t;
+
+    constexpr float_t DRAG_MIN_SPEED = 0.0001;
+
+
+    // Drag force is -(k1 * speed + k2 * speed^2) along velocity, which is the same as -(k1 + k2 * speed) * velocity.
+    float_t calcDragScale(const float_t vx, const float_t vy, const float_t vz, const float_t k1, const float_t k2) {
+        const auto speed = std::sqrt(vx * vx + vy * vy + vz * vz);
+        return speed < DRAG_MIN_SPEED ? float_t{ 0 } : -(k1 + k2 * speed);
+    }
+
+    void applyDragContiguous(const size_t count, const float_t k1, const float_t k2,
+        const float_t* __restrict const vx, const float_t* __restrict const vy, const float_t* __restrict const vz,
+        float_t* __restrict const fx, float_t* __restrict const fy, float_t* __restrict const fz)
+    {
+        for ( size_t i = 0; i < count; ++i ) {
+            const auto scale = ::calcDragScale(vx[i], vy[i], vz[i], k1, k2);
+
+            fx[i] += vx[i] * scale;
+            fy[i] += vy[i] * scale;
+            fz[i] += vz[i] * scale;
+        }
+    }
+
+
+    template <typename G>
+    G& groupOfColor(std::vector<G>& groups, const uint32_t color) {
+        if ( groups.size() <= color ) {
+            groups.resize(color + 1);
+        }
+        return groups[color];
+    }
+
+    // Calls func(group, begin, end) for each group in order of colors. Groups are split over pool except the overflow one.
+    template <typename G, typename F>
+    void forEachGroupRange(const std::vector<G>& groups, dal::WorkerPool* const pool, F&& func) {
+        for ( uint32_t color = 0; color < groups.size(); ++color ) {
+            const auto& group = groups[color];
+            const auto count = group.size();
+
+            if ( nullptr == pool || dal::ConstraintColoring::OVERFLOW_COLOR == color ) {
+                func(group, size_t{ 0 }, count);
+            }
+            else {
+                pool->parallelFor(count, dal::PARTICLE_MIN_RANGE_SIZE, [&](const size_t begin, const size_t end) {
+                    func(group, begin, end);
+                });
+            }
+        }
+    }
+
+}
+
+
+// ConstraintColoring
+namespace dal {
+
+    uint32_t ConstraintColoring::assign(const ParticleStore::id_t particle) {
+        auto& used = this->usedColorsOf(particle);
+        if ( ~uint64_t{ 0 } == used ) {
+            return OVERFLOW_COLOR;
+        }
+
+        uint32_t color = 0;
+        while ( used & (uint64_t{ 1 } << color) ) {
+            ++color;
+        }
+
+        used |= uint64_t{ 1 } << color;
+        return color;
+    }
+
+    uint32_t ConstraintColoring::assign(const ParticleStore::id_t one, const ParticleStore::id_t two) {
+        const auto used = this->usedColorsOf(one) | this->usedColorsOf(two);
+        if ( ~uint64_t{ 0 } == used ) {
+            return OVERFLOW_COLOR;
+        }
+
+        uint32_t color = 0;
+        while ( used & (uint64_t{ 1 } << color) ) {
+            ++color;
+        }
+
+        this->usedColorsOf(one) |= uint64_t{ 1 } << color;
+        this->usedColorsOf(two) |= uint64_t{ 1 } << color;
+        return color;
+    }
+
+    uint64_t& ConstraintColoring::usedColorsOf(const ParticleStore::id_t particle) {
+        if ( this->m_usedColors.size() <= particle ) {
+            this->m_usedColors.resize(particle + 1, 0);
+        }
+        return this->m_usedColors[particle];
+    }
+
+}
+
+
+// GravityBatch
+namespace dal {
+
+    void GravityBatch::add(const ParticleStore::id_t particle, const ParticleGravity& mod) {
+        auto& group = ::groupOfColor(this->m_groups, this->m_coloring.assign(particle));
+        group.m_particles.push_back(particle);
+        group.m_g.push_back(mod.gravityAcc());
+    }
+
+    void GravityBatch::apply(ParticleStore& store, WorkerPool* const pool) const {
+        const auto fy = store.forces(1);
+
+        ::forEachGroupRange(this->m_groups, pool, [&](const Group& group, const size_t begin, const size_t end) {
+            for ( size_t i = begin; i < end; ++i ) {
+                fy[store.indexOf(group.m_particles[i])] -= group.m_g[i];
+            }
+        });
+    }
+
+}
+
+
+// DragBatch
+namespace dal {
+
+    void DragBatch::add(const ParticleStore::id_t particle, const ParticleDrag& mod) {
+        auto& group = ::groupOfColor(this->m_groups, this->m_coloring.assign(particle));
+        group.m_particles.push_back(particle);
+        group.m_k1.push_back(mod.k1());
+        group.m_k2.push_back(mod.k2());
+    }
+
+    void DragBatch::apply(ParticleStore& store, WorkerPool* const pool) const {
+        const auto vx = store.velocities(0), vy = store.velocities(1), vz = store.velocities(2);
+        const auto fx = store.forces(0), fy = store.forces(1), fz = store.forces(2);
+
+        ::forEachGroupRange(this->m_groups, pool, [&](const Group& group, const size_t begin, const size_t end) {
+            for ( size_t i = begin; i < end; ++i ) {
+                const auto p = store.indexOf(group.m_particles[i]);
+                const auto scale = ::calcDragScale(vx[p], vy[p], vz[p], group.m_k1[i], group.m_k2[i]);
+
+                fx[p] += vx[p] * scale;
+                fy[p] += vy[p] * scale;
+                fz[p] += vz[p] * scale;
+            }
+        });
+    }
+
+    void DragBatch::applyToAll(ParticleStore& store, const ParticleDrag& mod, WorkerPool* const pool) {
+        const auto apply = [&](const size_t begin, const size_t end) {
+            ::applyDragContiguous(
+                end - begin, mod.k1(), mod.k2(),
+                store.velocities(0) + begin, store.velocities(1) + begin, store.velocities(2) + begin,
+                store.forces(0) + begin, store.forces(1) + begin, store.forces(2) + begin
+            );
+        };
+
+        if ( nullptr == pool ) {
+            apply(0, store.size());
+        }
+        else {
+            pool->parallelFor(store.size(), PARTICLE_MIN_RANGE_SIZE, apply);
+        }
+    }
+
+}
+
+
+// SpringBatch
+namespace dal {
+
+    void SpringBatch::add(const ParticleStore::id_t fixed, const ParticleStore::id_t moving, const FixedPointSpring& mod) {
+        auto& group = ::groupOfColor(this->m_groups, this->m_coloring.assign(fixed, moving));
+        group.m_fixed.push_back(fixed);
+        group.m_moving.push_back(moving);
+        group.m_springConst.push_back(mod.springConst());
+        group.m_restLen.push_back(mod.restLen());
+    }
+
+    void SpringBatch::apply(ParticleStore& store, WorkerPool* const pool) const {
+        const auto px = store.positions(0), py = store.positions(1), pz = store.positions(2);
+        const auto fx = store.forces(0), fy = store.forces(1), fz = store.forces(2);
+
+        ::forEachGroupRange(this->m_groups, pool, [&](const Group& group, const size_t begin, const size_t end) {
+            for ( size_t i = begin; i < end; ++i ) {
+                const auto a = store.indexOf(group.m_fixed[i]);
+                const auto b = store.indexOf(group.m_moving[i]);
+
+                const auto dx = px[b] - px[a], dy = py[b] - py[a], dz = pz[b] - pz[a];
+                const auto distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+                const auto restLen = group.m_restLen[i];
+
+                // Pulling springs only pull, so they are loose while shorter than rest length.
+                const auto minDistance = this->m_pullingOnly ? restLen : SPRING_MIN_REST_DIST;
+                if ( distance < minDistance || distance < SPRING_MIN_REST_DIST ) {
+                    continue;
+                }
+
+                const auto scale = (restLen - distance) * group.m_springConst[i] / distance;
+                fx[b] += dx * scale;
+                fy[b] += dy * scale;
+                fz[b] += dz * scale;
+            }
+        });
+    }
+
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "d_particle.h"
+#include "d_modifiers.h"
+
+
+namespace dal {
+
+    class WorkerPool;
+
+
+    // Greedy coloring of constraints so that constraints of the same color touch disjoint particles.
+    // Each color can then be applied in parallel without races, and the result doesn't depend on number of threads.
+    class ConstraintColoring {
+
+    public:
+        // Constraints that fit in none of colors get this one, which must be applied by a single thread.
+        static constexpr uint32_t OVERFLOW_COLOR = 64;
+
+    private:
+        // Bit c is set if a constraint of color c touches the particle. Indexed by particle id.
+        std::vector<uint64_t> m_usedColors;
+
+    public:
+        uint32_t assign(const ParticleStore::id_t particle);
+        uint32_t assign(const ParticleStore::id_t one, const ParticleStore::id_t two);
+
+    private:
+        uint64_t& usedColorsOf(const ParticleStore::id_t particle);
+
+    };
+
+}
+
+
+// Built-in modifiers of one type gathered into dense parameter arrays, so that a single loop applies all of them without virtual calls.
+// Particles are referred by ids of ParticleStore. Parameters are grouped by color, and each group is split over pool if one is given.
+namespace dal {
+
+    class GravityBatch {
+
+    private:
+        struct Group {
+            std::vector<ParticleStore::id_t> m_particles;
+            std::vector<float_t> m_g;
+
+            size_t size(void) const {
+                return this->m_particles.size();
+            }
+        };
+
+    private:
+        std::vector<Group> m_groups;
+        ConstraintColoring m_coloring;
+
+    public:
+        void add(const ParticleStore::id_t particle, const ParticleGravity& mod);
+        void apply(ParticleStore& store, WorkerPool* const pool) const;
+
+    };
+
+
+    class DragBatch {
+
+    private:
+        struct Group {
+            std::vector<ParticleStore::id_t> m_particles;
+            std::vector<float_t> m_k1, m_k2;
+
+            size_t size(void) const {
+                return this->m_particles.size();
+            }
+        };
+
+    private:
+        std::vector<Group> m_groups;
+        ConstraintColoring m_coloring;
+
+    public:
+        void add(const ParticleStore::id_t particle, const ParticleDrag& mod);
+        void apply(ParticleStore& store, WorkerPool* const pool) const;
+
+        // Applies the same drag to every particle in the store, which runs over contiguous arrays.
+        static void applyToAll(ParticleStore& store, const ParticleDrag& mod, WorkerPool* const pool);
+
+    };
+
+
+    // Either FixedPointSpring or FixedPointSpringPulling, selected on construction.
+    class SpringBatch {
+
+    private:
+        struct Group {
+            std::vector<ParticleStore::id_t> m_fixed, m_moving;
+            std::vector<float_t> m_springConst, m_restLen;
+
+            size_t size(void) const {
+                return this->m_fixed.size();
+            }
+        };
+
+    private:
+        std::vector<Group> m_groups;
+        ConstraintColoring m_coloring;
+        bool m_pullingOnly;
+
+    public:
+        SpringBatch(const bool pullingOnly)
+            : m_pullingOnly(pullingOnly)
+        {
+
+        }
+
+        void add(const ParticleStore::id_t fixed, const ParticleStore::id_t moving, const FixedPointSpring& mod);
+        void apply(ParticleStore& store, WorkerPool* const pool) const;
+
+    };
+
+}
@@ -41,9 +41,6 @@ namespace dal {
 
 namespace dal {
 
-    constexpr float_t SPRING_MIN_REST_DIST = 0.001;
-
-
     FixedPointSpring::FixedPointSpring(void)
         : m_springConst(5)
         , m_restLen(2)
@@ -59,7 +56,7 @@ namespace dal {
     }
 
     void FixedPointSpring::apply(const float_t deltaTime, PositionParticle& fixed, PositionParticle& moving) {
-        const auto fixedToMoving = moving.m_pos - fixed.m_pos;
+        const auto fixedToMoving = moving.pos() - fixed.pos();
         const auto distance = glm::length(fixedToMoving);
         if ( distance < SPRING_MIN_REST_DIST ) return;
 
@@ -72,7 +69,7 @@ namespace dal {
     void FixedPointSpringPulling::apply(const float_t deltaTime, PositionParticle& fixed, PositionParticle& moving) {
         assert(this->m_restLen >= SPRING_MIN_REST_DIST);
 
-        const auto fixedToMoving = moving.m_pos - fixed.m_pos;
+        const auto fixedToMoving = moving.pos() - fixed.pos();
         const auto distance = glm::length(fixedToMoving);
         if ( distance < this->m_restLen ) return;
 
@@ -5,6 +5,9 @@
 
 namespace dal {
 
+    constexpr float_t SPRING_MIN_REST_DIST = 0.001;
+
+
     class ParticleGravity : public UnaryPhyModifier {
 
     private:
@@ -14,6 +17,10 @@ namespace dal {
         ParticleGravity(void);
         ParticleGravity(const float_t gravityAcc);
 
+        float_t gravityAcc(void) const {
+            return this->m_g;
+        }
+
         virtual void apply(const float_t deltaTime, PositionParticle& particle) override;
 
     };
@@ -25,6 +32,14 @@ namespace dal {
 
     public:
         ParticleDrag(void);
+
+        float_t k1(void) const {
+            return this->m_k1;
+        }
+        float_t k2(void) const {
+            return this->m_k2;
+        }
+
         virtual void apply(const float_t deltaTime, PositionParticle& particle) override;
 
     };
@@ -39,6 +54,13 @@ namespace dal {
         FixedPointSpring(void);
         FixedPointSpring(float_t springConst, float_t restLen);
 
+        float_t springConst(void) const {
+            return this->m_springConst;
+        }
+        float_t restLen(void) const {
+            return this->m_restLen;
+        }
+
         virtual void apply(const float_t deltaTime, PositionParticle& fixed, PositionParticle& moving) override;
 
     };
@@ -2,6 +2,8 @@
 
 #include <cassert>
 
+#include <d_workerpool.h>
+
 
 // MassValue
 namespace dal {
@@ -31,36 +33,168 @@ namespace dal {
 }
 
 
-namespace dal {
+namespace {
+
+    using dal::float_t;
 
     constexpr float_t FREEZE_SPEED_THRESHOLD = 0.2;
+    constexpr float_t DEFAULT_DAMPING = 0.9;
 
 
-    PositionParticle::PositionParticle(void) 
-        : m_mass(1)
-        , m_damping(0.9)
+    // Velocity is updated first, and position moves with the new one.
+    void integrateSemiImplicitEuler(const size_t count, const float_t dt,
+        const float_t* __restrict const massInv, const float_t* __restrict const dampingFactor,
+        float_t* __restrict const px, float_t* __restrict const py, float_t* __restrict const pz,
+        float_t* __restrict const vx, float_t* __restrict const vy, float_t* __restrict const vz,
+        float_t* __restrict const fx, float_t* __restrict const fy, float_t* __restrict const fz)
     {
+        constexpr float_t FREEZE_SPEED_SQR = FREEZE_SPEED_THRESHOLD * FREEZE_SPEED_THRESHOLD;
+        constexpr float_t ZERO = 0, ONE = 1;
+
+        for ( size_t i = 0; i < count; ++i ) {
+            const auto w = massInv[i];
+            const auto damp = dampingFactor[i];
+
+            const auto nx = (vx[i] + fx[i] * w * dt) * damp;
+            const auto ny = (vy[i] + fy[i] * w * dt) * damp;
+            const auto nz = (vz[i] + fz[i] * w * dt) * damp;
+
+            // Selected by multiplying with 0 or 1 rather than branching. Infinite mass keeps velocity and doesn't move.
+            const float_t movable = w > ZERO ? ONE : ZERO;
+            const float_t keepNew = nx * nx + ny * ny + nz * nz < FREEZE_SPEED_SQR ? ZERO : movable;
+            const float_t keepOld = ONE - movable;
 
+            vx[i] = nx * keepNew + vx[i] * keepOld;
+            vy[i] = ny * keepNew + vy[i] * keepOld;
+            vz[i] = nz * keepNew + vz[i] * keepOld;
+
+            px[i] += vx[i] * (dt * movable);
+            py[i] += vy[i] * (dt * movable);
+            pz[i] += vz[i] * (dt * movable);
+
+            fx[i] = ZERO;
+            fy[i] = ZERO;
+            fz[i] = ZERO;
+        }
     }
 
-    void PositionParticle::addForce(const vec3_t force) {
-        this->m_forceAccum += force;
+}
+
+
+// ParticleStore
+namespace dal {
+
+    ParticleStore::id_t ParticleStore::add(void) {
+        id_t id;
+        if ( this->m_freeIDs.empty() ) {
+            id = static_cast<id_t>(this->m_indices.size());
+            this->m_indices.push_back(NULL_INDEX);
+        }
+        else {
+            id = this->m_freeIDs.back();
+            this->m_freeIDs.pop_back();
+        }
+
+        this->m_indices[id] = this->size();
+        this->m_ids.push_back(id);
+
+        this->forEachArray([](std::vector<float_t>& x) { x.push_back(0); });
+        this->m_massInv.back() = 1;
+        this->m_damping.back() = DEFAULT_DAMPING;
+        this->m_dampingFactor.back() = dal::pow(DEFAULT_DAMPING, this->m_dampingFactorDt);
+
+        return id;
     }
 
-    void PositionParticle::integrate(const float_t deltaTime) {
-        if ( this->m_mass.isInfinie() ) return;
+    void ParticleStore::remove(const id_t id) {
+        const auto index = this->indexOf(id);
+        const auto last = this->size() - 1;
+
+        // Last one fills the hole so that arrays stay dense.
+        this->forEachArray([index, last](std::vector<float_t>& x) {
+            x[index] = x[last];
+            x.pop_back();
+        });
 
-        this->m_pos += this->m_vel * deltaTime;
+        this->m_ids[index] = this->m_ids[last];
+        this->m_ids.pop_back();
+        if ( index != last ) {
+            this->m_indices[this->m_ids[index]] = index;
+        }
 
-        const auto acc = this->m_acc + this->m_forceAccum * this->m_mass.getMassInv();
+        this->m_indices[id] = NULL_INDEX;
+        this->m_freeIDs.push_back(id);
+    }
 
-        this->m_vel += acc * deltaTime;
-        this->m_vel *= dal::pow(this->m_damping, deltaTime);
-        if ( glm::length(this->m_vel) < FREEZE_SPEED_THRESHOLD ) {
-            this->m_vel = vec3_t{ 0 };
+    uint32_t ParticleStore::indexOf(const id_t id) const {
+        assert(this->has(id));
+        return this->m_indices[id];
+    }
+
+    vec3_t ParticleStore::pos(const uint32_t index) const {
+        return vec3_t{ this->m_pos[0][index], this->m_pos[1][index], this->m_pos[2][index] };
+    }
+
+    void ParticleStore::setPos(const uint32_t index, const vec3_t& v) {
+        for ( unsigned i = 0; i < 3; ++i ) {
+            this->m_pos[i][index] = v[i];
+        }
+    }
+
+    vec3_t ParticleStore::velocity(const uint32_t index) const {
+        return vec3_t{ this->m_vel[0][index], this->m_vel[1][index], this->m_vel[2][index] };
+    }
+
+    void ParticleStore::setVelocity(const uint32_t index, const vec3_t& v) {
+        for ( unsigned i = 0; i < 3; ++i ) {
+            this->m_vel[i][index] = v[i];
+        }
+    }
+
+    void ParticleStore::addForce(const uint32_t index, const vec3_t& force) {
+        for ( unsigned i = 0; i < 3; ++i ) {
+            this->m_force[i][index] += force[i];
         }
+    }
 
-        this->m_forceAccum = vec3_t{ 0 };
+    MassValue ParticleStore::mass(const uint32_t index) const {
+        MassValue result;
+        result.setMassInv(this->m_massInv[index]);
+        return result;
+    }
+
+    void ParticleStore::setMass(const uint32_t index, const MassValue& mass) {
+        this->m_massInv[index] = mass.getMassInv();
+    }
+
+    void ParticleStore::setDamping(const uint32_t index, const float_t damping) {
+        this->m_damping[index] = damping;
+        this->m_dampingFactor[index] = dal::pow(damping, this->m_dampingFactorDt);
+    }
+
+    void ParticleStore::integrate(const float_t deltaTime, WorkerPool* const pool) {
+        if ( deltaTime != this->m_dampingFactorDt ) {
+            this->m_dampingFactorDt = deltaTime;
+            for ( size_t i = 0; i < this->m_damping.size(); ++i ) {
+                this->m_dampingFactor[i] = dal::pow(this->m_damping[i], deltaTime);
+            }
+        }
+
+        const auto integrateRange = [this, deltaTime](const size_t begin, const size_t end) {
+            ::integrateSemiImplicitEuler(
+                end - begin, deltaTime, this->m_massInv.data() + begin, this->m_dampingFactor.data() + begin,
+                this->m_pos[0].data() + begin, this->m_pos[1].data() + begin, this->m_pos[2].data() + begin,
+                this->m_vel[0].data() + begin, this->m_vel[1].data() + begin, this->m_vel[2].data() + begin,
+                this->m_force[0].data() + begin, this->m_force[1].data() + begin, this->m_force[2].data() + begin
+            );
+        };
+
+        if ( nullptr == pool ) {
+            integrateRange(0, this->size());
+        }
+        else {
+            pool->parallelFor(this->size(), PARTICLE_MIN_RANGE_SIZE, integrateRange);
+        }
     }
 
 }
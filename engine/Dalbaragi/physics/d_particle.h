@@ -1,5 +1,8 @@
 #pragma once
 
+#include <vector>
+#include <limits>
+#include <cstdint>
 #include <optional>
 
 #include "d_precision.h"
@@ -7,6 +10,13 @@
 
 namespace dal {
 
+    class WorkerPool;
+
+
+    // Loops over particles are not split into ranges smaller than this, since thread synchronization would cost more.
+    constexpr size_t PARTICLE_MIN_RANGE_SIZE = 1024;
+
+
     class MassValue {
 
     private:
@@ -31,25 +41,130 @@ namespace dal {
     };
 
 
-    class PositionParticle {
+    // Particles in structure of arrays layout, so that per step work runs over contiguous arrays of each attribute.
+    // Particles are referred by ids, which stay valid until removed. Indices into arrays change when others are removed.
+    // Kernels over these and other physics arrays take each one as a __restrict pointer, since they never overlap,
+    // and keep loop bodies free of branches and calls that are not inlined, so that compilers can vectorize them.
+    class ParticleStore {
+
+    public:
+        using id_t = uint32_t;
+
+        static constexpr uint32_t NULL_INDEX = std::numeric_limits<uint32_t>::max();
+
+    private:
+        std::vector<float_t> m_pos[3], m_vel[3], m_force[3];
+        std::vector<float_t> m_massInv, m_damping;
+        // damping ^ delta time, which only changes when delta time does.
+        std::vector<float_t> m_dampingFactor;
+        float_t m_dampingFactorDt = 0;
+
+        std::vector<id_t> m_ids;
+        // Index of each id, or NULL_INDEX if id is free.
+        std::vector<uint32_t> m_indices;
+        std::vector<id_t> m_freeIDs;
 
     public:
-        vec3_t m_pos{};
-        MassValue m_mass;
-        float_t m_damping;
+        id_t add(void);
+        void remove(const id_t id);
+
+        bool has(const id_t id) const {
+            return id < this->m_indices.size() && NULL_INDEX != this->m_indices[id];
+        }
+        uint32_t indexOf(const id_t id) const;
+        id_t idOf(const uint32_t index) const {
+            return this->m_ids[index];
+        }
+        uint32_t size(void) const {
+            return static_cast<uint32_t>(this->m_ids.size());
+        }
+        // Every id in use is less than this.
+        uint32_t idCapacity(void) const {
+            return static_cast<uint32_t>(this->m_indices.size());
+        }
+
+        vec3_t pos(const uint32_t index) const;
+        void setPos(const uint32_t index, const vec3_t& v);
+        vec3_t velocity(const uint32_t index) const;
+        void setVelocity(const uint32_t index, const vec3_t& v);
+        void addForce(const uint32_t index, const vec3_t& force);
+
+        MassValue mass(const uint32_t index) const;
+        void setMass(const uint32_t index, const MassValue& mass);
+        float_t damping(const uint32_t index) const {
+            return this->m_damping[index];
+        }
+        void setDamping(const uint32_t index, const float_t damping);
+
+        const float_t* positions(const unsigned axis) const {
+            return this->m_pos[axis].data();
+        }
+        const float_t* velocities(const unsigned axis) const {
+            return this->m_vel[axis].data();
+        }
+        float_t* forces(const unsigned axis) {
+            return this->m_force[axis].data();
+        }
+
+        // Semi-implicit Euler over every particle, then forces are cleared. Particles with infinite mass don't move.
+        // Particles are split over pool if one is given.
+        void integrate(const float_t deltaTime, WorkerPool* const pool = nullptr);
+
+    private:
+        template <typename F>
+        void forEachArray(F&& func) {
+            for ( auto& x : this->m_pos ) func(x);
+            for ( auto& x : this->m_vel ) func(x);
+            for ( auto& x : this->m_force ) func(x);
+            func(this->m_massInv);
+            func(this->m_damping);
+            func(this->m_dampingFactor);
+        }
+
+    };
+
+
+    // Accessor to a particle in ParticleStore. Valid until a particle is added to or removed from the store.
+    class PositionParticle {
 
     private:
-        vec3_t m_vel{}, m_acc{}, m_forceAccum{};
+        ParticleStore& m_store;
+        uint32_t m_index;
 
     public:
-        PositionParticle(void);
+        PositionParticle(ParticleStore& store, const uint32_t index)
+            : m_store(store)
+            , m_index(index)
+        {
 
-        const vec3_t& velocity(void) const {
-            return this->m_vel;
         }
 
-        void addForce(const vec3_t force);
-        void integrate(const float_t deltaTime);
+        vec3_t pos(void) const {
+            return this->m_store.pos(this->m_index);
+        }
+        void setPos(const vec3_t& v) {
+            this->m_store.setPos(this->m_index, v);
+        }
+        vec3_t velocity(void) const {
+            return this->m_store.velocity(this->m_index);
+        }
+
+        MassValue mass(void) const {
+            return this->m_store.mass(this->m_index);
+        }
+        void setMass(const MassValue& mass) {
+            this->m_store.setMass(this->m_index, mass);
+        }
+        float_t damping(void) const {
+            return this->m_store.damping(this->m_index);
+        }
+        void setDamping(const float_t damping) {
+            this->m_store.setDamping(this->m_index, damping);
+        }
+
+        void addForce(const vec3_t force) {
+            this->m_store.addForce(this->m_index, force);
+        }
 
     };
 
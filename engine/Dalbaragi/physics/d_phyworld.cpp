@@ -1,5 +1,8 @@
 #include "d_phyworld.h"
 
+#include <typeinfo>
+#include <algorithm>
+
 #include "d_modifiers.h"
 
 
@@ -19,81 +22,238 @@ namespace dal {
 
 namespace dal {
 
+    PhysicsWorld::PhysicsWorld(void) = default;
+
+    PhysicsWorld::~PhysicsWorld(void) {
+        this->stopThread();
+    }
+
     void PhysicsWorld::update(const float_t deltaTime) {
+        if ( this->isThreadRunning() ) {
+            return;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+
 #if DAL_USE_FIXED_DT
-        constexpr float_t dt = FIXED_DELTA_TIME;
+        // Time beyond this many steps is dropped rather than caught up on, or a slow frame would make next ones slower.
+        constexpr unsigned MAX_STEPS_PER_UPDATE = 4;
 
         this->m_dtAccum += deltaTime;
-        if ( this->m_dtAccum < FIXED_DELTA_TIME ) {
-            return;
-        }
-        else {
-            this->m_dtAccum = 0;
+        for ( unsigned i = 0; this->m_dtAccum >= FIXED_DELTA_TIME; ++i ) {
+            if ( i >= MAX_STEPS_PER_UPDATE ) {
+                this->m_dtAccum = 0;
+                break;
+            }
+
+            this->step(FIXED_DELTA_TIME, now);
+            this->m_dtAccum -= FIXED_DELTA_TIME;
         }
 #else
-        const float_t dt = deltaTime;
+        this->step(deltaTime, now);
 #endif
+    }
 
-        auto particleView = this->m_reg.view<PositionParticle>();
+    void PhysicsWorld::step(const float_t dt, const std::chrono::steady_clock::time_point time) {
+        std::lock_guard<std::recursive_mutex> lck{ this->m_worldMut };
+        const auto pool = this->m_workers;
 
         // Apply modifiers
         {
+            this->m_gravities.apply(this->m_particles, pool);
+            this->m_drags.apply(this->m_particles, pool);
+
             for ( auto& [modifier, entity] : this->m_unaryMod ) {
-                auto& particle = this->m_reg.get<PositionParticle>(entity);
+                auto particle = this->getParticleOf(entity);
                 modifier->apply(dt, particle);
             }
 
+            this->m_springs.apply(this->m_particles, pool);
+            this->m_pullingSprings.apply(this->m_particles, pool);
+
             for ( auto& [modifier, entities] : this->m_binaryMod ) {
-                auto& one = this->m_reg.get<PositionParticle>(entities.first);
-                auto& two = this->m_reg.get<PositionParticle>(entities.second);
+                auto one = this->getParticleOf(entities.first);
+                auto two = this->getParticleOf(entities.second);
                 modifier->apply(dt, one, two);
             }
 
-            static ParticleDrag drag;
-            for ( const auto entity : particleView ) {
-                auto& particle = particleView.get(entity);
-                drag.apply(dt, particle);
-            }
+            DragBatch::applyToAll(this->m_particles, this->m_airDrag, pool);
         }
 
         // Integrate
         {
-            for ( const auto entity : particleView ) {
-                auto& particle = particleView.get(entity);
-                particle.integrate(dt);
+            this->m_particles.integrate(dt, pool);
+        }
+
+        this->publishSnapshot(time);
+    }
+
+    void PhysicsWorld::publishSnapshot(const std::chrono::steady_clock::time_point time) {
+        auto& spare = this->m_spareState;
+        spare.m_pos.resize(this->m_particles.idCapacity());
+        for ( uint32_t i = 0; i < this->m_particles.size(); ++i ) {
+            spare.m_pos[this->m_particles.idOf(i)] = this->m_particles.pos(i);
+        }
+        spare.m_time = time;
+
+        std::lock_guard<std::mutex> lck{ this->m_snapshotMut };
+        std::swap(this->m_prevState, this->m_currState);
+        std::swap(this->m_currState, spare);
+    }
+
+    float_t PhysicsWorld::interpolationFactor(void) const {
+        if ( this->isThreadRunning() ) {
+            const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->m_currState.m_time).count();
+            return std::min<float_t>(1, std::max<float_t>(0, static_cast<float_t>(elapsed) / FIXED_DELTA_TIME));
+        }
+
+#if DAL_USE_FIXED_DT
+        return std::min<float_t>(1, this->m_dtAccum / FIXED_DELTA_TIME);
+#else
+        return 1;
+#endif
+    }
+
+    void PhysicsWorld::startThread(void) {
+        if ( this->isThreadRunning() ) {
+            return;
+        }
+
+        this->m_flagExit = false;
+        this->m_thread = std::thread{ [this](void) { this->threadMain(); } };
+    }
+
+    void PhysicsWorld::stopThread(void) {
+        if ( !this->isThreadRunning() ) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lck{ this->m_threadMut };
+            this->m_flagExit = true;
+        }
+        this->m_threadCond.notify_all();
+        this->m_thread.join();
+
+#if DAL_USE_FIXED_DT
+        this->m_dtAccum = 0;
+#endif
+    }
+
+    void PhysicsWorld::threadMain(void) {
+        // Steps falling behind by more than this many are skipped, like update drops time.
+        constexpr unsigned MAX_STEPS_BEHIND = 4;
+
+        const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(FIXED_DELTA_TIME));
+        auto nextStep = std::chrono::steady_clock::now() + period;
+
+        while ( true ) {
+            {
+                std::unique_lock<std::mutex> lck{ this->m_threadMut };
+                if ( this->m_threadCond.wait_until(lck, nextStep, [this](void) { return this->m_flagExit; }) ) {
+                    return;
+                }
+            }
+
+            this->step(FIXED_DELTA_TIME, nextStep);
+
+            nextStep += period;
+            const auto now = std::chrono::steady_clock::now();
+            if ( now - nextStep > period * MAX_STEPS_BEHIND ) {
+                nextStep = now;
             }
         }
     }
 
+    void PhysicsWorld::setWorkerPool(WorkerPool* const pool) {
+        std::lock_guard<std::recursive_mutex> lck{ this->m_worldMut };
+        this->m_workers = pool;
+    }
+
     PhysicsEntity PhysicsWorld::newEntity(void) {
+        std::lock_guard<std::recursive_mutex> lck{ this->m_worldMut };
         return PhysicsEntity{ this->m_reg.create() };
     }
 
     void PhysicsWorld::buildParticle(const PhysicsEntity& entity) {
-        auto& posparticle = this->m_reg.assign<PositionParticle>(entity.get());
+        std::lock_guard<std::recursive_mutex> lck{ this->m_worldMut };
+        this->m_reg.assign<ParticleRef>(entity.get(), this->m_particles.add());
     }
 
-    PositionParticle* PhysicsWorld::tryParticleOf(const PhysicsEntity& entity) {
-        if ( this->m_reg.has<PositionParticle>(entity.get()) ) {
-            return &this->m_reg.get<PositionParticle>(entity.get());
+    std::optional<PositionParticle> PhysicsWorld::tryParticleOf(const PhysicsEntity& entity) {
+        std::lock_guard<std::recursive_mutex> lck{ this->m_worldMut };
+        if ( this->m_reg.has<ParticleRef>(entity.get()) ) {
+            const auto id = this->m_reg.get<ParticleRef>(entity.get()).m_id;
+            return PositionParticle{ this->m_particles, this->m_particles.indexOf(id) };
         }
         else {
-            return nullptr;
+            return std::nullopt;
         }
     }
 
-    PositionParticle& PhysicsWorld::getParticleOf(const PhysicsEntity& entity) {
+    PositionParticle PhysicsWorld::getParticleOf(const PhysicsEntity& entity) {
         auto result = this->tryParticleOf(entity);
-        assert(nullptr != result);
+        assert(result.has_value());
         return *result;
     }
 
+    std::optional<vec3_t> PhysicsWorld::renderPos(const PhysicsEntity& entity) const {
+        // Registry is only written by the main thread, which is the one calling this.
+        if ( !this->m_reg.has<ParticleRef>(entity.get()) ) {
+            return std::nullopt;
+        }
+        const auto id = this->m_reg.get<ParticleRef>(entity.get()).m_id;
+
+        {
+            std::lock_guard<std::mutex> lck{ this->m_snapshotMut };
+            const auto& curr = this->m_currState.m_pos;
+            const auto& prev = this->m_prevState.m_pos;
+
+            if ( id < prev.size() ) {
+                return glm::mix(prev[id], curr[id], this->interpolationFactor());
+            }
+            else if ( id < curr.size() ) {
+                return curr[id];
+            }
+        }
+
+        // Particles added after the last step are in no snapshot yet.
+        std::lock_guard<std::recursive_mutex> lck{ this->m_worldMut };
+        return this->m_particles.pos(this->m_particles.indexOf(id));
+    }
+
     void PhysicsWorld::registerUnaryMod(std::shared_ptr<UnaryPhyModifier> mod, const PhysicsEntity& particle) {
-        this->m_unaryMod.emplace_back(mod, particle.get());
+        std::lock_guard<std::recursive_mutex> lck{ this->m_worldMut };
+        const auto id = this->m_reg.get<ParticleRef>(particle.get()).m_id;
+
+        // Exact types are compared so that classes derived from built-in ones still get their own apply called.
+        const auto& type = typeid(*mod);
+        if ( typeid(ParticleGravity) == type ) {
+            this->m_gravities.add(id, static_cast<const ParticleGravity&>(*mod));
+        }
+        else if ( typeid(ParticleDrag) == type ) {
+            this->m_drags.add(id, static_cast<const ParticleDrag&>(*mod));
+        }
+        else {
+            this->m_unaryMod.emplace_back(mod, particle.get());
+        }
     }
 
     void PhysicsWorld::registerBinaryMod(std::shared_ptr<BinaryPhyModifier> mod, const PhysicsEntity& one, const PhysicsEntity& two) {
-        this->m_binaryMod.emplace_back(mod, std::pair(one.get(), two.get()));
+        std::lock_guard<std::recursive_mutex> lck{ this->m_worldMut };
+        const auto idOne = this->m_reg.get<ParticleRef>(one.get()).m_id;
+        const auto idTwo = this->m_reg.get<ParticleRef>(two.get()).m_id;
+
+        const auto& type = typeid(*mod);
+        if ( typeid(FixedPointSpring) == type ) {
+            this->m_springs.add(idOne, idTwo, static_cast<const FixedPointSpring&>(*mod));
+        }
+        else if ( typeid(FixedPointSpringPulling) == type ) {
+            this->m_pullingSprings.add(idOne, idTwo, static_cast<const FixedPointSpring&>(*mod));
+        }
+        else {
+            this->m_binaryMod.emplace_back(mod, std::pair(one.get(), two.get()));
+        }
     }
 
 }
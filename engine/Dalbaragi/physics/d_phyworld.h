@@ -1,12 +1,17 @@
 #pragma once
 
+#include <mutex>
+#include <chrono>
+#include <thread>
 #include <vector>
 #include <memory>
 #include <optional>
+#include <condition_variable>
 
 #include <entt/entity/registry.hpp>
 
 #include "d_particle.h"
+#include "d_forcebatch.h"
 #include "d_modifierabc.h"
 
 
@@ -38,22 +43,79 @@ namespace dal {
     class PhysicsWorld {
 
     private:
+        // Component binding a physics entity to a particle in m_particles.
+        struct ParticleRef {
+            ParticleStore::id_t m_id;
+        };
+
+        // Positions of particles after a step, indexed by particle id.
+        struct Snapshot {
+            std::vector<vec3_t> m_pos;
+            std::chrono::steady_clock::time_point m_time;
+        };
+
         using unaryModPair_t = std::pair< std::shared_ptr<UnaryPhyModifier>, entt::entity >;
         using binaryModPair_t = std::pair< std::shared_ptr<BinaryPhyModifier>, std::pair<entt::entity, entt::entity> >;
 
     private:
         entt::registry m_reg;
+        ParticleStore m_particles;
 
+        // Built-in modifiers are applied in batches of their types.
+        GravityBatch m_gravities;
+        DragBatch m_drags;
+        SpringBatch m_springs{ false }, m_pullingSprings{ true };
+        // Applied to every particle.
+        ParticleDrag m_airDrag;
+
+        // Modifiers of other types, applied one by one.
         std::vector<unaryModPair_t> m_unaryMod;
         std::vector<binaryModPair_t> m_binaryMod;
 
+        // Shared with other systems. Null if single threaded.
+        WorkerPool* m_workers = nullptr;
+
 #if DAL_USE_FIXED_DT
         float_t m_dtAccum = 0;
 #endif
 
+        // Last two steps for rendering, and a spare one being filled by the next step.
+        // Only swapping them needs m_snapshotMut, so rendering never waits for a step.
+        Snapshot m_prevState, m_currState, m_spareState;
+        mutable std::mutex m_snapshotMut;
+
+        // Held during each step, and by mutating functions. Recursive so that modifiers may call them from within a step.
+        mutable std::recursive_mutex m_worldMut;
+
+        std::thread m_thread;
+        std::mutex m_threadMut;
+        std::condition_variable m_threadCond;
+        bool m_flagExit = false;
+
     public:
+        PhysicsWorld(void);
+        ~PhysicsWorld(void);
+
+        // Advances by fixed steps as deltaTime accumulates. Does nothing while the dedicated thread runs.
         void update(const float_t deltaTime);
 
+        // Pool each step splits work over. Results are the same regardless of its number of threads.
+        // Built-in modifiers and integration are split over threads, while custom modifiers always run on the stepping thread.
+        // Pool must outlive this, or be replaced before it is destroyed. Null for stepping on one thread.
+        void setWorkerPool(WorkerPool* const pool);
+
+        // Runs fixed steps on a thread of its own at a steady rate, regardless of how long frames take.
+        // Custom modifiers are then called on that thread. Accessors from tryParticleOf must be used while holding lock().
+        void startThread(void);
+        void stopThread(void);
+        bool isThreadRunning(void) const {
+            return this->m_thread.joinable();
+        }
+        // Keeps the dedicated thread from stepping while returned lock is alive.
+        std::unique_lock<std::recursive_mutex> lock(void) const {
+            return std::unique_lock<std::recursive_mutex>{ this->m_worldMut };
+        }
+
         PhysicsEntity newEntity(void);
 
         void buildParticle(const PhysicsEntity& entity);
@@ -64,12 +126,28 @@ namespace dal {
             return entity;
         }
 
-        PositionParticle* tryParticleOf(const PhysicsEntity& entity);
-        PositionParticle& getParticleOf(const PhysicsEntity& entity);
+        // Returned accessors are valid until a particle is added.
+        std::optional<PositionParticle> tryParticleOf(const PhysicsEntity& entity);
+        PositionParticle getParticleOf(const PhysicsEntity& entity);
+        const ParticleStore& particles(void) const {
+            return this->m_particles;
+        }
 
+        // Position to render, interpolated between the last two steps by how far time has gone since the last one.
+        // So it lags behind by up to a step, but moves smoothly however frame and step rates differ. Safe without lock().
+        std::optional<vec3_t> renderPos(const PhysicsEntity& entity) const;
+
+        // Built-in modifiers are copied into batches rather than kept, so changing them after registration has no effect.
+        // Batched ones don't keep registration order with others. Unary ones go before binary ones, and custom ones after built-in ones.
         void registerUnaryMod(std::shared_ptr<UnaryPhyModifier> mod, const PhysicsEntity& particle);
         void registerBinaryMod(std::shared_ptr<BinaryPhyModifier> mod, const PhysicsEntity& one, const PhysicsEntity& two);
 
+    private:
+        void step(const float_t dt, const std::chrono::steady_clock::time_point time);
+        void publishSnapshot(const std::chrono::steady_clock::time_point time);
+        float_t interpolationFactor(void) const;
+        void threadMain(void);
+
     };
 
 }
@@ -5,10 +5,19 @@
 
 #define DAL_USE_FIXED_DT true
 
+// Define as false to simulate in single precision, which halves memory traffic of particle arrays.
+#ifndef DAL_PHYSICS_DOUBLE_PRECISION
+#define DAL_PHYSICS_DOUBLE_PRECISION true
+#endif
+
 
 namespace dal {
 
+#if DAL_PHYSICS_DOUBLE_PRECISION
     using float_t = double;
+#else
+    using float_t = float;
+#endif
 
     using vec2_t = glm::tvec2<float_t>;
     using vec3_t = glm::tvec3<float_t>;
@@ -19,6 +28,6 @@ namespace dal {
 
     float_t pow(const float_t base, const float_t exponent);
 
-    constexpr float_t FIXED_DELTA_TIME = 1.0 / 30.0;
+    constexpr float_t FIXED_DELTA_TIME = static_cast<float_t>(1.0 / 30.0);
 
 }
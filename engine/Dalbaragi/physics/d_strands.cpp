@@ -0,0 +1,324 @@
+#include "d_strands.h"
+
+#include <cmath>
+#include <cassert>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+
+namespace {
+
+    using dal::float_t;
+
+    // Frame hitches longer than this are simulated as this long, since a big step would throw strands far away.
+    constexpr float_t MAX_DELTA_TIME = 0.1;
+    constexpr float_t MIN_CONSTRAINT_LEN = 0.00001;
+    constexpr float_t NO_TETHER_LEN = std::numeric_limits<float_t>::max();
+
+
+    // Pinned particles get velocities which take them to their targets by the end of update.
+    void setPinnedVelocities(const size_t count, const float_t updateTimeInv, const float_t* __restrict const invMass,
+        const float_t* __restrict const px, const float_t* __restrict const py, const float_t* __restrict const pz,
+        const float_t* __restrict const tx, const float_t* __restrict const ty, const float_t* __restrict const tz,
+        float_t* __restrict const vx, float_t* __restrict const vy, float_t* __restrict const vz)
+    {
+        constexpr float_t ZERO = 0, ONE = 1;
+
+        for ( size_t i = 0; i < count; ++i ) {
+            const float_t pinned = invMass[i] > ZERO ? ZERO : ONE;
+            const auto keep = ONE - pinned;
+            const auto scale = updateTimeInv * pinned;
+
+            vx[i] = vx[i] * keep + (tx[i] - px[i]) * scale;
+            vy[i] = vy[i] * keep + (ty[i] - py[i]) * scale;
+            vz[i] = vz[i] * keep + (tz[i] - pz[i]) * scale;
+        }
+    }
+
+    // Positions before prediction are kept in q, which velocities are derived from after solving.
+    void predictPositions(const size_t count, const float_t dt, const float_t gx, const float_t gy, const float_t gz,
+        const float_t* __restrict const invMass,
+        float_t* __restrict const px, float_t* __restrict const py, float_t* __restrict const pz,
+        float_t* __restrict const qx, float_t* __restrict const qy, float_t* __restrict const qz,
+        float_t* __restrict const vx, float_t* __restrict const vy, float_t* __restrict const vz)
+    {
+        constexpr float_t ZERO = 0, ONE = 1;
+
+        for ( size_t i = 0; i < count; ++i ) {
+            const float_t movable = invMass[i] > ZERO ? ONE : ZERO;
+
+            vx[i] += gx * dt * movable;
+            vy[i] += gy * dt * movable;
+            vz[i] += gz * dt * movable;
+
+            qx[i] = px[i];
+            qy[i] = py[i];
+            qz[i] = pz[i];
+
+            px[i] += vx[i] * dt;
+            py[i] += vy[i] * dt;
+            pz[i] += vz[i] * dt;
+        }
+    }
+
+    // Pushes particles out to the surface of capsule along the shortest way. Pinned ones stay.
+    void collideCapsule(const size_t count, const dal::StrandCapsule& capsule, const float_t* __restrict const invMass,
+        float_t* __restrict const px, float_t* __restrict const py, float_t* __restrict const pz)
+    {
+        constexpr float_t ZERO = 0, ONE = 1;
+
+        const auto ax = capsule.m_one.x, ay = capsule.m_one.y, az = capsule.m_one.z;
+        const auto abx = capsule.m_two.x - ax, aby = capsule.m_two.y - ay, abz = capsule.m_two.z - az;
+        const auto abLenSqr = abx * abx + aby * aby + abz * abz;
+        const auto abLenSqrInv = abLenSqr > ZERO ? ONE / abLenSqr : ZERO;
+        const auto radius = capsule.m_radius;
+
+        for ( size_t i = 0; i < count; ++i ) {
+            const auto t = std::min(ONE, std::max(ZERO, ((px[i] - ax) * abx + (py[i] - ay) * aby + (pz[i] - az) * abz) * abLenSqrInv));
+            const auto cx = ax + abx * t, cy = ay + aby * t, cz = az + abz * t;
+            const auto dx = px[i] - cx, dy = py[i] - cy, dz = pz[i] - cz;
+            const auto distSqr = dx * dx + dy * dy + dz * dz;
+
+            // Particles right on the axis have no direction to be pushed to, so they are left for the next substep.
+            // Conditions are combined without short circuit, which would be a branch.
+            const bool isInside = (distSqr < radius * radius) & (distSqr > ZERO) & (invMass[i] > ZERO);
+            const auto push = isInside ? radius / std::sqrt(distSqr) - ONE : ZERO;
+
+            px[i] += dx * push;
+            py[i] += dy * push;
+            pz[i] += dz * push;
+        }
+    }
+
+    // Long range attachments, which pull particles back toward their roots if they got farther than the path along strand.
+    void applyTethers(const size_t count, const dal::StrandSolver::index_t* __restrict const root, const float_t* __restrict const maxLen,
+        float_t* __restrict const px, float_t* __restrict const py, float_t* __restrict const pz)
+    {
+        constexpr float_t ZERO = 0, ONE = 1;
+
+        for ( size_t i = 0; i < count; ++i ) {
+            const auto r = root[i];
+            const auto dx = px[i] - px[r], dy = py[i] - py[r], dz = pz[i] - pz[r];
+            const auto distSqr = dx * dx + dy * dy + dz * dz;
+            const auto len = maxLen[i];
+
+            const auto pull = distSqr > len * len ? len / std::sqrt(distSqr) - ONE : ZERO;
+            px[i] += dx * pull;
+            py[i] += dy * pull;
+            pz[i] += dz * pull;
+        }
+    }
+
+    // Pinned particles keep velocities, which were set for the whole update.
+    void updateVelocities(const size_t count, const float_t dtInv, const float_t dampingFactor, const float_t* __restrict const invMass,
+        const float_t* __restrict const px, const float_t* __restrict const py, const float_t* __restrict const pz,
+        const float_t* __restrict const qx, const float_t* __restrict const qy, const float_t* __restrict const qz,
+        float_t* __restrict const vx, float_t* __restrict const vy, float_t* __restrict const vz)
+    {
+        constexpr float_t ZERO = 0, ONE = 1;
+
+        for ( size_t i = 0; i < count; ++i ) {
+            const float_t movable = invMass[i] > ZERO ? ONE : ZERO;
+            const auto keep = ONE - movable;
+            const auto scale = dtInv * dampingFactor * movable;
+
+            vx[i] = vx[i] * keep + (px[i] - qx[i]) * scale;
+            vy[i] = vy[i] * keep + (py[i] - qy[i]) * scale;
+            vz[i] = vz[i] * keep + (pz[i] - qz[i]) * scale;
+        }
+    }
+
+}
+
+
+// StrandSolver::ConstraintArray
+namespace dal {
+
+    void StrandSolver::ConstraintArray::add(const index_t one, const index_t two, const float_t restLen, const uint32_t depth) {
+        this->m_one.push_back(one);
+        this->m_two.push_back(two);
+        this->m_restLen.push_back(restLen);
+        this->m_depth.push_back(depth);
+        this->m_isSorted = false;
+    }
+
+    void StrandSolver::ConstraintArray::sortByDepth(void) {
+        if ( this->m_isSorted ) {
+            return;
+        }
+
+        std::vector<uint32_t> order(this->m_depth.size());
+        std::iota(order.begin(), order.end(), 0);
+        // Stable so that constraints of the same depth in a tree are solved in order they were added.
+        std::stable_sort(order.begin(), order.end(), [this](const uint32_t a, const uint32_t b) {
+            return this->m_depth[a] < this->m_depth[b];
+        });
+
+        const auto reorder = [&order](auto& arr) {
+            std::remove_reference_t<decltype(arr)> sorted;
+            sorted.reserve(arr.size());
+            for ( const auto i : order ) {
+                sorted.push_back(arr[i]);
+            }
+            arr.swap(sorted);
+        };
+
+        reorder(this->m_one);
+        reorder(this->m_two);
+        reorder(this->m_restLen);
+        reorder(this->m_depth);
+        this->m_isSorted = true;
+    }
+
+}
+
+
+// StrandSolver
+namespace dal {
+
+    StrandSolver::index_t StrandSolver::addParticle(const vec3_t& pos, const float_t invMass) {
+        const auto index = this->size();
+
+        for ( unsigned axis = 0; axis < 3; ++axis ) {
+            this->m_pos[axis].push_back(pos[axis]);
+            this->m_prevPos[axis].push_back(pos[axis]);
+            this->m_vel[axis].push_back(0);
+            this->m_target[axis].push_back(pos[axis]);
+        }
+        this->m_invMass.push_back(invMass);
+        this->m_depth.push_back(0);
+        this->m_tetherRoot.push_back(index);
+        this->m_tetherLen.push_back(NO_TETHER_LEN);
+
+        return index;
+    }
+
+    void StrandSolver::addStretch(const index_t one, const index_t two) {
+        const auto restLen = glm::distance(this->pos(one), this->pos(two));
+        this->m_depth[two] = this->m_depth[one] + 1;
+        this->m_stretch.add(one, two, restLen, this->m_depth[two]);
+
+        if ( this->m_invMass[one] <= 0 ) {
+            this->m_tetherRoot[two] = one;
+            this->m_tetherLen[two] = restLen;
+        }
+        else if ( NO_TETHER_LEN != this->m_tetherLen[one] ) {
+            this->m_tetherRoot[two] = this->m_tetherRoot[one];
+            this->m_tetherLen[two] = this->m_tetherLen[one] + restLen;
+        }
+    }
+
+    void StrandSolver::addBend(const index_t one, const index_t two) {
+        this->m_bend.add(one, two, glm::distance(this->pos(one), this->pos(two)), this->m_depth[two]);
+    }
+
+    vec3_t StrandSolver::pos(const index_t index) const {
+        assert(index < this->size());
+        return vec3_t{ this->m_pos[0][index], this->m_pos[1][index], this->m_pos[2][index] };
+    }
+
+    void StrandSolver::setPos(const index_t index, const vec3_t& v) {
+        assert(index < this->size());
+        for ( unsigned axis = 0; axis < 3; ++axis ) {
+            this->m_pos[axis][index] = v[axis];
+            this->m_target[axis][index] = v[axis];
+        }
+    }
+
+    void StrandSolver::movePinned(const index_t index, const vec3_t& v) {
+        assert(index < this->size());
+        assert(this->m_invMass[index] <= 0);
+        for ( unsigned axis = 0; axis < 3; ++axis ) {
+            this->m_target[axis][index] = v[axis];
+        }
+    }
+
+    void StrandSolver::update(const float_t deltaTime) {
+        const auto substeps = std::max(1u, this->m_config.m_substeps);
+        const auto updateTime = std::min(deltaTime, MAX_DELTA_TIME);
+        if ( updateTime <= 0 ) {
+            return;
+        }
+
+        this->m_stretch.sortByDepth();
+        this->m_bend.sortByDepth();
+
+        auto& p = this->m_pos;
+        auto& t = this->m_target;
+        auto& v = this->m_vel;
+        ::setPinnedVelocities(this->size(), 1 / updateTime, this->m_invMass.data(),
+            p[0].data(), p[1].data(), p[2].data(), t[0].data(), t[1].data(), t[2].data(), v[0].data(), v[1].data(), v[2].data());
+
+        const auto dt = updateTime / static_cast<float_t>(substeps);
+        for ( unsigned i = 0; i < substeps; ++i ) {
+            this->substep(dt);
+        }
+
+        // Rounding errors would make pinned particles drift away from targets over time.
+        for ( index_t i = 0; i < this->size(); ++i ) {
+            if ( this->m_invMass[i] <= 0 ) {
+                for ( unsigned axis = 0; axis < 3; ++axis ) {
+                    p[axis][i] = t[axis][i];
+                }
+            }
+        }
+    }
+
+    // Small steps with a single iteration each, which converges better than many iterations on a big step.
+    // So Lagrange multipliers always start from 0 and don't need to be stored.
+    void StrandSolver::substep(const float_t dt) {
+        const auto count = this->size();
+        auto& p = this->m_pos;
+        auto& q = this->m_prevPos;
+        auto& v = this->m_vel;
+        const auto& g = this->m_config.m_gravity;
+
+        ::predictPositions(count, dt, g.x, g.y, g.z, this->m_invMass.data(),
+            p[0].data(), p[1].data(), p[2].data(), q[0].data(), q[1].data(), q[2].data(), v[0].data(), v[1].data(), v[2].data());
+
+        const auto dtSqrInv = 1 / (dt * dt);
+        this->solve(this->m_stretch, this->m_config.m_stretchCompliance * dtSqrInv);
+        this->solve(this->m_bend, this->m_config.m_bendCompliance * dtSqrInv);
+        ::applyTethers(count, this->m_tetherRoot.data(), this->m_tetherLen.data(), p[0].data(), p[1].data(), p[2].data());
+
+        for ( const auto& capsule : this->m_capsules ) {
+            ::collideCapsule(count, capsule, this->m_invMass.data(), p[0].data(), p[1].data(), p[2].data());
+        }
+
+        ::updateVelocities(count, 1 / dt, dal::pow(this->m_config.m_damping, dt), this->m_invMass.data(),
+            p[0].data(), p[1].data(), p[2].data(), q[0].data(), q[1].data(), q[2].data(), v[0].data(), v[1].data(), v[2].data());
+    }
+
+    // Gauss-Seidel over constraints sorted by depth, so every strand is solved from root to tip, interleaved with other strands.
+    void StrandSolver::solve(const ConstraintArray& constraints, const float_t complianceOverDtSqr) {
+        auto px = this->m_pos[0].data(), py = this->m_pos[1].data(), pz = this->m_pos[2].data();
+        const auto invMass = this->m_invMass.data();
+        const auto count = constraints.m_restLen.size();
+
+        for ( size_t i = 0; i < count; ++i ) {
+            const auto a = constraints.m_one[i];
+            const auto b = constraints.m_two[i];
+            const auto wa = invMass[a], wb = invMass[b];
+            const auto wSum = wa + wb + complianceOverDtSqr;
+
+            const auto dx = px[b] - px[a], dy = py[b] - py[a], dz = pz[b] - pz[a];
+            const auto len = std::sqrt(dx * dx + dy * dy + dz * dz);
+            if ( wSum <= 0 || len < MIN_CONSTRAINT_LEN ) {
+                continue;
+            }
+
+            // Delta lambda divided by length, which turns the difference vector into the gradient.
+            const auto scale = -(len - constraints.m_restLen[i]) / (wSum * len);
+
+            px[a] -= dx * scale * wa;
+            py[a] -= dy * scale * wa;
+            pz[a] -= dz * scale * wa;
+
+            px[b] += dx * scale * wb;
+            py[b] += dy * scale * wb;
+            pz[b] += dz * scale * wb;
+        }
+    }
+
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "d_precision.h"
+
+
+namespace dal {
+
+    // Compliance is inverse of stiffness, so 0 means rigid.
+    struct StrandConfig {
+        vec3_t m_gravity{ 0, -9.8, 0 };
+        float_t m_stretchCompliance = 0;
+        float_t m_bendCompliance = 0.001;
+        // Fraction of velocity kept after a second.
+        float_t m_damping = 0.3;
+        // More substeps make strands stiffer and collisions tighter, at linear cost.
+        unsigned m_substeps = 8;
+    };
+
+
+    // Segment with radius, which approximates a body part that strands can't get into.
+    struct StrandCapsule {
+        vec3_t m_one, m_two;
+        float_t m_radius = 0;
+    };
+
+
+    // Extended position based dynamics (XPBD) for hair and cloth.
+    // Particles of every strand share one set of arrays, and each substep runs a few loops over all of them at once.
+    // Particles with zero inverse mass are pinned, and only move by setPos or movePinned.
+    class StrandSolver {
+
+    public:
+        using index_t = uint32_t;
+
+    private:
+        // Keeps distance between two particles at what it was when added.
+        // Sorted by depth of particle two before solving, so that neighboring constraints belong to different strands
+        // and don't wait for each other. Each strand is still solved from root to tip.
+        struct ConstraintArray {
+            std::vector<index_t> m_one, m_two;
+            std::vector<float_t> m_restLen;
+            std::vector<uint32_t> m_depth;
+            bool m_isSorted = true;
+
+            void add(const index_t one, const index_t two, const float_t restLen, const uint32_t depth);
+            void sortByDepth(void);
+        };
+
+    private:
+        std::vector<float_t> m_pos[3], m_prevPos[3], m_vel[3];
+        // Where pinned particles reach at the end of next update.
+        std::vector<float_t> m_target[3];
+        std::vector<float_t> m_invMass;
+        // Number of stretch constraints between each particle and its root.
+        std::vector<uint32_t> m_depth;
+        // Pinned particle each one hangs from, and length of the path to it. Particles hang from themselves if none.
+        // Particles are never farther than that, so errors left by iterations don't add up along long strands.
+        std::vector<index_t> m_tetherRoot;
+        std::vector<float_t> m_tetherLen;
+
+        ConstraintArray m_stretch, m_bend;
+        std::vector<StrandCapsule> m_capsules;
+
+        StrandConfig m_config;
+
+    public:
+        index_t addParticle(const vec3_t& pos, const float_t invMass);
+        // Constraints between neighbors keep strands from stretching. Particle two hangs from one.
+        void addStretch(const index_t one, const index_t two);
+        // Constraints between particles one apart from each other keep strands from folding.
+        void addBend(const index_t one, const index_t two);
+
+        vec3_t pos(const index_t index) const;
+        // Teleports particle without moving its neighbors.
+        void setPos(const index_t index, const vec3_t& v);
+        // Pinned particle moves to v evenly over substeps of next update, so that strands are pulled smoothly rather than jerked.
+        void movePinned(const index_t index, const vec3_t& v);
+        index_t size(void) const {
+            return static_cast<index_t>(this->m_invMass.size());
+        }
+
+        const StrandConfig& config(void) const {
+            return this->m_config;
+        }
+        void setConfig(const StrandConfig& config) {
+            this->m_config = config;
+        }
+
+        // Colliders are given in the same space as particles, usually every frame.
+        void clearCapsules(void) {
+            this->m_capsules.clear();
+        }
+        void addCapsule(const StrandCapsule& capsule) {
+            this->m_capsules.push_back(capsule);
+        }
+
+        void update(const float_t deltaTime);
+
+    private:
+        void substep(const float_t dt);
+        void solve(const ConstraintArray& constraints, const float_t complianceOverDtSqr);
+
+    };
+
+}
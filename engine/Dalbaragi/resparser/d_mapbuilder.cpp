@@ -0,0 +1,345 @@
+#include "d_mapbuilder.h"
+
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+
+#include <daltools/common/compression.h>
+
+#include <u_byteutils.h>
+
+
+// Primitives
+namespace {
+
+    class BinaryBuilder {
+
+    private:
+        std::vector<uint8_t> m_data;
+
+    public:
+        auto& data(void) const {
+            return this->m_data;
+        }
+        auto size(void) const {
+            return this->m_data.size();
+        }
+
+        void appendInt4(const int32_t v) {
+            this->append4Bytes(&v);
+        }
+        void appendFloat(const float v) {
+            this->append4Bytes(&v);
+        }
+        void appendBool1(const bool v) {
+            this->m_data.push_back(v ? 1 : 0);
+        }
+        void appendVec3(const glm::vec3& v) {
+            this->appendFloat(v.x);
+            this->appendFloat(v.y);
+            this->appendFloat(v.z);
+        }
+        void appendStr(const std::string& v) {
+            this->m_data.insert(this->m_data.end(), v.begin(), v.end());
+            this->m_data.push_back('\0');
+        }
+        void appendFloatArray(const float* const arr, const size_t arrSize) {
+            for ( size_t i = 0; i < arrSize; ++i ) {
+                this->appendFloat(arr[i]);
+            }
+        }
+        void appendBytes(const uint8_t* const arr, const size_t arrSize) {
+            this->m_data.insert(this->m_data.end(), arr, arr + arrSize);
+        }
+
+    private:
+        // Data is always stored in little endian.
+        void append4Bytes(const void* const src) {
+            uint8_t buf[4];
+            std::memcpy(buf, src, 4);
+            if ( dal::isBigEndian() ) {
+                std::reverse(buf, buf + 4);
+            }
+            this->m_data.insert(this->m_data.end(), buf, buf + 4);
+        }
+
+    };
+
+}
+
+
+// Data blocks
+namespace {
+
+    void buildMesh(BinaryBuilder& output, const dal::v1::Mesh& info) {
+        output.appendInt4(static_cast<int32_t>(info.m_vertices.size() / 3));
+        output.appendFloatArray(info.m_vertices.data(), info.m_vertices.size());
+        output.appendFloatArray(info.m_uvcoords.data(), info.m_uvcoords.size());
+        output.appendFloatArray(info.m_normals.data(), info.m_normals.size());
+    }
+
+    void buildMaterial(BinaryBuilder& output, const dal::v1::Material& info) {
+        output.appendFloat(info.m_roughness);
+        output.appendFloat(info.m_metallic);
+
+        output.appendStr(info.m_albedoMap);
+        output.appendStr(info.m_roughnessMap);
+        output.appendStr(info.m_metallicMap);
+        output.appendStr(info.m_normalMap);
+    }
+
+    void buildModel(BinaryBuilder& output, const dal::v1::ModelEmbeded& info) {
+        output.appendInt4(static_cast<int32_t>(info.m_renderUnits.size()));
+        for ( auto& unit : info.m_renderUnits ) {
+            buildMaterial(output, unit.m_material);
+            buildMesh(output, unit.m_mesh);
+        }
+
+        output.appendVec3(info.m_aabb.m_min);
+        output.appendVec3(info.m_aabb.m_max);
+
+        output.appendBool1(info.m_hasRotate);
+        output.appendBool1(info.m_hasMeshCollider);
+    }
+
+    void buildStaticActor(BinaryBuilder& output, const dal::v1::StaticActor& info) {
+        output.appendStr(info.m_name);
+
+        output.appendVec3(info.m_trans.m_pos);
+        output.appendFloat(info.m_trans.m_quat.w);
+        output.appendFloat(info.m_trans.m_quat.x);
+        output.appendFloat(info.m_trans.m_quat.y);
+        output.appendFloat(info.m_trans.m_quat.z);
+        output.appendFloat(info.m_trans.m_scale);
+
+        output.appendInt4(static_cast<int32_t>(info.m_colType));
+
+        output.appendInt4(info.m_modelIndex);
+        output.appendInt4(static_cast<int32_t>(info.m_envmapIndices.size()));
+        for ( const auto index : info.m_envmapIndices ) {
+            output.appendInt4(index);
+        }
+    }
+
+    void buildModelCollider(BinaryBuilder& output, const dal::v2::ModelCollider& info) {
+        output.appendVec3(info.m_aabb.m_min);
+        output.appendVec3(info.m_aabb.m_max);
+
+        output.appendInt4(static_cast<int32_t>(info.m_triangles.size()));
+        output.appendFloatArray(info.m_triangles.data(), info.m_triangles.size());
+    }
+
+    void buildWaterPlane(BinaryBuilder& output, const dal::v1::WaterPlane& info) {
+        output.appendVec3(info.m_centerPos);
+        output.appendVec3(info.m_deepColor);
+
+        output.appendFloat(info.m_width);
+        output.appendFloat(info.m_height);
+
+        output.appendFloat(info.m_flowSpeed);
+        output.appendFloat(info.m_waveStreng);
+        output.appendFloat(info.m_darkestDepth);
+        output.appendFloat(info.m_reflectance);
+    }
+
+    void buildEnvMap(BinaryBuilder& output, const dal::v1::EnvMap& info) {
+        output.appendVec3(info.m_pos);
+
+        output.appendInt4(static_cast<int32_t>(info.m_volume.size()));
+        for ( auto& plane : info.m_volume ) {
+            output.appendFloat(plane.x);
+            output.appendFloat(plane.y);
+            output.appendFloat(plane.z);
+            output.appendFloat(plane.w);
+        }
+    }
+
+    void buildLight(BinaryBuilder& output, const dal::v1::ILight& info) {
+        output.appendStr(info.m_name);
+        output.appendBool1(info.m_hasShadow);
+        output.appendVec3(info.m_color);
+        output.appendFloat(info.m_intensity);
+    }
+
+    void buildPlight(BinaryBuilder& output, const dal::v1::PointLight& info) {
+        buildLight(output, info);
+
+        output.appendVec3(info.m_pos);
+        output.appendFloat(info.m_maxDist);
+        output.appendFloat(info.m_halfIntenseDist);
+    }
+
+    void buildSlight(BinaryBuilder& output, const dal::v1::SpotLight& info) {
+        buildLight(output, info);
+
+        output.appendVec3(info.m_pos);
+        output.appendFloat(info.m_maxDist);
+        output.appendFloat(info.m_halfIntenseDist);
+
+        output.appendVec3(info.m_direction);
+        output.appendFloat(info.m_spotDegree);
+        output.appendFloat(info.m_spotBlend);
+    }
+
+}
+
+
+// Sections
+namespace {
+
+    template <typename T, typename F>
+    void buildList(BinaryBuilder& output, const std::vector<T>& list, F func) {
+        output.appendInt4(static_cast<int32_t>(list.size()));
+        for ( auto& x : list ) {
+            func(output, x);
+        }
+    }
+
+    BinaryBuilder buildSection(const dal::v2::MapChunk& chunk, const dal::v2::ChunkSection section) {
+        BinaryBuilder output;
+
+        switch ( section ) {
+
+        case dal::v2::ChunkSection::models:
+            buildList(output, chunk.m_models, buildModel);
+            break;
+        case dal::v2::ChunkSection::actors:
+            buildList(output, chunk.m_staticActors, buildStaticActor);
+            break;
+        case dal::v2::ChunkSection::colliders:
+            buildList(output, chunk.m_colliders, buildModelCollider);
+            break;
+        case dal::v2::ChunkSection::lights:
+            buildList(output, chunk.m_plights, buildPlight);
+            buildList(output, chunk.m_slights, buildSlight);
+            break;
+        case dal::v2::ChunkSection::waters:
+            buildList(output, chunk.m_waters, buildWaterPlane);
+            break;
+        case dal::v2::ChunkSection::envmaps:
+            buildList(output, chunk.m_envmaps, buildEnvMap);
+            break;
+        default:
+            assert(false);
+            break;
+
+        }
+
+        return output;
+    }
+
+    // Same as compressBound of zlib.
+    size_t calcCompressBound(const size_t srcSize) {
+        return srcSize + (srcSize >> 12) + (srcSize >> 14) + (srcSize >> 25) + 13;
+    }
+
+    // Returns empty vector if compression failed or didn't make data smaller.
+    std::vector<uint8_t> compressSection(const std::vector<uint8_t>& src) {
+        std::vector<uint8_t> result(calcCompressBound(src.size()));
+        const auto com_result = dal::compress_zip(result.data(), result.size(), src.data(), src.size());
+
+        if ( dal::CompressResult::success != com_result.m_result ) {
+            return {};
+        }
+
+        const auto outputSize = static_cast<size_t>(com_result.m_output_size);
+        if ( outputSize >= src.size() ) {
+            return {};
+        }
+
+        result.resize(outputSize);
+        return result;
+    }
+
+}
+
+
+namespace dal {
+
+    v2::MapChunk convertMapChunk_v1to2(v1::MapChunk chunk) {
+        v2::MapChunk result;
+
+        result.m_colliders.resize(chunk.m_models.size());
+        for ( size_t i = 0; i < chunk.m_models.size(); ++i ) {
+            const auto& model = chunk.m_models[i];
+            auto& collider = result.m_colliders[i];
+
+            collider.m_aabb = model.m_aabb;
+
+            if ( model.m_hasMeshCollider ) {
+                for ( auto& unit : model.m_renderUnits ) {
+                    const auto& vertices = unit.m_mesh.m_vertices;
+                    const auto numFloats = vertices.size() - vertices.size() % 9;
+                    collider.m_triangles.insert(collider.m_triangles.end(), vertices.begin(), vertices.begin() + numFloats);
+                }
+            }
+        }
+
+        result.m_models = std::move(chunk.m_models);
+        result.m_staticActors = std::move(chunk.m_staticActors);
+        result.m_waters = std::move(chunk.m_waters);
+        result.m_envmaps = std::move(chunk.m_envmaps);
+        result.m_plights = std::move(chunk.m_plights);
+        result.m_slights = std::move(chunk.m_slights);
+
+        result.m_loadedSections = v2::SECTION_ALL;
+
+        return result;
+    }
+
+    std::vector<uint8_t> buildMapChunk_v2(const v2::MapChunk& chunk, const bool compress) {
+        struct SectionData {
+            v2::ChunkSection m_type;
+            v2::SectionCompression m_compression;
+            size_t m_rawSize;
+            std::vector<uint8_t> m_data;
+        };
+
+        std::vector<SectionData> sections;
+
+        for ( int32_t i = 0; i < static_cast<int32_t>(v2::ChunkSection::eoe); ++i ) {
+            const auto type = static_cast<v2::ChunkSection>(i);
+            if ( !chunk.hasSection(type) ) {
+                continue;
+            }
+
+            auto raw = buildSection(chunk, type);
+            auto& section = sections.emplace_back();
+            section.m_type = type;
+            section.m_rawSize = raw.size();
+
+            auto compressed = compress ? compressSection(raw.data()) : std::vector<uint8_t>{};
+            if ( compressed.empty() ) {
+                section.m_compression = v2::SectionCompression::none;
+                section.m_data = raw.data();
+            }
+            else {
+                section.m_compression = v2::SectionCompression::zip;
+                section.m_data = std::move(compressed);
+            }
+        }
+
+        BinaryBuilder output;
+
+        output.appendBytes(reinterpret_cast<const uint8_t*>(v2::MAP_CHUNK_MAGIC), v2::MAP_CHUNK_MAGIC_SIZE);
+        output.appendInt4(static_cast<int32_t>(sections.size()));
+
+        auto offset = v2::MAP_CHUNK_MAGIC_SIZE + 4 + sections.size() * v2::MAP_CHUNK_SECTION_ENTRY_SIZE;
+        for ( auto& section : sections ) {
+            output.appendInt4(static_cast<int32_t>(section.m_type));
+            output.appendInt4(static_cast<int32_t>(section.m_compression));
+            output.appendInt4(static_cast<int32_t>(offset));
+            output.appendInt4(static_cast<int32_t>(section.m_data.size()));
+            output.appendInt4(static_cast<int32_t>(section.m_rawSize));
+
+            offset += section.m_data.size();
+        }
+
+        for ( auto& section : sections ) {
+            output.appendBytes(section.m_data.data(), section.m_data.size());
+        }
+
+        return output.data();
+    }
+
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+
+#include "d_mapdata.h"
+
+
+namespace dal {
+
+    // Colliders are built from render unit vertices of models which have m_hasMeshCollider set.
+    v2::MapChunk convertMapChunk_v1to2(v1::MapChunk chunk);
+
+    // Only sections marked in m_loadedSections are written.
+    // Section is stored uncompressed if zip compression doesn't make it smaller.
+    std::vector<uint8_t> buildMapChunk_v2(const v2::MapChunk& chunk, const bool compress = true);
+
+}
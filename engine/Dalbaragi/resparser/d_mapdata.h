@@ -204,3 +204,81 @@ namespace dal::v1 {
     };
 
 }
+
+
+namespace dal::v2 {
+
+    // Layout of v2 chunk file
+    // magic(6) | num sections(4) | section table | section payloads
+    // Each entry of section table is 5 int4 values: type, compression, offset from file begin, stored size, raw size.
+
+    constexpr char MAP_CHUNK_MAGIC[] = "dalch2";
+    constexpr size_t MAP_CHUNK_MAGIC_SIZE = 6;
+    constexpr size_t MAP_CHUNK_SECTION_ENTRY_SIZE = 5 * 4;
+
+    enum class SectionCompression : int32_t {
+        none = 0,
+        zip = 1,
+    };
+
+    enum class ChunkSection : int32_t {
+        models = 0,
+        actors = 1,
+        colliders = 2,
+        lights = 3,
+        waters = 4,
+        envmaps = 5,
+        eoe
+    };
+
+    // Bit mask made of ChunkSection values, used to select which sections to parse.
+    using chunkSectionMask_t = uint32_t;
+
+    constexpr chunkSectionMask_t sectionBit(const ChunkSection section) {
+        return chunkSectionMask_t{ 1 } << static_cast<int32_t>(section);
+    }
+
+    constexpr chunkSectionMask_t SECTION_ALL = (chunkSectionMask_t{ 1 } << static_cast<int32_t>(ChunkSection::eoe)) - 1;
+
+
+    // Collision data of a model, index of it matches index of v1::ModelEmbeded in MapChunk::m_models.
+    class ModelCollider {
+
+    public:
+        v1::AABB m_aabb;
+        // 9 floats per triangle. Empty if model doesn't have mesh collider.
+        std::vector<float> m_triangles;
+
+    public:
+        size_t numTriangles(void) const {
+            return this->m_triangles.size() / 9;
+        }
+        bool hasMeshCollider(void) const {
+            return !this->m_triangles.empty();
+        }
+
+    };
+
+
+    class MapChunk {
+
+    public:
+        std::vector<v1::ModelEmbeded> m_models;
+        std::vector<v1::StaticActor> m_staticActors;
+        std::vector<ModelCollider> m_colliders;
+        std::vector<v1::WaterPlane> m_waters;
+        std::vector<v1::EnvMap> m_envmaps;
+
+        std::vector<v1::PointLight> m_plights;
+        std::vector<v1::SpotLight> m_slights;
+
+        chunkSectionMask_t m_loadedSections = 0;
+
+    public:
+        bool hasSection(const ChunkSection section) const {
+            return 0 != (this->m_loadedSections & sectionBit(section));
+        }
+
+    };
+
+}
@@ -2,17 +2,48 @@
 
 #include <array>
 #include <memory>
+#include <cstring>
 
 #include <daltools/common/compression.h>
 
 #include <u_byteutils.h>
 
+#include "d_mapbuilder.h"
+
 
 namespace {
 
+    // Declared sizes above this are treated as corrupted rather than being allocated.
+    constexpr int32_t MAX_UNCOMPRESSED_SIZE = 256 * 1024 * 1024;
+
+
+    class CorruptedBinary {  };
+
+    inline void assertHeaderPtr(const uint8_t* const begin, const uint8_t* const end) {
+        if ( begin > end ) {
+            throw CorruptedBinary{};
+        }
+    }
+
+    // Must be called before reading, so that header never goes past end.
+    inline void assertRemaining(const uint8_t* const begin, const uint8_t* const end, const size_t size) {
+        if ( begin > end || static_cast<size_t>(end - begin) < size ) {
+            throw CorruptedBinary{};
+        }
+    }
+
     // Returns nullptr containing unique_ptr and 0 on failure.
     std::pair<std::unique_ptr<uint8_t[]>, size_t> uncompressMap(const uint8_t* const buf, const size_t bufSize) {
-        const auto allocatedSize = static_cast<size_t>(1.01 * dal::makeInt4(buf));  // Just to ensure that buffer never lacks.
+        if ( bufSize < 4 ) {
+            return std::make_pair(nullptr, 0);
+        }
+
+        const auto declaredSize = dal::makeInt4(buf);
+        if ( declaredSize <= 0 || declaredSize > MAX_UNCOMPRESSED_SIZE ) {
+            return std::make_pair(nullptr, 0);
+        }
+
+        const auto allocatedSize = static_cast<size_t>(1.01 * declaredSize);  // Just to ensure that buffer never lacks.
         std::unique_ptr<uint8_t[]> decomBuf{ new uint8_t[allocatedSize] };
         const auto decom_result = dal::decomp_zip(decomBuf.get(), allocatedSize, buf + 4, bufSize - 4);
 
@@ -24,15 +55,6 @@ namespace {
         }
     }
 
-
-    class CorruptedBinary {  };
-
-    inline void assertHeaderPtr(const uint8_t* const begin, const uint8_t* const end) {
-        if ( begin > end ) {
-            throw CorruptedBinary{};
-        }
-    }
-
     inline void pushBackVec3(std::vector<float>& c, const glm::vec3 v) {
         c.push_back(v.x);
         c.push_back(v.y);
@@ -61,9 +83,45 @@ namespace {
 // Primitives
 namespace {
 
-    const uint8_t* parseVec3(glm::vec3& info, const uint8_t* begin) {
+    const uint8_t* parseInt4(int32_t& info, const uint8_t* begin, const uint8_t* const end) {
+        assertRemaining(begin, end, 4);
+        info = dal::makeInt4(begin);
+        return begin + 4;
+    }
+
+    const uint8_t* parseBool1(bool& info, const uint8_t* begin, const uint8_t* const end) {
+        assertRemaining(begin, end, 1);
+        info = dal::makeBool1(begin);
+        return begin + 1;
+    }
+
+    // Number of elements of following array.
+    // Fails if it's negative or following data can't be that long, to avoid allocating giant containers.
+    const uint8_t* parseCount(int32_t& info, const uint8_t* begin, const uint8_t* const end, const size_t minElementSize) {
+        begin = parseInt4(info, begin, end);
+
+        if ( info < 0 ) {
+            throw CorruptedBinary{};
+        }
+        if ( minElementSize > 0 && static_cast<size_t>(info) > static_cast<size_t>(end - begin) / minElementSize ) {
+            throw CorruptedBinary{};
+        }
+
+        return begin;
+    }
+
+    template <typename T>
+    const uint8_t* parse4BytesArray(T* const info, const size_t size, const uint8_t* begin, const uint8_t* const end) {
+        if ( size > static_cast<size_t>(end - begin) / 4 ) {
+            throw CorruptedBinary{};
+        }
+
+        return dal::assemble4BytesArray<T>(begin, info, size);
+    }
+
+    const uint8_t* parseVec3(glm::vec3& info, const uint8_t* begin, const uint8_t* const end) {
         float fbuf[3];
-        begin = dal::assemble4BytesArray<float>(begin, fbuf, 3);
+        begin = parse4BytesArray<float>(fbuf, 3, begin, end);
         info.x = fbuf[0];
         info.y = fbuf[1];
         info.z = fbuf[2];
@@ -71,18 +129,24 @@ namespace {
         return begin;
     }
 
-    const uint8_t* parseStr(std::string& info, const uint8_t* begin) {
-        info = reinterpret_cast<const char*>(begin);
-        begin += (info.size() + 1);
-        return begin;
+    const uint8_t* parseStr(std::string& info, const uint8_t* begin, const uint8_t* const end) {
+        assertHeaderPtr(begin, end);
+
+        const auto nullPos = static_cast<const uint8_t*>(std::memchr(begin, '\0', end - begin));
+        if ( nullptr == nullPos ) {
+            throw CorruptedBinary{};
+        }
+
+        info.assign(reinterpret_cast<const char*>(begin), nullPos - begin);
+        return nullPos + 1;
     }
 
     const uint8_t* parseFloatList(std::vector<float>& info, const uint8_t* begin, const uint8_t* const end) {
-        const auto arrSize = dal::makeInt4(begin); begin += 4;
+        int32_t arrSize;
+        begin = parseCount(arrSize, begin, end, 4);
         info.resize(arrSize);
-        begin = dal::assemble4BytesArray<float>(begin, info.data(), arrSize);
+        begin = parse4BytesArray<float>(info.data(), arrSize, begin, end);
 
-        assertHeaderPtr(begin, end);
         return begin;
     }
 
@@ -92,22 +156,34 @@ namespace {
 // Data blocks
 namespace {
 
+    // Minimum sizes of data blocks in bytes, used to validate element counts.
+    constexpr size_t MIN_SIZE_MODEL = 4 + 6 * 4 + 2;
+    constexpr size_t MIN_SIZE_RENDER_UNIT = 2 * 4 + 4 + 4;
+    constexpr size_t MIN_SIZE_STATIC_ACTOR = 1 + 8 * 4 + 4 + 4 + 4;
+    constexpr size_t MIN_SIZE_WATER = 12 * 4;
+    constexpr size_t MIN_SIZE_ENVMAP = 3 * 4 + 4;
+    constexpr size_t MIN_SIZE_LIGHT = 1 + 1 + 4 * 4;
+    constexpr size_t MIN_SIZE_DLIGHT = MIN_SIZE_LIGHT + 3 * 4;
+    constexpr size_t MIN_SIZE_PLIGHT = MIN_SIZE_LIGHT + 5 * 4;
+    constexpr size_t MIN_SIZE_SLIGHT = MIN_SIZE_LIGHT + 10 * 4;
+    constexpr size_t MIN_SIZE_CHUNK_INFO = 1 + 9 * 4;
+    constexpr size_t MIN_SIZE_COLLIDER = 6 * 4 + 4;
+
+
     const uint8_t* parseMesh(dal::v1::Mesh& info, const uint8_t* begin, const uint8_t* const end) {
-        const auto num_verts = dal::makeInt4(begin); begin += 4;
+        int32_t num_verts;
+        begin = parseCount(num_verts, begin, end, 8 * 4);
         const auto num_verts_3 = static_cast<int64_t>(num_verts) * 3;
         const auto num_verts_2 = static_cast<int64_t>(num_verts) * 2;
 
         info.m_vertices.resize(num_verts_3);
-        begin = dal::assemble4BytesArray<float>(begin, info.m_vertices.data(), num_verts_3);
-        assertHeaderPtr(begin, end);
+        begin = parse4BytesArray<float>(info.m_vertices.data(), num_verts_3, begin, end);
 
         info.m_uvcoords.resize(num_verts_2);
-        begin = dal::assemble4BytesArray<float>(begin, info.m_uvcoords.data(), num_verts_2);
-        assertHeaderPtr(begin, end);
+        begin = parse4BytesArray<float>(info.m_uvcoords.data(), num_verts_2, begin, end);
 
         info.m_normals.resize(num_verts_3);
-        begin = dal::assemble4BytesArray<float>(begin, info.m_normals.data(), num_verts_3);
-        assertHeaderPtr(begin, end);
+        begin = parse4BytesArray<float>(info.m_normals.data(), num_verts_3, begin, end);
 
         return begin;
     }
@@ -115,16 +191,16 @@ namespace {
     const uint8_t* parseMaterial(dal::v1::Material& info, const uint8_t* begin, const uint8_t* const end) {
         {
             float floatBuf[2];
-            begin = dal::assemble4BytesArray<float>(begin, floatBuf, 2);
+            begin = parse4BytesArray<float>(floatBuf, 2, begin, end);
 
             info.m_roughness = floatBuf[0];
             info.m_metallic = floatBuf[1];
         }
 
-        begin = parseStr(info.m_albedoMap, begin);
-        begin = parseStr(info.m_roughnessMap, begin);
-        begin = parseStr(info.m_metallicMap, begin);
-        begin = parseStr(info.m_normalMap, begin);
+        begin = parseStr(info.m_albedoMap, begin, end);
+        begin = parseStr(info.m_roughnessMap, begin, end);
+        begin = parseStr(info.m_metallicMap, begin, end);
+        begin = parseStr(info.m_normalMap, begin, end);
 
         return begin;
     }
@@ -137,17 +213,18 @@ namespace {
     }
 
     const uint8_t* parseModel(dal::v1::ModelEmbeded& info, const uint8_t* begin, const uint8_t* const end) {
-        const auto num_units = dal::makeInt4(begin); begin += 4;
+        int32_t num_units;
+        begin = parseCount(num_units, begin, end, MIN_SIZE_RENDER_UNIT);
         info.m_renderUnits.resize(num_units);
         for ( int32_t i = 0; i < num_units; ++i ) {
             begin = parseRenderUnit(info.m_renderUnits[i], begin, end);
         }
 
-        begin = parseVec3(info.m_aabb.m_min, begin);
-        begin = parseVec3(info.m_aabb.m_max, begin);
+        begin = parseVec3(info.m_aabb.m_min, begin, end);
+        begin = parseVec3(info.m_aabb.m_max, begin, end);
 
-        info.m_hasRotate = dal::makeBool1(begin); begin += 1;
-        info.m_hasMeshCollider = dal::makeBool1(begin); begin += 1;
+        begin = parseBool1(info.m_hasRotate, begin, end);
+        begin = parseBool1(info.m_hasMeshCollider, begin, end);
 
         return begin;
     }
@@ -155,15 +232,14 @@ namespace {
     const uint8_t* parseStaticActor(dal::v1::StaticActor& info, const uint8_t* begin, const uint8_t* const end) {
         // Name
         {
-            info.m_name = reinterpret_cast<const char*>(begin);
-            begin += info.m_name.size() + 1;
+            begin = parseStr(info.m_name, begin, end);
         }
 
         // Transform
         {
             constexpr int FBUF_SIZE = 8;
             float fbuf[FBUF_SIZE];
-            begin = dal::assemble4BytesArray<float>(begin, fbuf, FBUF_SIZE);
+            begin = parse4BytesArray<float>(fbuf, FBUF_SIZE, begin, end);
 
             info.m_trans.m_pos = { fbuf[0], fbuf[1], fbuf[2] };
             info.m_trans.m_quat = { fbuf[3], fbuf[4], fbuf[5], fbuf[6] };
@@ -171,7 +247,8 @@ namespace {
         }
 
         {
-            const auto colTypeIndex = dal::makeInt4(begin); begin += 4;
+            int32_t colTypeIndex;
+            begin = parseInt4(colTypeIndex, begin, end);
             switch ( colTypeIndex ) {
 
             case 0:
@@ -184,8 +261,7 @@ namespace {
                 info.m_colType = dal::v1::StaticActor::ColliderType::mesh;
                 break;
             default:
-                assert(false);
-                break;
+                throw CorruptedBinary{};
 
             }
         }
@@ -193,10 +269,23 @@ namespace {
         return begin;
     }
 
+    // Static actor followed by model index and envmap indices.
+    const uint8_t* parseStaticActorWithRefs(dal::v1::StaticActor& info, const uint8_t* begin, const uint8_t* const end) {
+        begin = parseStaticActor(info, begin, end);
+        begin = parseInt4(info.m_modelIndex, begin, end);
+
+        int32_t num_envmaps;
+        begin = parseCount(num_envmaps, begin, end, 4);
+        info.m_envmapIndices.resize(num_envmaps);
+        begin = parse4BytesArray<int32_t>(info.m_envmapIndices.data(), num_envmaps, begin, end);
+
+        return begin;
+    }
+
     const uint8_t* parseWaterPlane(dal::v1::WaterPlane& info, const uint8_t* begin, const uint8_t* const end) {
         constexpr int FBUF_SIZE = 12;
         float fbuf[FBUF_SIZE];
-        begin = dal::assemble4BytesArray<float>(begin, fbuf, FBUF_SIZE);
+        begin = parse4BytesArray<float>(fbuf, FBUF_SIZE, begin, end);
 
         info.m_centerPos = glm::vec3{ fbuf[0], fbuf[1], fbuf[2] };
         info.m_deepColor = glm::vec3{ fbuf[3], fbuf[4], fbuf[5] };
@@ -216,18 +305,19 @@ namespace {
         {
             constexpr int FBUF_SIZE = 3;
             float fbuf[FBUF_SIZE];
-            begin = dal::assemble4BytesArray<float>(begin, fbuf, FBUF_SIZE);
+            begin = parse4BytesArray<float>(fbuf, FBUF_SIZE, begin, end);
 
             info.m_pos = glm::vec3{ fbuf[0], fbuf[1], fbuf[2] };
         }
 
         {
-            const auto planeSize = dal::makeInt4(begin); begin += 4;
+            int32_t planeSize;
+            begin = parseCount(planeSize, begin, end, 4 * 4);
             info.m_volume.resize(planeSize);
             std::vector<float> fbuffer(planeSize * 4);
-            begin = dal::assemble4BytesArray<float>(begin, fbuffer.data(), fbuffer.size());
+            begin = parse4BytesArray<float>(fbuffer.data(), fbuffer.size(), begin, end);
 
-            for ( size_t i = 0; i < planeSize; ++i ) {
+            for ( int32_t i = 0; i < planeSize; ++i ) {
                 info.m_volume[i].x = fbuffer[4 * i + 0];
                 info.m_volume[i].y = fbuffer[4 * i + 1];
                 info.m_volume[i].z = fbuffer[4 * i + 2];
@@ -240,15 +330,13 @@ namespace {
 
 
     const uint8_t* parseLight(dal::v1::ILight& info, const uint8_t* begin, const uint8_t* const end) {
-        info.m_name = reinterpret_cast<const char*>(begin);
-        begin += info.m_name.size() + 1;
-
-        info.m_hasShadow = dal::makeBool1(begin); begin += 1;
+        begin = parseStr(info.m_name, begin, end);
+        begin = parseBool1(info.m_hasShadow, begin, end);
 
         {
             constexpr int FBUF_SIZE = 4;
             float fbuf[FBUF_SIZE];
-            begin = dal::assemble4BytesArray<float>(begin, fbuf, FBUF_SIZE);
+            begin = parse4BytesArray<float>(fbuf, FBUF_SIZE, begin, end);
 
             info.m_color = glm::vec3{ fbuf[0], fbuf[1], fbuf[2] };
             info.m_intensity = fbuf[3];
@@ -259,14 +347,7 @@ namespace {
 
     const uint8_t* parseDlight(dal::v1::DirectionalLight& info, const uint8_t* begin, const uint8_t* const end) {
         begin = parseLight(info, begin, end);
-
-        {
-            constexpr int FBUF_SIZE = 3;
-            float fbuf[FBUF_SIZE];
-            begin = dal::assemble4BytesArray<float>(begin, fbuf, FBUF_SIZE);
-
-            info.m_direction = glm::vec3{ fbuf[0], fbuf[1], fbuf[2] };
-        }
+        begin = parseVec3(info.m_direction, begin, end);
 
         return begin;
     }
@@ -277,7 +358,7 @@ namespace {
         {
             constexpr int FBUF_SIZE = 5;
             float fbuf[FBUF_SIZE];
-            begin = dal::assemble4BytesArray<float>(begin, fbuf, FBUF_SIZE);
+            begin = parse4BytesArray<float>(fbuf, FBUF_SIZE, begin, end);
 
             info.m_pos = glm::vec3{ fbuf[0], fbuf[1], fbuf[2] };
             info.m_maxDist = fbuf[3];
@@ -293,7 +374,7 @@ namespace {
         {
             // 2 vec3, 4 float
             std::array<float, 2 * 3 + 4> fbuf;
-            begin = dal::assemble4BytesArray<float>(begin, fbuf.data(), fbuf.size());
+            begin = parse4BytesArray<float>(fbuf.data(), fbuf.size(), begin, end);
 
             info.m_pos = glm::vec3{ fbuf[0], fbuf[1], fbuf[2] };
             info.m_maxDist = fbuf[3];
@@ -308,16 +389,15 @@ namespace {
     }
 
 
-    const uint8_t* parseMapChunkInfo(dal::v1::LevelData::ChunkData& info, const uint8_t* begin) {
+    const uint8_t* parseMapChunkInfo(dal::v1::LevelData::ChunkData& info, const uint8_t* begin, const uint8_t* const end) {
         {
-            info.m_name = reinterpret_cast<const char*>(begin);
-            begin += info.m_name.size() + 1;
+            begin = parseStr(info.m_name, begin, end);
         }
 
         {
             constexpr int FBUF_SIZE = 6 + 3;
             float fbuf[FBUF_SIZE];
-            begin = dal::assemble4BytesArray<float>(begin, fbuf, FBUF_SIZE);
+            begin = parse4BytesArray<float>(fbuf, FBUF_SIZE, begin, end);
 
             info.m_aabb.m_min = { fbuf[0], fbuf[1], fbuf[2] };
             info.m_aabb.m_max = { fbuf[3], fbuf[4], fbuf[5] };
@@ -327,6 +407,115 @@ namespace {
         return begin;
     }
 
+
+    template <typename T, typename F>
+    const uint8_t* parseList(std::vector<T>& info, const uint8_t* begin, const uint8_t* const end, const size_t minElementSize, F parseFunc) {
+        int32_t num_elements;
+        begin = parseCount(num_elements, begin, end, minElementSize);
+        info.resize(num_elements);
+        for ( int32_t i = 0; i < num_elements; ++i ) {
+            begin = parseFunc(info[i], begin, end);
+        }
+
+        return begin;
+    }
+
+    // Loader indexes models with these without checking, so it is done once here.
+    template <typename T>
+    bool areModelIndicesValid(const T& info) {
+        for ( const auto& actor : info.m_staticActors ) {
+            if ( actor.m_modelIndex < 0 || static_cast<size_t>(actor.m_modelIndex) >= info.m_models.size() ) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+}
+
+
+// v2 sections
+namespace {
+
+    const uint8_t* parseModelCollider(dal::v2::ModelCollider& info, const uint8_t* begin, const uint8_t* const end) {
+        begin = parseVec3(info.m_aabb.m_min, begin, end);
+        begin = parseVec3(info.m_aabb.m_max, begin, end);
+        begin = parseFloatList(info.m_triangles, begin, end);
+
+        if ( 0 != info.m_triangles.size() % 9 ) {
+            throw CorruptedBinary{};
+        }
+
+        return begin;
+    }
+
+    void parseSection(dal::v2::MapChunk& info, const dal::v2::ChunkSection section, const uint8_t* begin, const uint8_t* const end) {
+        switch ( section ) {
+
+        case dal::v2::ChunkSection::models:
+            begin = parseList(info.m_models, begin, end, MIN_SIZE_MODEL, parseModel);
+            break;
+        case dal::v2::ChunkSection::actors:
+            begin = parseList(info.m_staticActors, begin, end, MIN_SIZE_STATIC_ACTOR, parseStaticActorWithRefs);
+            break;
+        case dal::v2::ChunkSection::colliders:
+            begin = parseList(info.m_colliders, begin, end, MIN_SIZE_COLLIDER, parseModelCollider);
+            break;
+        case dal::v2::ChunkSection::lights:
+            begin = parseList(info.m_plights, begin, end, MIN_SIZE_PLIGHT, parsePlight);
+            begin = parseList(info.m_slights, begin, end, MIN_SIZE_SLIGHT, parseSlight);
+            break;
+        case dal::v2::ChunkSection::waters:
+            begin = parseList(info.m_waters, begin, end, MIN_SIZE_WATER, parseWaterPlane);
+            break;
+        case dal::v2::ChunkSection::envmaps:
+            begin = parseList(info.m_envmaps, begin, end, MIN_SIZE_ENVMAP, parseEnvMap);
+            break;
+        default:
+            throw CorruptedBinary{};
+
+        }
+
+        if ( begin != end ) {
+            throw CorruptedBinary{};
+        }
+    }
+
+    std::unique_ptr<uint8_t[]> uncompressSection(const uint8_t* const src, const size_t srcSize, const size_t rawSize) {
+        std::unique_ptr<uint8_t[]> result{ new uint8_t[rawSize] };
+        const auto decom_result = dal::decomp_zip(result.get(), rawSize, src, srcSize);
+
+        if ( dal::CompressResult::success != decom_result.m_result || rawSize != static_cast<size_t>(decom_result.m_output_size) ) {
+            throw CorruptedBinary{};
+        }
+
+        return result;
+    }
+
+    // v1 files don't have sections, so unwanted ones are dropped after parsing.
+    void dropUnselectedSections(dal::v2::MapChunk& info, const dal::v2::chunkSectionMask_t sections) {
+        using dal::v2::ChunkSection;
+        using dal::v2::sectionBit;
+
+        if ( 0 == (sections & sectionBit(ChunkSection::models)) )
+            info.m_models.clear();
+        if ( 0 == (sections & sectionBit(ChunkSection::actors)) )
+            info.m_staticActors.clear();
+        if ( 0 == (sections & sectionBit(ChunkSection::colliders)) )
+            info.m_colliders.clear();
+        if ( 0 == (sections & sectionBit(ChunkSection::lights)) ) {
+            info.m_plights.clear();
+            info.m_slights.clear();
+        }
+        if ( 0 == (sections & sectionBit(ChunkSection::waters)) )
+            info.m_waters.clear();
+        if ( 0 == (sections & sectionBit(ChunkSection::envmaps)) )
+            info.m_envmaps.clear();
+
+        info.m_loadedSections &= sections;
+    }
+
 }
 
 
@@ -334,7 +523,7 @@ namespace dal {
 
     std::optional<v1::LevelData> parseLevel_v1(const uint8_t* const buf, const size_t bufSize) {
         const char* const magicBits = "dallvl";
-        if ( 0 != std::memcmp(buf, magicBits, 6) ) {
+        if ( bufSize < 6 || 0 != std::memcmp(buf, magicBits, 6) ) {
             return std::nullopt;
         }
 
@@ -343,35 +532,29 @@ namespace dal {
 
         v1::LevelData info;
 
-        {
-            const auto num_dlights = dal::makeInt4(header); header += 4;
-            info.m_dlights.resize(num_dlights);
-            for ( int32_t i = 0; i < num_dlights; ++i ) {
-                header = parseDlight(info.m_dlights[i], header, end);
-            }
+        try {
+            header = parseList(info.m_dlights, header, end, MIN_SIZE_DLIGHT, parseDlight);
+            header = parseList(info.m_chunks, header, end, MIN_SIZE_CHUNK_INFO, parseMapChunkInfo);
         }
-
-        {
-            const auto num_chunks = dal::makeInt4(header); header += 4;
-            info.m_chunks.resize(num_chunks);
-            for ( int32_t i = 0; i < num_chunks; ++i ) {
-                header = parseMapChunkInfo(info.m_chunks[i], header);
-            }
+        catch ( CorruptedBinary ) {
+            return std::nullopt;
         }
 
-        assert(header == end);
+        if ( header != end ) {
+            return std::nullopt;
+        }
 
         return info;
     }
 
     std::optional<v1::MapChunk> parseMapChunk_v1(const uint8_t* const buf, const size_t bufSize) {
         const char* const magicBits = "dalchk";
-        if ( 0 != std::memcmp(buf, magicBits, 6) ) {
+        if ( bufSize < 6 || 0 != std::memcmp(buf, magicBits, 6) ) {
             //dalError("Given datablock does not start with magic numbers.");
             return std::nullopt;
         }
 
-        const auto [data, dataSize] = uncompressMap(buf + 6, bufSize);
+        const auto [data, dataSize] = uncompressMap(buf + 6, bufSize - 6);
         if ( nullptr == data ) {
             return std::nullopt;
         }
@@ -382,71 +565,121 @@ namespace dal {
         const uint8_t* const end = header + dataSize;
 
         try {
-            {
-                const auto num_models = dal::makeInt4(header); header += 4;
-                info.m_models.resize(num_models);
-                for ( int32_t i = 0; i < num_models; ++i ) {
-                    header = parseModel(info.m_models[i], header, end);
-                }
-            }
+            header = parseList(info.m_models, header, end, MIN_SIZE_MODEL, parseModel);
+            header = parseList(info.m_staticActors, header, end, MIN_SIZE_STATIC_ACTOR, parseStaticActorWithRefs);
+            header = parseList(info.m_waters, header, end, MIN_SIZE_WATER, parseWaterPlane);
+            header = parseList(info.m_envmaps, header, end, MIN_SIZE_ENVMAP, parseEnvMap);
+            header = parseList(info.m_plights, header, end, MIN_SIZE_PLIGHT, parsePlight);
+            header = parseList(info.m_slights, header, end, MIN_SIZE_SLIGHT, parseSlight);
+        }
+        catch ( CorruptedBinary ) {
+            // dalError("Failed to parse map, maybe it is corrupted.");
+            return std::nullopt;
+        }
 
-            {
-                const auto num_static_actors = dal::makeInt4(header); header += 4;
-                info.m_staticActors.resize(num_static_actors);
-                for ( int32_t i = 0; i < num_static_actors; ++i ) {
-                    auto& actor = info.m_staticActors[i];
+        if ( header != end || !::areModelIndicesValid(info) ) {
+            return std::nullopt;
+        }
 
-                    header = parseStaticActor(actor, header, end);
-                    actor.m_modelIndex = dal::makeInt4(header); header += 4;
+        return info;
+    }
 
-                    const auto num_envmaps = dal::makeInt4(header); header += 4;
-                    actor.m_envmapIndices.resize(num_envmaps);
-                    for ( unsigned j = 0; j < num_envmaps; ++j ) {
-                        actor.m_envmapIndices[j] = dal::makeInt4(header); header += 4;
-                    }
+
+    bool isMapChunk_v2(const uint8_t* const buf, const size_t bufSize) {
+        if ( bufSize < v2::MAP_CHUNK_MAGIC_SIZE ) {
+            return false;
+        }
+
+        return 0 == std::memcmp(buf, v2::MAP_CHUNK_MAGIC, v2::MAP_CHUNK_MAGIC_SIZE);
+    }
+
+    std::optional<v2::MapChunk> parseMapChunk_v2(const uint8_t* const buf, const size_t bufSize, const v2::chunkSectionMask_t sections) {
+        if ( !isMapChunk_v2(buf, bufSize) ) {
+            return std::nullopt;
+        }
+
+        v2::MapChunk info;
+
+        const uint8_t* header = buf + v2::MAP_CHUNK_MAGIC_SIZE;
+        const uint8_t* const end = buf + bufSize;
+
+        try {
+            int32_t num_sections;
+            header = parseCount(num_sections, header, end, v2::MAP_CHUNK_SECTION_ENTRY_SIZE);
+
+            for ( int32_t i = 0; i < num_sections; ++i ) {
+                int32_t entry[5];
+                header = parse4BytesArray<int32_t>(entry, 5, header, end);
+
+                const auto sectionType = entry[0];
+                const auto compression = static_cast<v2::SectionCompression>(entry[1]);
+                const auto offset = entry[2];
+                const auto storedSize = entry[3];
+                const auto rawSize = entry[4];
+
+                // Unknown sections are ignored so that old parsers can read newer files.
+                if ( sectionType < 0 || sectionType >= static_cast<int32_t>(v2::ChunkSection::eoe) ) {
+                    continue;
                 }
-            }
 
-            {
-                const auto num_waters = dal::makeInt4(header); header += 4;
-                info.m_waters.resize(num_waters);
-                for ( int32_t i = 0; i < num_waters; ++i ) {
-                    header = parseWaterPlane(info.m_waters[i], header, end);
+                const auto section = static_cast<v2::ChunkSection>(sectionType);
+                if ( 0 == (sections & v2::sectionBit(section)) ) {
+                    continue;
                 }
-            }
 
-            {
-                const auto size = dal::makeInt4(header); header += 4;
-                info.m_envmaps.resize(size);
-                for ( int32_t i = 0; i < size; ++i ) {
-                    header = parseEnvMap(info.m_envmaps[i], header, end);
+                if ( offset < 0 || storedSize < 0 || rawSize < 0 || rawSize > MAX_UNCOMPRESSED_SIZE ) {
+                    throw CorruptedBinary{};
                 }
-            }
+                if ( static_cast<size_t>(offset) + static_cast<size_t>(storedSize) > bufSize ) {
+                    throw CorruptedBinary{};
+                }
+
+                const uint8_t* const sectionBegin = buf + offset;
+
+                switch ( compression ) {
 
-            {
-                const auto num_plights = dal::makeInt4(header); header += 4;
-                info.m_plights.resize(num_plights);
-                for ( int32_t i = 0; i < num_plights; ++i ) {
-                    header = parsePlight(info.m_plights[i], header, end);
+                case v2::SectionCompression::none:
+                    parseSection(info, section, sectionBegin, sectionBegin + storedSize);
+                    break;
+                case v2::SectionCompression::zip:
+                {
+                    const auto data = uncompressSection(sectionBegin, storedSize, rawSize);
+                    parseSection(info, section, data.get(), data.get() + rawSize);
+                    break;
                 }
-            }
+                default:
+                    throw CorruptedBinary{};
 
-            {
-                const auto num_slights = dal::makeInt4(header); header += 4;
-                info.m_slights.resize(num_slights);
-                for ( int32_t i = 0; i < num_slights; ++i ) {
-                    header = parseSlight(info.m_slights[i], header, end);
                 }
+
+                info.m_loadedSections |= v2::sectionBit(section);
             }
         }
         catch ( CorruptedBinary ) {
-            // dalError("Failed to parse map, maybe it is corrupted.");
             return std::nullopt;
         }
 
-        assert(header == end);
+        // Either one alone refers to nothing loaded, so it can't be checked.
+        if ( info.hasSection(v2::ChunkSection::models) && info.hasSection(v2::ChunkSection::actors) && !::areModelIndicesValid(info) ) {
+            return std::nullopt;
+        }
 
         return info;
     }
 
+    std::optional<v2::MapChunk> parseMapChunk(const uint8_t* const buf, const size_t bufSize, const v2::chunkSectionMask_t sections) {
+        if ( isMapChunk_v2(buf, bufSize) ) {
+            return parseMapChunk_v2(buf, bufSize, sections);
+        }
+
+        auto chunk_v1 = parseMapChunk_v1(buf, bufSize);
+        if ( !chunk_v1 ) {
+            return std::nullopt;
+        }
+
+        auto result = convertMapChunk_v1to2(std::move(*chunk_v1));
+        dropUnselectedSections(result, sections);
+        return result;
+    }
+
 }
@@ -11,4 +11,12 @@ namespace dal {
 
     std::optional<v1::MapChunk> parseMapChunk_v1(const uint8_t* const buf, const size_t bufSize);
 
+    bool isMapChunk_v2(const uint8_t* const buf, const size_t bufSize);
+
+    // Sections not in the mask are skipped without being decompressed.
+    std::optional<v2::MapChunk> parseMapChunk_v2(const uint8_t* const buf, const size_t bufSize, const v2::chunkSectionMask_t sections = v2::SECTION_ALL);
+
+    // Accepts both v1 and v2. v1 data is converted into v2 after being fully parsed.
+    std::optional<v2::MapChunk> parseMapChunk(const uint8_t* const buf, const size_t bufSize, const v2::chunkSectionMask_t sections = v2::SECTION_ALL);
+
 }
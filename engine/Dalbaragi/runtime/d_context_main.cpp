@@ -237,6 +237,8 @@ namespace {
 
     constexpr float TARGET_CAM_DISTANCE = 3;
     const glm::vec3 TARGET_FOCUS_OFFSET{ 0, 1, 0 };
+    // Statistics of a frame are logged once in this many seconds.
+    constexpr float RENDER_STATS_LOG_INTERVAL = 10;
 
     void updateCamera(dal::FocusCamera& cam, dal::SceneGraph::CameraProp& camInfo, const dal::MoveInputInfo& moveInfo, const glm::vec3& thisPos) {
         // Apply conrol
@@ -254,6 +256,22 @@ namespace {
         cam.setPos(cam.focusPoint() + glm::vec3{ camPosDirec } *TARGET_CAM_DISTANCE);
     }
 
+    // Of the last frame rendered, since RenderMaster resets them before each.
+    void logRenderStats(const dal::SceneGraph& scene) {
+        using Pass = dal::SceneGraph::RenderPass;
+        const std::pair<Pass, const char*> passes[] = { { Pass::main, "main" }, { Pass::shadow, "shadow" }, { Pass::water, "water" }, { Pass::envmap, "envmap" } };
+
+        for ( const auto& [pass, name] : passes ) {
+            const auto& cull = scene.cullStats(pass);
+            const auto& queue = scene.renderQueueStats(pass);
+            dalDebug(fmt::format("{} pass: {} drawn, {} culled, {} draws, {} state changes, {} skipped",
+                name, cull.m_drawn, cull.m_culled, queue.m_draws, queue.m_stateChanges, queue.m_stateSkipped));
+        }
+
+        const auto& anim = scene.animationStats();
+        dalDebug(fmt::format("animation: {} characters, {} joints sampled, {} saved", anim.m_characters, anim.m_jointsSampled, anim.m_jointsSaved));
+    }
+
 }
 
 
@@ -274,6 +292,7 @@ namespace {
 
         dal::PlayerControlWidget m_crtlWidget;
         FPSCounter m_fcounter;
+        dal::Timer m_statsTimer;
 
         unsigned m_winWidth, m_winHeight;
 
@@ -363,6 +382,11 @@ namespace {
                 this->m_fcounter.render(this->m_winWidth, this->m_winHeight, &uniloc);
             }
 
+            if ( this->m_statsTimer.getElapsed() > RENDER_STATS_LOG_INTERVAL ) {
+                ::logRenderStats(this->m_scene);
+                this->m_statsTimer.check();
+            }
+
             return nextContext;
         }
 
@@ -144,6 +144,8 @@ namespace {
     constexpr float HEIGHT_RAY_Y_OFFSET = 1.2;
     constexpr float STOP_FALLING_OFFSET = 0.1;
     constexpr float SNAP_TO_FLOOR_HEIGHT = 0.5;
+    // Seconds over which animation of previous state blends into new one.
+    constexpr float ANIM_CROSS_FADE_SEC = 0.2;
 
     auto makeHeightRay(const glm::vec3& pos) {
         return dal::Segment{ pos + glm::vec3{ 0, HEIGHT_RAY_Y_OFFSET, 0 }, glm::vec3{ 0, -10, 0 } };;
@@ -194,7 +196,7 @@ namespace {
             dalVerbose("Enter idle");
 
             auto& model = this->m_scene.m_entities.get<dal::cpnt::AnimatedModel>(this->m_scene.m_player);
-            model.m_animState.setSelectedAnimeIndex(2);
+            model.m_animState.crossFade(2, ANIM_CROSS_FADE_SEC);
 
             auto& transform = getPlayerTransform(this->m_scene);
             const auto height = ::findDistanceToFloor(transform, this->m_scene);
@@ -262,7 +264,7 @@ namespace {
             auto& model = getPlayerModel(this->m_scene);
             auto& transform = getPlayerTransform(this->m_scene);
 
-            model.m_animState.setSelectedAnimeIndex(1);
+            model.m_animState.crossFade(1, ANIM_CROSS_FADE_SEC);
             this->m_lastPos = transform.getPos();
         }
 
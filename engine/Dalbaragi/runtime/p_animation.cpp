@@ -1,4 +1,7 @@
 #include "p_animation.h"
+#include "p_animbake.h"
+
+#include <algorithm>
 
 #include <spdlog/fmt/fmt.h>
 #include <glm/gtc/matrix_transform.hpp>
@@ -12,76 +15,82 @@ using namespace fmt::literals;
 
 namespace {
 
-    float interpolate(const float start, const float end, const float factor) {
-        const auto delta = end - start;
-        return start + factor * delta;
+    // Joints whose descendants reach less than this ratio of bound radius of skeleton are minor.
+    constexpr float MINOR_JOINT_REACH_RATIO = 0.1f;
+
+    template <typename C, typename T>
+    T sampleOr(const C& channel, const float animTick, uint32_t& cursor, const T& fallback) {
+        return channel.empty() ? fallback : channel.sample(animTick, cursor);
     }
 
-    glm::vec3 interpolate(const glm::vec3& start, const glm::vec3& end, const float factor) {
-        const auto delta = end - start;
-        return start + factor * delta;
+    // Whether joint keeps what it had last time instead of being sampled.
+    bool isSkipped(const dal::JointInfo& joint, const dal::AnimationLOD& lod, const bool canSkip) {
+        if ( lod.m_rootOnly && joint.parentIndex() >= 0 ) {
+            return true;
+        }
+
+        return canSkip && lod.m_skipMinorJoints && joint.isMinor();
     }
 
-    glm::quat interpolate(const glm::quat& start, const glm::quat& end, const float factor) {
-        return glm::slerp(start, end, factor);
+    // Joints can't be skipped until they have been sampled once.
+    bool canSkipJoints(const dal::PoseWorkspace& workspace, const dal::SkeletonInterface& interf) {
+        return workspace.m_isFullySampled && workspace.m_local.size() == static_cast<size_t>(interf.getSize());
     }
 
-    // Pass it container with size 0 and iterator to index of unsigned{ -1 }.
-    // WTF such a broken Engilsh that even I can't understand!!
-    template <typename T>
-    size_t findIndexToStartInterp(const std::vector<std::pair<float, T>>& container, const float criteria) {
-        dalAssert(0 != container.size());
+    // Hierarchy pass after pose is sampled and blended. Returns number of joints whose local transforms are made anew.
+    dal::jointID_t composePose(const float elapsed, const dal::SkeletonInterface& interf, dal::JointTransformArray& transformArr,
+        const dal::jointModifierRegistry_t& modifiers, dal::PoseWorkspace& workspace, const dal::AnimationLOD& lod, const bool canSkip)
+    {
+        const auto numBones = interf.getSize();
+        transformArr.setSize(numBones);
 
-        for ( size_t i = 0; i < container.size() - 1; i++ ) {
-            if ( criteria < container[i + 1].first ) {
-                return i;
-            }
+        // Parents come first, so their model space transforms are always ready when children need them.
+        auto& local = workspace.m_local;
+        auto& modelSpace = workspace.m_modelSpace;
+        if ( local.size() != static_cast<size_t>(numBones) ) {
+            workspace.m_isFullySampled = false;
+            local.resize(numBones);
+            modelSpace.resize(numBones);
         }
 
-        return container.size() - 1;
-    }
+        dal::jointID_t numSampled = 0;
+        for ( dal::jointID_t i = 0; i < numBones; ++i ) {
+            const auto& jointInfo = interf.at(i);
+            const auto parent = jointInfo.parentIndex();
+            dalAssert(parent < i);
 
-    template <typename T>
-    T makeInterpValue(const float animTick, const std::vector<std::pair<float, T>>& container) {
-        dalAssert(0 != container.size());
+            if ( lod.m_rootOnly && parent >= 0 ) {
+                continue;
+            }
 
-        if ( 1 == container.size() ) {
-            return container[0].second;
-        }
+            if ( !::isSkipped(jointInfo, lod, canSkip) ) {
+                const auto found = modifiers.find(i);
+                const auto boneTransform = modifiers.end() != found ? found->second->makeTransform(elapsed, i, interf) : workspace.m_pose.makeTransform(i);
+                local[i] = jointInfo.toParent() * boneTransform;
+                ++numSampled;
+            }
 
-        const auto startIndex = findIndexToStartInterp(container, animTick);
-        const auto nextIndex = startIndex + 1;
-        if ( nextIndex >= container.size() ) {
-            return container.back().second;
+            modelSpace[i] = parent < 0 ? local[i] : modelSpace[parent] * local[i];
+            transformArr.setTransform(i, modelSpace[i] * jointInfo.offsetInv());
         }
 
-        const auto deltaTime = container[nextIndex].first - container[startIndex].first;
-        auto factor = (animTick - container[startIndex].first) / deltaTime;
-        if ( 0.0f <= factor && factor <= 1.0f ) {
-            const auto start = container[startIndex].second;
-            const auto end = container[nextIndex].second;
-            return interpolate(start, end, factor);
-        }
-        else {
-            const auto start = container[startIndex].second;
-            const auto end = container[nextIndex].second;
-            return interpolate(start, end, 0.0f);
+        // Passes of root only or skipping minor joints leave some of local with nothing or stale ones.
+        if ( numSampled == numBones ) {
+            workspace.m_isFullySampled = true;
         }
+
+        return numSampled;
     }
 
-    std::vector<dal::jointID_t> makeParentList(const dal::jointID_t id, const dal::SkeletonInterface& interf) {
-        std::vector<dal::jointID_t> result;
+    template <typename T, typename S>
+    void splitKeyframes(dal::KeyframeChannel<T>& dst, const std::vector<std::pair<float, S>>& src) {
+        dst.m_times.clear();
+        dst.m_values.clear();
+        dst.m_times.reserve(src.size());
+        dst.m_values.reserve(src.size());
 
-        dal::jointID_t currentID = id;
-        while ( true ) {
-            const auto parentID = interf.at(currentID).parentIndex();
-            if ( parentID < 0 ) {
-                return result;
-            }
-            else {
-                result.push_back(parentID);
-                currentID = parentID;
-            }
+        for ( auto& [time, value] : src ) {
+            dst.add(time, value);
         }
     }
 
@@ -152,6 +161,43 @@ namespace dal {
         this->m_map.clear();
         this->m_boneInfo.clear();
         this->m_lastMadeIndex = -1;
+        this->m_boundRadius = 0;
+    }
+
+    void SkeletonInterface::classifyJoints(void) {
+        const auto numJoints = this->getSize();
+        if ( 0 == numJoints ) {
+            this->m_boundRadius = 0;
+            return;
+        }
+
+        std::vector<glm::vec3> positions(numJoints);
+        for ( jointID_t i = 0; i < numJoints; ++i ) {
+            positions[i] = this->at(i).localPos();
+        }
+
+        this->m_boundRadius = 0;
+        for ( jointID_t i = 0; i < numJoints; ++i ) {
+            this->m_boundRadius = std::max(this->m_boundRadius, glm::distance(positions[i], positions[0]));
+        }
+
+        // How far descendants of each joint reach along bones. Children come after parents, so going backward sees them first.
+        std::vector<float> reaches(numJoints, 0.f);
+        for ( jointID_t i = numJoints - 1; i >= 0; --i ) {
+            const auto parent = this->at(i).parentIndex();
+            if ( parent >= 0 ) {
+                reaches[parent] = std::max(reaches[parent], reaches[i] + glm::distance(positions[i], positions[parent]));
+            }
+        }
+
+        // Fingers, toes and face joints are small, and so is what they move. Hair is under its root joint.
+        for ( jointID_t i = 0; i < numJoints; ++i ) {
+            auto& joint = this->at(i);
+            const auto parent = joint.parentIndex();
+            const auto isUnderHair = parent >= 0 && (JointType::hair_root == this->at(parent).jointType() || this->at(parent).isMinor());
+            const auto isSmall = parent >= 0 && reaches[i] < this->m_boundRadius * MINOR_JOINT_REACH_RATIO;
+            joint.setMinor(isUnderHair || isSmall);
+        }
     }
 
     // Private
@@ -189,21 +235,88 @@ namespace dal {
         this->m_array[index] = mat;
     }
 
-    void JointTransformArray::sendUniform(const UniInterf_Skeleton& uniloc) const {
-        for ( unsigned i = 0; i < this->m_array.size(); i++ ) {
-            uniloc.jointTrans(i, this->m_array[i]);
+}
+
+
+namespace dal {
+
+    SkinningBuffer::SkinningBuffer(SkinningBuffer&& other) noexcept {
+        std::swap(this->m_buffer, other.m_buffer);
+    }
+
+    SkinningBuffer& SkinningBuffer::operator=(SkinningBuffer&& other) noexcept {
+        std::swap(this->m_buffer, other.m_buffer);
+        return *this;
+    }
+
+    SkinningBuffer::~SkinningBuffer(void) {
+        if ( 0 != this->m_buffer ) {
+            glDeleteBuffers(1, &this->m_buffer);
+            this->m_buffer = 0;
+        }
+    }
+
+    void SkinningBuffer::upload(const JointTransformArray& transforms) {
+        if ( 0 == this->m_buffer ) {
+            // Whole block is allocated, since binding less than block size is undefined.
+            glGenBuffers(1, &this->m_buffer);
+            glBindBuffer(GL_UNIFORM_BUFFER, this->m_buffer);
+            glBufferData(GL_UNIFORM_BUFFER, MAX_JOINTS_NUM * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+        }
+        else {
+            glBindBuffer(GL_UNIFORM_BUFFER, this->m_buffer);
+        }
+
+        // Array of mat4 in std140 layout is as tightly packed as glm::mat4 array.
+        const auto numJoints = std::min<size_t>(transforms.getSize(), MAX_JOINTS_NUM);
+        if ( numJoints > 0 ) {
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, numJoints * sizeof(glm::mat4), transforms.data());
         }
     }
 
+    void SkinningBuffer::bind(void) const {
+        glBindBufferBase(GL_UNIFORM_BUFFER, JOINT_TRANSFORMS_BINDING, this->m_buffer);
+    }
+
 }
 
 
 namespace dal {
 
+    void Animation::JointNode::set(const dal::parser::AnimJoint& data) {
+        this->m_name = data.name_;
+        ::splitKeyframes(this->m_pos, data.translations_);
+        ::splitKeyframes(this->m_rotate, data.rotations_);
+        ::splitKeyframes(this->m_scale, data.scales_);
+        this->m_isCompressed = false;
+    }
+
     glm::mat4 Animation::JointNode::makeTransform(const float animTick) const {
-        const auto pos = this->makePosInterp(animTick);
-        const auto rotate = this->makeRotateInterp(animTick);
-        const auto scale = this->makeScaleInterp(animTick);
+        KeyframeCursor cursor;
+        return this->makeTransform(animTick, cursor);
+    }
+
+    void Animation::JointNode::compress(const AnimCompressConfig& config) {
+        this->m_packedPos.build(this->m_pos, config.m_posTolerance);
+        this->m_packedRotate.build(this->m_rotate, config.m_rotateTolerance);
+        this->m_packedScale.build(this->m_scale, config.m_scaleTolerance);
+        this->m_isCompressed = true;
+
+        this->m_pos = KeyframeChannel<glm::vec3>{};
+        this->m_rotate = KeyframeChannel<glm::quat>{};
+        this->m_scale = KeyframeChannel<float>{};
+    }
+
+    size_t Animation::JointNode::calcMemorySize(void) const {
+        return this->m_pos.memorySize() + this->m_rotate.memorySize() + this->m_scale.memorySize() +
+            this->m_packedPos.memorySize() + this->m_packedRotate.memorySize() + this->m_packedScale.memorySize();
+    }
+
+    glm::mat4 Animation::JointNode::makeTransform(const float animTick, KeyframeCursor& cursor) const {
+        glm::vec3 pos;
+        glm::quat rotate;
+        float scale;
+        this->sampleChannels(animTick, cursor, pos, rotate, scale);
 
         const glm::mat4 identity{ 1.0f };
         const auto posMat = glm::translate(identity, pos);
@@ -213,22 +326,28 @@ namespace dal {
         return posMat * rotateMat * scaleMat;
     }
 
-    // Private
-
-    bool Animation::JointNode::hasKeyframes(void) const {
-        return (this->m_data.translations_.size() + this->m_data.rotations_.size() + this->m_data.scales_.size()) != 0;
-    }
+    void Animation::JointNode::sample(const float animTick, KeyframeCursor& cursor, LocalPose& pose, const size_t index) const {
+        glm::vec3 pos;
+        glm::quat rotate;
+        float scale;
+        this->sampleChannels(animTick, cursor, pos, rotate, scale);
 
-    glm::vec3 Animation::JointNode::makePosInterp(const float animTick) const {
-        return this->m_data.translations_.empty() ? glm::vec3{} : makeInterpValue(animTick, this->m_data.translations_);
+        pose.set(index, pos, rotate, scale);
     }
 
-    glm::quat Animation::JointNode::makeRotateInterp(const float animTick) const {
-        return this->m_data.rotations_.empty() ? glm::quat{} : makeInterpValue(animTick, this->m_data.rotations_);
-    }
+    // Private
 
-    float Animation::JointNode::makeScaleInterp(const float animTick) const {
-        return this->m_data.scales_.empty() ? 1.f : makeInterpValue(animTick, this->m_data.scales_);
+    void Animation::JointNode::sampleChannels(const float animTick, KeyframeCursor& cursor, glm::vec3& pos, glm::quat& rotate, float& scale) const {
+        if ( this->m_isCompressed ) {
+            pos = ::sampleOr(this->m_packedPos, animTick, cursor.m_pos, glm::vec3{});
+            rotate = ::sampleOr(this->m_packedRotate, animTick, cursor.m_rotate, glm::quat{ 1, 0, 0, 0 });
+            scale = ::sampleOr(this->m_packedScale, animTick, cursor.m_scale, 1.f);
+        }
+        else {
+            pos = ::sampleOr(this->m_pos, animTick, cursor.m_pos, glm::vec3{});
+            rotate = ::sampleOr(this->m_rotate, animTick, cursor.m_rotate, glm::quat{ 1, 0, 0, 0 });
+            scale = ::sampleOr(this->m_scale, animTick, cursor.m_scale, 1.f);
+        }
     }
 
 }  // namespace dal
@@ -249,37 +368,60 @@ namespace dal {
         }
     }
 
-    void Animation::sample2(
-        const float elapsed,
+    void Animation::compress(const AnimCompressConfig& config) {
+        for ( auto& joint : this->m_joints ) {
+            joint.compress(config);
+        }
+    }
+
+    size_t Animation::calcMemorySize(void) const {
+        size_t result = 0;
+        for ( auto& joint : this->m_joints ) {
+            result += joint.calcMemorySize();
+        }
+        return result;
+    }
+
+    jointID_t Animation::sampleLocal(
         const float animTick,
         const SkeletonInterface& interf,
-        JointTransformArray& transformArr,
-        const jointModifierRegistry_t& modifiers
+        LocalPose& pose,
+        std::vector<KeyframeCursor>& cursors,
+        const AnimationLOD& lod,
+        const bool canSkip,
+        const float* const mask
     ) const {
         const auto numBones = interf.getSize();
-        transformArr.setSize(numBones);
-
-        std::vector<glm::mat4> boneTransforms(numBones);
         dalAssert(numBones == this->m_joints.size());
-        for ( int i = 0; i < numBones; ++i ) {
-            const auto found = modifiers.find(i);
-            if ( modifiers.end() != found ) {
-                boneTransforms[i] = found->second->makeTransform(elapsed, i, interf);
-            }
-            else {
-                boneTransforms[i] = this->m_joints[i].makeTransform(animTick);
-            }
-        }
+        pose.resize(numBones);
+        cursors.resize(numBones);
 
+        jointID_t numSampled = 0;
         for ( dal::jointID_t i = 0; i < numBones; ++i ) {
-            dal::jointID_t curBone = i;
-            glm::mat4 totalTrans = interf.at(i).offsetInv();
-            while ( curBone != -1 ) {
-                totalTrans = interf.at(curBone).toParent() * boneTransforms[curBone] * totalTrans;
-                curBone = interf.at(curBone).parentIndex();
+            if ( ::isSkipped(interf.at(i), lod, canSkip) || (nullptr != mask && 0.f == mask[i]) ) {
+                continue;
             }
-            transformArr.setTransform(i, totalTrans);
+
+            this->m_joints[i].sample(animTick, cursors[i], pose, i);
+            ++numSampled;
         }
+
+        return numSampled;
+    }
+
+    jointID_t Animation::sample2(
+        const float elapsed,
+        const float animTick,
+        const SkeletonInterface& interf,
+        JointTransformArray& transformArr,
+        const jointModifierRegistry_t& modifiers,
+        PoseWorkspace& workspace,
+        const AnimationLOD& lod
+    ) const {
+        const auto canSkip = ::canSkipJoints(workspace, interf);
+
+        this->sampleLocal(animTick, interf, workspace.m_pose, workspace.m_cursors, lod, canSkip, nullptr);
+        return ::composePose(elapsed, interf, transformArr, modifiers, workspace, lod, canSkip);
     }
 
     float Animation::calcAnimTick(const float seconds) const {
@@ -310,9 +452,27 @@ namespace dal {
 
     void AnimationState::setSelectedAnimeIndex(const unsigned int index) {
         if ( this->m_selectedAnimIndex != index ) {
-            this->m_selectedAnimIndex = index;
-            this->m_localTimeAccumulator = 0.0f;
+            this->restartSelected(index);
+            this->m_crossFade.m_isActive = false;
+            this->m_sparsePoses.m_isValid = false;
+        }
+    }
+
+    void AnimationState::crossFade(const unsigned int index, const float duration) {
+        if ( duration <= 0.f ) {
+            this->setSelectedAnimeIndex(index);
+            return;
         }
+        if ( this->m_selectedAnimIndex == index ) {
+            return;
+        }
+
+        // Clip being faded out already is dropped, which pops a little only if it had much weight left.
+        this->m_crossFade.m_fromIndex = this->m_selectedAnimIndex;
+        this->m_crossFade.m_fromTime = this->m_localTimeAccumulator;
+        this->m_crossFade.m_duration = duration;
+        this->m_crossFade.m_isActive = true;
+        this->restartSelected(index);
     }
 
     void AnimationState::setTimeScale(const float scale) {
@@ -323,23 +483,175 @@ namespace dal {
         this->m_modifiers.emplace(jid, std::move(mod));
     }
 
+    // Private
+
+    void AnimationState::restartSelected(const unsigned int index) {
+        for ( auto& layer : this->m_layers ) {
+            layer.m_timeOffset += this->m_localTimeAccumulator;
+        }
+
+        // Sparse poses are timed by elapsed time too, which goes on from 0 now.
+        this->m_sparsePoses.m_fromTime -= this->m_localTimeAccumulator;
+        this->m_sparsePoses.m_toTime -= this->m_localTimeAccumulator;
+        this->m_sparsePoses.m_lastElapsed -= this->m_localTimeAccumulator;
+
+        this->m_selectedAnimIndex = index;
+        this->m_localTimeAccumulator = 0.0f;
+    }
+
+}
+
+
+// Sampling states
+namespace {
+
+    // Samples selected clip of state at time into its workspace pose, with cross-fade and layers blended onto it.
+    // Returns number of joints of selected clip sampled, which doesn't count ones of other clips blended onto them.
+    // Selected clip must be in range.
+    dal::jointID_t sampleBlendedPose(dal::AnimationState& state, const std::vector<dal::Animation>& anims, const dal::SkeletonInterface& skeletonInterf,
+        const float time, const dal::AnimationLOD& lod, const bool canSkip)
+    {
+        const auto selectedAnimIndex = state.getSelectedAnimeIndex();
+        dalAssert(selectedAnimIndex < anims.size());
+
+        const auto& anim = anims[selectedAnimIndex];
+        auto& workspace = state.getWorkspace();
+        auto& fade = state.getCrossFade();
+        auto& layers = state.getLayers();
+
+        const auto numBones = skeletonInterf.getSize();
+        workspace.m_sources.resize(layers.size() + 1);
+
+        const auto numSampled = anim.sampleLocal(anim.calcAnimTick(time), skeletonInterf, workspace.m_pose, workspace.m_cursors, lod, canSkip, nullptr);
+
+        if ( fade.m_isActive ) {
+            const auto weight = time / fade.m_duration;
+            if ( weight >= 1.f || fade.m_fromIndex >= anims.size() ) {
+                fade.m_isActive = false;
+            }
+            else {
+                const auto& fromAnim = anims[fade.m_fromIndex];
+                auto& source = workspace.m_sources[0];
+                fromAnim.sampleLocal(fromAnim.calcAnimTick(fade.m_fromTime + time), skeletonInterf, source.m_pose, source.m_cursors, lod, canSkip, nullptr);
+                dal::blendPoses(workspace.m_pose, source.m_pose, 1.f - std::max(weight, 0.f), nullptr);
+            }
+        }
+
+        for ( size_t i = 0; i < layers.size(); ++i ) {
+            const auto& layer = layers[i];
+            if ( layer.m_weight <= 0.f || layer.m_animIndex >= anims.size() ) {
+                continue;
+            }
+
+            dalAssert(layer.m_mask.empty() || layer.m_mask.size() == static_cast<size_t>(numBones));
+            const auto mask = layer.m_mask.empty() ? nullptr : layer.m_mask.data();
+            const auto& layerAnim = anims[layer.m_animIndex];
+            auto& source = workspace.m_sources[i + 1];
+            layerAnim.sampleLocal(layerAnim.calcAnimTick(time + layer.m_timeOffset), skeletonInterf, source.m_pose, source.m_cursors, lod, canSkip, mask);
+
+            if ( dal::BlendMode::additive == layer.m_mode ) {
+                if ( source.m_referenceAnimIndex != static_cast<int>(layer.m_animIndex) ) {
+                    std::vector<dal::KeyframeCursor> cursors;
+                    layerAnim.sampleLocal(0.f, skeletonInterf, source.m_reference, cursors, dal::AnimationLOD{}, false, nullptr);
+                    source.m_referenceAnimIndex = static_cast<int>(layer.m_animIndex);
+                }
+
+                dal::addPoses(workspace.m_pose, source.m_pose, source.m_reference, layer.m_weight, mask);
+            }
+            else {
+                dal::blendPoses(workspace.m_pose, source.m_pose, layer.m_weight, mask);
+            }
+        }
+
+        return numSampled;
+    }
+
 }
 
 
 // Functions
 namespace dal {
 
-    void updateAnimeState(AnimationState& state, const std::vector<Animation>& anims, const SkeletonInterface& skeletonInterf) {
+    jointID_t sampleAnimeState(AnimationState& state, const std::vector<Animation>& anims, const SkeletonInterface& skeletonInterf,
+        const float time, JointTransformArray& result, const AnimationLOD& lod)
+    {
+        if ( state.getSelectedAnimeIndex() >= anims.size() ) {
+            return 0;
+        }
+
+        auto& workspace = state.getWorkspace();
+        const auto canSkip = ::canSkipJoints(workspace, skeletonInterf);
+
+        ::sampleBlendedPose(state, anims, skeletonInterf, time, lod, canSkip);
+        return ::composePose(time, skeletonInterf, result, state.getModifiers(), workspace, lod, canSkip);
+    }
+
+    jointID_t updateAnimeState(AnimationState& state, const std::vector<Animation>& anims, const SkeletonInterface& skeletonInterf,
+        const std::vector<BakedAnimation>* const baked)
+    {
         const auto selectedAnimIndex = state.getSelectedAnimeIndex();
         if ( selectedAnimIndex >= anims.size() ) {
             //dalError(fmt::format("Selected animation's index is out of range: {}", selectedAnimIndex));
-            return;
+            return 0;
         }
 
-        const auto& anim = anims[selectedAnimIndex];
         const auto elapsed = state.getElapsed();
-        const auto animTick = anim.calcAnimTick(elapsed);
-        anim.sample2(elapsed, animTick, skeletonInterf, state.getTransformArray(), state.getModifiers());
+        const auto& lod = state.getLOD();
+        auto& poses = state.getSparsePoses();
+
+        const auto deltaTime = std::max(0.f, elapsed - poses.m_lastElapsed);
+        poses.m_lastElapsed = elapsed;
+
+        const auto canPlayBaked = BakedPlayback::off != state.getBakedPlayback() && nullptr != baked && selectedAnimIndex < baked->size() &&
+            (*baked)[selectedAnimIndex].isReady() && !state.getCrossFade().m_isActive && state.getLayers().empty() && state.getModifiers().empty();
+        if ( canPlayBaked ) {
+            poses.m_isValid = false;
+            (*baked)[selectedAnimIndex].sample(elapsed, BakedPlayback::interpolated == state.getBakedPlayback(), state.getTransformArray());
+            return 0;
+        }
+
+        if ( lod.m_interval <= 1 ) {
+            poses.m_isValid = false;
+            return sampleAnimeState(state, anims, skeletonInterf, elapsed, state.getTransformArray(), lod);
+        }
+
+        auto& workspace = state.getWorkspace();
+        const auto canSkip = ::canSkipJoints(workspace, skeletonInterf);
+
+        // Blended pose is copied out of workspace, which is overwritten by interpolated one every frame.
+        jointID_t numSampled = 0;
+        const auto sampleAt = [&](const float time, LocalPose& result) {
+            numSampled += ::sampleBlendedPose(state, anims, skeletonInterf, time, lod, canSkip);
+            result = workspace.m_pose;
+        };
+
+        if ( !poses.m_isValid ) {
+            sampleAt(elapsed, poses.m_to);
+            poses.m_toTime = elapsed;
+            poses.m_framesToNextSample = 0;
+            poses.m_isValid = true;
+        }
+
+        if ( 0 == poses.m_framesToNextSample ) {
+            // Sampled ahead to when next one will be, so that interpolated poses don't lag behind.
+            std::swap(poses.m_from, poses.m_to);
+            poses.m_fromTime = poses.m_toTime;
+            poses.m_toTime = elapsed + deltaTime * static_cast<float>(lod.m_interval);
+            sampleAt(poses.m_toTime, poses.m_to);
+            poses.m_framesToNextSample = lod.m_interval;
+        }
+        poses.m_framesToNextSample = std::min(poses.m_framesToNextSample, lod.m_interval) - 1;
+
+        const auto timeSpan = poses.m_toTime - poses.m_fromTime;
+        const auto factor = timeSpan > 0.f ? std::clamp((elapsed - poses.m_fromTime) / timeSpan, 0.f, 1.f) : 1.f;
+
+        // Interpolating translations, rotations and scales keeps joints from shrinking as blended matrices would.
+        // Composing them is cheap next to sampling keyframes, so it is done every frame.
+        workspace.m_pose = poses.m_from;
+        blendPoses(workspace.m_pose, poses.m_to, factor, nullptr);
+        ::composePose(elapsed, skeletonInterf, state.getTransformArray(), state.getModifiers(), workspace, lod, canSkip);
+
+        return numSampled;
     }
 
 }
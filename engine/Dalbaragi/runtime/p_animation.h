@@ -12,6 +12,8 @@
 #include <daltools/scene/struct.h>
 
 #include "p_uniloc.h"
+#include "p_animclip.h"
+#include "p_animblend.h"
 #include "u_timer.h"
 
 
@@ -31,6 +33,7 @@ namespace dal {
         glm::mat4 m_spaceToParent;
         jointID_t m_parentIndex = -1;
         JointType m_jointType = JointType::basic;
+        bool m_isMinor = false;
 
     public:
         const std::string& name(void) const {
@@ -51,6 +54,10 @@ namespace dal {
         JointType jointType(void) const {
             return this->m_jointType;
         }
+        // Minor joints like fingers and hair may keep their last pose while character is far.
+        bool isMinor(void) const {
+            return this->m_isMinor;
+        }
 
         glm::vec3 localPos(void) const;
 
@@ -73,15 +80,20 @@ namespace dal {
         void setType(const JointType type) {
             this->m_jointType = type;
         }
+        void setMinor(const bool minor) {
+            this->m_isMinor = minor;
+        }
 
     };
 
+    // Joints are stored parents first, so a parent's index is always less than its children's. Loaders must keep it so.
     class SkeletonInterface {
 
     private:
         std::map<std::string, jointID_t> m_map;
         std::vector<JointInfo> m_boneInfo;
         jointID_t m_lastMadeIndex = -1;
+        float m_boundRadius = 0;
 
     public:
         SkeletonInterface(const SkeletonInterface&) = delete;
@@ -100,6 +112,13 @@ namespace dal {
 
         jointID_t getSize(void) const;
         bool isEmpty(void) const;
+        // Farthest distance of a joint from the first one in bind pose.
+        float boundRadius(void) const {
+            return this->m_boundRadius;
+        }
+
+        // Marks minor joints and measures bound radius. Call after offsets and parents of every joint are set.
+        void classifyJoints(void);
 
         void clear(void);
 
@@ -126,15 +145,50 @@ namespace dal {
     public:
         void setSize(const jointID_t size);
         void setTransform(const jointID_t index, const glm::mat4& mat);
-        void sendUniform(const UniInterf_Skeleton& uniloc) const;
 
         jointID_t getSize(void) const {
             return this->m_array.size();
         }
+        const glm::mat4& at(const jointID_t index) const {
+            return this->m_array[index];
+        }
+        const glm::mat4* data(void) const {
+            return this->m_array.data();
+        }
+
+    };
+
+
+    // Uniform buffer holding joint transforms of a character, which is uploaded once a frame and then
+    // bound for each render pass, instead of sending every joint to every shader.
+    // Buffer is made on first upload, so this may be constructed off the GL thread.
+    class SkinningBuffer {
+
+    private:
+        GLuint m_buffer = 0;
+
+    public:
+        SkinningBuffer(const SkinningBuffer&) = delete;
+        SkinningBuffer& operator=(const SkinningBuffer&) = delete;
+
+    public:
+        SkinningBuffer(void) = default;
+        SkinningBuffer(SkinningBuffer&& other) noexcept;
+        SkinningBuffer& operator=(SkinningBuffer&& other) noexcept;
+        ~SkinningBuffer(void);
+
+        void upload(const JointTransformArray& transforms);
+        // To JOINT_TRANSFORMS_BINDING, where shaders with UniInterf_Skeleton read it.
+        void bind(void) const;
+
+        bool isReady(void) const {
+            return 0 != this->m_buffer;
+        }
 
     };
 
 
+    // Characters are sampled on worker threads at once, so modifiers may only read what is shared between them.
     class IJointModifier {
 
     public:
@@ -146,13 +200,65 @@ namespace dal {
     using jointModifierRegistry_t = std::unordered_map<jointID_t, std::shared_ptr<IJointModifier>>;
 
 
+    // Keyframe each channel of a joint interpolated from when it was sampled last time.
+    // Playback moves forward a little every frame, so searching from there takes a step or two.
+    struct KeyframeCursor {
+        uint32_t m_pos = 0, m_rotate = 0, m_scale = 0;
+    };
+
+
+    // How much of a character is sampled. SceneGraph picks it every frame from how large the character looks on screen.
+    struct AnimationLOD {
+        // Samples once every this many frames, and poses between are interpolated.
+        unsigned m_interval = 1;
+        bool m_skipMinorJoints = false;
+        // Only root joints are sampled, which is for characters out of sight.
+        bool m_rootOnly = false;
+    };
+
+
+    // Clip other than selected one that is sampled to be blended, with its own keyframe cursors.
+    struct BlendSource {
+        LocalPose m_pose;
+        std::vector<KeyframeCursor> m_cursors;
+        // Pose at tick 0, which additive blending takes difference from.
+        LocalPose m_reference;
+        // Animation m_reference was sampled from, or -1.
+        int m_referenceAnimIndex = -1;
+    };
+
+
+    // Memory Animation::sample2 works on, kept by each animated instance so that it isn't allocated every frame.
+    struct PoseWorkspace {
+        // Pose of selected clip, onto which others are blended.
+        LocalPose m_pose;
+        // Joint to parent space transform of each joint, which skipped joints keep from last time they were sampled.
+        std::vector<glm::mat4> m_local;
+        // Joint to model space transform of each joint.
+        std::vector<glm::mat4> m_modelSpace;
+        std::vector<KeyframeCursor> m_cursors;
+        // First one is for clip being faded out, and the rest are for layers.
+        std::vector<BlendSource> m_sources;
+        // Whether every joint of m_local has been made since it was resized, which joints can't be skipped before.
+        bool m_isFullySampled = false;
+    };
+
+
     class Animation {
 
     public:
         class JointNode {
 
         private:
-            dal::parser::AnimJoint m_data;
+            std::string m_name;
+            KeyframeChannel<glm::vec3> m_pos;
+            KeyframeChannel<glm::quat> m_rotate;
+            KeyframeChannel<float> m_scale;
+            // Replace ones above once compressed.
+            CompressedChannel<glm::vec3> m_packedPos;
+            CompressedChannel<glm::quat> m_packedRotate;
+            CompressedChannel<float> m_packedScale;
+            bool m_isCompressed = false;
 
         public:
             JointNode(const JointNode&) = delete;
@@ -163,38 +269,44 @@ namespace dal {
         public:
             JointNode() = default;
 
-            void set(const dal::parser::AnimJoint& data) {
-                this->m_data = data;
-            }
+            void set(const dal::parser::AnimJoint& data);
 
             void setName(const std::string& name) {
-                this->m_data.name_ = name;
+                this->m_name = name;
             }
 
             void addPos(const float timepoint, const glm::vec3& pos) {
-                this->m_data.add_position(timepoint, pos.x, pos.y, pos.z);
+                this->m_pos.add(timepoint, pos);
             }
 
             void addRotation(const float timepoint, const glm::quat& rot) {
-                this->m_data.add_rotation(timepoint, rot.w, rot.x, rot.y, rot.z);
+                this->m_rotate.add(timepoint, rot);
             }
 
             void addScale(const float timepoint, const float scale) {
-                this->m_data.add_scale(timepoint, scale);
+                this->m_scale.add(timepoint, scale);
             }
 
             const std::string& name(void) const {
-                return this->m_data.name_;
+                return this->m_name;
             }
+            bool isCompressed(void) const {
+                return this->m_isCompressed;
+            }
+
+            // Keyframes are sampled from compressed ones afterwards, and uncompressed ones are freed.
+            void compress(const AnimCompressConfig& config);
+            size_t calcMemorySize(void) const;
 
+            // Searches keyframes from scratch.
             glm::mat4 makeTransform(const float animTick) const;
+            // Searches keyframes from where cursor points to, and moves it to where they are found.
+            glm::mat4 makeTransform(const float animTick, KeyframeCursor& cursor) const;
+            // Same as above, but into joint of pose at index.
+            void sample(const float animTick, KeyframeCursor& cursor, LocalPose& pose, const size_t index) const;
 
         private:
-            bool hasKeyframes(void) const;
-
-            glm::vec3 makePosInterp(const float animTick) const;
-            glm::quat makeRotateInterp(const float animTick) const;
-            float makeScaleInterp(const float animTick) const;
+            void sampleChannels(const float animTick, KeyframeCursor& cursor, glm::vec3& pos, glm::quat& rotate, float& scale) const;
 
         };
 
@@ -225,20 +337,77 @@ namespace dal {
         float getDurationInTick(void) const {
             return this->m_durationInTick;
         }
+        const std::vector<JointNode>& getJoints(void) const {
+            return this->m_joints;
+        }
 
-        void sample2(const float elapsed, const float animTick, const SkeletonInterface& interf,
-            JointTransformArray& transformArr, const jointModifierRegistry_t& modifiers) const;
+        void compress(const AnimCompressConfig& config);
+        // Bytes taken by keyframes.
+        size_t calcMemorySize(void) const;
+
+        // Samples joint to parent space transforms only, of joints lod doesn't skip and mask isn't zero at.
+        // Param mask may be null, and canSkip is false until every joint has been sampled once. Returns number of joints sampled.
+        jointID_t sampleLocal(const float animTick, const SkeletonInterface& interf, LocalPose& pose, std::vector<KeyframeCursor>& cursors,
+            const AnimationLOD& lod, const bool canSkip, const float* const mask) const;
+        // Returns number of joints sampled, which lod may have skipped some of.
+        jointID_t sample2(const float elapsed, const float animTick, const SkeletonInterface& interf, JointTransformArray& transformArr,
+            const jointModifierRegistry_t& modifiers, PoseWorkspace& workspace, const AnimationLOD& lod) const;
         float calcAnimTick(const float seconds) const;
 
     };
 
 
+    enum class BlendMode { override, additive };
+
+    // Clip played on top of selected one of AnimationState.
+    struct AnimationLayer {
+        unsigned int m_animIndex = 0;
+        BlendMode m_mode = BlendMode::override;
+        float m_weight = 1;
+        // Multiplied to m_weight for each joint, so that a layer moves only part of body. Empty means 1 for all.
+        std::vector<float> m_mask;
+        // Added to elapsed time of state, which restarts whenever selected clip changes, so that layers keep playing.
+        float m_timeOffset = 0;
+    };
+
+
+    class BakedAnimation;
+
+    // Whether characters play baked clips, which is only when nothing is blended onto or modifies them.
+    enum class BakedPlayback { off, nearest, interpolated };
+
+
     class AnimationState {
 
+    public:
+        // Clip that was selected before, blended out over m_duration.
+        struct CrossFade {
+            unsigned int m_fromIndex = 0;
+            // Playback time of m_fromIndex when it was left, which keeps going on during fade.
+            float m_fromTime = 0;
+            float m_duration = 0;
+            bool m_isActive = false;
+        };
+
+        // Poses sampled once every few frames, between which the final one is interpolated in joint to parent space.
+        struct SparsePoses {
+            LocalPose m_from, m_to;
+            float m_fromTime = 0, m_toTime = 0;
+            float m_lastElapsed = 0;
+            unsigned m_framesToNextSample = 0;
+            bool m_isValid = false;
+        };
+
     private:
         Timer m_localTimer;
         JointTransformArray m_finalTransform;
+        PoseWorkspace m_workspace;
+        AnimationLOD m_lod;
+        BakedPlayback m_bakedPlayback = BakedPlayback::off;
+        SparsePoses m_sparsePoses;
         jointModifierRegistry_t m_modifiers;
+        CrossFade m_crossFade;
+        std::vector<AnimationLayer> m_layers;
         unsigned int m_selectedAnimIndex = 0;
         float m_timeScale = 1.0f;
         float m_localTimeAccumulator = 0.0f;
@@ -246,19 +415,60 @@ namespace dal {
     public:
         float getElapsed(void);
         JointTransformArray& getTransformArray(void);
+        PoseWorkspace& getWorkspace(void) {
+            return this->m_workspace;
+        }
+        SparsePoses& getSparsePoses(void) {
+            return this->m_sparsePoses;
+        }
+        const AnimationLOD& getLOD(void) const {
+            return this->m_lod;
+        }
+        void setLOD(const AnimationLOD& lod) {
+            this->m_lod = lod;
+        }
+        BakedPlayback getBakedPlayback(void) const {
+            return this->m_bakedPlayback;
+        }
+        void setBakedPlayback(const BakedPlayback playback) {
+            this->m_bakedPlayback = playback;
+        }
         unsigned int getSelectedAnimeIndex(void) const;
 
+        // Snaps to the clip.
         void setSelectedAnimeIndex(const unsigned int index);
+        // Blends from current clip to the one over duration in seconds.
+        void crossFade(const unsigned int index, const float duration);
         void setTimeScale(const float scale);
 
+        CrossFade& getCrossFade(void) {
+            return this->m_crossFade;
+        }
+        std::vector<AnimationLayer>& getLayers(void) {
+            return this->m_layers;
+        }
+
         void addModifier(const jointID_t jid, std::shared_ptr<IJointModifier> mod);
         const jointModifierRegistry_t& getModifiers(void) const {
             return this->m_modifiers;
         }
 
+    private:
+        // Selected clip plays from the start, while layers keep going.
+        void restartSelected(const unsigned int index);
+
     };
 
 
-    void updateAnimeState(AnimationState& state, const std::vector<Animation>& anims, const SkeletonInterface& skeletonInterf);
+    // Samples selected clip of state at time with cross-fade and layers blended onto it, then makes joint transforms.
+    // Returns number of joints sampled, which is less than size of skeleton if lod skipped some.
+    jointID_t sampleAnimeState(AnimationState& state, const std::vector<Animation>& anims, const SkeletonInterface& skeletonInterf,
+        const float time, JointTransformArray& result, const AnimationLOD& lod);
+
+    // Returns number of joints sampled, which is less than size of skeleton if LOD of state skipped some, or 0 if baked one was played.
+    // With sparse sampling it is 0 on frames which only interpolate, and sums every sample taken on frames which do.
+    // Param baked has the same indices as anims, or is null or empty if none are baked.
+    jointID_t updateAnimeState(AnimationState& state, const std::vector<Animation>& anims, const SkeletonInterface& skeletonInterf,
+        const std::vector<BakedAnimation>* const baked = nullptr);
 
 }
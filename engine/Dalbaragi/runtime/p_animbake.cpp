@@ -0,0 +1,95 @@
+#include "p_animbake.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include <d_logger.h>
+
+
+namespace {
+
+    // Model space position of each joint is what skinning transform moves joint's own bind position to.
+    float calcMaxJointError(const dal::SkeletonInterface& skeleton, const dal::JointTransformArray& a, const dal::JointTransformArray& b) {
+        float result = 0;
+
+        for ( dal::jointID_t i = 0; i < skeleton.getSize(); ++i ) {
+            const glm::vec4 bindPos{ skeleton.at(i).localPos(), 1 };
+            result = std::max(result, glm::distance(glm::vec3{ a.at(i) * bindPos }, glm::vec3{ b.at(i) * bindPos }));
+        }
+
+        return result;
+    }
+
+}
+
+
+namespace dal {
+
+    void BakedAnimation::bake(const Animation& anim, const SkeletonInterface& skeleton, const float framesPerSec) {
+        dalAssert(framesPerSec > 0.f);
+
+        const auto duration = anim.getDurationInTick() / anim.getTickPerSec();
+        this->m_numJoints = skeleton.getSize();
+        this->m_numFrames = std::max<uint32_t>(1, static_cast<uint32_t>(std::ceil(duration * framesPerSec)));
+        this->m_frameInterval = duration / static_cast<float>(this->m_numFrames);
+        this->m_palettes.resize(static_cast<size_t>(this->m_numFrames) * this->m_numJoints);
+
+        const jointModifierRegistry_t noModifiers;
+        const AnimationLOD fullLOD;
+        PoseWorkspace workspace;
+        JointTransformArray sampled, baked;
+
+        const auto sampleAt = [&](const float seconds) {
+            anim.sample2(seconds, anim.calcAnimTick(seconds), skeleton, sampled, noModifiers, workspace, fullLOD);
+        };
+
+        for ( uint32_t i = 0; i < this->m_numFrames; ++i ) {
+            sampleAt(static_cast<float>(i) * this->m_frameInterval);
+            std::copy(sampled.data(), sampled.data() + this->m_numJoints, this->m_palettes.begin() + static_cast<size_t>(i) * this->m_numJoints);
+        }
+
+        this->m_maxErrorNearest = 0;
+        this->m_maxErrorInterp = 0;
+        for ( uint32_t i = 0; i < this->m_numFrames; ++i ) {
+            const auto halfway = (static_cast<float>(i) + 0.5f) * this->m_frameInterval;
+            sampleAt(halfway);
+
+            this->sample(halfway, false, baked);
+            this->m_maxErrorNearest = std::max(this->m_maxErrorNearest, ::calcMaxJointError(skeleton, sampled, baked));
+            this->sample(halfway, true, baked);
+            this->m_maxErrorInterp = std::max(this->m_maxErrorInterp, ::calcMaxJointError(skeleton, sampled, baked));
+        }
+    }
+
+    void BakedAnimation::sample(const float seconds, const bool interpolate, JointTransformArray& result) const {
+        dalAssert(this->isReady());
+        result.setSize(this->m_numJoints);
+
+        const auto duration = this->m_frameInterval * static_cast<float>(this->m_numFrames);
+        auto time = std::fmod(seconds, duration);
+        if ( time < 0.f ) {
+            time += duration;
+        }
+
+        const auto position = time / this->m_frameInterval;
+        const auto frame = std::min(static_cast<uint32_t>(position), this->m_numFrames - 1);
+        const auto next = (frame + 1) % this->m_numFrames;
+        const auto factor = position - static_cast<float>(frame);
+
+        if ( !interpolate ) {
+            const auto nearest = this->palette(factor < 0.5f ? frame : next);
+            for ( jointID_t i = 0; i < this->m_numJoints; ++i ) {
+                result.setTransform(i, nearest[i]);
+            }
+            return;
+        }
+
+        // Blending matrices shrinks joints rotating far, but baked frames are too close together for it to be visible.
+        const auto from = this->palette(frame);
+        const auto to = this->palette(next);
+        for ( jointID_t i = 0; i < this->m_numJoints; ++i ) {
+            result.setTransform(i, from[i] * (1.f - factor) + to[i] * factor);
+        }
+    }
+
+}
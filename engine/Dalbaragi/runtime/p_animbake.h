@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "p_animation.h"
+
+
+namespace dal {
+
+    // Joint transforms of a looping clip sampled at a fixed rate into one contiguous table.
+    // Characters playing it only look up their frame, instead of sampling keyframes and walking the skeleton.
+    class BakedAnimation {
+
+    private:
+        // Frame major, so that joint transforms of a frame are in a row.
+        std::vector<glm::mat4> m_palettes;
+        jointID_t m_numJoints = 0;
+        uint32_t m_numFrames = 0;
+        // In seconds, and frames divide duration of clip evenly so that the last one wraps to the first one.
+        float m_frameInterval = 0;
+        float m_maxErrorNearest = 0, m_maxErrorInterp = 0;
+
+    public:
+        void bake(const Animation& anim, const SkeletonInterface& skeleton, const float framesPerSec);
+
+        bool isReady(void) const {
+            return 0 != this->m_numFrames;
+        }
+        jointID_t numJoints(void) const {
+            return this->m_numJoints;
+        }
+        uint32_t numFrames(void) const {
+            return this->m_numFrames;
+        }
+        size_t memorySize(void) const {
+            return this->m_palettes.size() * sizeof(glm::mat4);
+        }
+        // Farthest a joint is off from sampled pose, halfway between baked frames where it is the worst.
+        float maxErrorNearest(void) const {
+            return this->m_maxErrorNearest;
+        }
+        float maxErrorInterp(void) const {
+            return this->m_maxErrorInterp;
+        }
+
+        const glm::mat4* palette(const uint32_t frame) const {
+            return this->m_palettes.data() + static_cast<size_t>(frame) * this->m_numJoints;
+        }
+        // Param seconds wraps around duration of clip. Frames are blended if interpolate, or the nearest one is copied.
+        void sample(const float seconds, const bool interpolate, JointTransformArray& result) const;
+
+    };
+
+}
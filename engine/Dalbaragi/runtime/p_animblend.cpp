@@ -0,0 +1,223 @@
+#include "p_animblend.h"
+
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <d_logger.h>
+
+#include <d_simdlane.h>
+
+
+// Kernels
+// Each one works on joints [i, i + lane count).
+namespace {
+
+    using namespace dal::simd;
+
+    template <typename F>
+    F weightAt(const float weight, const float* const mask, const size_t i) {
+        return nullptr == mask ? splat<F>(weight) : splat<F>(weight) * load<F>(mask + i);
+    }
+
+    template <typename F>
+    void normalizeQuat(F (&q)[4]) {
+        const auto lengthSqr = q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+        const auto lengthInv = splat<F>(1) / vsqrt(lengthSqr);
+        for ( auto& x : q ) {
+            x = x * lengthInv;
+        }
+    }
+
+    template <typename F>
+    void blendKernel(dal::LocalPose& dst, const dal::LocalPose& src, const float weight, const float* const mask, const size_t i) {
+        const auto w = weightAt<F>(weight, mask, i);
+
+        for ( unsigned axis = 0; axis < 3; ++axis ) {
+            const auto d = load<F>(dst.posArray(axis) + i);
+            const auto s = load<F>(src.posArray(axis) + i);
+            store(d + w * (s - d), dst.posArray(axis) + i);
+        }
+
+        {
+            const auto d = load<F>(dst.scaleArray() + i);
+            const auto s = load<F>(src.scaleArray() + i);
+            store(d + w * (s - d), dst.scaleArray() + i);
+        }
+
+        F d[4], s[4];
+        for ( unsigned c = 0; c < 4; ++c ) {
+            d[c] = load<F>(dst.rotateArray(c) + i);
+            s[c] = load<F>(src.rotateArray(c) + i);
+        }
+
+        // q and -q are the same rotation, and the one closer to d takes shorter arc.
+        const auto dot = d[0] * s[0] + d[1] * s[1] + d[2] * s[2] + d[3] * s[3];
+        F result[4];
+        for ( unsigned c = 0; c < 4; ++c ) {
+            result[c] = d[c] + w * (flipSign(s[c], dot) - d[c]);
+        }
+
+        ::normalizeQuat(result);
+        for ( unsigned c = 0; c < 4; ++c ) {
+            store(result[c], dst.rotateArray(c) + i);
+        }
+    }
+
+    // Components are x, y, z and w.
+    template <typename F>
+    void multiplyQuat(const F (&a)[4], const F (&b)[4], F (&out)[4]) {
+        out[0] = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+        out[1] = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+        out[2] = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+        out[3] = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+    }
+
+    template <typename F>
+    void addKernel(dal::LocalPose& dst, const dal::LocalPose& src, const dal::LocalPose& reference, const float weight, const float* const mask, const size_t i) {
+        const auto w = weightAt<F>(weight, mask, i);
+        const auto one = splat<F>(1);
+
+        for ( unsigned axis = 0; axis < 3; ++axis ) {
+            const auto d = load<F>(dst.posArray(axis) + i);
+            const auto s = load<F>(src.posArray(axis) + i);
+            const auto r = load<F>(reference.posArray(axis) + i);
+            store(d + w * (s - r), dst.posArray(axis) + i);
+        }
+
+        {
+            const auto d = load<F>(dst.scaleArray() + i);
+            const auto s = load<F>(src.scaleArray() + i);
+            const auto r = load<F>(reference.scaleArray() + i);
+            store(d * ((one - w) + w * (s / r)), dst.scaleArray() + i);
+        }
+
+        F d[4], s[4], rInv[4];
+        for ( unsigned c = 0; c < 4; ++c ) {
+            d[c] = load<F>(dst.rotateArray(c) + i);
+            s[c] = load<F>(src.rotateArray(c) + i);
+            // Conjugate is inverse of unit quaternion.
+            rInv[c] = c < 3 ? -load<F>(reference.rotateArray(c) + i) : load<F>(reference.rotateArray(c) + i);
+        }
+
+        // Rotation that takes reference to src, scaled by nlerp from identity along shorter arc.
+        F delta[4];
+        ::multiplyQuat(s, rInv, delta);
+        F scaled[4];
+        for ( unsigned c = 0; c < 3; ++c ) {
+            scaled[c] = w * flipSign(delta[c], delta[3]);
+        }
+        scaled[3] = one + w * (flipSign(delta[3], delta[3]) - one);
+
+        F result[4];
+        ::multiplyQuat(scaled, d, result);
+        ::normalizeQuat(result);
+        for ( unsigned c = 0; c < 4; ++c ) {
+            store(result[c], dst.rotateArray(c) + i);
+        }
+    }
+
+}
+
+
+// LocalPose
+namespace dal {
+
+    void LocalPose::resize(const size_t size) {
+        for ( auto& x : this->m_pos ) {
+            x.resize(size, 0.f);
+        }
+        for ( unsigned i = 0; i < 3; ++i ) {
+            this->m_rotate[i].resize(size, 0.f);
+        }
+        this->m_rotate[3].resize(size, 1.f);
+        this->m_scale.resize(size, 1.f);
+    }
+
+    void LocalPose::set(const size_t index, const glm::vec3& pos, const glm::quat& rotate, const float scale) {
+        for ( unsigned i = 0; i < 3; ++i ) {
+            this->m_pos[i][index] = pos[i];
+        }
+        this->m_rotate[0][index] = rotate.x;
+        this->m_rotate[1][index] = rotate.y;
+        this->m_rotate[2][index] = rotate.z;
+        this->m_rotate[3][index] = rotate.w;
+        this->m_scale[index] = scale;
+    }
+
+    glm::vec3 LocalPose::pos(const size_t index) const {
+        return glm::vec3{ this->m_pos[0][index], this->m_pos[1][index], this->m_pos[2][index] };
+    }
+
+    glm::quat LocalPose::rotate(const size_t index) const {
+        return glm::quat{ this->m_rotate[3][index], this->m_rotate[0][index], this->m_rotate[1][index], this->m_rotate[2][index] };
+    }
+
+    glm::mat4 LocalPose::makeTransform(const size_t index) const {
+        const glm::mat4 identity{ 1.0f };
+        const auto posMat = glm::translate(identity, this->pos(index));
+        const auto rotateMat = glm::mat4_cast(this->rotate(index));
+        const auto scaleMat = glm::scale(identity, glm::vec3{ this->scale(index) });
+
+        return posMat * rotateMat * scaleMat;
+    }
+
+}
+
+
+// Blend functions
+namespace dal {
+
+    void blendPoses(LocalPose& dst, const LocalPose& src, const float weight, const float* const mask) {
+#if DAL_SIMD_LANE_SSE || DAL_SIMD_LANE_NEON
+        dalAssert(dst.size() == src.size());
+
+        size_t i = 0;
+        for ( ; i + simd::FLOAT4_LANE_COUNT <= dst.size(); i += simd::FLOAT4_LANE_COUNT ) {
+            ::blendKernel<simd::Float4>(dst, src, weight, mask, i);
+        }
+        for ( ; i < dst.size(); ++i ) {
+            ::blendKernel<float>(dst, src, weight, mask, i);
+        }
+#else
+        blendPoses_scalar(dst, src, weight, mask);
+#endif
+    }
+
+    void blendPoses_scalar(LocalPose& dst, const LocalPose& src, const float weight, const float* const mask) {
+        dalAssert(dst.size() == src.size());
+
+        for ( size_t i = 0; i < dst.size(); ++i ) {
+            ::blendKernel<float>(dst, src, weight, mask, i);
+        }
+    }
+
+    void addPoses(LocalPose& dst, const LocalPose& src, const LocalPose& reference, const float weight, const float* const mask) {
+#if DAL_SIMD_LANE_SSE || DAL_SIMD_LANE_NEON
+        dalAssert(dst.size() == src.size() && dst.size() == reference.size());
+
+        size_t i = 0;
+        for ( ; i + simd::FLOAT4_LANE_COUNT <= dst.size(); i += simd::FLOAT4_LANE_COUNT ) {
+            ::addKernel<simd::Float4>(dst, src, reference, weight, mask, i);
+        }
+        for ( ; i < dst.size(); ++i ) {
+            ::addKernel<float>(dst, src, reference, weight, mask, i);
+        }
+#else
+        addPoses_scalar(dst, src, reference, weight, mask);
+#endif
+    }
+
+    void addPoses_scalar(LocalPose& dst, const LocalPose& src, const LocalPose& reference, const float weight, const float* const mask) {
+        dalAssert(dst.size() == src.size() && dst.size() == reference.size());
+
+        for ( size_t i = 0; i < dst.size(); ++i ) {
+            ::addKernel<float>(dst, src, reference, weight, mask, i);
+        }
+    }
+
+    const char* getPoseBlendBackendName(void) {
+        return dal::simd::getLaneBackendName();
+    }
+
+}
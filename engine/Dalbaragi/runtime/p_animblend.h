@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+
+// Blending of joint to parent space poses, which runs before they are composed into matrices.
+// Joints are blended 4 at once with SSE2 or NEON, or one by one where neither is available.
+// Scalar versions run the same sequence of float operations, so both give the same results unless compiler fuses them.
+namespace dal {
+
+    // Translation, rotation and uniform scale of each joint, each component in its own array.
+    class LocalPose {
+
+    private:
+        std::vector<float> m_pos[3];
+        // x, y, z and w.
+        std::vector<float> m_rotate[4];
+        std::vector<float> m_scale;
+
+    public:
+        // New joints are identity.
+        void resize(const size_t size);
+        size_t size(void) const {
+            return this->m_scale.size();
+        }
+
+        void set(const size_t index, const glm::vec3& pos, const glm::quat& rotate, const float scale);
+        glm::vec3 pos(const size_t index) const;
+        glm::quat rotate(const size_t index) const;
+        float scale(const size_t index) const {
+            return this->m_scale[index];
+        }
+        // Translate * rotate * scale, which is how keyframes are composed.
+        glm::mat4 makeTransform(const size_t index) const;
+
+        float* posArray(const unsigned axis) {
+            return this->m_pos[axis].data();
+        }
+        const float* posArray(const unsigned axis) const {
+            return this->m_pos[axis].data();
+        }
+        float* rotateArray(const unsigned component) {
+            return this->m_rotate[component].data();
+        }
+        const float* rotateArray(const unsigned component) const {
+            return this->m_rotate[component].data();
+        }
+        float* scaleArray(void) {
+            return this->m_scale.data();
+        }
+        const float* scaleArray(void) const {
+            return this->m_scale.data();
+        }
+
+    };
+
+
+    // Moves dst toward src by weight * mask[i] for each joint i. Rotations are nlerped along shorter arc.
+    // Param mask may be null, which means 1 for every joint. Sizes of poses and mask must be the same.
+    void blendPoses(LocalPose& dst, const LocalPose& src, const float weight, const float* const mask);
+    void blendPoses_scalar(LocalPose& dst, const LocalPose& src, const float weight, const float* const mask);
+
+    // Adds difference of src from reference to dst, scaled by weight * mask[i] for each joint i.
+    // Translations are added, rotations are multiplied from parent side and scales are multiplied.
+    void addPoses(LocalPose& dst, const LocalPose& src, const LocalPose& reference, const float weight, const float* const mask);
+    void addPoses_scalar(LocalPose& dst, const LocalPose& src, const LocalPose& reference, const float weight, const float* const mask);
+
+    // Name of instruction set blend functions are using.
+    const char* getPoseBlendBackendName(void);
+
+}
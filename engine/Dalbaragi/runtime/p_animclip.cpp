@@ -0,0 +1,338 @@
+#include "p_animclip.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <d_logger.h>
+
+
+namespace {
+
+    constexpr float QUANTIZE_MAX = 65535.f;
+    constexpr float QUAT_QUANTIZE_MAX = 32767.f;
+    constexpr float INV_SQRT2 = 0.70710678f;
+
+    // Cursor moves forward at most this many keyframes before falling back to binary search.
+    constexpr uint32_t MAX_CURSOR_STEPS = 4;
+    // Keyframe reduction never skips more than this many keyframes at once, which bounds import time of long clips.
+    constexpr size_t MAX_SKIP_SPAN = 1024;
+
+
+    float interpolate(const float start, const float end, const float factor) {
+        const auto delta = end - start;
+        return start + factor * delta;
+    }
+
+    glm::vec3 interpolate(const glm::vec3& start, const glm::vec3& end, const float factor) {
+        const auto delta = end - start;
+        return start + factor * delta;
+    }
+
+    glm::quat interpolate(const glm::quat& start, const glm::quat& end, const float factor) {
+        return glm::slerp(start, end, factor);
+    }
+
+    float calcError(const float a, const float b) {
+        return std::abs(a - b);
+    }
+
+    float calcError(const glm::vec3& a, const glm::vec3& b) {
+        return glm::length(a - b);
+    }
+
+    // Angle between two rotations. q and -q are the same rotation.
+    float calcError(const glm::quat& a, const glm::quat& b) {
+        const auto cosHalf = std::min(1.f, std::abs(glm::dot(a, b)));
+        return 2.f * std::acos(cosHalf);
+    }
+
+    // Index of the last keyframe at or before criteria, or 0 if none.
+    // Starts from cursor, which holds the result of previous search, and moves it to the result.
+    template <typename TimeT>
+    uint32_t findIndexToStartInterp(const std::vector<TimeT>& times, const float criteria, uint32_t& cursor) {
+        dalAssert(!times.empty());
+        const auto size = static_cast<uint32_t>(times.size());
+
+        // Playback is moving forward, so the result is the cursor or a few after it.
+        if ( cursor < size && (0 == cursor || times[cursor] <= criteria) ) {
+            for ( uint32_t i = cursor, steps = 0; steps < MAX_CURSOR_STEPS; ++i, ++steps ) {
+                if ( i + 1 >= size || criteria < times[i + 1] ) {
+                    cursor = i;
+                    return i;
+                }
+            }
+        }
+
+        // Seeked, looped or skipped many keyframes.
+        const auto found = std::upper_bound(times.begin(), times.end(), criteria, [](const float a, const TimeT b) {
+            return a < b;
+        });
+        cursor = times.begin() == found ? 0 : static_cast<uint32_t>(found - times.begin()) - 1;
+        return cursor;
+    }
+
+    // Factor out of [0, 1] means animTick is out of keyframes, where the start one is held.
+    template <typename T>
+    T interpolateClamped(const T& start, const T& end, const float factor) {
+        return interpolate(start, end, (0.0f <= factor && factor <= 1.0f) ? factor : 0.0f);
+    }
+
+
+    uint16_t quantize(const float value, const float min, const float step) {
+        if ( step <= 0.f ) {
+            return 0;
+        }
+
+        const auto scaled = std::round((value - min) / step);
+        return static_cast<uint16_t>(std::clamp(scaled, 0.f, QUANTIZE_MAX));
+    }
+
+    // Param values must not be empty.
+    dal::QuantizeRange<float> calcRange(const std::vector<float>& values) {
+        const auto [low, high] = std::minmax_element(values.begin(), values.end());
+        return dal::QuantizeRange<float>{ *low, (*high - *low) / QUANTIZE_MAX };
+    }
+
+    dal::QuantizeRange<glm::vec3> calcRange(const std::vector<glm::vec3>& values) {
+        glm::vec3 min{ std::numeric_limits<float>::max() };
+        glm::vec3 max{ -std::numeric_limits<float>::max() };
+
+        for ( auto& v : values ) {
+            min = glm::min(min, v);
+            max = glm::max(max, v);
+        }
+
+        return dal::QuantizeRange<glm::vec3>{ min, (max - min) / QUANTIZE_MAX };
+    }
+
+    dal::PackedValue<float> pack(const float value, const dal::QuantizeRange<float>& range) {
+        return dal::PackedValue<float>{ ::quantize(value, range.m_min, range.m_step) };
+    }
+
+    dal::PackedValue<glm::vec3> pack(const glm::vec3& value, const dal::QuantizeRange<glm::vec3>& range) {
+        return dal::PackedValue<glm::vec3>{ {
+            ::quantize(value.x, range.m_min.x, range.m_step.x),
+            ::quantize(value.y, range.m_min.y, range.m_step.y),
+            ::quantize(value.z, range.m_min.z, range.m_step.z),
+        } };
+    }
+
+    dal::PackedValue<glm::quat> pack(const glm::quat& value) {
+        const auto q = glm::normalize(value);
+        const float components[4] = { q.x, q.y, q.z, q.w };
+
+        unsigned largest = 0;
+        for ( unsigned i = 1; i < 4; ++i ) {
+            if ( std::abs(components[i]) > std::abs(components[largest]) ) {
+                largest = i;
+            }
+        }
+
+        // Dropped one must be positive to be recovered, and negating all of them keeps the rotation.
+        const auto sign = components[largest] < 0.f ? -1.f : 1.f;
+
+        dal::PackedValue<glm::quat> result;
+        for ( unsigned i = 0, k = 0; i < 4; ++i ) {
+            if ( i != largest ) {
+                const auto scaled = std::round((components[i] * sign + INV_SQRT2) / (2.f * INV_SQRT2) * QUAT_QUANTIZE_MAX);
+                result.m_data[k++] = static_cast<uint16_t>(std::clamp(scaled, 0.f, QUAT_QUANTIZE_MAX));
+            }
+        }
+
+        result.m_data[0] |= static_cast<uint16_t>((largest >> 1) << 15);
+        result.m_data[1] |= static_cast<uint16_t>((largest & 1) << 15);
+        return result;
+    }
+
+    float unpack(const dal::PackedValue<float>& value, const dal::QuantizeRange<float>& range) {
+        return range.m_min + static_cast<float>(value.m_data) * range.m_step;
+    }
+
+    glm::vec3 unpack(const dal::PackedValue<glm::vec3>& value, const dal::QuantizeRange<glm::vec3>& range) {
+        const glm::vec3 quantized{
+            static_cast<float>(value.m_data[0]),
+            static_cast<float>(value.m_data[1]),
+            static_cast<float>(value.m_data[2]),
+        };
+        return range.m_min + quantized * range.m_step;
+    }
+
+    glm::quat unpack(const dal::PackedValue<glm::quat>& value) {
+        const unsigned largest = ((value.m_data[0] >> 15) << 1) | (value.m_data[1] >> 15);
+
+        float components[4];
+        float sumSqr = 0;
+        for ( unsigned i = 0, k = 0; i < 4; ++i ) {
+            if ( i != largest ) {
+                const auto quantized = static_cast<float>(value.m_data[k++] & 0x7FFF);
+                components[i] = quantized / QUAT_QUANTIZE_MAX * (2.f * INV_SQRT2) - INV_SQRT2;
+                sumSqr += components[i] * components[i];
+            }
+        }
+        components[largest] = std::sqrt(std::max(0.f, 1.f - sumSqr));
+
+        return glm::quat{ components[3], components[0], components[1], components[2] };
+    }
+
+}
+
+
+// KeyframeChannel
+namespace dal {
+
+    template <typename T>
+    T KeyframeChannel<T>::sample(const float animTick, uint32_t& cursor) const {
+        dalAssert(!this->empty());
+
+        if ( 1 == this->m_times.size() ) {
+            return this->m_values[0];
+        }
+
+        const auto startIndex = ::findIndexToStartInterp(this->m_times, animTick, cursor);
+        const auto nextIndex = startIndex + 1;
+        if ( nextIndex >= this->m_times.size() ) {
+            return this->m_values.back();
+        }
+
+        const auto deltaTime = this->m_times[nextIndex] - this->m_times[startIndex];
+        const auto factor = (animTick - this->m_times[startIndex]) / deltaTime;
+        return ::interpolateClamped(this->m_values[startIndex], this->m_values[nextIndex], factor);
+    }
+
+    template struct KeyframeChannel<glm::vec3>;
+    template struct KeyframeChannel<glm::quat>;
+    template struct KeyframeChannel<float>;
+
+}
+
+
+// CompressedChannel
+namespace dal {
+
+    template <typename T>
+    void CompressedChannel<T>::build(const KeyframeChannel<T>& src, const float tolerance) {
+        if ( !src.empty() ) {
+            this->m_valueRange = ::calcRange(src.m_values);
+        }
+
+        this->reduceKeyframes(src, tolerance);
+    }
+
+    // Rotations have no value range to find.
+    template <>
+    void CompressedChannel<glm::quat>::build(const KeyframeChannel<glm::quat>& src, const float tolerance) {
+        this->reduceKeyframes(src, tolerance);
+    }
+
+    template <typename T>
+    T CompressedChannel<T>::sample(const float animTick, uint32_t& cursor) const {
+        dalAssert(!this->empty());
+
+        if ( 1 == this->m_times.size() ) {
+            return this->decode(this->m_values[0]);
+        }
+
+        // Searching in quantized units spares decoding every time it compares.
+        const auto criteria = this->m_timeStep > 0.f ? (animTick - this->m_timeBegin) / this->m_timeStep : 0.f;
+        const auto startIndex = ::findIndexToStartInterp(this->m_times, criteria, cursor);
+        const auto nextIndex = startIndex + 1;
+        if ( nextIndex >= this->m_times.size() ) {
+            return this->decode(this->m_values.back());
+        }
+
+        const auto startTime = static_cast<float>(this->m_times[startIndex]);
+        const auto deltaTime = static_cast<float>(this->m_times[nextIndex]) - startTime;
+        const auto factor = (criteria - startTime) / deltaTime;
+        return ::interpolateClamped(this->decode(this->m_values[startIndex]), this->decode(this->m_values[nextIndex]), factor);
+    }
+
+    // Private
+
+    template <typename T>
+    uint16_t CompressedChannel<T>::encodeTime(const float time) const {
+        return ::quantize(time, this->m_timeBegin, this->m_timeStep);
+    }
+
+    template <typename T>
+    float CompressedChannel<T>::decodeTime(const uint16_t time) const {
+        return this->m_timeBegin + static_cast<float>(time) * this->m_timeStep;
+    }
+
+    template <typename T>
+    PackedValue<T> CompressedChannel<T>::encode(const T& value) const {
+        return ::pack(value, this->m_valueRange);
+    }
+
+    template <>
+    PackedValue<glm::quat> CompressedChannel<glm::quat>::encode(const glm::quat& value) const {
+        return ::pack(value);
+    }
+
+    template <typename T>
+    T CompressedChannel<T>::decode(const PackedValue<T>& value) const {
+        return ::unpack(value, this->m_valueRange);
+    }
+
+    template <>
+    glm::quat CompressedChannel<glm::quat>::decode(const PackedValue<glm::quat>& value) const {
+        return ::unpack(value);
+    }
+
+    template <typename T>
+    void CompressedChannel<T>::reduceKeyframes(const KeyframeChannel<T>& src, const float tolerance) {
+        this->m_times.clear();
+        this->m_values.clear();
+        if ( src.empty() ) {
+            return;
+        }
+
+        const auto size = src.m_times.size();
+        this->m_timeBegin = src.m_times.front();
+        this->m_timeStep = (src.m_times.back() - src.m_times.front()) / QUANTIZE_MAX;
+
+        const auto keep = [&](const size_t index) {
+            this->m_times.push_back(this->encodeTime(src.m_times[index]));
+            this->m_values.push_back(this->encode(src.m_values[index]));
+        };
+
+        // Each kept keyframe reaches as far as it can while every one skipped stays within tolerance.
+        keep(0);
+        for ( size_t one = 0; one + 1 < size; ) {
+            auto two = one + 1;
+            while ( two + 1 < size && two + 1 - one <= MAX_SKIP_SPAN && this->canSkip(src, one, two + 1, tolerance) ) {
+                ++two;
+            }
+
+            keep(two);
+            one = two;
+        }
+
+        this->m_times.shrink_to_fit();
+        this->m_values.shrink_to_fit();
+    }
+
+    template <typename T>
+    bool CompressedChannel<T>::canSkip(const KeyframeChannel<T>& src, const size_t one, const size_t two, const float tolerance) const {
+        // Compared with what sample will decode, so that quantization error is counted too.
+        const auto oneTime = this->decodeTime(this->encodeTime(src.m_times[one]));
+        const auto twoTime = this->decodeTime(this->encodeTime(src.m_times[two]));
+        const auto oneValue = this->decode(this->encode(src.m_values[one]));
+        const auto twoValue = this->decode(this->encode(src.m_values[two]));
+
+        for ( auto i = one + 1; i < two; ++i ) {
+            const auto factor = (src.m_times[i] - oneTime) / (twoTime - oneTime);
+            const auto interpolated = ::interpolateClamped(oneValue, twoValue, factor);
+            if ( ::calcError(interpolated, src.m_values[i]) > tolerance ) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    template class CompressedChannel<glm::vec3>;
+    template class CompressedChannel<glm::quat>;
+    template class CompressedChannel<float>;
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+
+namespace dal {
+
+    // Largest error keyframe reduction may leave in each channel, measured at removed keyframes.
+    struct AnimCompressConfig {
+        float m_posTolerance = 0.0005f;
+        // In radians.
+        float m_rotateTolerance = 0.001f;
+        float m_scaleTolerance = 0.0005f;
+    };
+
+
+    // Keyframe times are kept apart from values, so that searching for a keyframe only touches contiguous numbers.
+    template <typename T>
+    struct KeyframeChannel {
+        std::vector<float> m_times;
+        std::vector<T> m_values;
+
+        void add(const float timepoint, const T& value) {
+            this->m_times.push_back(timepoint);
+            this->m_values.push_back(value);
+        }
+        bool empty(void) const {
+            return this->m_times.empty();
+        }
+        size_t memorySize(void) const {
+            return this->m_times.size() * sizeof(float) + this->m_values.size() * sizeof(T);
+        }
+
+        // Param cursor is the keyframe found last time, and is moved to the one found this time.
+        T sample(const float animTick, uint32_t& cursor) const;
+    };
+
+
+    template <typename T>
+    struct PackedValue;
+
+    template <>
+    struct PackedValue<glm::vec3> {
+        uint16_t m_data[3];
+    };
+
+    // Largest component is dropped, since unit length recovers it, and the other three, which lie within ±1/sqrt(2),
+    // are quantized to 15 bits each. Top bits of the first two tell which one was dropped.
+    template <>
+    struct PackedValue<glm::quat> {
+        uint16_t m_data[3];
+    };
+
+    template <>
+    struct PackedValue<float> {
+        uint16_t m_data;
+    };
+
+
+    // Values are m_min + quantized * m_step.
+    template <typename T>
+    struct QuantizeRange {
+        T m_min{}, m_step{};
+    };
+
+    // Components of unit quaternions are already in known range, so rotations have none.
+    template <>
+    struct QuantizeRange<glm::quat> {
+
+    };
+
+
+    // Times and values are quantized to 16 bits within range of the channel, and rotations are packed into 48 bits.
+    // Keyframes that interpolation between their neighbors reproduces within tolerance are removed.
+    template <typename T>
+    class CompressedChannel {
+
+    private:
+        std::vector<uint16_t> m_times;
+        std::vector<PackedValue<T>> m_values;
+        float m_timeBegin = 0, m_timeStep = 0;
+        QuantizeRange<T> m_valueRange;
+
+    public:
+        void build(const KeyframeChannel<T>& src, const float tolerance);
+
+        bool empty(void) const {
+            return this->m_times.empty();
+        }
+        size_t size(void) const {
+            return this->m_times.size();
+        }
+        size_t memorySize(void) const {
+            return this->m_times.size() * sizeof(uint16_t) + this->m_values.size() * sizeof(PackedValue<T>);
+        }
+
+        // Same as KeyframeChannel::sample.
+        T sample(const float animTick, uint32_t& cursor) const;
+
+    private:
+        uint16_t encodeTime(const float time) const;
+        float decodeTime(const uint16_t time) const;
+        PackedValue<T> encode(const T& value) const;
+        T decode(const PackedValue<T>& value) const;
+
+        // Fills times and values with keyframes kept, once value range is ready.
+        void reduceKeyframes(const KeyframeChannel<T>& src, const float tolerance);
+        // Whether keyframes between one and two can be dropped.
+        bool canSkip(const KeyframeChannel<T>& src, const size_t one, const size_t two, const float tolerance) const;
+
+    };
+
+}
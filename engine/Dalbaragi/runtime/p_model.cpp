@@ -124,6 +124,10 @@ namespace dal {
         this->m_animations = std::move(animations);
     }
 
+    void ModelAnimated::setBakedAnimations(std::vector<BakedAnimation>&& baked) {
+        this->m_bakedAnimations = std::move(baked);
+    }
+
     bool ModelAnimated::isReady(void) const {
         for ( const auto& unit : this->m_renderUnits ) {
             if ( !unit.m_mesh.isReady() ) {
@@ -135,12 +139,12 @@ namespace dal {
     }
 
 
-    void ModelAnimated::render(const UniRender_Animated uniloc, const JointTransformArray& transformArr) const {
-        if ( !this->isReady() ) {
+    void ModelAnimated::render(const UniRender_Animated uniloc, const SkinningBuffer& skinning) const {
+        if ( !this->isReady() || !skinning.isReady() ) {
             return;
         }
 
-        transformArr.sendUniform(uniloc.i_skeleton);
+        skinning.bind();
 
         for ( auto& unit : this->m_renderUnits ) {
             if ( !unit.m_mesh.isReady() ) {
@@ -153,10 +157,10 @@ namespace dal {
         }
     }
 
-    void ModelAnimated::render(const UniRender_AnimatedDepth& uniloc, const JointTransformArray& transformArr) const {
-        if ( !this->isReady() ) return;
+    void ModelAnimated::render(const UniRender_AnimatedDepth& uniloc, const SkinningBuffer& skinning) const {
+        if ( !this->isReady() || !skinning.isReady() ) return;
 
-        transformArr.sendUniform(uniloc.i_skeleton);
+        skinning.bind();
 
         for ( auto& unit : this->m_renderUnits ) {
             if ( !unit.m_mesh.isReady() ) {
@@ -167,12 +171,12 @@ namespace dal {
         }
     }
 
-    void ModelAnimated::render(const UniRender_AnimatedOnWater& uniloc, const JointTransformArray& transformArr) const {
-        if ( !this->isReady() ) {
+    void ModelAnimated::render(const UniRender_AnimatedOnWater& uniloc, const SkinningBuffer& skinning) const {
+        if ( !this->isReady() || !skinning.isReady() ) {
             return;
         }
 
-        transformArr.sendUniform(uniloc.i_skeleton);
+        skinning.bind();
 
         for ( auto& unit : this->m_renderUnits ) {
             if ( !unit.m_mesh.isReady() ) {
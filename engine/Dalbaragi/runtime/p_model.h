@@ -5,6 +5,7 @@
 #include <entt/entity/registry.hpp>
 
 #include "p_meshStatic.h"
+#include "p_animbake.h"
 
 
 namespace dal {
@@ -92,6 +93,8 @@ namespace dal {
     private:
         SkeletonInterface m_jointInterface;
         std::vector<Animation> m_animations;
+        // Same indices as m_animations. Empty if not baked.
+        std::vector<BakedAnimation> m_bakedAnimations;
 
     public:
         void* operator new(size_t size);
@@ -99,12 +102,13 @@ namespace dal {
 
         void setSkeletonInterface(SkeletonInterface&& joints);
         void setAnimations(std::vector<Animation>&& animations);
+        void setBakedAnimations(std::vector<BakedAnimation>&& baked);
 
         bool isReady(void) const;
 
-        void render(const UniRender_Animated uniloc, const JointTransformArray& transformArr) const;
-        void render(const UniRender_AnimatedDepth& uniloc, const JointTransformArray& transformArr) const;
-        void render(const UniRender_AnimatedOnWater& uniloc, const JointTransformArray& transformArr) const;
+        void render(const UniRender_Animated uniloc, const SkinningBuffer& skinning) const;
+        void render(const UniRender_AnimatedDepth& uniloc, const SkinningBuffer& skinning) const;
+        void render(const UniRender_AnimatedOnWater& uniloc, const SkinningBuffer& skinning) const;
 
         const SkeletonInterface& getSkeletonInterf(void) const {
             return this->m_jointInterface;
@@ -112,6 +116,9 @@ namespace dal {
         const std::vector<Animation>& getAnimations(void) const {
             return this->m_animations;
         }
+        const std::vector<BakedAnimation>& getBakedAnimations(void) const {
+            return this->m_bakedAnimations;
+        }
 
     };
 
@@ -125,6 +132,8 @@ namespace dal {
         struct AnimatedModel {
             std::shared_ptr<const ModelAnimated> m_model;
             AnimationState m_animState;
+            // Transform array of m_animState as of last upload, shared by every render pass of a frame.
+            SkinningBuffer m_skinning;
         };
 
     }
@@ -405,6 +405,7 @@ namespace dal {
         {
             float radio = static_cast<float>(m_winWidth) / static_cast<float>(m_winHeight);
             this->m_projectMat = glm::perspective(glm::radians(90.0f), radio, 0.01f, this->m_farPlaneDistance);
+            this->m_scene.setPlayerCamProjMat(this->m_projectMat);
 
             const auto shorter = this->m_winWidth < this->m_winHeight ? this->m_winWidth : this->m_winHeight;
             if ( shorter > MAX_SCREEN_RES ) {
@@ -469,6 +470,8 @@ namespace dal {
     }
 
     void RenderMaster::render(entt::registry& reg) {
+        this->m_scene.resetRenderStats();
+
         this->render_onShadowmaps();
 #if DAL_RENDER_WATER
         this->render_onWater(reg);
@@ -538,6 +541,7 @@ namespace dal {
 
         float radio = static_cast<float>(width) / static_cast<float>(height);
         this->m_projectMat = glm::perspective(glm::radians(90.0f), radio, 0.01f, this->m_farPlaneDistance);
+        this->m_scene.setPlayerCamProjMat(this->m_projectMat);
 
         const auto shorter = this->m_winWidth < this->m_winHeight ? this->m_winWidth : this->m_winHeight;
         if ( shorter > MAX_SCREEN_RES ) {
@@ -578,14 +582,15 @@ namespace dal {
             }
 
             {
+                // Depth may be clamped, where casters in front of near plane still cast shadows.
                 auto& uniloc = this->m_shader.useStaticDepth();
                 for ( auto s : slights ) {
                     s->startRenderShadowmap(uniloc);
-                    this->m_scene.render_staticDepth(uniloc);
+                    this->m_scene.render_staticDepth(uniloc, Frustum{ s->makeProjMat() * s->makeViewMat(), false });
                 }
                 for ( auto& d : this->m_scene.m_dlights ) {
                     d.startRenderShadowmap(uniloc);
-                    this->m_scene.render_staticDepth(uniloc);
+                    this->m_scene.render_staticDepth(uniloc, Frustum{ d.makeProjMat() * d.makeViewMat(), false });
                 }
             }
 
@@ -629,17 +634,20 @@ namespace dal {
             uniloc.viewPos(this->m_mainCamera->pos());
             uniloc.i_lighting.baseAmbient(this->m_baseAmbientColor);
 
+            const Frustum refracFrustum{ this->m_projectMat * this->m_mainCamera->viewMat() };
+
             for ( auto water : waters ) {
                 {
+                    const auto reflectedMat = this->m_mainCamera->makeReflected(water->height()).second;
                     water->startRenderOnReflec(uniloc, *this->m_mainCamera);
                     glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
-                    this->m_scene.render_staticOnWater(uniloc);
+                    this->m_scene.render_staticOnWater(uniloc, Frustum{ this->m_projectMat * reflectedMat });
                 }
 
                 {
                     water->startRenderOnRefrac(uniloc, *this->m_mainCamera);
                     glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
-                    this->m_scene.render_staticOnWater(uniloc);
+                    this->m_scene.render_staticOnWater(uniloc, refracFrustum);
                 }
             }
         }
@@ -739,7 +747,7 @@ namespace dal {
                     g_cubemapFbuf.readyFace(envmap->prefilterMap(), i, 0);
                     glClear(GL_DEPTH_BUFFER_BIT);
                     uniloc.viewMat(viewMats[i]);
-                    this->m_scene.render_staticOnEnvmap(uniloc);
+                    this->m_scene.render_staticOnEnvmap(uniloc, Frustum{ projMat * viewMats[i] });
                 }
             }
 
@@ -842,7 +850,7 @@ namespace dal {
             g_brdfLUT.sendUniform(uniloc.i_envmap.brdfLUT());
             //g_cubemapFbuf.m_depthMaps[0].sendUniform(uniloc.i_envmap.brdfLUT());
 
-            this->m_scene.render_static(uniloc);
+            this->m_scene.render_static(uniloc, Frustum{ this->m_projectMat * this->m_mainCamera->viewMat() });
         }
 
         // Render to framebuffer animated
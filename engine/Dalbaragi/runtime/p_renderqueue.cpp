@@ -0,0 +1,305 @@
+#include "p_renderqueue.h"
+
+#include <array>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+
+#include "p_resource.h"
+
+
+// Sort keys
+namespace {
+
+    constexpr unsigned PROGRAM_SHIFT = 60, LIGHTS_SHIFT = 52, ENVMAP_SHIFT = 44, DIFFUSE_SHIFT = 30, ROUGHNESS_SHIFT = 16;
+    constexpr uint64_t ID_MASK = 0xFF, TEXTURE_MASK = 0x3FFF, PROGRAM_MASK = 0xF;
+
+    // 0 for null. Ones past what key has room for share the last id, which only makes them group worse.
+    uint64_t findID(std::vector<const void*>& table, const void* const ptr) {
+        if ( nullptr == ptr ) {
+            return 0;
+        }
+
+        for ( size_t i = 0; i < table.size(); ++i ) {
+            if ( table[i] == ptr ) {
+                return std::min<uint64_t>(i + 1, ID_MASK);
+            }
+        }
+
+        table.push_back(ptr);
+        return std::min<uint64_t>(table.size(), ID_MASK);
+    }
+
+    uint64_t makeTextureBits(const std::shared_ptr<const dal::Texture>& texture) {
+        return nullptr != texture ? (texture->get() & TEXTURE_MASK) : 0;
+    }
+
+    // Bits of non negative float are in the same order as the float, and high 16 of them are a log scale quantization.
+    uint64_t makeDepthBits(const float distToFar) {
+        const auto dist = distToFar > 0.f ? distToFar : 0.f;
+        uint32_t bits;
+        std::memcpy(&bits, &dist, sizeof(float));
+        // Farther from far plane is nearer to camera, which goes first.
+        return 0xFFFF - (bits >> 16);
+    }
+
+}
+
+
+// Submitting
+namespace {
+
+    using Packet = dal::RenderQueue::Packet;
+    using SortItem = dal::RenderQueue::SortItem;
+
+    constexpr GLuint TEXTURE_NOT_SENT = std::numeric_limits<GLuint>::max();
+
+
+    // What was last sent for this queue. Everything starts unknown, since other draws may have changed any of it.
+    class SubmitState {
+
+    private:
+        dal::RenderQueueStats& m_stats;
+
+        const glm::mat4* m_modelMat = nullptr;
+        const dal::MapChunk2* m_lights = nullptr;
+        const dal::EnvMap* m_envmap = nullptr;
+        bool m_lightsSent = false, m_envmapSent = false, m_scalarsSent = false;
+        float m_roughness = 0, m_metallic = 0;
+        // Diffuse, roughness, metallic and normal map.
+        std::array<GLuint, 4> m_textures;
+
+    public:
+        SubmitState(dal::RenderQueueStats& stats)
+            : m_stats(stats)
+        {
+            this->m_textures.fill(TEXTURE_NOT_SENT);
+        }
+
+        template <typename U>
+        void modelMat(const U& uniloc, const glm::mat4* const mat) {
+            if ( this->m_modelMat == mat ) {
+                ++this->m_stats.m_stateSkipped;
+                return;
+            }
+
+            this->m_modelMat = mat;
+            ++this->m_stats.m_stateChanges;
+            uniloc.modelMat(*mat);
+        }
+
+        void lights(const dal::UniInterf_Lighting& uniloc, const dal::MapChunk2* const map) {
+            if ( this->m_lightsSent && this->m_lights == map ) {
+                ++this->m_stats.m_stateSkipped;
+                return;
+            }
+
+            this->m_lights = map;
+            this->m_lightsSent = true;
+            ++this->m_stats.m_stateChanges;
+
+            if ( nullptr != map ) {
+                map->sendPlightUniforms(uniloc);
+                map->sendSlightUniforms(uniloc);
+            }
+            else {
+                uniloc.plightCount(0);
+                uniloc.slightCount(0);
+            }
+        }
+
+        void envmap(const dal::UniInterf_Envmap& uniloc, const dal::EnvMap* const envmap) {
+            if ( this->m_envmapSent && this->m_envmap == envmap ) {
+                ++this->m_stats.m_stateSkipped;
+                return;
+            }
+
+            this->m_envmap = envmap;
+            this->m_envmapSent = true;
+            ++this->m_stats.m_stateChanges;
+
+            if ( nullptr != envmap ) {
+                dal::sendEnvmapUniform(*envmap, uniloc);
+            }
+            else {
+                uniloc.hasEnvmap(false);
+            }
+        }
+
+        void material(const dal::UniInterf_Lighting& lighting, const dal::UniInterf_Lightmap& lightmap, const dal::Material& material) {
+            if ( this->m_scalarsSent && this->m_roughness == material.m_roughness && this->m_metallic == material.m_metallic ) {
+                ++this->m_stats.m_stateSkipped;
+            }
+            else {
+                this->m_roughness = material.m_roughness;
+                this->m_metallic = material.m_metallic;
+                this->m_scalarsSent = true;
+                ++this->m_stats.m_stateChanges;
+                material.sendUniform(lighting);
+            }
+
+            this->texture(lightmap.diffuseMap(), material.m_diffuseMap.get(), this->m_textures[0]);
+            this->texture(lightmap.roughnessMap(), material.m_roughnessMap.get(), this->m_textures[1]);
+            this->texture(lightmap.metallicMap(), material.m_metallicMap.get(), this->m_textures[2]);
+#if DAL_NORMAL_MAPPING
+            this->texture(lightmap.normalMap(), material.m_normalMap.get(), this->m_textures[3]);
+#else
+            this->texture(lightmap.normalMap(), nullptr, this->m_textures[3]);
+#endif
+        }
+
+        void draw(const dal::MeshStatic& mesh) {
+            ++this->m_stats.m_draws;
+            mesh.draw();
+        }
+
+    private:
+        // Texture that is not ready is the same as having none, which only clears flag.
+        void texture(const dal::SamplerInterf& sampler, const dal::Texture* const texture, GLuint& bound) {
+            const GLuint id = (nullptr != texture && texture->isReady()) ? texture->get() : 0;
+            if ( bound == id ) {
+                ++this->m_stats.m_stateSkipped;
+                return;
+            }
+
+            bound = id;
+            ++this->m_stats.m_stateChanges;
+
+            if ( 0 != id ) {
+                texture->sendUniform(sampler);
+            }
+            else {
+                sampler.setFlagHas(false);
+            }
+        }
+
+    };
+
+
+    // Interfaces which are null are not part of the program, so their state is not sent.
+    template <typename U>
+    void submitPackets(const std::vector<Packet>& packets, const std::vector<SortItem>& items, const U& uniloc,
+        const dal::UniInterf_Lighting* const lighting, const dal::UniInterf_Lightmap* const lightmap, const dal::UniInterf_Envmap* const envmap,
+        dal::RenderQueueStats& stats)
+    {
+        SubmitState state{ stats };
+
+        for ( const auto& item : items ) {
+            const auto& packet = packets[item.m_index];
+
+            if ( nullptr != lighting ) {
+                state.lights(*lighting, packet.m_lights);
+            }
+            if ( nullptr != envmap ) {
+                state.envmap(*envmap, packet.m_envmap);
+            }
+            if ( nullptr != lighting && nullptr != lightmap ) {
+                state.material(*lighting, *lightmap, *packet.m_material);
+            }
+
+            state.modelMat(uniloc, packet.m_modelMat);
+            state.draw(*packet.m_mesh);
+        }
+    }
+
+}
+
+
+// RenderQueue
+namespace dal {
+
+    void RenderQueue::begin(const unsigned program, const Frustum& frustum, const bool sortByMaterial) {
+        this->m_packets.clear();
+        this->m_items.clear();
+        this->m_lightIDs.clear();
+        this->m_envmapIDs.clear();
+
+        this->m_farPlane = frustum.plane(5);
+        this->m_programBits = (static_cast<uint64_t>(program) & PROGRAM_MASK) << PROGRAM_SHIFT;
+        this->m_sortByMaterial = sortByMaterial;
+    }
+
+    void RenderQueue::push(const MeshStatic& mesh, const Material& material, const glm::mat4& modelMat, const MapChunk2* const lights, const EnvMap* const envmap, const glm::vec3& center) {
+        auto key = this->m_programBits;
+        if ( this->m_sortByMaterial ) {
+            key |= ::findID(this->m_lightIDs, lights) << LIGHTS_SHIFT;
+            key |= ::findID(this->m_envmapIDs, envmap) << ENVMAP_SHIFT;
+            key |= ::makeTextureBits(material.m_diffuseMap) << DIFFUSE_SHIFT;
+            key |= ::makeTextureBits(material.m_roughnessMap) << ROUGHNESS_SHIFT;
+        }
+        key |= ::makeDepthBits(glm::dot(glm::vec3{ this->m_farPlane }, center) + this->m_farPlane.w);
+
+        this->m_items.push_back(SortItem{ key, static_cast<uint32_t>(this->m_packets.size()) });
+        this->m_packets.push_back(Packet{ &mesh, &material, &modelMat, lights, envmap });
+    }
+
+    void RenderQueue::sort(void) {
+        dal::radixSortKeys(this->m_items, this->m_scratch);
+    }
+
+    void RenderQueue::submit(const UniRender_Static& uniloc, RenderQueueStats& stats) const {
+        ::submitPackets(this->m_packets, this->m_items, uniloc, &uniloc.i_lighting, &uniloc.i_lightmap, &uniloc.i_envmap, stats);
+    }
+
+    void RenderQueue::submit(const UniRender_StaticOnWater& uniloc, RenderQueueStats& stats) const {
+        ::submitPackets(this->m_packets, this->m_items, uniloc, &uniloc.i_lighting, &uniloc.i_lightmap, nullptr, stats);
+    }
+
+    void RenderQueue::submit(const UniRender_StaticDepth& uniloc, RenderQueueStats& stats) const {
+        ::submitPackets(this->m_packets, this->m_items, uniloc, nullptr, nullptr, nullptr, stats);
+    }
+
+}
+
+
+namespace dal {
+
+    void radixSortKeys(std::vector<RenderQueue::SortItem>& items, std::vector<RenderQueue::SortItem>& scratch) {
+        constexpr unsigned NUM_DIGITS = sizeof(uint64_t);
+
+        const auto numItems = items.size();
+        if ( numItems < 2 ) {
+            return;
+        }
+
+        // Histograms of all digits are counted in one read of keys.
+        std::array<std::array<uint32_t, 256>, NUM_DIGITS> counts{};
+        for ( const auto& item : items ) {
+            for ( unsigned d = 0; d < NUM_DIGITS; ++d ) {
+                ++counts[d][(item.m_key >> (d * 8)) & 0xFF];
+            }
+        }
+
+        scratch.resize(numItems);
+        auto src = &items, dst = &scratch;
+
+        for ( unsigned d = 0; d < NUM_DIGITS; ++d ) {
+            auto& count = counts[d];
+            const auto digit = [d](const uint64_t key) {
+                return static_cast<size_t>((key >> (d * 8)) & 0xFF);
+            };
+
+            // Every key falls in the same bucket, so this pass wouldn't move anything.
+            if ( numItems == count[digit(src->front().m_key)] ) {
+                continue;
+            }
+
+            uint32_t offset = 0;
+            for ( auto& c : count ) {
+                const auto n = c;
+                c = offset;
+                offset += n;
+            }
+
+            for ( const auto& item : *src ) {
+                (*dst)[count[digit(item.m_key)]++] = item;
+            }
+            std::swap(src, dst);
+        }
+
+        if ( src != &items ) {
+            items.swap(scratch);
+        }
+    }
+
+}
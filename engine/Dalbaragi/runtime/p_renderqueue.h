@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <d_frustum.h>
+
+#include "p_uniloc.h"
+#include "p_meshStatic.h"
+
+
+namespace dal {
+
+    class EnvMap;
+    class MapChunk2;
+
+
+    // Counted by RenderQueue::submit over all views of a render pass.
+    struct RenderQueueStats {
+        size_t m_draws = 0;
+        // Uniform uploads and texture binds, and ones skipped because the same state was already set.
+        // Sum of the two is what sending every state for every draw costs.
+        size_t m_stateChanges = 0, m_stateSkipped = 0;
+    };
+
+
+    // Draws of static render units in a view, sorted so that ones sharing state are submitted in a row.
+    // Sort key only decides order. Submitting compares actual state, so collisions of ids in keys never draw wrong.
+    class RenderQueue {
+
+    public:
+        struct Packet {
+            const MeshStatic* m_mesh;
+            const Material* m_material;
+            // Owner of transform must not move until submitted.
+            const glm::mat4* m_modelMat;
+            // Point and spot lights of this chunk are sent. Null for none.
+            const MapChunk2* m_lights;
+            // Null for no envmap.
+            const EnvMap* m_envmap;
+        };
+
+        // From the most significant bits: program, lights, envmap, diffuse map, roughness map and depth.
+        struct SortItem {
+            uint64_t m_key;
+            uint32_t m_index;
+        };
+
+    private:
+        std::vector<Packet> m_packets;
+        std::vector<SortItem> m_items, m_scratch;
+        // Pointers met in this queue, whose index + 1 goes into keys.
+        std::vector<const void*> m_lightIDs, m_envmapIDs;
+        // Far plane of the view, which shadow passes have unlike near plane.
+        glm::vec4 m_farPlane{ 0, 0, 0, 1 };
+        uint64_t m_programBits = 0;
+        bool m_sortByMaterial = true;
+
+    public:
+        // Param program is what this renderer has one per pass, which all draws of a queue share.
+        // Depth only passes don't bind materials, so they should be sorted only by depth.
+        void begin(const unsigned program, const Frustum& frustum, const bool sortByMaterial);
+        // Param center is world position for depth sorting. Front to back so that early depth test rejects more.
+        void push(const MeshStatic& mesh, const Material& material, const glm::mat4& modelMat, const MapChunk2* const lights, const EnvMap* const envmap, const glm::vec3& center);
+        void sort(void);
+
+        // Draws in sorted order, sending only state that differs from the previous draw.
+        void submit(const UniRender_Static& uniloc, RenderQueueStats& stats) const;
+        void submit(const UniRender_StaticOnWater& uniloc, RenderQueueStats& stats) const;
+        void submit(const UniRender_StaticDepth& uniloc, RenderQueueStats& stats) const;
+
+        size_t size(void) const {
+            return this->m_packets.size();
+        }
+
+    };
+
+
+    // Stable LSD radix sort by m_key, 8 bits a pass. Passes whose digit is the same in every key are skipped.
+    // Param scratch is resized to the size of items, kept to avoid allocating every frame.
+    void radixSortKeys(std::vector<RenderQueue::SortItem>& items, std::vector<RenderQueue::SortItem>& scratch);
+
+}
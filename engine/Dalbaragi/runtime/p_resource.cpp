@@ -1,6 +1,7 @@
 #include "p_resource.h"
 
 #include <limits>
+#include <cstring>
 
 #include <spdlog/fmt/fmt.h>
 #include <glm/gtc/matrix_transform.hpp>
@@ -10,6 +11,7 @@
 #include <d_filesystem.h>
 #include <d_mapparser.h>
 #include <d_debugview.h>
+#include <d_raybatch.h>
 
 #include "u_objparser.h"
 #include "s_configs.h"
@@ -97,15 +99,19 @@ namespace {
         public:
             const std::string in_modelID;
 
+            const float in_bakeRate;
+
             bool out_success;
             dal::ModelLoadInfo out_info;
+            std::vector<dal::BakedAnimation> out_baked;
 
             dal::ModelAnimated& data_coresponding;
             dal::Package& data_package;
 
         public:
-            TaskModelAnimated(const std::string& modelID, dal::ModelAnimated& coresponding, dal::Package& package)
+            TaskModelAnimated(const std::string& modelID, const float bakeRate, dal::ModelAnimated& coresponding, dal::Package& package)
                 : in_modelID(modelID),
+                in_bakeRate(bakeRate),
                 out_success(false),
                 data_coresponding(coresponding),
                 data_package(package)
@@ -119,6 +125,18 @@ namespace {
                 if ( 0 == this->out_info.m_model.m_joints.getSize() ) {
                     this->out_success = false;
                 }
+
+                // Clips that don't match skeleton are left unbaked, as they can't be played anyway.
+                if ( this->out_success && this->in_bakeRate > 0.f ) {
+                    const auto& skeleton = this->out_info.m_model.m_joints;
+                    this->out_baked.resize(this->out_info.m_animations.size());
+                    for ( size_t i = 0; i < this->out_baked.size(); ++i ) {
+                        const auto& anim = this->out_info.m_animations[i];
+                        if ( anim.getJoints().size() == static_cast<size_t>(skeleton.getSize()) ) {
+                            this->out_baked[i].bake(anim, skeleton, this->in_bakeRate);
+                        }
+                    }
+                }
             }
 
         };
@@ -189,8 +207,8 @@ namespace {
             this->m_map.emplace(task.get(), ResTyp::model_static);
             return std::move(task);
         }
-        std::unique_ptr<dal::ITask> newModelAnimated(const std::string& modelID, dal::ModelAnimated& coresponding, dal::Package& package) {
-            std::unique_ptr<dal::ITask> task{ new TaskModelAnimated(modelID, coresponding, package) };
+        std::unique_ptr<dal::ITask> newModelAnimated(const std::string& modelID, const float bakeRate, dal::ModelAnimated& coresponding, dal::Package& package) {
+            std::unique_ptr<dal::ITask> task{ new TaskModelAnimated(modelID, bakeRate, coresponding, package) };
             this->m_map.emplace(task.get(), ResTyp::model_animated);
             return std::move(task);
         }
@@ -383,118 +401,186 @@ namespace dal {
     }
 
 
-    void MapChunk2::findIntersctionsToStatic(const dal::AABB& aabb, std::vector<dal::AABB>& out_aabbs, dal::TriangleSorter& out_triangles) const {
-        auto& dview = dal::DebugViewGod::inst();
+    void MapChunk2::bakeStaticColliders(void) {
+        this->m_staticColliders.clear();
 
         for ( auto& modelActor : this->m_staticActors ) {
             const auto colBounding = modelActor.m_model->getBounding();
+            const auto colDetailed = modelActor.m_model->getDetailed();
             if ( nullptr == colBounding )
                 continue;
             assert(dal::ColliderType::aabb == colBounding->getColType());
 
             for ( auto& actor : modelActor.m_actors ) {
-                const auto box = reinterpret_cast<const ColAABB*>(colBounding)->transform(actor.m_transform.getPos(), actor.m_transform.getScale());
-
-                switch ( actor.m_colType ) {
+                if ( dal::ActorInfo::ColliderType::none == actor.m_colType )
+                    continue;
 
-                case dal::ActorInfo::ColliderType::aabb:
-                {
-                    if ( dal::isIntersecting(aabb, box) ) {
-                        out_aabbs.push_back(box);
+                auto& baked = this->m_staticColliders.emplace_back();
+                baked.m_colType = actor.m_colType;
+                baked.m_aabb = reinterpret_cast<const ColAABB*>(colBounding)->transform(actor.m_transform.getPos(), actor.m_transform.getScale());
 
-                        for ( auto& tri : box.makeTriangles() )
-                            dview.addTriangle(tri.point0(), tri.point1(), tri.point2(), glm::vec4{ 0, 0, 1, 0.2 });
-                    }
-                    else {
-                        for ( auto& tri : box.makeTriangles() )
-                            dview.addTriangle(tri.point0(), tri.point1(), tri.point2(), glm::vec4{ 0, 0, 0.3, 0.2 });
+                if ( dal::ActorInfo::ColliderType::mesh == actor.m_colType ) {
+                    if ( nullptr == colDetailed || dal::ColliderType::triangle_soup != colDetailed->getColType() ) {
+                        dalError(fmt::format("A actor '{}' with collider type 'mesh' doesn't have defailed collider", actor.m_name));
+                        this->m_staticColliders.pop_back();
+                        continue;
                     }
-                    break;
+
+                    const auto soup = reinterpret_cast<const dal::ColTriangleSoup*>(colDetailed);
+                    baked.m_soup = dal::TriangleSoupSoA{ *soup, actor.m_transform.getMat() };
+                    // Bounding box above ignores rotation, while the soup's one is exact.
+                    baked.m_aabb = baked.m_soup.aabb();
                 }
-                case dal::ActorInfo::ColliderType::mesh:
-                {
-                    if ( !dal::isIntersecting(aabb, box) ) {
-                        for ( const auto& tri : box.makeTriangles() )
-                            dview.addTriangle(tri.point0(), tri.point1(), tri.point2(), glm::vec4{ 0.3, 0, 0, 0.2 });
+            }
+        }
 
-                        continue;
-                    }
+        std::vector<dal::BVH::Bounds> bounds;
+        bounds.reserve(this->m_staticColliders.size());
+        for ( auto& col : this->m_staticColliders ) {
+            bounds.push_back(dal::BVH::Bounds{ col.m_aabb.min(), col.m_aabb.max() });
+        }
 
-                    const auto colDetailed = modelActor.m_model->getDetailed();
-                    if ( dal::ColliderType::triangle_soup == colDetailed->getColType() ) {
-                        const auto soup = reinterpret_cast<const dal::ColTriangleSoup*>(colDetailed);
-                        const auto transMat = actor.m_transform.getMat();
-
-                        for ( const auto& rawTri : *soup ) {
-                            const auto tri = rawTri.transform(transMat);
-                            if ( dal::isIntersecting(tri, aabb) ) {
-                                out_triangles.add(tri);
-                                dview.addTriangle(tri.point0(), tri.point1(), tri.point2(), glm::vec4{ 1, 0.3, 0.3, 0.2 });
-                            }
-                            else {
-                                dview.addTriangle(tri.point0(), tri.point1(), tri.point2(), glm::vec4{ 0.3, 0, 0, 0.2 });
-                            }
-                        }
-                    }
-                    else {
+        const auto order = this->m_staticBVH.build(bounds);
 
-                    }
-                    break;
-                }
-                default:
-                    break;
+        std::vector<StaticActorCollider> sorted;
+        sorted.reserve(order.size());
+        for ( const auto index : order ) {
+            sorted.push_back(std::move(this->m_staticColliders[index]));
+        }
+        this->m_staticColliders.swap(sorted);
+    }
 
+    void MapChunk2::bakeRenderBounds(void) {
+        size_t numActors = 0;
+        for ( const auto& modelActor : this->m_staticActors ) {
+            numActors += modelActor.m_actors.size();
+        }
+
+        this->m_actorBounds.clear();
+        this->m_actorBounds.reserve(numActors);
+
+        // Models without bounding box are never culled. Extents are finite so that plane tests don't produce NaN.
+        const AABB everywhere{ glm::vec3{ -1e18f }, glm::vec3{ 1e18f } };
+
+        for ( const auto& modelActor : this->m_staticActors ) {
+            const auto colBounding = modelActor.m_model->getBounding();
+
+            for ( const auto& actor : modelActor.m_actors ) {
+                if ( nullptr == colBounding ) {
+                    this->m_actorBounds.push_back(everywhere);
+                }
+                else {
+                    // Unlike colliders, render bounds include rotation so that actors never pop in.
+                    this->m_actorBounds.push_back(*reinterpret_cast<const ColAABB*>(colBounding), actor.m_transform.getMat());
                 }
             }
         }
     }
 
+    void MapChunk2::findIntersctionsToStatic(const dal::AABB& aabb, std::vector<dal::AABB>& out_aabbs, dal::TriangleSoupSoA& out_triangles) const {
+        this->queryStatic(aabb, [&](const StaticActorCollider& col) {
+            switch ( col.m_colType ) {
+
+            case dal::ActorInfo::ColliderType::aabb:
+                out_aabbs.push_back(col.m_aabb);
+                break;
+            case dal::ActorInfo::ColliderType::mesh:
+            {
+                this->m_triBuffer.clear();
+                dal::getIntersectingTriangles(aabb, col.m_soup, this->m_triBuffer);
+
+                for ( const auto& tri : this->m_triBuffer ) {
+                    out_triangles.addTriangle(tri);
+                }
+                break;
+            }
+            default:
+                break;
+
+            }
+        });
+    }
+
     std::optional<RayCastingResult> MapChunk2::castRayToClosest(const Segment& ray) const {
-        float closestDistance = std::numeric_limits<float>::max();
         std::optional<RayCastingResult> result{ std::nullopt };
 
-        for ( auto& modelActor : this->m_staticActors ) {
-            const auto mdlBounding = modelActor.m_model->getBounding();
-            const auto mdlDetailed = modelActor.m_model->getDetailed();
-            if ( nullptr == mdlBounding )
-                continue;
+        const auto rayLength = ray.length();
+        if ( 0.f == rayLength )
+            return result;
 
-            for ( auto& actor : modelActor.m_actors ) {
-                if ( dal::ActorInfo::ColliderType::aabb == actor.m_colType ) {
-                    const auto res = calcCollisionInfoAbs(ray, *mdlBounding, actor.m_transform);
-                    if ( !res )
-                        continue;
+        this->queryStatic(ray, [&](const StaticActorCollider& col, float& tMax) {
+            std::optional<RayCastingResult> res{ std::nullopt };
 
-                    if ( res->m_distance < closestDistance ) {
-                        closestDistance = res->m_distance;
-                        result = *res;
-                    }
+            if ( dal::ActorInfo::ColliderType::aabb == col.m_colType ) {
+                res = dal::findIntersection(ray, col.m_aabb);
+            }
+            else if ( dal::ActorInfo::ColliderType::mesh == col.m_colType ) {
+                res = dal::findIntersection(ray, col.m_soup);
+            }
+
+            if ( res ) {
+                const auto t = res->m_distance / rayLength;
+                if ( t < tMax ) {
+                    tMax = t;
+                    result = *res;
                 }
-                else if ( dal::ActorInfo::ColliderType::mesh == actor.m_colType ) {
-                    if ( nullptr == mdlDetailed ) {
-                        dalError(fmt::format("A actor '{}' with collider type 'mesh' doesn't have defailed collider", actor.m_name));
-                        continue;
-                    }
+            }
+        });
 
-                    if ( !checkCollisionAbs(ray, *mdlBounding, actor.m_transform) )
-                        continue;
+        return result;
+    }
 
-                    const auto res = calcCollisionInfoAbs(ray, *mdlDetailed, actor.m_transform);
-                    if ( !res )
-                        continue;
 
-                    if ( res->m_distance < closestDistance ) {
-                        closestDistance = res->m_distance;
-                        result = *res;
-                    }
+    void MapChunk2::castRaysToClosest(const Segment* const rays, const uint32_t count, const uint32_t mask,
+        std::optional<RayCastingResult>* const results) const
+    {
+        dalAssert(count <= 32);
+
+        glm::vec3 pos[32], rel[32];
+        float lengths[32], tMax[32];
+        uint32_t active = 0;
+
+        for ( uint32_t i = 0; i < count; ++i ) {
+            pos[i] = rays[i].pos();
+            rel[i] = rays[i].rel();
+            lengths[i] = rays[i].length();
+            tMax[i] = 0.f;
+
+            if ( 0 == (mask & (1u << i)) || 0.f == lengths[i] ) {
+                continue;
+            }
+
+            tMax[i] = results[i] ? std::min(BVH::SEGMENT_T_LIMIT, results[i]->m_distance / lengths[i]) : BVH::SEGMENT_T_LIMIT;
+            active |= 1u << i;
+        }
+
+        this->m_staticBVH.castSegmentPacket(pos, rel, count, tMax, active, [&](const uint32_t first, const uint32_t numColliders, const uint32_t rayMask) {
+            for ( uint32_t c = first; c < first + numColliders; ++c ) {
+                const auto& col = this->m_staticColliders[c];
+
+                if ( dal::ActorInfo::ColliderType::mesh == col.m_colType ) {
+                    dal::findIntersections(rays, count, rayMask, col.m_soup, results);
                 }
-                else {
-                    continue;
+                else if ( dal::ActorInfo::ColliderType::aabb == col.m_colType ) {
+                    for ( uint32_t i = 0; i < count; ++i ) {
+                        if ( 0 == (rayMask & (1u << i)) ) {
+                            continue;
+                        }
+
+                        const auto res = dal::findIntersection(rays[i], col.m_aabb);
+                        if ( res && (!results[i] || res->m_distance < results[i]->m_distance) ) {
+                            results[i] = *res;
+                        }
+                    }
                 }
             }
-        }
 
-        return result;
+            for ( uint32_t i = 0; i < count; ++i ) {
+                if ( 0 != (rayMask & (1u << i)) && results[i] ) {
+                    tMax[i] = std::min(tMax[i], results[i]->m_distance / lengths[i]);
+                }
+            }
+        });
     }
 
 
@@ -508,36 +594,28 @@ namespace dal {
     }
 
 
-    void MapChunk2::render_static(const UniRender_Static& uniloc) {
-        this->sendPlightUniforms(uniloc.i_lighting);
-        this->sendSlightUniforms(uniloc.i_lighting);
+    void MapChunk2::queueStaticActors(RenderQueue& queue, const Frustum& frustum, CullStats& stats, const bool withEnvmaps) {
+        this->cullActors(frustum, stats);
 
+        size_t actorIndex = 0;
         for ( const auto& [model, actors] : this->m_staticActors ) {
             for ( const auto& actor : actors ) {
+                if ( 0 == this->m_actorVisible[actorIndex++] ) {
+                    continue;
+                }
                 if ( !model->isReady() ) {
-                    return;
+                    continue;
                 }
 
-                uniloc.modelMat(actor.m_transform.getMat());
-
-                for ( int i = 0; i < model->renderUnits().size(); ++i ) {
+                for ( size_t i = 0; i < model->renderUnits().size(); ++i ) {
                     auto& unit = model->renderUnits()[i];
                     if ( !unit.m_mesh.isReady() ) {
                         continue;
                     }
 
                     const auto envmapIndex = actor.m_envmapIndices[i];
-                    if ( -1 != envmapIndex ) {
-                        sendEnvmapUniform(this->m_envmap[envmapIndex], uniloc.i_envmap);
-                    }
-                    else {
-                        uniloc.i_envmap.hasEnvmap(false);
-                    }
-
-                    unit.m_material.sendUniform(uniloc.i_lighting);
-                    unit.m_material.sendUniform(uniloc.i_lightmap);
-
-                    unit.m_mesh.draw();
+                    const auto envmap = (withEnvmaps && -1 != envmapIndex) ? &this->m_envmap[envmapIndex] : nullptr;
+                    queue.push(unit.m_mesh, unit.m_material, actor.m_transform.getMat(), this, envmap, actor.m_transform.getPos());
                 }
             }
         }
@@ -547,47 +625,14 @@ namespace dal {
 
     }
 
-    void MapChunk2::render_staticDepth(const UniRender_StaticDepth& uniloc) {
-        for ( const auto& [mdl, actors] : this->m_staticActors ) {
-            for ( const auto& actor : actors ) {
-                uniloc.modelMat(actor.m_transform.getMat());
-                mdl->render();
-            }
-        }
-    }
-
     void MapChunk2::render_animatedDepth(const UniRender_AnimatedDepth& uniloc) {
 
     }
 
-    void MapChunk2::render_staticOnWater(const UniRender_StaticOnWater& uniloc) {
-        this->sendPlightUniforms(uniloc.i_lighting);
-        this->sendSlightUniforms(uniloc.i_lighting);
-
-        for ( const auto& [model, actors] : this->m_staticActors ) {
-            for ( const auto& actor : actors ) {
-                uniloc.modelMat(actor.m_transform.getMat());
-                model->render(uniloc);
-            }
-        }
-    }
-
     void MapChunk2::render_animatedOnWater(const UniRender_AnimatedOnWater& uniloc) {
 
     }
 
-    void MapChunk2::render_staticOnEnvmap(const UniRender_Static& uniloc) {
-        this->sendPlightUniforms(uniloc.i_lighting);
-        this->sendSlightUniforms(uniloc.i_lighting);
-
-        for ( const auto& [model, actors] : this->m_staticActors ) {
-            for ( const auto& actor : actors ) {
-                uniloc.modelMat(actor.m_transform.getMat());
-                model->render(uniloc);
-            }
-        }
-    }
-
 
     int MapChunk2::sendPlightUniforms(const UniInterf_Lighting& uniloc) const {
         dalAssert(this->m_plights.size() <= 3);
@@ -613,6 +658,14 @@ namespace dal {
         return lsize;
     }
 
+    // Private
+
+    void MapChunk2::cullActors(const Frustum& frustum, CullStats& stats) {
+        const auto numDrawn = dal::cullAABBs(frustum, this->m_actorBounds, this->m_actorVisible);
+        stats.m_drawn += numDrawn;
+        stats.m_culled += this->m_actorBounds.size() - numDrawn;
+    }
+
 }
 
 
@@ -819,8 +872,18 @@ namespace dal {
 
             loaded->data_coresponding.setBounding(std::unique_ptr<ICollider>{new ColAABB{ loaded->out_info.m_model.m_aabb }});
 
+            for ( size_t i = 0; i < loaded->out_baked.size(); ++i ) {
+                const auto& baked = loaded->out_baked[i];
+                if ( baked.isReady() ) {
+                    dalInfo(fmt::format("Animation baked: {} of {}, {} frames, {} KB, max error {} nearest, {} interpolated",
+                        loaded->out_info.m_animations[i].getName(), loaded->in_modelID, baked.numFrames(), baked.memorySize() / 1024,
+                        baked.maxErrorNearest(), baked.maxErrorInterp()));
+                }
+            }
+
             loaded->data_coresponding.setSkeletonInterface(std::move(loaded->out_info.m_model.m_joints));
             loaded->data_coresponding.setAnimations(std::move(loaded->out_info.m_animations));
+            loaded->data_coresponding.setBakedAnimations(std::move(loaded->out_baked));
 
             loaded->data_coresponding.clearRenderUnits();
             loaded->data_coresponding.reserveRenderUnits(loaded->out_info.m_model.m_renderUnits.size());
@@ -897,7 +960,7 @@ namespace dal {
             model->setResID(resinfo.m_finalPath);
             package.giveModelAnim(resinfo.m_finalPath, modelHandle);
 
-            auto task = g_taskManger.newModelAnimated(respath, *model, package);
+            auto task = g_taskManger.newModelAnimated(respath, this->m_animBakeRate, *model, package);
             this->m_task.orderTask(std::move(task), this);
 
             return modelHandle;
@@ -939,14 +1002,15 @@ namespace dal {
         const auto loadResult = loadFileBuffer(respath, buffer);
         dalAssert(loadResult);
 
-        auto mapInfo = parseMapChunk_v1(buffer.data(), buffer.size());
+        auto mapInfo = parseMapChunk(buffer.data(), buffer.size());
         if ( !mapInfo ) {
             dalAbort(fmt::format("failed to parse map chunk: {}", respath));
         }
 
         MapChunk2 map;
 
-        for ( auto& modelInfo : mapInfo->m_models ) {
+        for ( size_t modelIndex = 0; modelIndex < mapInfo->m_models.size(); ++modelIndex ) {
+            auto& modelInfo = mapInfo->m_models[modelIndex];
             auto model = std::make_shared<ModelStatic>();
 
             for ( auto& unitInfo : modelInfo.m_renderUnits ) {
@@ -963,21 +1027,13 @@ namespace dal {
 
             model->setBounding(std::unique_ptr<ICollider>{new ColAABB{ modelInfo.m_aabb.m_min, modelInfo.m_aabb.m_max }});
 
-            if ( modelInfo.m_hasMeshCollider ) {
+            if ( modelIndex < mapInfo->m_colliders.size() && mapInfo->m_colliders[modelIndex].hasMeshCollider() ) {
+                const auto& colliderInfo = mapInfo->m_colliders[modelIndex];
                 auto soup = std::make_unique<dal::ColTriangleSoup>();
 
-                for ( auto& unitInfo : modelInfo.m_renderUnits ) {
-                    const auto& vertices = unitInfo.m_mesh.m_vertices;
-                    const auto vertSize = unitInfo.m_mesh.m_vertices.size() / 3;
-                    const auto numTriangles = vertSize / 3;
-
-                    for ( unsigned i = 0; i < numTriangles; ++i ) {
-                        const glm::vec3 p0{ vertices[9 * i + 0], vertices[9 * i + 1], vertices[9 * i + 2] };
-                        const glm::vec3 p1{ vertices[9 * i + 3], vertices[9 * i + 4], vertices[9 * i + 5] };
-                        const glm::vec3 p2{ vertices[9 * i + 6], vertices[9 * i + 7], vertices[9 * i + 8] };
-                        soup->addTriangle(dal::Triangle{ p0, p1, p2 });
-                    }
-                }
+                soup->resize(colliderInfo.numTriangles());
+                std::memcpy(soup->data(), colliderInfo.m_triangles.data(), colliderInfo.numTriangles() * sizeof(dal::Triangle));
+                soup->buildBVH();
 
                 model->setDetailed(std::unique_ptr<ICollider>{ soup.release() });
             }
@@ -1057,6 +1113,9 @@ namespace dal {
             slight.setStartFadeDegree(slightInfo.m_spotDegree * slightInfo.m_spotBlend * 0.3f);
         }
 
+        map.bakeStaticColliders();
+        map.bakeRenderBounds();
+
         return map;
     }
 
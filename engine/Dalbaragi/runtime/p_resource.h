@@ -5,12 +5,14 @@
 #include <unordered_map>
 
 #include <entt/entity/registry.hpp>
+#include <d_frustum.h>
 
 #include "s_threader.h"
 #include "p_meshStatic.h"
 #include "p_water.h"
 #include "p_model.h"
 #include "p_light.h"
+#include "p_renderqueue.h"
 #include "u_timer.h"
 
 
@@ -54,6 +56,12 @@ namespace dal {
     void sendEnvmapUniform(const dal::EnvMap& cubemap, const dal::UniInterf_Envmap& uniloc);
 
 
+    // Objects tested against view frustum of a render pass, counted over all of its views.
+    struct CullStats {
+        size_t m_drawn = 0, m_culled = 0;
+    };
+
+
     class MapChunk2 {
 
     private:
@@ -74,14 +82,33 @@ namespace dal {
             }
         };
 
+    public:
+        // Collision data of a static actor, baked into world space since static actors never move.
+        struct StaticActorCollider {
+            dal::AABB m_aabb;
+            // Empty unless collider type is mesh.
+            dal::TriangleSoupSoA m_soup;
+            ActorInfo::ColliderType m_colType = ActorInfo::ColliderType::none;
+        };
+
     public:
         std::vector<StaticModelActor> m_staticActors;
+        std::vector<StaticActorCollider> m_staticColliders;
         std::vector<WaterRenderer> m_waters;
         std::vector<EnvMap> m_envmap;
 
         std::vector<PointLight> m_plights;
         std::vector<SpotLight> m_slights;
 
+    private:
+        // Spatial index over world boxes of m_staticColliders.
+        dal::BVH m_staticBVH;
+        // World boxes of all actors in order of m_staticActors, for frustum culling.
+        dal::AABBArraySoA m_actorBounds;
+        std::vector<uint8_t> m_actorVisible;
+        // Reused by findIntersctionsToStatic to avoid allocating every frame.
+        mutable std::vector<dal::Triangle> m_triBuffer;
+
     public:
         MapChunk2(const MapChunk2&) = delete;
         MapChunk2& operator=(const MapChunk2&) = delete;
@@ -93,9 +120,12 @@ namespace dal {
 
         void onWinResize(const unsigned int winWidth, const unsigned int winHeight);
 
+        // Call bakeStaticColliders and bakeRenderBounds after static actors are all added.
         void addStaticActorModel(std::shared_ptr<const ModelStatic>&& model, std::vector<ActorInfo>&& actors) {
             this->m_staticActors.emplace_back(std::move(model), std::move(actors));
         }
+        void bakeStaticColliders(void);
+        void bakeRenderBounds(void);
         void addWaterPlane(const dlb::WaterPlane& waterInfo);
         PointLight& newPlight(void) {
             return this->m_plights.emplace_back();
@@ -104,22 +134,54 @@ namespace dal {
         void getWaters(std::vector<WaterRenderer*>& result);
         auto getClosestEnvMap(const glm::vec3& worldPos) const -> std::pair<const EnvMap*, float>;
 
-        void findIntersctionsToStatic(const dal::AABB& aabb, std::vector<dal::AABB>& out_aabbs, dal::TriangleSorter& out_triangles) const;
+        // Appends static collision geometry intersecting with the box. Outputs are not cleared.
+        void findIntersctionsToStatic(const dal::AABB& aabb, std::vector<dal::AABB>& out_aabbs, dal::TriangleSoupSoA& out_triangles) const;
         std::optional<RayCastingResult> castRayToClosest(const Segment& ray) const;
+        // Packet version of castRayToClosest for up to 32 rays whose bit is set in mask.
+        // Existing results are only replaced by closer hits. Safe to call from several threads at once.
+        void castRaysToClosest(const Segment* const rays, const uint32_t count, const uint32_t mask, std::optional<RayCastingResult>* const results) const;
+
+        // Calls func(const StaticActorCollider&) for each static collider whose world box overlaps given box.
+        template <typename F>
+        void queryStatic(const dal::AABB& aabb, F&& func) const {
+            this->m_staticBVH.queryOverlap(aabb.min(), aabb.max(), [&](const uint32_t first, const uint32_t count) {
+                for ( uint32_t i = first; i < first + count; ++i ) {
+                    if ( dal::isIntersecting(aabb, this->m_staticColliders[i].m_aabb) ) {
+                        func(this->m_staticColliders[i]);
+                    }
+                }
+                return false;
+            });
+        }
+
+        // Calls func(const StaticActorCollider&, float& tMax) for each static collider whose world box the segment may pass through, nearer ones first.
+        // tMax is parameter of the segment, starting at BVH::SEGMENT_T_LIMIT, which func can lower to skip farther colliders.
+        template <typename F>
+        void queryStatic(const dal::Segment& seg, F&& func) const {
+            this->m_staticBVH.castSegment(seg.pos(), seg.rel(), [&](const uint32_t first, const uint32_t count, float& tMax) {
+                for ( uint32_t i = first; i < first + count; ++i ) {
+                    func(this->m_staticColliders[i], tMax);
+                }
+                return false;
+            });
+        }
 
         void renderWater(const UniRender_Water& uniloc);
 
-        void render_static(const UniRender_Static& uniloc);
+        // Pushes render units of static actors in frustum with lights of this chunk. Ones outside are added to stats as culled.
+        // Envmaps are left out if not withEnvmaps, like for rendering envmaps themselves.
+        void queueStaticActors(RenderQueue& queue, const Frustum& frustum, CullStats& stats, const bool withEnvmaps);
         void render_animated(const UniRender_Animated& uniloc);
-        void render_staticDepth(const UniRender_StaticDepth& uniloc);
         void render_animatedDepth(const UniRender_AnimatedDepth& uniloc);
-        void render_staticOnWater(const UniRender_StaticOnWater& uniloc);
         void render_animatedOnWater(const UniRender_AnimatedOnWater& uniloc);
-        void render_staticOnEnvmap(const UniRender_Static& uniloc);
 
         int sendPlightUniforms(const UniInterf_Lighting& uniloc) const;
         int sendSlightUniforms(const UniInterf_Lighting& uniloc) const;
 
+    private:
+        // Fills m_actorVisible.
+        void cullActors(const Frustum& frustum, CullStats& stats);
+
     };
 
 
@@ -172,6 +234,7 @@ namespace dal {
 
         std::unordered_map<std::string, Package> m_packages;
         std::vector<std::shared_ptr<CubeMap>> m_cubeMaps;
+        float m_animBakeRate = 0;
 
         //////// Methods ////////
 
@@ -187,6 +250,10 @@ namespace dal {
 
         std::shared_ptr<const ModelStatic> orderModelStatic(const char* const respath);
         std::shared_ptr<const ModelAnimated> orderModelAnim(const char* const respath);
+        // Models already ordered are not affected. 0 disables baking.
+        void setAnimationBakeRate(const float framesPerSec) {
+            this->m_animBakeRate = framesPerSec;
+        }
         std::shared_ptr<const Texture> orderTexture(const char* const respath, const bool gammaCorrect);
         std::shared_ptr<const CubeMap> orderCubeMap(const std::array<std::string, 6>& respathes, const bool gammaCorrect);
 
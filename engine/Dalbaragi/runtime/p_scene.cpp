@@ -1,6 +1,9 @@
 #include "p_scene.h"
 
+#include <cmath>
 #include <limits>
+#include <optional>
+#include <algorithm>
 
 #include <spdlog/fmt/fmt.h>
 #include <glm/gtc/matrix_transform.hpp>
@@ -10,6 +13,8 @@
 #include <d_filesystem.h>
 #include <d_mapparser.h>
 #include <d_debugview.h>
+#include <d_raybatch.h>
+#include <d_strands.h>
 
 #include "s_configs.h"
 #include "g_charastate.h"
@@ -22,6 +27,30 @@ using namespace fmt::literals;
 namespace {
 
     const dal::ColAABB PLAYER_AABB{ glm::vec3{-0.3, 0.3, -0.3}, glm::vec3{0.3, 1.3, 0.3} };
+    // In the same unit as PLAYER_AABB, so it's scaled along with the player.
+    constexpr float PLAYER_STEP_HEIGHT = 0.5f;
+    // Upper bound of sweeps for each slide, which keeps cost of a frame predictable.
+    constexpr unsigned MAX_SLIDE_SWEEPS = 4;
+    // Upper bound of overlaps resolved before moving, one at a time from the deepest.
+    constexpr unsigned MAX_DEPENETRATION_STEPS = 4;
+    // Distance kept from surfaces after a hit so that next sweep doesn't start touching them.
+    constexpr float SWEEP_SKIN = 0.001f;
+    // Surfaces with flatter normal than this are treated as floors when stepping.
+    constexpr float MIN_FLOOR_NORMAL_Y = 0.7f;
+    // How much the contact cache reaches beyond what a frame needs, in the same unit as PLAYER_AABB.
+    // Bigger one refreshes less often but holds more triangles.
+    constexpr float PLAYER_CONTACT_MARGIN = 2.f;
+    // Sampling a character takes microseconds, so fewer than this per thread would cost more to hand out than to do.
+    constexpr size_t ANIMATION_MIN_RANGE_SIZE = 4;
+
+
+    dal::AABB expandAABB(const dal::AABB& aabb, const float amount) {
+        return dal::AABB{ aabb.min() - amount, aabb.max() + amount };
+    }
+
+    bool isAABBInside(const dal::AABB& inner, const dal::AABB& outer) {
+        return glm::all(glm::greaterThanEqual(inner.min(), outer.min())) && glm::all(glm::lessThanEqual(inner.max(), outer.max()));
+    }
 
 
     void bindCameraPos(dal::FPSEulerCamera& camera, const glm::vec3 thisPos, const glm::vec3 lastPos) {
@@ -114,9 +143,11 @@ namespace {
         }
 
         virtual void apply(const entt::entity entity, entt::registry& reg) override {
-            auto& particle = this->m_phyworld.getParticleOf(this->m_particleEntt);
-            auto& trans = reg.get<dal::cpnt::Transform>(entity);
-            trans.setPos(particle.m_pos);
+            const auto pos = this->m_phyworld.renderPos(this->m_particleEntt);
+            if ( pos ) {
+                auto& trans = reg.get<dal::cpnt::Transform>(entity);
+                trans.setPos(glm::vec3{ *pos });
+            }
         }
 
     };
@@ -146,39 +177,7 @@ namespace {
 
         virtual void apply(const dal::float_t deltaTime, dal::PositionParticle& particle) override {
             auto& trans = this->m_registry.get<dal::cpnt::Transform>(this->m_entity);
-            particle.m_pos = trans.getMat() * this->m_offset * glm::vec4{ 0, 0, 0, 1 };
-        }
-
-    };
-
-
-    class HairJointPhysics : public dal::IJointModifier {
-
-    private:
-        dal::PhysicsWorld& m_phyworld;
-        dal::PhysicsEntity m_particleEntt;
-
-        entt::entity m_entity;
-        entt::registry& m_registry;
-
-    public:
-        HairJointPhysics(const dal::PhysicsEntity& particleEntt, dal::PhysicsWorld& phyworld, const entt::entity entity, entt::registry& registry)
-            : m_phyworld(phyworld)
-            , m_particleEntt(particleEntt)
-            , m_entity(entity)
-            , m_registry(registry)
-        {
-
-        }
-
-        virtual glm::mat4 makeTransform(const float elapsed, const dal::jointID_t jid, const dal::SkeletonInterface& skeleton) override {
-            auto& particle = this->m_phyworld.getParticleOf(this->m_particleEntt);
-            auto& trans = this->m_registry.get<dal::cpnt::Transform>(this->m_entity);
-            const auto& jointInfo = skeleton.at(jid);
-            const auto decomposed = dal::decomposeTransform(jointInfo.offsetInv());
-
-            const auto jointToParticle = glm::vec3{ particle.m_pos } -(decomposed.first + trans.getPos());
-            return glm::translate(glm::mat4{ 1.f }, jointToParticle);
+            particle.setPos(dal::vec3_t{ trans.getMat() * this->m_offset * glm::vec4{ 0, 0, 0, 1 } });
         }
 
     };
@@ -189,43 +188,59 @@ namespace {
 // Hair
 namespace {
 
+    // Body of the player approximated as a capsule inside PLAYER_AABB, so that hair falls on shoulders and back.
+    dal::StrandCapsule makePlayerCapsule(const glm::vec3& pos, const float scale) {
+        const auto aabb = PLAYER_AABB.transform(pos, scale);
+        const auto center = (aabb.min() + aabb.max()) * 0.5f;
+        const auto radius = 0.5f * std::min(aabb.max().x - aabb.min().x, aabb.max().z - aabb.min().z);
+
+        dal::StrandCapsule capsule;
+        capsule.m_one = dal::vec3_t{ center.x, aabb.min().y + radius, center.z };
+        capsule.m_two = dal::vec3_t{ center.x, aabb.max().y - radius, center.z };
+        capsule.m_radius = radius;
+        return capsule;
+    }
+
+
+    // Simulates joints under the hair root as strands of one StrandSolver, and writes them back through joint modifiers.
+    // Joints attached to the hair root are pinned and follow the entity, and the ones under them are simulated.
     class HairMaster {
 
     private:
-        class HairPullingForce : public dal::BinaryPhyModifier {
+        class HairJointModifier : public dal::IJointModifier {
 
         private:
-            dal::float_t m_restLen;
+            const HairMaster& m_master;
 
         public:
-            HairPullingForce(const dal::float_t restLen)
-                : m_restLen(restLen)
+            HairJointModifier(const HairMaster& master)
+                : m_master(master)
             {
 
             }
 
-            virtual void apply(const dal::float_t deltaTime, dal::PositionParticle& one, dal::PositionParticle& two) override {
-                const auto one2two = two.m_pos - one.m_pos;
-                const auto dist = glm::length(one2two);
-
-                if ( dist > this->m_restLen ) {
-                    const auto one2two_n = one2two / dist;
-                    const auto newOffset = one2two_n * this->m_restLen;
-                    two.m_pos = one.m_pos + newOffset;
-                }
+            virtual glm::mat4 makeTransform(const float elapsed, const dal::jointID_t jid, const dal::SkeletonInterface& skeleton) override {
+                return this->m_master.makeJointTransform(jid, skeleton);
             }
 
         };
 
-        class HairStructure {
-
+        struct HairJoint {
+            glm::vec3 m_bindPos;
+            dal::jointID_t m_jid;
+            dal::StrandSolver::index_t m_particle;
+            bool m_isPinned;
         };
 
     private:
-        dal::PhysicsWorld m_phyworld;
+        dal::StrandSolver m_solver;
+        std::vector<HairJoint> m_joints;
+        // How far each joint is from its bind pose in model space, which is zero for joints not simulated. Indexed by joint id.
+        std::vector<glm::vec3> m_deltas;
 
         const entt::entity m_targetEntity;
         entt::registry& m_reg;
+        bool m_isBuilt = false;
 
     public:
         HairMaster(const entt::entity entity, entt::registry& reg)
@@ -235,21 +250,99 @@ namespace {
 
         }
 
-        void update(void) {
+        void update(const float deltaTime) {
             auto& animModel = this->m_reg.get<dal::cpnt::AnimatedModel>(this->m_targetEntity);
             const auto& trans = this->m_reg.get<dal::cpnt::Transform>(this->m_targetEntity);
             const auto& skeleton = animModel.m_model->getSkeletonInterf();
+
+            if ( !this->m_isBuilt ) {
+                // Model is loaded asynchronously, so skeleton may not be there yet.
+                if ( skeleton.isEmpty() ) {
+                    return;
+                }
+
+                this->build(animModel, trans.getMat(), skeleton);
+                this->m_isBuilt = true;
+            }
+
+            // Particles are simulated in world space, so that moving the character swings hair.
+            const auto& modelMat = trans.getMat();
+            for ( const auto& joint : this->m_joints ) {
+                if ( joint.m_isPinned ) {
+                    this->m_solver.movePinned(joint.m_particle, dal::vec3_t{ modelMat * glm::vec4{ joint.m_bindPos, 1 } });
+                }
+            }
+
+            this->m_solver.clearCapsules();
+            this->m_solver.addCapsule(::makePlayerCapsule(trans.getPos(), trans.getScale()));
+            this->m_solver.update(deltaTime);
+
+            const auto modelInv = glm::inverse(modelMat);
+            for ( const auto& joint : this->m_joints ) {
+                if ( !joint.m_isPinned ) {
+                    const auto particlePos = glm::vec3{ this->m_solver.pos(joint.m_particle) };
+                    this->m_deltas[joint.m_jid] = glm::vec3{ modelInv * glm::vec4{ particlePos, 1 } } - joint.m_bindPos;
+                }
+            }
         }
 
     private:
-        static dal::jointID_t findHairRoot(const dal::SkeletonInterface& skeleton) {
+        void build(dal::cpnt::AnimatedModel& animModel, const glm::mat4& modelMat, const dal::SkeletonInterface& skeleton) {
+            this->m_deltas.assign(skeleton.getSize(), glm::vec3{ 0 });
+
+            const auto hairRoot = findHairRoot(skeleton);
+            if ( !hairRoot ) {
+                return;
+            }
+
+            // Parents always come before children in skeletons, so one pass from the hair root finds all joints under it.
+            std::vector<std::optional<dal::StrandSolver::index_t>> particleOf(skeleton.getSize());
+            for ( dal::jointID_t jid = *hairRoot + 1; jid < skeleton.getSize(); ++jid ) {
+                const auto& jointInfo = skeleton.at(jid);
+                const auto parent = jointInfo.parentIndex();
+                const auto isPinned = *hairRoot == parent;
+                if ( !isPinned && (parent < 0 || !particleOf[parent]) ) {
+                    continue;
+                }
+
+                const auto bindPos = jointInfo.localPos();
+                const auto particle = this->m_solver.addParticle(dal::vec3_t{ modelMat * glm::vec4{ bindPos, 1 } }, isPinned ? 0 : 1);
+                particleOf[jid] = particle;
+                this->m_joints.push_back(HairJoint{ bindPos, jid, particle, isPinned });
+
+                if ( isPinned ) {
+                    continue;
+                }
+
+                this->m_solver.addStretch(*particleOf[parent], particle);
+                const auto grandParent = skeleton.at(parent).parentIndex();
+                if ( grandParent >= 0 && particleOf[grandParent] ) {
+                    this->m_solver.addBend(*particleOf[grandParent], particle);
+                }
+
+                animModel.m_animState.addModifier(jid, std::make_shared<HairJointModifier>(*this));
+            }
+
+            dalInfo(fmt::format("Hair has {} joints simulated as strands.", this->m_joints.size()));
+        }
+
+        // Moves bind pose of joint by its delta. Parent's delta is taken out since the joint inherits it.
+        glm::mat4 makeJointTransform(const dal::jointID_t jid, const dal::SkeletonInterface& skeleton) const {
+            const auto& jointInfo = skeleton.at(jid);
+            const auto parent = jointInfo.parentIndex();
+            const auto parentDelta = parent < 0 ? glm::vec3{ 0 } : this->m_deltas[parent];
+
+            return jointInfo.offsetInv() * glm::translate(glm::mat4{ 1 }, this->m_deltas[jid] - parentDelta) * jointInfo.offset();
+        }
+
+        static std::optional<dal::jointID_t> findHairRoot(const dal::SkeletonInterface& skeleton) {
             for ( int i = 0; i < skeleton.getSize(); ++i ) {
                 if ( dal::JointType::hair_root == skeleton.at(i).jointType() ) {
                     return i;
                 }
             }
 
-            dalAbort("Failed to find hair root joint.");
+            return std::nullopt;
         }
 
     };
@@ -340,8 +433,8 @@ namespace dal {
             transform.setScale(0.6);
 
             auto enttParticle = this->m_phyworld.newParticle();
-            auto& particle = this->m_phyworld.getParticleOf(enttParticle);
-            particle.m_pos = glm::vec3{ 0, 3, 0 };
+            auto particle = this->m_phyworld.getParticleOf(enttParticle);
+            particle.setPos(dal::vec3_t{ 0, 3, 0 });
             this->m_phyworld.registerBinaryMod(
                 std::shared_ptr<BinaryPhyModifier>{ new FixedPointSpringPulling{ 5, 3 } },
                 playerParticle, enttParticle
@@ -372,71 +465,30 @@ namespace dal {
 
         // Resolve collisions
         {
-            constexpr unsigned MAX_ITERATION = 3;
-
             auto& trans = this->m_entities.get<cpnt::Transform>(this->m_player);
-            auto playerAABB = PLAYER_AABB.transform(trans.getPos(), trans.getScale());
             const auto deltaPlayerMove = trans.getPos() - this->m_playerLastTrans.getPos();
 
-            std::vector<dal::AABB> aabbs;
-            std::vector<dal::Triangle> triangles;
-
-            // Get sets of colliders
-            {
-                dal::TriangleSorter triangleHeap{ -deltaPlayerMove };
-                for ( const auto& map : this->m_mapChunks )
-                    if ( dal::isIntersecting(playerAABB, map.m_info->m_aabb) )
-                        map.m_map.findIntersctionsToStatic(playerAABB, aabbs, triangleHeap);
-
-                const auto numTri = triangleHeap.size();
-                for ( size_t i = 0; i < numTri; ++i ) {
-                    triangles.push_back(triangleHeap.pop());
-                }
-            }
-
-            // Resolve AABBs
-            for ( const auto& aabb : aabbs ) {
-                const auto result = dal::calcResolveForAABB(playerAABB, aabb);
-                trans.addPos(result);
-                playerAABB = PLAYER_AABB.transform(trans.getPos(), trans.getScale());
-            }
-
-            // Resolve triangles
-            for ( int i = 0; i < MAX_ITERATION; ++i ) {
-                bool resolved = false;
-
-                for ( const auto& tri : triangles ) {
-                    if ( dal::isIntersecting(tri, playerAABB) ) {
-                        const auto [dist, direc] = dal::calcIntersectingDepth(playerAABB, tri.plane());
-                        if ( 0.f == dist )
-                            continue;
-
-                        trans.addPos(-dist * direc);
-                        playerAABB = PLAYER_AABB.transform(trans.getPos(), trans.getScale());
-                        resolved = true;
-                    }
-                }
-
-                if ( !resolved )
-                    break;
-            }
+            // Movement of this frame is swept from where the player was, so that it never passes through thin walls.
+            this->updatePlayerContacts(this->m_playerLastTrans.getPos(), deltaPlayerMove, trans.getScale());
+            const auto start = this->depenetratePlayer(this->m_playerLastTrans.getPos(), trans.getScale());
+            trans.setPos(this->movePlayer(start, deltaPlayerMove, trans.getScale()));
+            const auto playerAABB = PLAYER_AABB.transform(trans.getPos(), trans.getScale());
 
             // Draw player aabb
             for ( auto& tri : playerAABB.makeTriangles() )
                 dal::DebugViewGod::inst().addTriangle(tri.point0(), tri.point1(), tri.point2(), glm::vec4{ 0, 1, 0, 0.2 });
 
+#if DAL_DRAW_DEBUG_VIEW
+            for ( size_t i = 0; i < this->m_playerContacts.m_triangles.getSize(); ++i ) {
+                const auto tri = this->m_playerContacts.m_triangles.triangle(i);
+                dal::DebugViewGod::inst().addTriangle(tri.point0(), tri.point1(), tri.point2(), glm::vec4{ 1, 0.3, 0.3, 0.2 });
+            }
+#endif
+
             this->m_playerLastTrans = trans;
         }
 
-        // Update animtions of dynamic objects.
-        {
-            auto view = this->m_entities.view<cpnt::AnimatedModel>();
-            for ( const auto entity : view ) {
-                auto& cpntModel = view.get(entity);
-                auto pModel = cpntModel.m_model;
-                updateAnimeState(cpntModel.m_animState, pModel->getAnimations(), pModel->getSkeletonInterf());
-            }
-        }
+        g_hairMas->update(deltaTime);
 
         // Find map chunks to load
         for ( unsigned i = 0; i < this->m_activeLevel.size(); ++i ) {
@@ -452,6 +504,21 @@ namespace dal {
                 dalInfo(fmt::format("Map chunk activated: {}", mapInfo.m_name));
             }
         }
+
+        // Last thing before rendering, which needs all of joint transforms.
+        this->updateAnimations();
+    }
+
+    void SceneGraph::setAnimationConfig(const Config::Animation& config) {
+        this->m_animConfig = config;
+    }
+
+    void SceneGraph::setPlayerCamProjMat(const glm::mat4& mat) {
+        this->m_playerCamProj = mat;
+    }
+
+    void SceneGraph::setWorkerPool(WorkerPool* const pool) {
+        this->m_workers = pool;
     }
 
 
@@ -468,37 +535,11 @@ namespace dal {
     }
 
 
-    void SceneGraph::render_static(const UniRender_Static& uniloc) {
+    void SceneGraph::render_static(const UniRender_Static& uniloc, const Frustum& frustum) {
         this->sendDlightUniform(uniloc.i_lighting);
 
-        for ( auto& map : this->m_mapChunks ) {
-            map.m_map.render_static(uniloc);
-        }
-
-        const auto view = this->m_entities.view<cpnt::Transform, cpnt::StaticModel>();
-        for ( const auto entity : view ) {
-            auto& cpntTrans = view.get<cpnt::Transform>(entity);
-            auto& cpntModel = view.get<cpnt::StaticModel>(entity);
-
-            auto envmap = this->findClosestEnv(cpntTrans.getPos());
-            if ( nullptr != envmap )
-                sendEnvmapUniform(*envmap, uniloc.i_envmap);
-            else
-                uniloc.i_envmap.hasEnvmap(false);
-
-            auto map = this->findClosestMapChunk(cpntTrans.getPos());
-            if ( nullptr != map ) {
-                map->sendPlightUniforms(uniloc.i_lighting);
-                map->sendSlightUniforms(uniloc.i_lighting);
-            }
-            else {
-                uniloc.i_lighting.plightCount(0);
-                uniloc.i_lighting.slightCount(0);
-            }
-
-            uniloc.modelMat(cpntTrans.getMat());
-            cpntModel.m_model->render(uniloc);
-        }
+        this->queueStatics(frustum, RenderPass::main);
+        this->m_renderQueue.submit(uniloc, this->m_queueStats[static_cast<size_t>(RenderPass::main)]);
     }
 
     void SceneGraph::render_animated(const UniRender_Animated& uniloc) {
@@ -526,21 +567,13 @@ namespace dal {
             }
 
             uniloc.modelMat(cpntTrans.getMat());
-            cpntModel.m_model->render(uniloc, cpntModel.m_animState.getTransformArray());
+            cpntModel.m_model->render(uniloc, cpntModel.m_skinning);
         }
     }
 
-    void SceneGraph::render_staticDepth(const UniRender_StaticDepth& uniloc) {
-        for ( auto& map : this->m_mapChunks ) {
-            map.m_map.render_staticDepth(uniloc);
-        }
-
-        this->m_entities.view<cpnt::Transform, cpnt::StaticModel>().each(
-            [&uniloc](const cpnt::Transform& trans, const cpnt::StaticModel& model) {
-                uniloc.modelMat(trans.getMat());
-                model.m_model->render();
-            }
-        );
+    void SceneGraph::render_staticDepth(const UniRender_StaticDepth& uniloc, const Frustum& frustum) {
+        this->queueStatics(frustum, RenderPass::shadow);
+        this->m_renderQueue.submit(uniloc, this->m_queueStats[static_cast<size_t>(RenderPass::shadow)]);
     }
 
     void SceneGraph::render_animatedDepth(const UniRender_AnimatedDepth& uniloc) {
@@ -550,25 +583,15 @@ namespace dal {
             auto& cpntModel = viewAnimated.get<cpnt::AnimatedModel>(entity);
 
             uniloc.modelMat(cpntTrans.getMat());
-            cpntModel.m_model->render(uniloc, cpntModel.m_animState.getTransformArray());
+            cpntModel.m_model->render(uniloc, cpntModel.m_skinning);
         }
     }
 
-    void SceneGraph::render_staticOnWater(const UniRender_StaticOnWater& uniloc) {
+    void SceneGraph::render_staticOnWater(const UniRender_StaticOnWater& uniloc, const Frustum& frustum) {
         this->sendDlightUniform(uniloc.i_lighting);
 
-        for ( auto& map : this->m_mapChunks ) {
-            map.m_map.render_staticOnWater(uniloc);
-        }
-
-        const auto view = this->m_entities.view<cpnt::Transform, cpnt::StaticModel>();
-        for ( const auto entity : view ) {
-            auto& cpntTrans = view.get<cpnt::Transform>(entity);
-            auto& cpntModel = view.get<cpnt::StaticModel>(entity);
-
-            uniloc.modelMat(cpntTrans.getMat());
-            cpntModel.m_model->render(uniloc);
-        }
+        this->queueStatics(frustum, RenderPass::water);
+        this->m_renderQueue.submit(uniloc, this->m_queueStats[static_cast<size_t>(RenderPass::water)]);
     }
 
     void SceneGraph::render_animatedOnWater(const UniRender_AnimatedOnWater& uniloc) {
@@ -585,26 +608,15 @@ namespace dal {
             auto& cpntModel = viewAnimated.get<cpnt::AnimatedModel>(entity);
 
             uniloc.modelMat(cpntTrans.getMat());
-            cpntModel.m_model->render(uniloc, cpntModel.m_animState.getTransformArray());
+            cpntModel.m_model->render(uniloc, cpntModel.m_skinning);
         }
     }
 
-    void SceneGraph::render_staticOnEnvmap(const UniRender_Static& uniloc) {
+    void SceneGraph::render_staticOnEnvmap(const UniRender_Static& uniloc, const Frustum& frustum) {
         this->sendDlightUniform(uniloc.i_lighting);
-        uniloc.i_envmap.hasEnvmap(false);
 
-        for ( auto& map : this->m_mapChunks ) {
-            map.m_map.render_staticOnEnvmap(uniloc);
-        }
-
-        const auto view = this->m_entities.view<cpnt::Transform, cpnt::StaticModel>();
-        for ( const auto entity : view ) {
-            auto& cpntTrans = view.get<cpnt::Transform>(entity);
-            auto& cpntModel = view.get<cpnt::StaticModel>(entity);
-
-            uniloc.modelMat(cpntTrans.getMat());
-            cpntModel.m_model->render(uniloc);
-        }
+        this->queueStatics(frustum, RenderPass::envmap);
+        this->m_renderQueue.submit(uniloc, this->m_queueStats[static_cast<size_t>(RenderPass::envmap)]);
     }
 
 
@@ -635,6 +647,89 @@ namespace dal {
     }
 
 
+    void SceneGraph::castRays(const Segment* const rays, const size_t count, std::optional<RayCastingResult>* const results) const {
+        std::vector<uint32_t> order;
+        dal::sortSegmentsCoherent(rays, count, order);
+
+        const auto numPackets = (count + RAY_PACKET_SIZE - 1) / RAY_PACKET_SIZE;
+
+        const auto castRange = [&](const size_t packetBegin, const size_t packetEnd) {
+            Segment packet[RAY_PACKET_SIZE];
+            std::optional<RayCastingResult> packetResults[RAY_PACKET_SIZE];
+
+            for ( size_t p = packetBegin; p < packetEnd; ++p ) {
+                const auto first = p * RAY_PACKET_SIZE;
+                const auto packetSize = static_cast<uint32_t>(std::min<size_t>(RAY_PACKET_SIZE, count - first));
+
+                for ( uint32_t i = 0; i < packetSize; ++i ) {
+                    packet[i] = rays[order[first + i]];
+                    packetResults[i] = std::nullopt;
+                }
+
+                for ( const auto& map : this->m_mapChunks ) {
+                    uint32_t mask = 0;
+                    for ( uint32_t i = 0; i < packetSize; ++i ) {
+                        if ( dal::isIntersecting(packet[i], map.m_info->m_aabb) ) {
+                            mask |= 1u << i;
+                        }
+                    }
+
+                    if ( 0 != mask ) {
+                        map.m_map.castRaysToClosest(packet, packetSize, mask, packetResults);
+                    }
+                }
+
+                for ( uint32_t i = 0; i < packetSize; ++i ) {
+                    results[order[first + i]] = packetResults[i];
+                }
+            }
+        };
+
+        if ( nullptr == this->m_workers ) {
+            castRange(0, numPackets);
+        }
+        else {
+            this->m_workers->parallelFor(numPackets, RAY_PACKET_MIN_RANGE_SIZE, castRange);
+        }
+    }
+
+
+    std::optional<SweepHit> SceneGraph::ContactCache::sweep(const AABB& aabb, const glm::vec3& delta) const {
+        auto result = dal::sweepAABB(aabb, delta, this->m_triangles);
+
+        for ( const auto& box : this->m_boxes ) {
+            const auto hit = dal::sweepAABB(aabb, delta, box);
+            if ( hit && (!result || hit->m_time < result->m_time) ) {
+                result = hit;
+            }
+        }
+
+        return result;
+    }
+
+    std::optional<glm::vec3> SceneGraph::ContactCache::findDeepestPush(const AABB& aabb) const {
+        std::optional<glm::vec3> result{ std::nullopt };
+        float maxDepthSqr = 0;
+
+        const auto consider = [&](const glm::vec3& push) {
+            const auto depthSqr = glm::dot(push, push);
+            if ( depthSqr > maxDepthSqr ) {
+                maxDepthSqr = depthSqr;
+                result = push;
+            }
+        };
+
+        for ( const auto& box : this->m_boxes ) {
+            consider(dal::calcResolveForAABB(aabb, box));
+        }
+        for ( size_t i = 0; i < this->m_triangles.getSize(); ++i ) {
+            consider(dal::calcResolveForAABB(aabb, this->m_triangles.triangle(i)));
+        }
+
+        return result;
+    }
+
+
     auto SceneGraph::findClosestEnv(const glm::vec3& pos) const -> const dal::EnvMap* {
         const dal::EnvMap* result = nullptr;
         float maxDist = std::numeric_limits<float>::max();
@@ -671,6 +766,233 @@ namespace dal {
 
     // Private
 
+    void SceneGraph::updatePlayerContacts(const glm::vec3& from, const glm::vec3& delta, const float scale) {
+        // Sliding never goes farther than delta, and stepping adds step height on top of it.
+        // Each hit may also push the player away from surfaces by skin distance.
+        // Depenetration moves the player before that, by no more than the diagonal of the player box each step.
+        const auto playerBox = PLAYER_AABB.transform(from, scale);
+        const auto depenetrationReach = MAX_DEPENETRATION_STEPS * (glm::length(playerBox.max() - playerBox.min()) + SWEEP_SKIN);
+        const auto reach = glm::length(delta) + PLAYER_STEP_HEIGHT * scale + 4.f * MAX_SLIDE_SWEEPS * SWEEP_SKIN + depenetrationReach;
+        const auto needed = ::expandAABB(playerBox, reach);
+
+        auto& cache = this->m_playerContacts;
+        if ( cache.m_valid && ::isAABBInside(needed, cache.m_bounds) ) {
+            return;
+        }
+
+        cache.m_bounds = ::expandAABB(needed, PLAYER_CONTACT_MARGIN * scale);
+        cache.m_boxes.clear();
+        cache.m_triangles.clear();
+
+        for ( const auto& map : this->m_mapChunks ) {
+            if ( dal::isIntersecting(cache.m_bounds, map.m_info->m_aabb) ) {
+                map.m_map.findIntersctionsToStatic(cache.m_bounds, cache.m_boxes, cache.m_triangles);
+            }
+        }
+
+        cache.m_valid = true;
+    }
+
+    glm::vec3 SceneGraph::depenetratePlayer(glm::vec3 pos, const float scale) const {
+        for ( unsigned i = 0; i < MAX_DEPENETRATION_STEPS; ++i ) {
+            const auto push = this->m_playerContacts.findDeepestPush(PLAYER_AABB.transform(pos, scale));
+            if ( !push ) {
+                break;
+            }
+
+            pos += *push + glm::normalize(*push) * SWEEP_SKIN;
+        }
+
+        return pos;
+    }
+
+    glm::vec3 SceneGraph::movePlayer(const glm::vec3& from, const glm::vec3& delta, const float scale) const {
+        const auto slid = this->slidePlayer(from, delta, scale);
+
+        const glm::vec3 horizontal{ delta.x, 0, delta.z };
+        const auto target = from + delta;
+        const auto slidShortfall = glm::length(glm::vec2{ target.x - slid.x, target.z - slid.z });
+        if ( slidShortfall <= SWEEP_SKIN ) {
+            return slid;
+        }
+
+        // Blocked horizontally, so try going up, forward and then down again to step over small obstacles.
+        const auto stepHeight = PLAYER_STEP_HEIGHT * scale;
+        const auto up = this->slidePlayer(from, glm::vec3{ 0, stepHeight, 0 }, scale);
+        const auto forward = this->slidePlayer(up, horizontal + glm::vec3{ 0, delta.y, 0 }, scale);
+
+        const glm::vec3 down{ 0, from.y - up.y, 0 };
+        const auto landing = this->m_playerContacts.sweep(PLAYER_AABB.transform(forward, scale), down);
+        if ( !landing || landing->m_normal.y < MIN_FLOOR_NORMAL_Y ) {
+            return slid;
+        }
+
+        const auto stepped = forward + down * landing->m_time + landing->m_normal * SWEEP_SKIN;
+        const auto steppedShortfall = glm::length(glm::vec2{ target.x - stepped.x, target.z - stepped.z });
+
+        return steppedShortfall < slidShortfall ? stepped : slid;
+    }
+
+    glm::vec3 SceneGraph::slidePlayer(glm::vec3 pos, glm::vec3 delta, const float scale) const {
+        for ( unsigned i = 0; i < MAX_SLIDE_SWEEPS; ++i ) {
+            if ( glm::dot(delta, delta) <= SWEEP_SKIN * SWEEP_SKIN ) {
+                break;
+            }
+
+            const auto hit = this->m_playerContacts.sweep(PLAYER_AABB.transform(pos, scale), delta);
+            if ( !hit ) {
+                pos += delta;
+                break;
+            }
+
+            pos += delta * hit->m_time + hit->m_normal * SWEEP_SKIN;
+
+            // Rest of the movement goes along the surface.
+            const auto remaining = delta * (1.f - hit->m_time);
+            delta = remaining - hit->m_normal * glm::dot(remaining, hit->m_normal);
+        }
+
+        return pos;
+    }
+
+    void SceneGraph::cullStaticEntities(const Frustum& frustum, const RenderPass pass) {
+        this->m_staticEntities.clear();
+        this->m_staticBounds.clear();
+        this->m_visibleStatics.clear();
+
+        // Entities may move any time, so boxes are made again for every view.
+        const auto view = this->m_entities.view<cpnt::Transform, cpnt::StaticModel>();
+        for ( const auto entity : view ) {
+            const auto colBounding = view.get<cpnt::StaticModel>(entity).m_model->getBounding();
+            if ( nullptr == colBounding ) {
+                // Not loaded yet, which draws nothing anyway.
+                this->m_visibleStatics.push_back(entity);
+                continue;
+            }
+
+            this->m_staticEntities.push_back(entity);
+            this->m_staticBounds.push_back(*reinterpret_cast<const ColAABB*>(colBounding), view.get<cpnt::Transform>(entity).getMat());
+        }
+
+        const auto numDrawn = dal::cullAABBs(frustum, this->m_staticBounds, this->m_staticVisible);
+        for ( size_t i = 0; i < this->m_staticEntities.size(); ++i ) {
+            if ( 0 != this->m_staticVisible[i] ) {
+                this->m_visibleStatics.push_back(this->m_staticEntities[i]);
+            }
+        }
+
+        auto& stats = this->m_cullStats[static_cast<size_t>(pass)];
+        stats.m_drawn += numDrawn;
+        stats.m_culled += this->m_staticEntities.size() - numDrawn;
+    }
+
+    void SceneGraph::queueStatics(const Frustum& frustum, const RenderPass pass) {
+        // Envmaps are what envmap pass renders, and depth only pass has neither them nor materials.
+        const auto withMaterials = RenderPass::shadow != pass;
+        const auto withEnvmaps = RenderPass::main == pass;
+
+        this->m_renderQueue.begin(static_cast<unsigned>(pass), frustum, withMaterials);
+
+        auto& stats = this->m_cullStats[static_cast<size_t>(pass)];
+        for ( auto& map : this->m_mapChunks ) {
+            map.m_map.queueStaticActors(this->m_renderQueue, frustum, stats, withEnvmaps);
+        }
+
+        this->cullStaticEntities(frustum, pass);
+        for ( const auto entity : this->m_visibleStatics ) {
+            auto& cpntTrans = this->m_entities.get<cpnt::Transform>(entity);
+            auto& model = *this->m_entities.get<cpnt::StaticModel>(entity).m_model;
+            if ( !model.isReady() ) {
+                continue;
+            }
+
+            const auto& pos = cpntTrans.getPos();
+            const auto envmap = withEnvmaps ? this->findClosestEnv(pos) : nullptr;
+            const auto lights = this->findClosestMapChunk(pos);
+
+            for ( const auto& unit : model.renderUnits() ) {
+                if ( unit.m_mesh.isReady() ) {
+                    this->m_renderQueue.push(unit.m_mesh, unit.m_material, cpntTrans.getMat(), lights, envmap, pos);
+                }
+            }
+        }
+
+        this->m_renderQueue.sort();
+    }
+
+    void SceneGraph::updateAnimations(void) {
+        this->m_animJobs.clear();
+        const Frustum sight{ this->m_playerCamProj * this->m_playerCam.viewMat() };
+        auto view = this->m_entities.view<cpnt::AnimatedModel>();
+        for ( const auto entity : view ) {
+            auto& cpntModel = view.get(entity);
+            cpntModel.m_animState.setLOD(this->selectAnimationLOD(entity, cpntModel.m_model->getSkeletonInterf(), sight));
+            this->m_animJobs.push_back(AnimationJob{ &cpntModel, 0 });
+        }
+
+        const auto sampleRange = [this](const size_t begin, const size_t end) {
+            for ( size_t i = begin; i < end; ++i ) {
+                auto& job = this->m_animJobs[i];
+                const auto& model = *job.m_model->m_model;
+                job.m_numSampled = updateAnimeState(job.m_model->m_animState, model.getAnimations(), model.getSkeletonInterf(), &model.getBakedAnimations());
+            }
+        };
+
+        if ( nullptr == this->m_workers ) {
+            sampleRange(0, this->m_animJobs.size());
+        }
+        else {
+            this->m_workers->parallelFor(this->m_animJobs.size(), ANIMATION_MIN_RANGE_SIZE, sampleRange);
+        }
+
+        // Here rather than in each render pass, which would send the same transforms again and again.
+        // Buffers are GL objects, so this can't be done on worker threads.
+        for ( auto& job : this->m_animJobs ) {
+            job.m_model->m_skinning.upload(job.m_model->m_animState.getTransformArray());
+        }
+
+        this->m_animStats = AnimationStats{};
+        this->m_animStats.m_characters = this->m_animJobs.size();
+        for ( const auto& job : this->m_animJobs ) {
+            const auto numJoints = job.m_model->m_model->getSkeletonInterf().getSize();
+            this->m_animStats.m_jointsSampled += job.m_numSampled;
+            this->m_animStats.m_jointsSaved += numJoints > job.m_numSampled ? numJoints - job.m_numSampled : 0;
+        }
+    }
+
+    AnimationLOD SceneGraph::selectAnimationLOD(const entt::entity entity, const SkeletonInterface& skeleton, const Frustum& sight) const {
+        AnimationLOD lod;
+        if ( skeleton.isEmpty() || !this->m_entities.has<cpnt::Transform>(entity) ) {
+            return lod;
+        }
+
+        const auto& transform = this->m_entities.get<cpnt::Transform>(entity);
+        const auto center = glm::vec3{ transform.getMat() * glm::vec4{ skeleton.at(0).localPos(), 1 } };
+        const auto radius = skeleton.boundRadius() * transform.getScale();
+        const auto viewPos = glm::vec3{ this->m_playerCam.viewMat() * glm::vec4{ center, 1 } };
+
+        // Box around bounding sphere is tested, which keeps some just out of sight animated in full.
+        if ( this->m_animConfig.m_cullOutOfSight && !sight.isIntersecting(AABB{ center - radius, center + radius }) ) {
+            lod.m_rootOnly = true;
+            return lod;
+        }
+
+        // Camera inside of bounding sphere sees it fill the screen.
+        const auto distance = glm::length(viewPos);
+        const auto size = distance > radius ? radius / distance : 1.f;
+
+        if ( size < this->m_animConfig.m_quarterRateSize ) {
+            lod.m_interval = 4;
+        }
+        else if ( size < this->m_animConfig.m_halfRateSize ) {
+            lod.m_interval = 2;
+        }
+        lod.m_skipMinorJoints = size < this->m_animConfig.m_minorJointSize;
+
+        return lod;
+    }
+
+
     void SceneGraph::openLevel(const char* const respath) {
         std::vector<uint8_t> buffer;
         {
@@ -710,6 +1032,9 @@ namespace dal {
         auto& map = this->m_mapChunks.emplace_back();
         map.m_map = this->m_resMas.loadChunk(respath);
         map.m_info = &info;
+
+        // New chunk may have colliders inside of cached area.
+        this->m_playerContacts.m_valid = false;
     }
 
 }
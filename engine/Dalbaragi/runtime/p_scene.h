@@ -1,13 +1,16 @@
 #pragma once
 
+#include <list>
+#include <array>
 #include <string>
 #include <vector>
-#include <list>
 
 #include <entt/entity/registry.hpp>
 
 #include <d_phyworld.h>
+#include <d_workerpool.h>
 
+#include "s_configs.h"
 #include "p_uniloc.h"
 #include "u_loadinfo.h"
 #include "p_resource.h"
@@ -77,12 +80,35 @@ namespace dal {
             float m_horizontal = 0, m_vertical = 0;
         };
 
+        // Of last update. Saved joints are ones that would have been sampled without LOD.
+        struct AnimationStats {
+            size_t m_characters = 0;
+            size_t m_jointsSampled = 0, m_jointsSaved = 0;
+        };
+
+        // Passes static actors and static model entities are frustum culled in.
+        // Shadow pass includes every light, and water and cubemap passes include every view of them.
+        enum class RenderPass { main, shadow, water, envmap, count };
+
     private:
         struct MapChunkPack {
             MapChunk2 m_map;
             const LevelData::ChunkData* m_info = nullptr;
         };
 
+        // Static collision geometry around the player, reused until the player's movement leaves m_bounds.
+        // Buffers keep their memory so that refreshing doesn't allocate once they grew enough.
+        struct ContactCache {
+            AABB m_bounds;
+            std::vector<AABB> m_boxes;
+            TriangleSoupSoA m_triangles;
+            bool m_valid = false;
+
+            std::optional<SweepHit> sweep(const AABB& aabb, const glm::vec3& delta) const;
+            // Translation that gets the box out of its deepest overlap, or nullopt if it overlaps nothing.
+            std::optional<glm::vec3> findDeepestPush(const AABB& aabb) const;
+        };
+
         //////// Attribs ////////
 
     private:
@@ -102,26 +128,76 @@ namespace dal {
         CameraProp m_playerCamInfo;
         dal::Transform m_playerLastTrans;
 
+    private:
+        ContactCache m_playerContacts;
+
+        struct AnimationJob {
+            cpnt::AnimatedModel* m_model;
+            jointID_t m_numSampled;
+        };
+
+        Config::Animation m_animConfig;
+        AnimationStats m_animStats;
+        // Of m_playerCam, which RenderMaster owns. Characters out of its frustum are sampled root only.
+        glm::mat4 m_playerCamProj{ 1 };
+        // Shared with other systems. Samples animations of characters and casts rays. Null if only the calling thread does them.
+        WorkerPool* m_workers = nullptr;
+        // Animated models of current frame, gathered so that they can be split into ranges.
+        std::vector<AnimationJob> m_animJobs;
+
+        std::array<CullStats, static_cast<size_t>(RenderPass::count)> m_cullStats;
+        std::array<RenderQueueStats, static_cast<size_t>(RenderPass::count)> m_queueStats;
+        // Reused by every view of every pass, which are rendered one after another.
+        RenderQueue m_renderQueue;
+        // Static model entities of the view being rendered, gathered so that their boxes can be tested at once.
+        std::vector<entt::entity> m_staticEntities, m_visibleStatics;
+        AABBArraySoA m_staticBounds;
+        std::vector<uint8_t> m_staticVisible;
+
         //////// Methods ////////
 
     public:
         SceneGraph(ResourceMaster& resMas, PhysicsWorld& phyworld, const unsigned int winWidth, const unsigned int winHeight);
 
         void update(const float deltaTime);
+        void setAnimationConfig(const Config::Animation& config);
+        // RenderMaster sets it whenever it makes projection matrix of main camera anew.
+        void setPlayerCamProjMat(const glm::mat4& mat);
+        // Pool must outlive this, or be replaced before it is destroyed. Null for doing everything on the calling thread.
+        void setWorkerPool(WorkerPool* const pool);
+        const AnimationStats& animationStats(void) const {
+            return this->m_animStats;
+        }
+
+        // Counted since last reset. RenderMaster resets them every frame.
+        const CullStats& cullStats(const RenderPass pass) const {
+            return this->m_cullStats[static_cast<size_t>(pass)];
+        }
+        const RenderQueueStats& renderQueueStats(const RenderPass pass) const {
+            return this->m_queueStats[static_cast<size_t>(pass)];
+        }
+        void resetRenderStats(void) {
+            this->m_cullStats.fill(CullStats{});
+            this->m_queueStats.fill(RenderQueueStats{});
+        }
 
         entt::entity addObj_static(const char* const resid);
 
-        void render_static(const UniRender_Static& uniloc);
+        // Param frustum is of the view static ones are rendered to. Animated ones are not culled.
+        void render_static(const UniRender_Static& uniloc, const Frustum& frustum);
         void render_animated(const UniRender_Animated& uniloc);
-        void render_staticDepth(const UniRender_StaticDepth& uniloc);
+        void render_staticDepth(const UniRender_StaticDepth& uniloc, const Frustum& frustum);
         void render_animatedDepth(const UniRender_AnimatedDepth& uniloc);
-        void render_staticOnWater(const UniRender_StaticOnWater& uniloc);
+        void render_staticOnWater(const UniRender_StaticOnWater& uniloc, const Frustum& frustum);
         void render_animatedOnWater(const UniRender_AnimatedOnWater& uniloc);
-        void render_staticOnEnvmap(const UniRender_Static& uniloc);
+        void render_staticOnEnvmap(const UniRender_Static& uniloc, const Frustum& frustum);
 
         void sendDlightUniform(const UniInterf_Lighting& uniloc);
 
         std::optional<RayCastingResult> doRayCasting(const Segment& ray);
+        // Closest hits of many rays at once. Param results must have room for count elements.
+        // Rays are sorted for coherence and traced in packets, split over threads of the worker pool.
+        void castRays(const Segment* const rays, const size_t count, std::optional<RayCastingResult>* const results) const;
 
         auto findClosestEnv(const glm::vec3& pos) const -> const dal::EnvMap*;
         auto findClosestMapChunk(const glm::vec3& pos) const -> const dal::MapChunk2*;
@@ -132,6 +208,23 @@ namespace dal {
         void openLevel(const char* const respath);
         void openChunk(const char* const respath, const LevelData::ChunkData& info);
 
+        // Makes sure m_playerContacts covers everything the player can touch while moving by delta.
+        void updatePlayerContacts(const glm::vec3& from, const glm::vec3& delta, const float scale);
+        // Pushes the player out of static geometry it overlaps, which sweeping can't get out of since every sweep hits at time 0.
+        glm::vec3 depenetratePlayer(glm::vec3 pos, const float scale) const;
+        // Returns where the player ends up after trying to move by delta, sliding along and stepping over obstacles.
+        glm::vec3 movePlayer(const glm::vec3& from, const glm::vec3& delta, const float scale) const;
+        glm::vec3 slidePlayer(glm::vec3 pos, glm::vec3 delta, const float scale) const;
+
+        // Fills m_visibleStatics with static model entities intersecting the frustum.
+        void cullStaticEntities(const Frustum& frustum, const RenderPass pass);
+        // Fills m_renderQueue with static actors of map chunks and static model entities in frustum, sorted.
+        void queueStatics(const Frustum& frustum, const RenderPass pass);
+
+        // Every character has its own AnimationState, so each one is sampled independently of others.
+        void updateAnimations(void);
+        AnimationLOD selectAnimationLOD(const entt::entity entity, const SkeletonInterface& skeleton, const Frustum& sight) const;
+
     };
 
 }
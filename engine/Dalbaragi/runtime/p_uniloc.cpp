@@ -16,14 +16,6 @@
 using namespace fmt::literals;
 
 
-// Konstants
-namespace {
-
-    constexpr size_t MAX_JOINTS_NUM = 230;
-
-}
-
-
 // Utils
 namespace {
 
@@ -169,15 +161,18 @@ namespace dal {
     }
 
     void UniInterf_Skeleton::set(const GLuint shader) {
-        this->u_jointTrans = getUniloc(shader, "u_jointTrans[0]");
+        const auto blockIndex = glGetUniformBlockIndex(shader, "JointTransforms");
+        if ( GL_INVALID_INDEX == blockIndex ) {
+            dalAbort("Uniform block JointTransforms not found.");
+        }
 
-        for ( unsigned int i = 1; i < MAX_JOINTS_NUM; ++i ) {
-            const auto id = fmt::format("u_jointTrans[{}]", i);
-            const auto loc = getUniloc(shader, id.c_str());
-            if ( loc != this->u_jointTrans + i ) {
-                dalAbort("u_jointTrans[] is not a continuous array.");
-            }
+        GLint blockSize = 0;
+        glGetActiveUniformBlockiv(shader, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+        if ( static_cast<size_t>(blockSize) != MAX_JOINTS_NUM * sizeof(glm::mat4) ) {
+            dalAbort(fmt::format("Uniform block JointTransforms has unexpected size: {}", blockSize));
         }
+
+        glUniformBlockBinding(shader, blockIndex, JOINT_TRANSFORMS_BINDING);
     }
 
 
@@ -7,6 +7,12 @@
 
 namespace dal {
 
+    // Length of u_jointTrans in shaders.
+    constexpr unsigned MAX_JOINTS_NUM = 230;
+    // Uniform buffer binding point of JointTransforms block, which no other block uses.
+    constexpr GLuint JOINT_TRANSFORMS_BINDING = 0;
+
+
     inline void sendMatrix(const GLint loc, const glm::mat4& mat) {
         glUniformMatrix4fv(loc, 1, GL_FALSE, &mat[0][0]);
     }
@@ -236,18 +242,12 @@ namespace dal {
 
     };
 
+    // Joint transforms are in a uniform block, which reads SkinningBuffer bound to JOINT_TRANSFORMS_BINDING.
     class UniInterf_Skeleton {
 
-    private:
-        GLint u_jointTrans = -1;
-
     public:
         void set(const GLuint shader);
 
-        void jointTrans(const unsigned i, const glm::mat4& mat) const {
-            sendMatrix(this->u_jointTrans + i, mat);
-        }
-
     };
 
 }
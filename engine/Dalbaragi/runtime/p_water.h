@@ -143,6 +143,10 @@ namespace dal {
             this->m_fbuffer.onWinResize(winWidth, winHeight);
         }
 
+        float height(void) const {
+            return this->m_height;
+        }
+
     private:
         void initMesh(const glm::vec3& pos, const glm::vec2& size);
 
@@ -1,5 +1,8 @@
 #include "u_objparser.h"
 
+#include <numeric>
+#include <algorithm>
+
 #include <daltools/dmd/parser.h>
 #include <daltools/common/compression.h>
 
@@ -28,6 +31,41 @@ namespace {
         return output;
     }
 
+    // Joints in order that puts every parent before its children, keeping the original order if it already does.
+    // Returns indices into joints. Parent indices that are out of range or make cycles are treated as roots.
+    template <typename T>
+    std::vector<dal::jointID_t> makeParentFirstOrder(const std::vector<T>& joints) {
+        const auto numJoints = static_cast<dal::jointID_t>(joints.size());
+        std::vector<dal::jointID_t> order(numJoints);
+        std::iota(order.begin(), order.end(), 0);
+
+        const auto isParentFirst = [&](void) {
+            for ( dal::jointID_t i = 0; i < numJoints; ++i ) {
+                if ( joints[i].parent_index_ >= i ) {
+                    return false;
+                }
+            }
+            return true;
+        }();
+        if ( isParentFirst ) {
+            return order;
+        }
+
+        std::vector<dal::jointID_t> depths(numJoints, 0);
+        for ( dal::jointID_t i = 0; i < numJoints; ++i ) {
+            auto parent = joints[i].parent_index_;
+            for ( dal::jointID_t steps = 0; parent >= 0 && parent < numJoints && steps < numJoints; ++steps ) {
+                ++depths[i];
+                parent = joints[parent].parent_index_;
+            }
+        }
+
+        std::stable_sort(order.begin(), order.end(), [&depths](const dal::jointID_t a, const dal::jointID_t b) {
+            return depths[a] < depths[b];
+        });
+        return order;
+    }
+
     void convert_material(dal::binfo::Material& dst, const dal::parser::Material& src) {
         dst.m_roughness = src.roughness_;
         dst.m_metallic = src.metallic_;
@@ -154,26 +192,55 @@ namespace {
 
         // Skeleton
         {
-            for (auto& src_joint : src.skeleton_.joints_) {
+            const auto& src_joints = src.skeleton_.joints_;
+            const auto order = ::makeParentFirstOrder(src_joints);
+            std::vector<dal::jointID_t> new_index_of(order.size());
+            for ( dal::jointID_t i = 0; i < static_cast<dal::jointID_t>(order.size()); ++i ) {
+                new_index_of[order[i]] = i;
+            }
+
+            for ( dal::jointID_t i = 0; i < static_cast<dal::jointID_t>(order.size()); ++i ) {
+                const auto& src_joint = src_joints[order[i]];
                 const auto jid = dst.m_joints.getOrMakeIndexOf(src_joint.name_);
                 auto& dst_joint = dst.m_joints.at(jid);
 
+                // Parent placed after its child is part of a cycle, so the child is made a root as makeParentFirstOrder says.
+                const auto src_parent = src_joint.parent_index_;
+                const auto has_parent = src_parent >= 0 && src_parent < static_cast<dal::jointID_t>(order.size()) && new_index_of[src_parent] < i;
+
                 dst_joint.setName(src_joint.name_);
                 dst_joint.setOffset(src_joint.offset_mat_);
-                dst_joint.setParentIndex(src_joint.parent_index_);
+                dst_joint.setParentIndex(has_parent ? new_index_of[src_parent] : -1);
                 dst_joint.setType(src_joint.joint_type_);
             }
 
-            if (dst.m_joints.getSize() > 0) {
-                // Character lies on ground without this line.
-                dst.m_joints.at(0).setParentMat(dst.m_joints.at(0).offset());
+            // Vertices refer to joints by indices in file.
+            if ( !std::is_sorted(order.begin(), order.end()) ) {
+                dalWarn("Joints are reordered so that parents come before children.");
+
+                for (auto& unit : dst.m_renderUnits) {
+                    for (auto& index : unit.m_mesh.m_boneIndex) {
+                        if ( index >= 0 && index < static_cast<int32_t>(new_index_of.size()) ) {
+                            index = new_index_of[index];
+                        }
+                    }
+                }
+            }
+
+            for ( int i = 0; i < dst.m_joints.getSize(); ++i ) {
+                auto& this_info = dst.m_joints.at(i);
 
-                for ( int i = 1; i < dst.m_joints.getSize(); ++i ) {
-                    auto& this_info = dst.m_joints.at(i);
+                // Character lies on ground if roots don't get this.
+                if ( this_info.parentIndex() < 0 ) {
+                    this_info.setParentMat(this_info.offset());
+                }
+                else {
                     const auto& parent_info = dst.m_joints.at(this_info.parentIndex());
                     this_info.setParentMat(parent_info);
                 }
             }
+
+            dst.m_joints.classifyJoints();
         }
     }
 
@@ -216,15 +283,26 @@ namespace {
 namespace dal {
 
     bool loadDalModel(const char* const respath, ModelLoadInfo& info) {
-        // Load file contents
         std::vector<uint8_t> filebuf;
         if ( !loadFileBuffer(respath, filebuf) ) {
             return false;
         }
 
+        if ( !parseDalModel(filebuf.data(), filebuf.size(), info) ) {
+            return false;
+        }
+
+        for ( auto& anim : info.m_animations ) {
+            anim.compress(AnimCompressConfig{});
+        }
+
+        return true;
+    }
+
+    bool parseDalModel(const uint8_t* const buf, const size_t bufSize, ModelLoadInfo& info) {
         // Parse model
         {
-            const auto parsed_model = dal::parser::parse_dmd(filebuf.data(), filebuf.size());
+            const auto parsed_model = dal::parser::parse_dmd(buf, bufSize);
             if (!parsed_model.has_value())
                 return false;
 
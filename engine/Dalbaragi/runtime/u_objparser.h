@@ -12,5 +12,7 @@ namespace dal {
     };
 
     bool loadDalModel(const char* const respath, ModelLoadInfo& info);
+    // Same as loadDalModel but from contents of a file already read, and animations are left uncompressed.
+    bool parseDalModel(const uint8_t* const buf, const size_t bufSize, ModelLoadInfo& info);
 
 }
@@ -1,7 +1,7 @@
 ﻿#include "x_mainloop.h"
 
 #include <time.h>
-#include <unordered_set>
+#include <thread>
 
 #include <spdlog/fmt/fmt.h>
 
@@ -190,6 +190,18 @@ namespace dal {
         // Set configs
         {
             this->m_config.m_ui.m_uiScale = static_cast<double>(winHeight) / 720.0;
+
+            const auto numThreads = this->m_config.m_workers.m_threadCount;
+            this->m_workers.reset(new WorkerPool{ 0 != numThreads ? numThreads : std::thread::hardware_concurrency() });
+            this->m_scene.setWorkerPool(this->m_workers.get());
+            this->m_phyworld.setWorkerPool(this->m_workers.get());
+
+            if ( this->m_config.m_physics.m_dedicatedThread ) {
+                this->m_phyworld.startThread();
+            }
+
+            this->m_scene.setAnimationConfig(this->m_config.m_animation);
+            this->m_resMas.setAnimationBakeRate(this->m_config.m_animation.m_bakeFramesPerSec);
         }
 
         // Create contexts
@@ -204,82 +216,6 @@ namespace dal {
             LuaState::giveDependencies(this, &this->m_renderMan);
         }
 
-        // Animation modifier
-        /* {
-            auto& animModel = this->m_scene.m_entities.get<cpnt::AnimatedModel>(this->m_scene.m_player);
-            const auto& trans = this->m_scene.m_entities.get<cpnt::Transform>(this->m_scene.m_player);
-            const auto& skeleton = animModel.m_model->getSkeletonInterf();
-
-            while ( skeleton.isEmpty() ) {
-                this->m_task.update();
-            }
-
-            std::unordered_set<jointID_t> hairJointIDs;
-            std::unordered_map<jointID_t, PhysicsEntity> particles;
-            std::unordered_map<jointID_t, glm::vec3> localPoses;
-
-            const auto hairRootIndex = [&](void) {
-                for ( int i = 0; i < skeleton.getSize(); ++i ) {
-                    if ( 1 == skeleton.at(i).jointType() ) {
-                        return i;
-                    }
-                }
-                dalAbort("Failed to find hair root joint.");
-            }();
-            hairJointIDs.emplace(hairRootIndex);
-
-            for ( jointID_t i = hairRootIndex + 1; ; ++i ) {
-                const auto& jointInfo = animModel.m_model->getSkeletonInterf().at(i);
-                const auto parentID = jointInfo.parentIndex();
-                if ( hairJointIDs.end() == hairJointIDs.find(parentID) )
-                    break;
-
-                hairJointIDs.emplace(i);
-                const auto& addedLocalPos = localPoses.emplace(i, jointInfo.localPos());
-                auto addedParticle = particles.emplace(i, this->m_phyworld.newParticle()); dalAssert(addedParticle.second);
-
-                const auto thisLocalPos = addedLocalPos.first->second;
-
-                // POTENTIAL BUG!!
-                // The z value jointInfo.m_boneOffset is minus of what it should be.
-                if ( hairRootIndex == parentID ) {
-                    this->m_phyworld.registerUnaryMod(
-                        std::shared_ptr<dal::UnaryPhyModifier>{new ParticleToEntity{
-                            this->m_scene.m_player, this->m_scene.m_entities,
-                            glm::translate(glm::mat4{1.f}, thisLocalPos)
-                        }},
-                        addedParticle.first->second
-                    );
-                }
-                else {
-                    auto parentParticle = particles.find(parentID); dalAssert(particles.end() != parentParticle);
-                    const auto parentLocalPos = localPoses.at(parentID);
-
-                    this->m_phyworld.registerBinaryMod(
-                        std::shared_ptr<dal::BinaryPhyModifier>{new FixedPointSpringPulling{ 10, glm::distance(parentLocalPos, thisLocalPos) / 10.0 }},
-                        parentParticle->second, addedParticle.first->second
-                    );
-
-                    animModel.m_animState.addModifier(i, std::shared_ptr<dal::IJointModifier>{new HairJointPhysics{
-                        addedParticle.first->second, this->m_phyworld, this->m_scene.m_player, this->m_scene.m_entities
-                        }});
-
-                    std::shared_ptr<UnaryPhyModifier> gravity{ new ParticleGravity{3} };
-                    this->m_phyworld.registerUnaryMod(gravity, addedParticle.first->second);
-                }
-
-                // Draw balls to debug.
-                {
-                    const auto entity = this->m_scene.addObj_static("asset::pbr_ball.dmd");
-                    auto& transform = this->m_scene.m_entities.get<cpnt::Transform>(entity);
-                    transform.setScale(0.02);
-
-                    auto& enttCtrl = this->m_scene.m_entities.assign<cpnt::EntityCtrl>(entity);
-                    enttCtrl.m_ctrler.reset(new EntityToParticle{ addedParticle.first->second, this->m_phyworld });
-                }
-            }
-        } */
-
         // Misc
         {
             this->m_timer.setCapFPS(120);
@@ -296,7 +232,8 @@ namespace dal {
     }
 
     Mainloop::~Mainloop(void) {
-
+        // Modifiers stepped on physics thread may refer to scene, which is destroyed before physics world.
+        this->m_phyworld.stopThread();
     }
 
     int Mainloop::update(void) {
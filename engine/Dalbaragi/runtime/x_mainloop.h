@@ -19,6 +19,8 @@ namespace dal {
 
     private:
         // Managers
+        // Shared by systems below, so it must be destroyed after them.
+        std::unique_ptr<WorkerPool> m_workers;
         TaskMaster m_task;
         ShaderMaster m_shader;
         ResourceMaster m_resMas;
@@ -0,0 +1,222 @@
+#include "d_bvh.h"
+
+#include <algorithm>
+
+
+namespace {
+
+    constexpr unsigned BIN_COUNT = 12;
+    constexpr unsigned MIN_LEAF_SIZE = 2;
+    constexpr unsigned MAX_LEAF_SIZE = 8;
+    // Leaves deeper than this are never made so traversal stack never overflows.
+    constexpr unsigned MAX_BUILD_DEPTH = 48;
+    // Cost of visiting a node relative to testing a primitive.
+    constexpr float TRAVERSAL_COST = 1.f;
+
+
+    struct BuildPrimitive {
+        dal::BVH::Bounds m_bounds;
+        glm::vec3 m_center;
+        uint32_t m_index;
+    };
+
+    struct Bin {
+        dal::BVH::Bounds m_bounds;
+        uint32_t m_count = 0;
+    };
+
+    struct SplitInfo {
+        float m_cost = std::numeric_limits<float>::max();
+        unsigned m_axis = 0;
+        unsigned m_bin = 0;
+    };
+
+
+    class BVHBuilder {
+
+    private:
+        std::vector<dal::BVH::Node>& m_nodes;
+        std::vector<BuildPrimitive>& m_prims;
+
+    public:
+        BVHBuilder(std::vector<dal::BVH::Node>& nodes, std::vector<BuildPrimitive>& prims)
+            : m_nodes(nodes)
+            , m_prims(prims)
+        {
+
+        }
+
+        void build(const uint32_t nodeIndex, const uint32_t first, const uint32_t count, const unsigned depth) {
+            dal::BVH::Bounds bounds, centerBounds;
+            for ( uint32_t i = first; i < first + count; ++i ) {
+                bounds.expand(this->m_prims[i].m_bounds);
+                centerBounds.expand(this->m_prims[i].m_center);
+            }
+            this->m_nodes[nodeIndex].m_bounds = bounds;
+
+            if ( count <= MIN_LEAF_SIZE || depth >= MAX_BUILD_DEPTH ) {
+                this->makeLeaf(nodeIndex, first, count);
+                return;
+            }
+
+            const auto split = this->findBestSplit(first, count, centerBounds);
+            const auto leafCost = static_cast<float>(count);
+            const auto splitCost = TRAVERSAL_COST + split.m_cost / bounds.surfaceArea();
+
+            uint32_t mid;
+            if ( split.m_cost == std::numeric_limits<float>::max() ) {
+                // All centers are at the same point, so SAH can't tell anything.
+                if ( count <= MAX_LEAF_SIZE ) {
+                    this->makeLeaf(nodeIndex, first, count);
+                    return;
+                }
+                mid = first + count / 2;
+            }
+            else if ( splitCost >= leafCost && count <= MAX_LEAF_SIZE ) {
+                this->makeLeaf(nodeIndex, first, count);
+                return;
+            }
+            else {
+                const auto axis = split.m_axis;
+                const auto axisMin = centerBounds.m_min[axis];
+                const auto scale = BIN_COUNT / (centerBounds.m_max[axis] - axisMin);
+
+                const auto midIter = std::partition(this->m_prims.begin() + first, this->m_prims.begin() + first + count,
+                    [&](const BuildPrimitive& p) { return calcBinIndex(p.m_center[axis], axisMin, scale) <= split.m_bin; }
+                );
+                mid = static_cast<uint32_t>(midIter - this->m_prims.begin());
+
+                if ( mid == first || mid == first + count ) {
+                    mid = first + count / 2;
+                }
+            }
+
+            const auto leftIndex = this->newNode();
+            this->build(leftIndex, first, mid - first, depth + 1);
+
+            const auto rightIndex = this->newNode();
+            this->m_nodes[nodeIndex].m_offset = rightIndex;
+            this->build(rightIndex, mid, first + count - mid, depth + 1);
+        }
+
+        uint32_t newNode(void) {
+            this->m_nodes.emplace_back();
+            return static_cast<uint32_t>(this->m_nodes.size() - 1);
+        }
+
+    private:
+        void makeLeaf(const uint32_t nodeIndex, const uint32_t first, const uint32_t count) {
+            auto& node = this->m_nodes[nodeIndex];
+            node.m_offset = first;
+            node.m_count = count;
+        }
+
+        // m_cost of result is sum of area * count of both sides, or float max if no split is possible.
+        SplitInfo findBestSplit(const uint32_t first, const uint32_t count, const dal::BVH::Bounds& centerBounds) const {
+            SplitInfo result;
+
+            for ( unsigned axis = 0; axis < 3; ++axis ) {
+                const auto axisMin = centerBounds.m_min[axis];
+                const auto extent = centerBounds.m_max[axis] - axisMin;
+                if ( extent <= 0.f ) {
+                    continue;
+                }
+
+                const auto scale = BIN_COUNT / extent;
+
+                Bin bins[BIN_COUNT];
+                for ( uint32_t i = first; i < first + count; ++i ) {
+                    const auto& prim = this->m_prims[i];
+                    auto& bin = bins[calcBinIndex(prim.m_center[axis], axisMin, scale)];
+                    bin.m_bounds.expand(prim.m_bounds);
+                    ++bin.m_count;
+                }
+
+                // Sweep from right to get area and count of right side of each split plane.
+                float rightCosts[BIN_COUNT - 1];
+                {
+                    dal::BVH::Bounds rightBounds;
+                    uint32_t rightCount = 0;
+                    for ( unsigned i = BIN_COUNT - 1; i > 0; --i ) {
+                        rightBounds.expand(bins[i].m_bounds);
+                        rightCount += bins[i].m_count;
+                        rightCosts[i - 1] = 0 == rightCount ? 0.f : rightBounds.surfaceArea() * rightCount;
+                    }
+                }
+
+                dal::BVH::Bounds leftBounds;
+                uint32_t leftCount = 0;
+                for ( unsigned i = 0; i < BIN_COUNT - 1; ++i ) {
+                    leftBounds.expand(bins[i].m_bounds);
+                    leftCount += bins[i].m_count;
+                    if ( 0 == leftCount || count == leftCount ) {
+                        continue;
+                    }
+
+                    const auto cost = leftBounds.surfaceArea() * leftCount + rightCosts[i];
+                    if ( cost < result.m_cost ) {
+                        result.m_cost = cost;
+                        result.m_axis = axis;
+                        result.m_bin = i;
+                    }
+                }
+            }
+
+            return result;
+        }
+
+        static unsigned calcBinIndex(const float value, const float axisMin, const float scale) {
+            const auto index = static_cast<int>((value - axisMin) * scale);
+            return static_cast<unsigned>(std::clamp<int>(index, 0, BIN_COUNT - 1));
+        }
+
+    };
+
+}
+
+
+namespace dal {
+
+    float BVH::Bounds::surfaceArea(void) const {
+        const auto d = this->m_max - this->m_min;
+        if ( d.x < 0.f || d.y < 0.f || d.z < 0.f ) {
+            return 0.f;
+        }
+
+        return 2.f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+
+    std::vector<uint32_t> BVH::build(const std::vector<Bounds>& primitives) {
+        this->m_nodes.clear();
+
+        std::vector<uint32_t> order;
+        if ( primitives.empty() ) {
+            return order;
+        }
+
+        std::vector<BuildPrimitive> prims(primitives.size());
+        for ( size_t i = 0; i < primitives.size(); ++i ) {
+            auto& prim = prims[i];
+            prim.m_bounds = primitives[i];
+            prim.m_center = primitives[i].center();
+            prim.m_index = static_cast<uint32_t>(i);
+        }
+
+        // Binary tree with at least 1 primitive per leaf never has more than 2n - 1 nodes.
+        this->m_nodes.reserve(2 * prims.size() - 1);
+
+        BVHBuilder builder{ this->m_nodes, prims };
+        const auto root = builder.newNode();
+        builder.build(root, 0, static_cast<uint32_t>(prims.size()), 0);
+        this->m_nodes.shrink_to_fit();
+
+        order.resize(prims.size());
+        for ( size_t i = 0; i < prims.size(); ++i ) {
+            order[i] = prims[i].m_index;
+        }
+
+        return order;
+    }
+
+}
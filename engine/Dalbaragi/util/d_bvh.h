@@ -0,0 +1,274 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+
+namespace dal {
+
+    // Bounding volume hierarchy over primitives which are only known by their bounding boxes.
+    // Built with binned SAH and stored flattened in depth first order, so left child of a node is always the next one.
+    // Leaves refer to a range of primitives, which means owner must reorder its primitives with the order given by build().
+    class BVH {
+
+    public:
+        struct Bounds {
+            glm::vec3 m_min{ std::numeric_limits<float>::max() };
+            glm::vec3 m_max{ -std::numeric_limits<float>::max() };
+
+            void expand(const glm::vec3& p) {
+                this->m_min = glm::min(this->m_min, p);
+                this->m_max = glm::max(this->m_max, p);
+            }
+            void expand(const Bounds& other) {
+                this->m_min = glm::min(this->m_min, other.m_min);
+                this->m_max = glm::max(this->m_max, other.m_max);
+            }
+            glm::vec3 center(void) const {
+                return (this->m_min + this->m_max) * 0.5f;
+            }
+            float surfaceArea(void) const;
+            bool isOverlapping(const glm::vec3& min, const glm::vec3& max) const {
+                return this->m_min.x <= max.x && this->m_max.x >= min.x &&
+                       this->m_min.y <= max.y && this->m_max.y >= min.y &&
+                       this->m_min.z <= max.z && this->m_max.z >= min.z;
+            }
+        };
+
+        struct Node {
+            Bounds m_bounds;
+            // Index of first primitive for leaves, index of right child for inner nodes.
+            uint32_t m_offset = 0;
+            // 0 for inner nodes.
+            uint32_t m_count = 0;
+
+            bool isLeaf(void) const {
+                return 0 != this->m_count;
+            }
+        };
+
+    private:
+        static constexpr unsigned MAX_DEPTH = 64;
+
+        std::vector<Node> m_nodes;
+
+    public:
+        // Initial tMax of segments, just above 1 so that callers keeping hits with t < tMax find ones at the very end too.
+        static constexpr float SEGMENT_T_LIMIT = 1.f + std::numeric_limits<float>::epsilon();
+
+        // Returns primitive index for each position in new order.
+        std::vector<uint32_t> build(const std::vector<Bounds>& primitives);
+        void clear(void) {
+            this->m_nodes.clear();
+        }
+
+        bool isEmpty(void) const {
+            return this->m_nodes.empty();
+        }
+        auto& nodes(void) const {
+            return this->m_nodes;
+        }
+
+        // Calls func(first, count) for every leaf overlapping the box. Traversal stops if func returns true.
+        template <typename F>
+        bool queryOverlap(const glm::vec3& min, const glm::vec3& max, F&& func) const {
+            if ( this->m_nodes.empty() ) {
+                return false;
+            }
+
+            uint32_t stack[MAX_DEPTH];
+            unsigned stackSize = 0;
+            stack[stackSize++] = 0;
+
+            while ( stackSize > 0 ) {
+                const auto& node = this->m_nodes[stack[--stackSize]];
+                if ( !node.m_bounds.isOverlapping(min, max) ) {
+                    continue;
+                }
+
+                if ( node.isLeaf() ) {
+                    if ( func(node.m_offset, node.m_count) ) {
+                        return true;
+                    }
+                }
+                else {
+                    stack[stackSize++] = node.m_offset;
+                    stack[stackSize++] = static_cast<uint32_t>(&node - this->m_nodes.data()) + 1;
+                }
+            }
+
+            return false;
+        }
+
+        // Segment is pos + rel * t where t is in [0, 1].
+        // Calls func(first, count, tMax) for leaves the segment passes through, nearer ones first. tMax starts at SEGMENT_T_LIMIT.
+        // func may lower tMax to prune farther nodes, and traversal stops if it returns true.
+        template <typename F>
+        bool castSegment(const glm::vec3& pos, const glm::vec3& rel, F&& func) const {
+            if ( this->m_nodes.empty() ) {
+                return false;
+            }
+
+            const glm::vec3 relInv{ 1.f / rel.x, 1.f / rel.y, 1.f / rel.z };
+            float tMax = SEGMENT_T_LIMIT;
+
+            struct StackEntry {
+                uint32_t m_node;
+                float m_entryT;
+            };
+
+            StackEntry stack[MAX_DEPTH];
+            unsigned stackSize = 0;
+
+            const auto tRoot = calcEntryT(this->m_nodes[0].m_bounds, pos, relInv, tMax);
+            if ( tRoot > tMax ) {
+                return false;
+            }
+            stack[stackSize++] = StackEntry{ 0, tRoot };
+
+            while ( stackSize > 0 ) {
+                const auto entry = stack[--stackSize];
+                // func may have lowered tMax since the node was pushed.
+                if ( entry.m_entryT > tMax ) {
+                    continue;
+                }
+
+                const auto nodeIndex = entry.m_node;
+                const auto& node = this->m_nodes[nodeIndex];
+
+                if ( node.isLeaf() ) {
+                    if ( func(node.m_offset, node.m_count, tMax) ) {
+                        return true;
+                    }
+                    continue;
+                }
+
+                const auto left = nodeIndex + 1;
+                const auto right = node.m_offset;
+                const auto tLeft = calcEntryT(this->m_nodes[left].m_bounds, pos, relInv, tMax);
+                const auto tRight = calcEntryT(this->m_nodes[right].m_bounds, pos, relInv, tMax);
+
+                // Push farther one first so that nearer one is popped first.
+                if ( tLeft <= tRight ) {
+                    if ( tRight <= tMax ) stack[stackSize++] = StackEntry{ right, tRight };
+                    if ( tLeft <= tMax ) stack[stackSize++] = StackEntry{ left, tLeft };
+                }
+                else {
+                    if ( tLeft <= tMax ) stack[stackSize++] = StackEntry{ left, tLeft };
+                    if ( tRight <= tMax ) stack[stackSize++] = StackEntry{ right, tRight };
+                }
+            }
+
+            return false;
+        }
+
+        // Packet version of castSegment for up to 32 segments, which shares traversal among segments going similar ways.
+        // Only segments whose bit is set in activeMask are traced. tMax holds end parameter of each segment,
+        // which is SEGMENT_T_LIMIT at most, like the one castSegment starts with.
+        // Calls func(first, count, mask) for leaves reached by segments in mask. func may lower tMax of them to prune farther nodes.
+        template <typename F>
+        void castSegmentPacket(const glm::vec3* const pos, const glm::vec3* const rel, const uint32_t count, float* const tMax,
+            const uint32_t activeMask, F&& func) const
+        {
+            if ( this->m_nodes.empty() || 0 == activeMask ) {
+                return;
+            }
+
+            glm::vec3 relInv[32];
+            for ( uint32_t i = 0; i < count; ++i ) {
+                relInv[i] = glm::vec3{ 1.f / rel[i].x, 1.f / rel[i].y, 1.f / rel[i].z };
+            }
+
+            // Returns bits of segments in mask which pass through the box. out_nearest is the smallest entry parameter among them.
+            const auto findHitMask = [&](const Bounds& bounds, const uint32_t mask, float& out_nearest) {
+                uint32_t result = 0;
+                out_nearest = std::numeric_limits<float>::infinity();
+
+                for ( uint32_t i = 0; i < count; ++i ) {
+                    if ( 0 == (mask & (1u << i)) ) {
+                        continue;
+                    }
+
+                    const auto t = calcEntryT(bounds, pos[i], relInv[i], tMax[i]);
+                    if ( t <= tMax[i] ) {
+                        result |= 1u << i;
+                        out_nearest = std::min(out_nearest, t);
+                    }
+                }
+
+                return result;
+            };
+
+            struct StackEntry {
+                uint32_t m_node, m_mask;
+            };
+
+            StackEntry stack[MAX_DEPTH];
+            unsigned stackSize = 0;
+
+            float nearest;
+            const auto rootMask = findHitMask(this->m_nodes[0].m_bounds, activeMask, nearest);
+            if ( 0 == rootMask ) {
+                return;
+            }
+            stack[stackSize++] = StackEntry{ 0, rootMask };
+
+            while ( stackSize > 0 ) {
+                const auto entry = stack[--stackSize];
+                const auto& node = this->m_nodes[entry.m_node];
+
+                if ( node.isLeaf() ) {
+                    func(node.m_offset, node.m_count, entry.m_mask);
+                    continue;
+                }
+
+                float nearLeft, nearRight;
+                const auto left = entry.m_node + 1;
+                const auto right = node.m_offset;
+                const auto maskLeft = findHitMask(this->m_nodes[left].m_bounds, entry.m_mask, nearLeft);
+                const auto maskRight = findHitMask(this->m_nodes[right].m_bounds, entry.m_mask, nearRight);
+
+                // Push farther one first so that nearer one is popped first.
+                if ( nearLeft <= nearRight ) {
+                    if ( 0 != maskRight ) stack[stackSize++] = StackEntry{ right, maskRight };
+                    if ( 0 != maskLeft ) stack[stackSize++] = StackEntry{ left, maskLeft };
+                }
+                else {
+                    if ( 0 != maskLeft ) stack[stackSize++] = StackEntry{ left, maskLeft };
+                    if ( 0 != maskRight ) stack[stackSize++] = StackEntry{ right, maskRight };
+                }
+            }
+        }
+
+    private:
+        // Returns parameter t where segment enters the box, or infinity if it misses the box within [0, tMax].
+        static float calcEntryT(const Bounds& bounds, const glm::vec3& pos, const glm::vec3& relInv, const float tMax) {
+            constexpr auto MISS = std::numeric_limits<float>::infinity();
+            float tEnter = 0.f, tExit = tMax;
+
+            for ( unsigned i = 0; i < 3; ++i ) {
+                // Segment parallel to the slab, whose parameters would be 0 * inf = NaN if it starts on a slab plane.
+                if ( std::isinf(relInv[i]) ) {
+                    if ( pos[i] < bounds.m_min[i] || pos[i] > bounds.m_max[i] ) {
+                        return MISS;
+                    }
+                    continue;
+                }
+
+                const auto t0 = (bounds.m_min[i] - pos[i]) * relInv[i];
+                const auto t1 = (bounds.m_max[i] - pos[i]) * relInv[i];
+                tEnter = std::max(tEnter, std::min(t0, t1));
+                tExit = std::min(tExit, std::max(t0, t1));
+            }
+
+            return tEnter <= tExit ? tEnter : MISS;
+        }
+
+    };
+
+}
@@ -0,0 +1,180 @@
+#include "d_frustum.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include "d_simdlane.h"
+
+
+// Kernels
+namespace {
+
+    using namespace dal::simd;
+
+    constexpr unsigned NUM_PLANES = 6;
+
+    // Box is outside if even its corner farthest along plane normal is behind the plane.
+    template <typename F, typename M>
+    M isOutsidePlane(const glm::vec4& plane, const F (&center)[3], const F (&extent)[3]) {
+        const auto dist = splat<F>(plane.x) * center[0] + splat<F>(plane.y) * center[1] + splat<F>(plane.z) * center[2] + splat<F>(plane.w);
+        const auto radius = splat<F>(std::abs(plane.x)) * extent[0] + splat<F>(std::abs(plane.y)) * extent[1] + splat<F>(std::abs(plane.z)) * extent[2];
+        return dist + radius < splat<F>(0.f);
+    }
+
+    template <typename F, typename M>
+    M isOutsideFrustum(const dal::Frustum& frustum, const F (&center)[3], const F (&extent)[3]) {
+        M outside = isOutsidePlane<F, M>(frustum.plane(0), center, extent);
+        for ( unsigned i = 1; i < NUM_PLANES; ++i ) {
+            outside = outside | isOutsidePlane<F, M>(frustum.plane(i), center, extent);
+        }
+        return outside;
+    }
+
+    template <typename F, typename M, uint32_t W>
+    size_t runCullAABBs(const dal::Frustum& frustum, const dal::AABBArraySoA& boxes, std::vector<uint8_t>& out_visible) {
+        const auto numBoxes = boxes.size();
+        out_visible.resize(numBoxes);
+        size_t numVisible = 0;
+
+        // Arrays are padded to multiple of 4, so lanes past the last box are safe to load.
+        for ( size_t i = 0; i < numBoxes; i += W ) {
+            F center[3], extent[3];
+            for ( unsigned axis = 0; axis < 3; ++axis ) {
+                loadAt(boxes.center(axis) + i, center[axis]);
+                loadAt(boxes.extent(axis) + i, extent[axis]);
+            }
+
+            const auto outsideBits = toBits(isOutsideFrustum<F, M>(frustum, center, extent));
+            const auto numLanes = std::min<size_t>(W, numBoxes - i);
+            for ( size_t j = 0; j < numLanes; ++j ) {
+                const uint8_t visible = 0 == (outsideBits & (1u << j)) ? 1 : 0;
+                out_visible[i + j] = visible;
+                numVisible += visible;
+            }
+        }
+
+        return numVisible;
+    }
+
+    void makeCenterExtent(const dal::AABB& aabb, float (&center)[3], float (&extent)[3]) {
+        for ( unsigned axis = 0; axis < 3; ++axis ) {
+            center[axis] = (aabb.min()[axis] + aabb.max()[axis]) * 0.5f;
+            extent[axis] = (aabb.max()[axis] - aabb.min()[axis]) * 0.5f;
+        }
+    }
+
+    glm::vec4 normalizePlane(const glm::vec4& plane) {
+        const auto length = glm::length(glm::vec3{ plane });
+        return length > 0.f ? plane / length : glm::vec4{ 0, 0, 0, 1 };
+    }
+
+}
+
+
+// Frustum
+namespace dal {
+
+    Frustum::Frustum(void) {
+        this->m_planes.fill(glm::vec4{ 0, 0, 0, 1 });
+    }
+
+    Frustum::Frustum(const glm::mat4& projView, const bool cullNear) {
+        // Rows of the matrix. glm is column major.
+        glm::vec4 rows[4];
+        for ( unsigned i = 0; i < 4; ++i ) {
+            rows[i] = glm::vec4{ projView[0][i], projView[1][i], projView[2][i], projView[3][i] };
+        }
+
+        // Point is inside if -w <= x, y, z <= w in clip space.
+        for ( unsigned i = 0; i < 3; ++i ) {
+            this->m_planes[2 * i + 0] = ::normalizePlane(rows[3] + rows[i]);
+            this->m_planes[2 * i + 1] = ::normalizePlane(rows[3] - rows[i]);
+        }
+
+        if ( !cullNear ) {
+            this->m_planes[4] = glm::vec4{ 0, 0, 0, 1 };
+        }
+    }
+
+    bool Frustum::isIntersecting(const AABB& aabb) const {
+        float center[3], extent[3];
+        ::makeCenterExtent(aabb, center, extent);
+        return !::isOutsideFrustum<float, bool>(*this, center, extent);
+    }
+
+}
+
+
+// AABBArraySoA
+namespace dal {
+
+    void AABBArraySoA::clear(void) {
+        for ( unsigned axis = 0; axis < 3; ++axis ) {
+            this->m_center[axis].clear();
+            this->m_extent[axis].clear();
+        }
+        this->m_size = 0;
+    }
+
+    void AABBArraySoA::reserve(const size_t size) {
+        const auto padded = (size + 3) / 4 * 4;
+        for ( unsigned axis = 0; axis < 3; ++axis ) {
+            this->m_center[axis].reserve(padded);
+            this->m_extent[axis].reserve(padded);
+        }
+    }
+
+    void AABBArraySoA::push_back(const AABB& aabb) {
+        float center[3], extent[3];
+        ::makeCenterExtent(aabb, center, extent);
+
+        // Padding slot of the last group is reused if there is one.
+        const auto padded = (this->m_size + 1 + 3) / 4 * 4;
+        for ( unsigned axis = 0; axis < 3; ++axis ) {
+            this->m_center[axis].resize(padded, 0.f);
+            this->m_extent[axis].resize(padded, 0.f);
+            this->m_center[axis][this->m_size] = center[axis];
+            this->m_extent[axis][this->m_size] = extent[axis];
+        }
+        ++this->m_size;
+    }
+
+    void AABBArraySoA::push_back(const AABB& aabb, const glm::mat4& transform) {
+        const auto vertices = aabb.vertices();
+
+        AABB world;
+        for ( size_t i = 0; i < vertices.size(); ++i ) {
+            const glm::vec3 p{ transform * glm::vec4{ vertices[i], 1 } };
+            if ( 0 == i ) {
+                world.set(p, p);
+            }
+            else {
+                world.upscaleToInclude(p);
+            }
+        }
+
+        this->push_back(world);
+    }
+
+}
+
+
+namespace dal {
+
+    size_t cullAABBs(const Frustum& frustum, const AABBArraySoA& boxes, std::vector<uint8_t>& out_visible) {
+#if DAL_SIMD_LANE_SSE || DAL_SIMD_LANE_NEON
+        return ::runCullAABBs<simd::Float4, simd::Mask4, simd::FLOAT4_LANE_COUNT>(frustum, boxes, out_visible);
+#else
+        return dal::cullAABBs_scalar(frustum, boxes, out_visible);
+#endif
+    }
+
+    size_t cullAABBs_scalar(const Frustum& frustum, const AABBArraySoA& boxes, std::vector<uint8_t>& out_visible) {
+        return ::runCullAABBs<float, bool, 1>(frustum, boxes, out_visible);
+    }
+
+    const char* getFrustumCullBackendName(void) {
+        return dal::simd::getLaneBackendName();
+    }
+
+}
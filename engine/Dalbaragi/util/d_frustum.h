@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "d_geometrymath.h"
+
+
+// View frustum culling of world space boxes.
+// Boxes are tested 4 at once with SSE2 or NEON, or one by one where neither is available.
+// Scalar versions run the same sequence of float operations, so both must give the same results.
+namespace dal {
+
+    // Six planes facing inward, whose xyz is normalized so that w is signed distance to origin.
+    class Frustum {
+
+    private:
+        // Left, right, bottom, top, near and far.
+        std::array<glm::vec4, 6> m_planes;
+
+    public:
+        // Everything is inside.
+        Frustum(void);
+        // Param projView is projection * view of OpenGL, whose clip space z is in [-w, w].
+        // Shadow passes clamp depth, so their casters in front of near plane must not be culled.
+        explicit Frustum(const glm::mat4& projView, const bool cullNear = true);
+
+        const glm::vec4& plane(const unsigned index) const {
+            return this->m_planes[index];
+        }
+
+        // Conservative, so boxes near corners of the frustum may be reported as intersecting though they are not.
+        bool isIntersecting(const AABB& aabb) const;
+
+    };
+
+
+    // Boxes as centers and half extents in structure of arrays layout, padded to multiple of 4.
+    // Padding boxes are at origin with extents of 0, and results for them must be ignored.
+    class AABBArraySoA {
+
+    private:
+        std::vector<float> m_center[3], m_extent[3];
+        size_t m_size = 0;
+
+    public:
+        void clear(void);
+        void reserve(const size_t size);
+        void push_back(const AABB& aabb);
+        // Transform is applied to all 8 corners, so the result bounds rotated box too.
+        void push_back(const AABB& aabb, const glm::mat4& transform);
+
+        size_t size(void) const {
+            return this->m_size;
+        }
+        bool empty(void) const {
+            return 0 == this->m_size;
+        }
+        const float* center(const unsigned axis) const {
+            return this->m_center[axis].data();
+        }
+        const float* extent(const unsigned axis) const {
+            return this->m_extent[axis].data();
+        }
+
+    };
+
+
+    // Element i of out_visible is set to 1 if box i intersects the frustum, 0 otherwise. Returns number of visible ones.
+    // Param out_visible is resized to number of boxes. Result is the same as Frustum::isIntersecting for each box.
+    size_t cullAABBs(const Frustum& frustum, const AABBArraySoA& boxes, std::vector<uint8_t>& out_visible);
+    size_t cullAABBs_scalar(const Frustum& frustum, const AABBArraySoA& boxes, std::vector<uint8_t>& out_visible);
+
+    // Name of instruction set cull functions are using.
+    const char* getFrustumCullBackendName(void);
+
+}
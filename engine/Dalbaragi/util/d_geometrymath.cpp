@@ -3,6 +3,8 @@
 #include <limits>
 #include <algorithm>
 
+#include "d_geometrysimd.h"
+
 
 namespace {
 
@@ -46,6 +48,60 @@ namespace {
         tri2 = dal::Triangle{ p1, p3, p4 };
     }
 
+    // Calls func(first, count) for each piece of [first, first + count) no longer than TRI_BATCH_MAX.
+    // Traversal stops if func returns true.
+    template <typename F>
+    bool forEachTriBatch(const uint32_t first, const uint32_t count, F&& func) {
+        for ( uint32_t i = 0; i < count; i += dal::TRI_BATCH_MAX ) {
+            if ( func(first + i, std::min(dal::TRI_BATCH_MAX, count - i)) ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename F>
+    void forEachSetBit(uint32_t mask, F&& func) {
+        for ( uint32_t i = 0; 0 != mask; ++i, mask >>= 1 ) {
+            if ( mask & 1 ) {
+                func(i);
+            }
+        }
+    }
+
+    dal::BVH::Bounds makeTriangleBounds(const dal::Triangle& tri) {
+        dal::BVH::Bounds result;
+
+        for ( auto& p : tri.points() ) {
+            result.expand(p);
+        }
+
+        return result;
+    }
+
+    // Box in local space of a soup which contains given world space box.
+    dal::BVH::Bounds makeLocalBounds(const dal::AABB& aabb, const glm::mat4& transInv) {
+        dal::BVH::Bounds result;
+
+        for ( auto& p : aabb.vertices() ) {
+            result.expand(glm::vec3{ transInv * glm::vec4{ p, 1 } });
+        }
+
+        return result;
+    }
+
+    template <typename T>
+    void reorderByBVH(std::vector<T>& list, const std::vector<uint32_t>& order) {
+        std::vector<T> result;
+        result.reserve(list.size());
+
+        for ( const auto index : order ) {
+            result.push_back(list[index]);
+        }
+
+        list.swap(result);
+    }
+
 }
 
 
@@ -107,10 +163,12 @@ namespace {
                 return false; // No intersection possible.
         }
 
+        const auto boxVertices = box.vertices();
+
         // Test the triangle normal
         {
             const double triangleOffset = glm::dot(triangle.normal(), triangle.point0());
-            const auto [boxMin, boxMax] = ::Project(box.vertices(), triangle.normal());
+            const auto [boxMin, boxMax] = ::Project(boxVertices, triangle.normal());
             if ( boxMax <= triangleOffset || boxMin >= triangleOffset )
                 return false; // No intersection possible.
         }
@@ -125,7 +183,7 @@ namespace {
             for ( int j = 0; j < 3; j++ ) {
                 // The box normals are the same as it's edge tangents
                 const glm::vec3 axis = glm::cross(triangleEdges[i], boxNormals[j]);
-                const auto [boxMin, boxMax] = ::Project(box.vertices(), axis);
+                const auto [boxMin, boxMax] = ::Project(boxVertices, axis);
                 const auto [triangleMin, triangleMax] = ::Project(triangle.points(), axis);
                 if ( boxMax < triangleMin || boxMin > triangleMax )
                     return false; // No intersection possible
@@ -361,6 +419,8 @@ namespace dal {
 // AABB
 namespace dal {
 
+    static_assert(sizeof(AABB) == sizeof(float) * 6);
+
     AABB::AABB(const glm::vec3& p0, const glm::vec3& p1) {
         this->set(p0, p1);
     }
@@ -389,6 +449,22 @@ namespace dal {
         };
     }
 
+    std::array<glm::vec3, 8> AABB::vertices(void) const {
+        const auto p000 = this->min();
+        const auto p111 = this->max();
+
+        return std::array<glm::vec3, 8>{
+            p000,  // 000
+            glm::vec3{ p000.x, p000.y, p111.z },  // 001
+            glm::vec3{ p000.x, p111.y, p000.z },  // 010
+            glm::vec3{ p000.x, p111.y, p111.z },  // 011
+            glm::vec3{ p111.x, p000.y, p000.z },  // 100
+            glm::vec3{ p111.x, p000.y, p111.z },  // 101
+            glm::vec3{ p111.x, p111.y, p000.z },  // 110
+            p111   // 111
+        };
+    }
+
 
     std::array<dal::Segment, 12> AABB::makeEdges(void) const {
         std::array<dal::Segment, 12> result;
@@ -441,8 +517,6 @@ namespace dal {
                 this->m_max[i] = value0;
             }
         }
-
-        this->updateVertices(this->m_vertices);
     }
 
     void AABB::upscaleToInclude(const glm::vec3& p) {
@@ -454,24 +528,6 @@ namespace dal {
                 this->m_max[i] = p[i];
             }
         }
-
-        this->updateVertices(this->m_vertices);
-    }
-
-    // Private
-
-    void AABB::updateVertices(std::array<glm::vec3, 8>& result) const {
-        const auto p000 = this->min();
-        const auto p111 = this->max();
-
-        result[0] = p000;  // 000
-        result[1] = glm::vec3{ p000.x, p000.y, p111.z };  // 001
-        result[2] = glm::vec3{ p000.x, p111.y, p000.z };  // 010
-        result[3] = glm::vec3{ p000.x, p111.y, p111.z };  // 011
-        result[4] = glm::vec3{ p111.x, p000.y, p000.z };  // 100
-        result[5] = glm::vec3{ p111.x, p000.y, p111.z };  // 101
-        result[6] = glm::vec3{ p111.x, p111.y, p000.z };  // 110
-        result[7] = p111;  // 111
     }
 
 }
@@ -510,6 +566,110 @@ namespace dal {
 }
 
 
+// TriangleSoup
+namespace dal {
+
+    void TriangleSoup::buildBVH(void) {
+        std::vector<BVH::Bounds> bounds;
+        bounds.reserve(this->m_triangles.size());
+
+        for ( auto& tri : this->m_triangles ) {
+            bounds.push_back(::makeTriangleBounds(tri));
+        }
+
+        const auto order = this->m_bvh.build(bounds);
+        ::reorderByBVH(this->m_triangles, order);
+    }
+
+}
+
+
+// TriangleSoupSoA
+namespace dal {
+
+    TriangleSoupSoA::TriangleSoupSoA(const TriangleSoup& soup, const glm::mat4& trans)
+        : m_faceCull(soup.isFaceCullSet())
+    {
+        this->reserve(soup.getSize());
+
+        for ( auto& tri : soup ) {
+            this->addTriangle(tri.transform(trans));
+        }
+
+        this->buildBVH();
+    }
+
+    Triangle TriangleSoupSoA::triangle(const size_t index) const {
+        auto& c = this->m_coords;
+
+        return Triangle{
+            glm::vec3{ c[0][index], c[1][index], c[2][index] },
+            glm::vec3{ c[3][index], c[4][index], c[5][index] },
+            glm::vec3{ c[6][index], c[7][index], c[8][index] }
+        };
+    }
+
+    void TriangleSoupSoA::reserve(const size_t size) {
+        for ( auto& x : this->m_coords ) {
+            x.reserve(size);
+        }
+    }
+
+    void TriangleSoupSoA::addTriangle(const Triangle& tri) {
+        glm::vec3 boxMin, boxMax;
+
+        if ( this->isEmpty() ) {
+            boxMin = tri.point0();
+            boxMax = tri.point0();
+        }
+        else {
+            boxMin = this->m_aabb.min();
+            boxMax = this->m_aabb.max();
+        }
+
+        for ( unsigned i = 0; i < 3; ++i ) {
+            const auto& p = tri.points()[i];
+
+            for ( unsigned j = 0; j < 3; ++j ) {
+                this->m_coords[3 * i + j].push_back(p[j]);
+            }
+
+            boxMin = glm::min(boxMin, p);
+            boxMax = glm::max(boxMax, p);
+        }
+
+        this->m_aabb.set(boxMin, boxMax);
+        this->m_bvh.clear();
+    }
+
+    void TriangleSoupSoA::clear(void) {
+        for ( auto& x : this->m_coords ) {
+            x.clear();
+        }
+
+        this->m_aabb = AABB{};
+        this->m_bvh.clear();
+    }
+
+    void TriangleSoupSoA::buildBVH(void) {
+        const auto numTriangles = this->getSize();
+
+        std::vector<BVH::Bounds> bounds;
+        bounds.reserve(numTriangles);
+
+        for ( size_t i = 0; i < numTriangles; ++i ) {
+            bounds.push_back(::makeTriangleBounds(this->triangle(i)));
+        }
+
+        const auto order = this->m_bvh.build(bounds);
+        for ( auto& x : this->m_coords ) {
+            ::reorderByBVH(x, order);
+        }
+    }
+
+}
+
+
 // Triangle Sorter
 namespace dal {
 
@@ -633,6 +793,47 @@ namespace dal {
         return dal::isIntersecting(newSeg, obb.aabb());
     }
 
+    bool isIntersecting(const Segment& seg, const TriangleSoup& soup, const glm::mat4& trans) {
+        const auto localSeg = seg.transform(glm::inverse(trans));
+
+        const auto testRange = [&](const uint32_t first, const uint32_t count) {
+            for ( uint32_t i = first; i < first + count; ++i ) {
+                if ( dal::findIntersection(localSeg, soup[i], soup.isFaceCullSet()) ) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        if ( soup.bvh().isEmpty() ) {
+            return testRange(0, static_cast<uint32_t>(soup.getSize()));
+        }
+        else {
+            return soup.bvh().castSegment(localSeg.pos(), localSeg.rel(), [&](const uint32_t first, const uint32_t count, float&) {
+                return testRange(first, count);
+            });
+        }
+    }
+
+    bool isIntersecting(const Segment& seg, const TriangleSoupSoA& soup) {
+        const auto testRange = [&](const uint32_t first, const uint32_t count) {
+            return ::forEachTriBatch(first, count, [&](const uint32_t batchFirst, const uint32_t batchCount) {
+                SegTriBatchResult batch;
+                dal::intersectSegTriBatch(soup, batchFirst, batchCount, seg, soup.isFaceCullSet(), batch);
+                return 0 != batch.m_hitMask;
+            });
+        };
+
+        if ( soup.bvh().isEmpty() ) {
+            return testRange(0, static_cast<uint32_t>(soup.getSize()));
+        }
+        else {
+            return soup.bvh().castSegment(seg.pos(), seg.rel(), [&](const uint32_t first, const uint32_t count, float&) {
+                return testRange(first, count);
+            });
+        }
+    }
+
 
     bool isIntersecting(const Plane& plane, const Sphere& sphere) {
         const auto distOfCenter = std::abs(plane.calcSignedDist(sphere.center()));
@@ -640,10 +841,11 @@ namespace dal {
     }
 
     bool isIntersecting(const Plane& plane, const AABB& aabb) {
-        const auto firstOne = plane.isInFront(aabb.vertices()[0]);
+        const auto vertices = aabb.vertices();
+        const auto firstOne = plane.isInFront(vertices[0]);
 
-        for ( size_t i = 1; i < aabb.vertices().size(); ++i ) {
-            const auto thisOne = plane.isInFront(aabb.vertices()[i]);
+        for ( size_t i = 1; i < vertices.size(); ++i ) {
+            const auto thisOne = plane.isInFront(vertices[i]);
             if ( firstOne != thisOne ) {
                 return true;
             }
@@ -705,13 +907,45 @@ namespace dal {
     }
 
     bool isIntersecting(const AABB& aabb, const TriangleSoup& soup, const glm::mat4& trans) {
-        for ( const auto& tri : soup ) {
-            const auto newTri = tri.transform(trans);
-            if ( dal::isIntersecting(newTri, aabb) ) {
-                return true;
+        if ( soup.bvh().isEmpty() ) {
+            for ( const auto& tri : soup ) {
+                const auto newTri = tri.transform(trans);
+                if ( dal::isIntersecting(newTri, aabb) ) {
+                    return true;
+                }
             }
+            return false;
+        }
+
+        const auto localBox = ::makeLocalBounds(aabb, glm::inverse(trans));
+
+        return soup.bvh().queryOverlap(localBox.m_min, localBox.m_max, [&](const uint32_t first, const uint32_t count) {
+            for ( uint32_t i = first; i < first + count; ++i ) {
+                if ( dal::isIntersecting(soup[i].transform(trans), aabb) ) {
+                    return true;
+                }
+            }
+            return false;
+        });
+    }
+
+    bool isIntersecting(const AABB& aabb, const TriangleSoupSoA& soup) {
+        if ( !dal::isIntersecting(aabb, soup.aabb()) ) {
+            return false;
+        }
+
+        const auto testRange = [&](const uint32_t first, const uint32_t count) {
+            return ::forEachTriBatch(first, count, [&](const uint32_t batchFirst, const uint32_t batchCount) {
+                return 0 != dal::intersectTriBoxBatch(soup, batchFirst, batchCount, aabb);
+            });
+        };
+
+        if ( soup.bvh().isEmpty() ) {
+            return testRange(0, static_cast<uint32_t>(soup.getSize()));
+        }
+        else {
+            return soup.bvh().queryOverlap(aabb.min(), aabb.max(), testRange);
         }
-        return false;
     }
 
 }
@@ -734,12 +968,28 @@ namespace dal {
     }
 
     size_t getIntersectingTriangles(const AABB& aabb, const TriangleSoup& soup, const glm::mat4& trans, std::vector<dal::Triangle>& result) {
-        for ( const auto& tri : soup ) {
-            const auto newTri = tri.transform(trans);
-            if ( dal::isIntersecting(newTri, aabb) ) {
-                result.push_back(newTri);
+        if ( soup.bvh().isEmpty() ) {
+            for ( const auto& tri : soup ) {
+                const auto newTri = tri.transform(trans);
+                if ( dal::isIntersecting(newTri, aabb) ) {
+                    result.push_back(newTri);
+                }
             }
+            return result.size();
         }
+
+        const auto localBox = ::makeLocalBounds(aabb, glm::inverse(trans));
+
+        soup.bvh().queryOverlap(localBox.m_min, localBox.m_max, [&](const uint32_t first, const uint32_t count) {
+            for ( uint32_t i = first; i < first + count; ++i ) {
+                const auto newTri = soup[i].transform(trans);
+                if ( dal::isIntersecting(newTri, aabb) ) {
+                    result.push_back(newTri);
+                }
+            }
+            return false;
+        });
+
         return result.size();
     }
 
@@ -749,6 +999,31 @@ namespace dal {
         return result;
     }
 
+    size_t getIntersectingTriangles(const AABB& aabb, const TriangleSoupSoA& soup, std::vector<dal::Triangle>& result) {
+        if ( !dal::isIntersecting(aabb, soup.aabb()) ) {
+            return result.size();
+        }
+
+        const auto testRange = [&](const uint32_t first, const uint32_t count) {
+            return ::forEachTriBatch(first, count, [&](const uint32_t batchFirst, const uint32_t batchCount) {
+                const auto mask = dal::intersectTriBoxBatch(soup, batchFirst, batchCount, aabb);
+                ::forEachSetBit(mask, [&](const uint32_t i) {
+                    result.push_back(soup.triangle(batchFirst + i));
+                });
+                return false;
+            });
+        };
+
+        if ( soup.bvh().isEmpty() ) {
+            testRange(0, static_cast<uint32_t>(soup.getSize()));
+        }
+        else {
+            soup.bvh().queryOverlap(aabb.min(), aabb.max(), testRange);
+        }
+
+        return result.size();
+    }
+
 }
 
 
@@ -810,6 +1085,86 @@ namespace dal {
         return result;
     }
 
+    std::optional<SegIntersecInfo> findIntersection(const Segment& seg, const TriangleSoup& soup, const glm::mat4& trans) {
+        std::optional<SegIntersecInfo> result = std::nullopt;
+
+        if ( soup.bvh().isEmpty() ) {
+            float maxDist = std::numeric_limits<float>::max();
+
+            for ( const auto& tri : soup ) {
+                const auto triCol = dal::findIntersection(seg, tri.transform(trans), soup.isFaceCullSet());
+                if ( triCol && triCol->m_distance < maxDist ) {
+                    result = triCol;
+                    maxDist = triCol->m_distance;
+                }
+            }
+
+            return result;
+        }
+
+        // Ratio of distance to segment length doesn't change by affine transform, so triangles are tested in local space.
+        const auto localSeg = seg.transform(glm::inverse(trans));
+        const auto localLength = localSeg.length();
+        const auto worldLength = seg.length();
+        if ( 0.f == localLength )
+            return std::nullopt;
+
+        soup.bvh().castSegment(localSeg.pos(), localSeg.rel(), [&](const uint32_t first, const uint32_t count, float& tMax) {
+            for ( uint32_t i = first; i < first + count; ++i ) {
+                const auto triCol = dal::findIntersection(localSeg, soup[i], soup.isFaceCullSet());
+                if ( !triCol )
+                    continue;
+
+                const auto t = triCol->m_distance / localLength;
+                if ( t < tMax ) {
+                    tMax = t;
+                    result = SegIntersecInfo{ t * worldLength, triCol->m_isFromFront };
+                }
+            }
+            return false;
+        });
+
+        return result;
+    }
+
+    std::optional<SegIntersecInfo> findIntersection(const Segment& seg, const TriangleSoupSoA& soup) {
+        if ( !dal::isIntersecting(seg, soup.aabb()) )
+            return std::nullopt;
+
+        const auto segLength = seg.length();
+        if ( 0.f == segLength )
+            return std::nullopt;
+
+        std::optional<SegIntersecInfo> result = std::nullopt;
+
+        const auto testRange = [&](const uint32_t first, const uint32_t count, float& tMax) {
+            ::forEachTriBatch(first, count, [&](const uint32_t batchFirst, const uint32_t batchCount) {
+                SegTriBatchResult batch;
+                dal::intersectSegTriBatch(soup, batchFirst, batchCount, seg, soup.isFaceCullSet(), batch);
+
+                ::forEachSetBit(batch.m_hitMask, [&](const uint32_t i) {
+                    if ( batch.m_t[i] < tMax ) {
+                        tMax = batch.m_t[i];
+                        result = SegIntersecInfo{ batch.m_t[i] * segLength, 0 != (batch.m_frontMask & (1u << i)) };
+                    }
+                });
+                return false;
+            });
+            return false;
+        };
+
+        if ( soup.bvh().isEmpty() ) {
+            // Same as BVH traversal starts with, so that both find hits at exactly t = 1.
+            float tMax = BVH::SEGMENT_T_LIMIT;
+            testRange(0, static_cast<uint32_t>(soup.getSize()), tMax);
+        }
+        else {
+            soup.bvh().castSegment(seg.pos(), seg.rel(), testRange);
+        }
+
+        return result;
+    }
+
 }
 
 
@@ -891,4 +1246,243 @@ namespace dal {
         return result.m_this;
     }
 
+    glm::vec3 calcResolveForAABB(const dal::AABB& movingBox, const dal::Triangle& tri) {
+        const auto center = (movingBox.min() + movingBox.max()) * 0.5f;
+        const auto extent = (movingBox.max() - movingBox.min()) * 0.5f;
+        const auto& points = tri.points();
+
+        const glm::vec3 boxAxes[3]{ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+        const glm::vec3 edges[3]{ points[1] - points[0], points[2] - points[1], points[0] - points[2] };
+
+        // Box axes go first since they reject most of triangles that are merely nearby.
+        std::array<glm::vec3, 13> axes;
+        for ( unsigned i = 0; i < 3; ++i ) {
+            axes[i] = boxAxes[i];
+            for ( unsigned j = 0; j < 3; ++j ) {
+                axes[4 + 3 * i + j] = glm::cross(boxAxes[i], edges[j]);
+            }
+        }
+        axes[3] = glm::cross(edges[0], edges[1]);
+
+        glm::vec3 result{ 0 };
+        float minDepth = std::numeric_limits<float>::max();
+
+        for ( const auto& axis : axes ) {
+            const auto lengthSqr = glm::dot(axis, axis);
+            // Edge parallel to a box axis, whose cross product says nothing.
+            if ( lengthSqr < 1e-12f ) {
+                continue;
+            }
+            const auto unit = axis / std::sqrt(lengthSqr);
+
+            const auto boxCenter = glm::dot(unit, center);
+            const auto boxRadius = std::abs(unit.x) * extent.x + std::abs(unit.y) * extent.y + std::abs(unit.z) * extent.z;
+            const auto d0 = glm::dot(unit, points[0]);
+            const auto d1 = glm::dot(unit, points[1]);
+            const auto d2 = glm::dot(unit, points[2]);
+            const auto triMin = std::min(d0, std::min(d1, d2));
+            const auto triMax = std::max(d0, std::max(d1, d2));
+
+            // Moving box towards negative or positive direction of the axis.
+            const auto depthNeg = (boxCenter + boxRadius) - triMin;
+            const auto depthPos = triMax - (boxCenter - boxRadius);
+            if ( depthNeg <= 0.f || depthPos <= 0.f ) {
+                return glm::vec3{ 0 };
+            }
+
+            if ( depthNeg < minDepth ) {
+                minDepth = depthNeg;
+                result = -unit * depthNeg;
+            }
+            if ( depthPos < minDepth ) {
+                minDepth = depthPos;
+                result = unit * depthPos;
+            }
+        }
+
+        return result;
+    }
+
+}
+
+
+namespace {
+
+    // Time range during which moving box overlaps a static convex shape, narrowed axis by axis.
+    struct SweepRange {
+        float m_enter = -std::numeric_limits<float>::max();
+        float m_exit = std::numeric_limits<float>::max();
+        // Normal of the axis which was entered last.
+        glm::vec3 m_normal{ 0 };
+    };
+
+    // Half length of projection of a box with given half size onto the axis.
+    float projectBoxRadius(const glm::vec3& halfSize, const glm::vec3& axis) {
+        return halfSize.x * std::abs(axis.x) + halfSize.y * std::abs(axis.y) + halfSize.z * std::abs(axis.z);
+    }
+
+    // Projection of moving box is [boxCenter - boxRadius, boxCenter + boxRadius] + speed * t.
+    // Returns false if the projections never overlap, which means the shapes never collide.
+    bool narrowSweepOnAxis(const glm::vec3& axis, const float boxCenter, const float boxRadius, const float speed,
+        const float otherMin, const float otherMax, SweepRange& range)
+    {
+        const auto boxMin = boxCenter - boxRadius;
+        const auto boxMax = boxCenter + boxRadius;
+
+        if ( 0.f == speed ) {
+            return boxMax >= otherMin && boxMin <= otherMax;
+        }
+
+        float enter, exit;
+        glm::vec3 normal;
+        if ( speed > 0.f ) {
+            enter = (otherMin - boxMax) / speed;
+            exit = (otherMax - boxMin) / speed;
+            normal = -axis;
+        }
+        else {
+            enter = (otherMax - boxMin) / speed;
+            exit = (otherMin - boxMax) / speed;
+            normal = axis;
+        }
+
+        if ( enter > range.m_enter ) {
+            range.m_enter = enter;
+            range.m_normal = normal;
+        }
+        range.m_exit = std::min(range.m_exit, exit);
+
+        return range.m_enter <= range.m_exit;
+    }
+
+    // Boxes overlapping from the start only count when the movement goes deeper.
+    std::optional<dal::SweepHit> makeSweepHit(const SweepRange& range, const glm::vec3& delta) {
+        if ( range.m_enter > 1.f || range.m_exit < 0.f ) {
+            return std::nullopt;
+        }
+        // Not moving on any axis which could separate them.
+        if ( glm::vec3{ 0 } == range.m_normal ) {
+            return std::nullopt;
+        }
+
+        const auto normal = glm::normalize(range.m_normal);
+        if ( range.m_enter < 0.f ) {
+            if ( glm::dot(delta, normal) >= 0.f ) {
+                return std::nullopt;
+            }
+            return dal::SweepHit{ 0.f, normal };
+        }
+
+        return dal::SweepHit{ range.m_enter, normal };
+    }
+
+    dal::AABB makeSweptBox(const dal::AABB& moving, const glm::vec3& delta) {
+        return dal::AABB{
+            glm::min(moving.min(), moving.min() + delta),
+            glm::max(moving.max(), moving.max() + delta)
+        };
+    }
+
+}
+
+
+// Swept AABB
+namespace dal {
+
+    std::optional<SweepHit> sweepAABB(const AABB& moving, const glm::vec3& delta, const AABB& target) {
+        const auto center = (moving.min() + moving.max()) * 0.5f;
+        const auto halfSize = (moving.max() - moving.min()) * 0.5f;
+
+        SweepRange range;
+        for ( unsigned i = 0; i < 3; ++i ) {
+            glm::vec3 axis{ 0 };
+            axis[i] = 1.f;
+
+            if ( !::narrowSweepOnAxis(axis, center[i], halfSize[i], delta[i], target.min()[i], target.max()[i], range) ) {
+                return std::nullopt;
+            }
+        }
+
+        return ::makeSweepHit(range, delta);
+    }
+
+    std::optional<SweepHit> sweepAABB(const AABB& moving, const glm::vec3& delta, const Triangle& tri) {
+        const auto center = (moving.min() + moving.max()) * 0.5f;
+        const auto halfSize = (moving.max() - moving.min()) * 0.5f;
+
+        // Box normals, triangle normal and cross products of their edges separate box and triangle if anything does.
+        std::array<glm::vec3, 13> axes;
+        axes[0] = glm::vec3{ 1, 0, 0 };
+        axes[1] = glm::vec3{ 0, 1, 0 };
+        axes[2] = glm::vec3{ 0, 0, 1 };
+
+        const std::array<glm::vec3, 3> edges{
+            tri.point1() - tri.point0(),
+            tri.point2() - tri.point1(),
+            tri.point0() - tri.point2()
+        };
+        axes[3] = glm::cross(edges[0], edges[1]);
+        for ( unsigned i = 0; i < 3; ++i ) {
+            for ( unsigned j = 0; j < 3; ++j ) {
+                axes[4 + 3 * i + j] = glm::cross(axes[j], edges[i]);
+            }
+        }
+
+        SweepRange range;
+        for ( auto& axis : axes ) {
+            // Parallel edges make zero vector, which separates nothing.
+            if ( glm::dot(axis, axis) < 1e-12f ) {
+                continue;
+            }
+
+            const auto p0 = glm::dot(tri.point0(), axis);
+            const auto p1 = glm::dot(tri.point1(), axis);
+            const auto p2 = glm::dot(tri.point2(), axis);
+            const auto triMin = std::min(p0, std::min(p1, p2));
+            const auto triMax = std::max(p0, std::max(p1, p2));
+
+            const auto boxCenter = glm::dot(center, axis);
+            const auto boxRadius = ::projectBoxRadius(halfSize, axis);
+
+            if ( !::narrowSweepOnAxis(axis, boxCenter, boxRadius, glm::dot(delta, axis), triMin, triMax, range) ) {
+                return std::nullopt;
+            }
+        }
+
+        return ::makeSweepHit(range, delta);
+    }
+
+    std::optional<SweepHit> sweepAABB(const AABB& moving, const glm::vec3& delta, const TriangleSoupSoA& soup) {
+        const auto sweptBox = ::makeSweptBox(moving, delta);
+        if ( !dal::isIntersecting(sweptBox, soup.aabb()) ) {
+            return std::nullopt;
+        }
+
+        std::optional<SweepHit> result = std::nullopt;
+
+        const auto testRange = [&](const uint32_t first, const uint32_t count) {
+            ::forEachTriBatch(first, count, [&](const uint32_t batchFirst, const uint32_t batchCount) {
+                // Triangles outside of swept box can never be touched.
+                const auto mask = dal::intersectTriBoxBatch(soup, batchFirst, batchCount, sweptBox);
+                ::forEachSetBit(mask, [&](const uint32_t i) {
+                    const auto hit = dal::sweepAABB(moving, delta, soup.triangle(batchFirst + i));
+                    if ( hit && (!result || hit->m_time < result->m_time) ) {
+                        result = hit;
+                    }
+                });
+                return false;
+            });
+            return false;
+        };
+
+        if ( soup.bvh().isEmpty() ) {
+            testRange(0, static_cast<uint32_t>(soup.getSize()));
+        }
+        else {
+            soup.bvh().queryOverlap(sweptBox.min(), sweptBox.max(), testRange);
+        }
+
+        return result;
+    }
+
 }
@@ -7,6 +7,8 @@
 
 #include <glm/glm.hpp>
 
+#include "d_bvh.h"
+
 
 #define DAL_PI 3.141592653589793238462643383279502884L
 
@@ -147,14 +149,10 @@ namespace dal {
     };
 
 
+    // Only min and max are stored so that arrays of boxes stay small. Corners are made on demand.
     class AABB {
 
     private:
-        // The order is
-        // 000, 001, 010, 011, 100, 101, 110, 111
-        // Each digit means x, y, z, 0 means lower value on the axis, 1 means higher.
-        std::array<glm::vec3, 8> m_vertices{ glm::vec3{0} };
-
         glm::vec3 m_min{ 0 }, m_max{ 0 };
 
     public:
@@ -167,9 +165,10 @@ namespace dal {
         const glm::vec3& max(void) const {
             return this->m_max;
         }
-        auto& vertices(void) const {
-            return this->m_vertices;
-        }
+        // The order is
+        // 000, 001, 010, 011, 100, 101, 110, 111
+        // Each digit means x, y, z, 0 means lower value on the axis, 1 means higher.
+        std::array<glm::vec3, 8> vertices(void) const;
 
         float volume(void) const;
         bool isInside(const glm::vec3& p) const;
@@ -185,9 +184,6 @@ namespace dal {
             this->upscaleToInclude(glm::vec3{ x, y, z });
         }
 
-    private:
-         void updateVertices(std::array<glm::vec3, 8>& result) const;
-
     };
 
 }
@@ -230,6 +226,8 @@ namespace dal {
 
     private:
         std::vector<dal::Triangle> m_triangles;
+        // Empty until buildBVH is called, and cleared whenever triangles are added.
+        dal::BVH m_bvh;
         bool m_faceCull = true;
 
     public:
@@ -247,6 +245,9 @@ namespace dal {
         bool isFaceCullSet(void) const {
             return this->m_faceCull;
         }
+        const BVH& bvh(void) const {
+            return this->m_bvh;
+        }
 
         auto begin(void) const {
             return this->m_triangles.begin();
@@ -257,8 +258,10 @@ namespace dal {
 
         void addTriangle(const Triangle& tri) {
             this->m_triangles.push_back(tri);
+            this->m_bvh.clear();
         }
         Triangle& emplaceTriangle(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3) {
+            this->m_bvh.clear();
             return this->m_triangles.emplace_back(p1, p2, p3);
         }
         void reserve(const size_t size) {
@@ -266,12 +269,64 @@ namespace dal {
         }
         void resize(const size_t size) {
             this->m_triangles.resize(size);
+            this->m_bvh.clear();
         }
+        // Call buildBVH again after modifying triangles through this.
         auto data(void) {
             static_assert(sizeof(float) * 9 == sizeof(Triangle));
             return this->m_triangles.data();
         }
 
+        // Reorders triangles.
+        void buildBVH(void);
+
+    };
+
+
+    // Triangles stored in structure of arrays layout, with a box bounding all of them.
+    // Meant for static geometry which is transformed into world space only once.
+    class TriangleSoupSoA {
+
+    private:
+        // Index is 3 * point index + axis index.
+        std::array<std::vector<float>, 9> m_coords;
+        dal::AABB m_aabb;
+        dal::BVH m_bvh;
+        bool m_faceCull = true;
+
+    public:
+        TriangleSoupSoA(void) = default;
+        // BVH is built as well.
+        TriangleSoupSoA(const TriangleSoup& soup, const glm::mat4& trans);
+
+        size_t getSize(void) const {
+            return this->m_coords[0].size();
+        }
+        bool isEmpty(void) const {
+            return this->m_coords[0].empty();
+        }
+        bool isFaceCullSet(void) const {
+            return this->m_faceCull;
+        }
+        const AABB& aabb(void) const {
+            return this->m_aabb;
+        }
+        const BVH& bvh(void) const {
+            return this->m_bvh;
+        }
+        const float* coords(const unsigned pointIndex, const unsigned axis) const {
+            return this->m_coords[3 * pointIndex + axis].data();
+        }
+        Triangle triangle(const size_t index) const;
+
+        void reserve(const size_t size);
+        void addTriangle(const Triangle& tri);
+        // Memory is kept for reuse.
+        void clear(void);
+
+        // Reorders triangles.
+        void buildBVH(void);
+
     };
 
 }
@@ -320,6 +375,8 @@ namespace dal {
     bool isIntersecting(const Segment& seg, const Sphere& sphere);
     bool isIntersecting(const Segment& seg, const AABB& aabb);
     bool isIntersecting(const Segment& seg, const OBB& obb);
+    bool isIntersecting(const Segment& seg, const TriangleSoup& soup, const glm::mat4& trans);
+    bool isIntersecting(const Segment& seg, const TriangleSoupSoA& soup);
 
     bool isIntersecting(const Plane& plane, const Sphere& sphere);
     bool isIntersecting(const Plane& plane, const AABB& aabb);
@@ -332,6 +389,7 @@ namespace dal {
 
     bool isIntersecting(const AABB& one, const AABB& other);
     bool isIntersecting(const AABB& aabb, const TriangleSoup& soup, const glm::mat4& trans);
+    bool isIntersecting(const AABB& aabb, const TriangleSoupSoA& soup);
 
 }
 
@@ -343,6 +401,7 @@ namespace dal {
 
     size_t getIntersectingTriangles(const AABB& aabb, const TriangleSoup& soup, const glm::mat4& trans, std::vector<dal::Triangle>& result);
     std::vector<dal::Triangle> getIntersectingTriangles(const AABB& aabb, const TriangleSoup& soup, const glm::mat4& trans);
+    size_t getIntersectingTriangles(const AABB& aabb, const TriangleSoupSoA& soup, std::vector<dal::Triangle>& result);
 
 }
 
@@ -361,6 +420,28 @@ namespace dal {
     std::optional<SegIntersecInfo> findIntersection(const Segment& seg, const Triangle& tri, const bool ignoreFromBack);
     //std::optional<SegIntersecInfo> findIntersection(const Segment& seg, const Sphere& sphere);
     std::optional<SegIntersecInfo> findIntersection(const Segment& seg, const AABB& aabb);
+    // Closest one among all triangles.
+    std::optional<SegIntersecInfo> findIntersection(const Segment& seg, const TriangleSoup& soup, const glm::mat4& trans);
+    std::optional<SegIntersecInfo> findIntersection(const Segment& seg, const TriangleSoupSoA& soup);
+
+}
+
+
+// Swept AABB
+namespace dal {
+
+    struct SweepHit {
+        // Fraction of the movement done before contact, in [0, 1].
+        float m_time = 0;
+        // Unit vector pointing from the obstacle towards the moving box.
+        glm::vec3 m_normal{ 0 };
+    };
+
+    // Time of impact of a box moving by delta. If they overlap from the start, time is 0 unless delta moves them apart.
+    std::optional<SweepHit> sweepAABB(const AABB& moving, const glm::vec3& delta, const AABB& target);
+    std::optional<SweepHit> sweepAABB(const AABB& moving, const glm::vec3& delta, const Triangle& tri);
+    // Earliest one among all triangles.
+    std::optional<SweepHit> sweepAABB(const AABB& moving, const glm::vec3& delta, const TriangleSoupSoA& soup);
 
 }
 
@@ -376,6 +457,8 @@ namespace dal {
 
 
     glm::vec3 calcResolveForAABB(const dal::AABB& movingBox, const dal::AABB& staticBox);
+    // Shortest translation that separates the box from the triangle, found over separating axes of the two. Zero if not overlapping.
+    glm::vec3 calcResolveForAABB(const dal::AABB& movingBox, const dal::Triangle& tri);
 
 }
 
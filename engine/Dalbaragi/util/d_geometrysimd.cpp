@@ -0,0 +1,330 @@
+#include "d_geometrysimd.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "d_simdlane.h"
+
+
+// Loading triangles into lanes
+namespace {
+
+    using namespace dal::simd;
+
+    inline void loadLanes(const dal::TriangleSoupSoA& soup, const uint32_t first, const uint32_t, float (&out)[9]) {
+        for ( unsigned i = 0; i < 9; ++i ) {
+            out[i] = soup.coords(i / 3, i % 3)[first];
+        }
+    }
+    inline void storeLanes(const float x, const uint32_t, float* const out) {
+        out[0] = x;
+    }
+
+}
+
+
+#if DAL_SIMD_LANE_SSE || DAL_SIMD_LANE_NEON
+
+namespace {
+
+    // Lanes past count are filled with the first triangle so that they never produce NaN or infinity.
+    inline void loadLanes(const dal::TriangleSoupSoA& soup, const uint32_t first, const uint32_t count, Float4 (&out)[9]) {
+        for ( unsigned i = 0; i < 9; ++i ) {
+            const auto src = soup.coords(i / 3, i % 3) + first;
+
+            if ( FLOAT4_LANE_COUNT == count ) {
+                loadAt(src, out[i]);
+            }
+            else {
+                float buf[4] = { src[0], src[0], src[0], src[0] };
+                for ( uint32_t j = 1; j < count; ++j ) {
+                    buf[j] = src[j];
+                }
+                loadAt(buf, out[i]);
+            }
+        }
+    }
+
+    inline void storeLanes(const Float4 x, const uint32_t count, float* const out) {
+        float buf[4];
+        store(x, buf);
+        std::copy(buf, buf + count, out);
+    }
+
+}
+
+#endif
+
+
+// Kernels
+namespace {
+
+    template <typename F, typename M>
+    M isAxisSeparating(const F& p0, const F& p1, const F& p2, const F& r) {
+        return (vmin(p0, vmin(p1, p2)) > r) | (vmax(p0, vmax(p1, p2)) < -r);
+    }
+
+    // Returns mask of triangles separated from the box, which means not intersecting.
+    // Params p are coordinates of triangles, index of which is 3 * point index + axis index.
+    template <typename F, typename M>
+    M findSeparatedTriBox(const F (&p)[9], const F (&center)[3], const F (&half)[3]) {
+        // Move the box to origin.
+        F v[3][3];
+        for ( unsigned i = 0; i < 3; ++i ) {
+            for ( unsigned axis = 0; axis < 3; ++axis ) {
+                v[i][axis] = p[3 * i + axis] - center[axis];
+            }
+        }
+
+        // Box normals, which is the cheapest and rejects most of triangles.
+        M separated = isAxisSeparating<F, M>(v[0][0], v[1][0], v[2][0], half[0]);
+        separated = separated | isAxisSeparating<F, M>(v[0][1], v[1][1], v[2][1], half[1]);
+        separated = separated | isAxisSeparating<F, M>(v[0][2], v[1][2], v[2][2], half[2]);
+        if ( allTrue(separated) ) {
+            return separated;
+        }
+
+        F f[3][3];
+        for ( unsigned i = 0; i < 3; ++i ) {
+            for ( unsigned axis = 0; axis < 3; ++axis ) {
+                f[i][axis] = v[(i + 1) % 3][axis] - v[i][axis];
+            }
+        }
+
+        // Cross products of box normals and triangle edges.
+        for ( unsigned i = 0; i < 3; ++i ) {
+            const auto& e = f[i];
+
+            // (1, 0, 0) x e = (0, -e.z, e.y)
+            separated = separated | isAxisSeparating<F, M>(
+                v[0][2] * e[1] - v[0][1] * e[2],
+                v[1][2] * e[1] - v[1][1] * e[2],
+                v[2][2] * e[1] - v[2][1] * e[2],
+                half[1] * vabs(e[2]) + half[2] * vabs(e[1])
+            );
+            // (0, 1, 0) x e = (e.z, 0, -e.x)
+            separated = separated | isAxisSeparating<F, M>(
+                v[0][0] * e[2] - v[0][2] * e[0],
+                v[1][0] * e[2] - v[1][2] * e[0],
+                v[2][0] * e[2] - v[2][2] * e[0],
+                half[0] * vabs(e[2]) + half[2] * vabs(e[0])
+            );
+            // (0, 0, 1) x e = (-e.y, e.x, 0)
+            separated = separated | isAxisSeparating<F, M>(
+                v[0][1] * e[0] - v[0][0] * e[1],
+                v[1][1] * e[0] - v[1][0] * e[1],
+                v[2][1] * e[0] - v[2][0] * e[1],
+                half[0] * vabs(e[1]) + half[1] * vabs(e[0])
+            );
+        }
+
+        // Triangle normal
+        {
+            const F n[3] = {
+                f[0][1] * f[1][2] - f[0][2] * f[1][1],
+                f[0][2] * f[1][0] - f[0][0] * f[1][2],
+                f[0][0] * f[1][1] - f[0][1] * f[1][0]
+            };
+            const auto d = n[0] * v[0][0] + n[1] * v[0][1] + n[2] * v[0][2];
+            const auto r = half[0] * vabs(n[0]) + half[1] * vabs(n[1]) + half[2] * vabs(n[2]);
+            separated = separated | (d > r) | (d < -r);
+        }
+
+        return separated;
+    }
+
+    // Möller–Trumbore. out_front is set where the segment comes from the side normal of CCW triangle points to.
+    template <typename F, typename M>
+    void findSegTriHit(const F (&p)[9], const F (&o)[3], const F (&d)[3], F& out_t, M& out_hit, M& out_front) {
+        const auto zero = splat<F>(0.f);
+        const auto one = splat<F>(1.f);
+
+        const F e1[3] = { p[3] - p[0], p[4] - p[1], p[5] - p[2] };
+        const F e2[3] = { p[6] - p[0], p[7] - p[1], p[8] - p[2] };
+
+        const F pvec[3] = {
+            d[1] * e2[2] - d[2] * e2[1],
+            d[2] * e2[0] - d[0] * e2[2],
+            d[0] * e2[1] - d[1] * e2[0]
+        };
+        const auto det = e1[0] * pvec[0] + e1[1] * pvec[1] + e1[2] * pvec[2];
+        const auto invDet = one / det;
+
+        const F tvec[3] = { o[0] - p[0], o[1] - p[1], o[2] - p[2] };
+        const auto u = (tvec[0] * pvec[0] + tvec[1] * pvec[1] + tvec[2] * pvec[2]) * invDet;
+
+        const F qvec[3] = {
+            tvec[1] * e1[2] - tvec[2] * e1[1],
+            tvec[2] * e1[0] - tvec[0] * e1[2],
+            tvec[0] * e1[1] - tvec[1] * e1[0]
+        };
+        const auto v = (d[0] * qvec[0] + d[1] * qvec[1] + d[2] * qvec[2]) * invDet;
+        const auto t = (e2[0] * qvec[0] + e2[1] * qvec[1] + e2[2] * qvec[2]) * invDet;
+
+        // det is dot of -direction and normal, so positive one means hitting front face.
+        out_front = det > zero;
+        out_hit = ((det > zero) | (det < zero)) & (u >= zero) & (v >= zero) & (u + v <= one) & (t >= zero) & (t <= one);
+        out_t = t;
+    }
+
+
+    template <typename F, typename M, uint32_t W>
+    uint32_t runAABB4(const dal::AABB4& boxes, const dal::AABB& aabb) {
+        uint32_t result = 0;
+
+        const auto isSeparatedOnAxis = [&](const uint32_t i, const unsigned axis) -> M {
+            F boxMin, boxMax;
+            loadAt(boxes.m_min[axis] + i, boxMin);
+            loadAt(boxes.m_max[axis] + i, boxMax);
+
+            return (boxMax < splat<F>(aabb.min()[axis])) | (boxMin > splat<F>(aabb.max()[axis]));
+        };
+
+        for ( uint32_t i = 0; i < 4; i += W ) {
+            const M separated = isSeparatedOnAxis(i, 0) | isSeparatedOnAxis(i, 1) | isSeparatedOnAxis(i, 2);
+            result |= (~toBits(separated) & ((1u << W) - 1)) << i;
+        }
+
+        return result;
+    }
+
+    template <typename F, typename M, uint32_t W>
+    uint32_t runTriBoxBatch(const dal::TriangleSoupSoA& soup, const uint32_t first, const uint32_t count, const dal::AABB& aabb) {
+        F center[3], half[3];
+        for ( unsigned axis = 0; axis < 3; ++axis ) {
+            center[axis] = splat<F>((aabb.min()[axis] + aabb.max()[axis]) * 0.5f);
+            half[axis] = splat<F>((aabb.max()[axis] - aabb.min()[axis]) * 0.5f);
+        }
+
+        uint32_t result = 0;
+
+        for ( uint32_t i = 0; i < count; i += W ) {
+            const auto numLanes = std::min(W, count - i);
+
+            F p[9];
+            loadLanes(soup, first + i, numLanes, p);
+
+            const M separated = findSeparatedTriBox<F, M>(p, center, half);
+            const uint32_t laneMask = (1u << numLanes) - 1;
+            result |= (~toBits(separated) & laneMask) << i;
+        }
+
+        return result;
+    }
+
+    template <typename F, typename M, uint32_t W>
+    void runSegTriBatch(const dal::TriangleSoupSoA& soup, const uint32_t first, const uint32_t count, const dal::Segment& seg,
+        const bool ignoreFromBack, dal::SegTriBatchResult& result)
+    {
+        F o[3], d[3];
+        for ( unsigned axis = 0; axis < 3; ++axis ) {
+            o[axis] = splat<F>(seg.pos()[axis]);
+            d[axis] = splat<F>(seg.rel()[axis]);
+        }
+
+        result.m_hitMask = 0;
+        result.m_frontMask = 0;
+
+        for ( uint32_t i = 0; i < count; i += W ) {
+            const auto numLanes = std::min(W, count - i);
+
+            F p[9];
+            loadLanes(soup, first + i, numLanes, p);
+
+            F t;
+            M hit, front;
+            findSegTriHit<F, M>(p, o, d, t, hit, front);
+
+            const uint32_t laneMask = (1u << numLanes) - 1;
+            const auto frontBits = toBits(front) & laneMask;
+            auto hitBits = toBits(hit) & laneMask;
+            if ( ignoreFromBack ) {
+                hitBits &= frontBits;
+            }
+
+            result.m_hitMask |= hitBits << i;
+            result.m_frontMask |= frontBits << i;
+            storeLanes(t, numLanes, result.m_t + i);
+        }
+    }
+
+}
+
+
+namespace dal {
+
+    AABB4::AABB4(void) {
+        for ( unsigned i = 0; i < 4; ++i ) {
+            this->setEmpty(i);
+        }
+    }
+
+    void AABB4::set(const unsigned index, const AABB& aabb) {
+        for ( unsigned axis = 0; axis < 3; ++axis ) {
+            this->m_min[axis][index] = aabb.min()[axis];
+            this->m_max[axis][index] = aabb.max()[axis];
+        }
+    }
+
+    AABB AABB4::get(const unsigned index) const {
+        return AABB{
+            glm::vec3{ this->m_min[0][index], this->m_min[1][index], this->m_min[2][index] },
+            glm::vec3{ this->m_max[0][index], this->m_max[1][index], this->m_max[2][index] }
+        };
+    }
+
+    void AABB4::setEmpty(const unsigned index) {
+        for ( unsigned axis = 0; axis < 3; ++axis ) {
+            this->m_min[axis][index] = std::numeric_limits<float>::max();
+            this->m_max[axis][index] = -std::numeric_limits<float>::max();
+        }
+    }
+
+
+    uint32_t intersectAABB4(const AABB4& boxes, const AABB& aabb) {
+#if DAL_SIMD_LANE_SSE || DAL_SIMD_LANE_NEON
+        return ::runAABB4<simd::Float4, simd::Mask4, simd::FLOAT4_LANE_COUNT>(boxes, aabb);
+#else
+        return dal::intersectAABB4_scalar(boxes, aabb);
+#endif
+    }
+
+    uint32_t intersectAABB4_scalar(const AABB4& boxes, const AABB& aabb) {
+        return ::runAABB4<float, bool, 1>(boxes, aabb);
+    }
+
+
+    uint32_t intersectTriBoxBatch(const TriangleSoupSoA& soup, const uint32_t first, const uint32_t count, const AABB& aabb) {
+#if DAL_SIMD_LANE_SSE || DAL_SIMD_LANE_NEON
+        return ::runTriBoxBatch<simd::Float4, simd::Mask4, simd::FLOAT4_LANE_COUNT>(soup, first, count, aabb);
+#else
+        return dal::intersectTriBoxBatch_scalar(soup, first, count, aabb);
+#endif
+    }
+
+    uint32_t intersectTriBoxBatch_scalar(const TriangleSoupSoA& soup, const uint32_t first, const uint32_t count, const AABB& aabb) {
+        return ::runTriBoxBatch<float, bool, 1>(soup, first, count, aabb);
+    }
+
+    void intersectSegTriBatch(const TriangleSoupSoA& soup, const uint32_t first, const uint32_t count, const Segment& seg,
+        const bool ignoreFromBack, SegTriBatchResult& result)
+    {
+#if DAL_SIMD_LANE_SSE || DAL_SIMD_LANE_NEON
+        ::runSegTriBatch<simd::Float4, simd::Mask4, simd::FLOAT4_LANE_COUNT>(soup, first, count, seg, ignoreFromBack, result);
+#else
+        dal::intersectSegTriBatch_scalar(soup, first, count, seg, ignoreFromBack, result);
+#endif
+    }
+
+    void intersectSegTriBatch_scalar(const TriangleSoupSoA& soup, const uint32_t first, const uint32_t count, const Segment& seg,
+        const bool ignoreFromBack, SegTriBatchResult& result)
+    {
+        ::runSegTriBatch<float, bool, 1>(soup, first, count, seg, ignoreFromBack, result);
+    }
+
+    const char* getTriBatchBackendName(void) {
+        return dal::simd::getLaneBackendName();
+    }
+
+}
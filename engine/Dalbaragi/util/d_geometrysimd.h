@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+
+#include "d_geometrymath.h"
+
+
+// Batched intersection kernels over TriangleSoupSoA.
+// Triangles are tested 4 at once with SSE2 or NEON, or one by one where neither is available.
+// Scalar versions run the exact same sequence of float operations, so both must give bitwise identical results.
+namespace dal {
+
+    // Maximum number of triangles a single call can test, which is the number of bits in result masks.
+    constexpr uint32_t TRI_BATCH_MAX = 32;
+
+
+    struct SegTriBatchResult {
+        // Bit i is set if the segment hits triangle first + i.
+        uint32_t m_hitMask = 0;
+        // Bit i is set if the segment comes from front side of triangle first + i. Only meaningful for hit ones.
+        uint32_t m_frontMask = 0;
+        // Parameter of hit point on the segment in [0, 1]. Only meaningful for hit ones.
+        float m_t[TRI_BATCH_MAX];
+    };
+
+
+    // Four boxes in structure of arrays layout so that they can be tested at once.
+    struct AABB4 {
+        // Index is [axis][box].
+        alignas(16) float m_min[3][4];
+        alignas(16) float m_max[3][4];
+
+        // All slots are empty at first.
+        AABB4(void);
+
+        void set(const unsigned index, const AABB& aabb);
+        AABB get(const unsigned index) const;
+        // Empty slot never intersects anything.
+        void setEmpty(const unsigned index);
+    };
+
+
+    // Separating axis test between a box and triangles in [first, first + count), touching counts as intersecting.
+    // Bit i of returned mask is set if triangle first + i intersects the box. Param count must not exceed TRI_BATCH_MAX.
+    uint32_t intersectTriBoxBatch(const TriangleSoupSoA& soup, const uint32_t first, const uint32_t count, const AABB& aabb);
+    uint32_t intersectTriBoxBatch_scalar(const TriangleSoupSoA& soup, const uint32_t first, const uint32_t count, const AABB& aabb);
+
+    // Möller–Trumbore between a segment and triangles in [first, first + count).
+    // If ignoreFromBack is true, hits from back side are not reported. Param count must not exceed TRI_BATCH_MAX.
+    void intersectSegTriBatch(const TriangleSoupSoA& soup, const uint32_t first, const uint32_t count, const Segment& seg,
+        const bool ignoreFromBack, SegTriBatchResult& result);
+    void intersectSegTriBatch_scalar(const TriangleSoupSoA& soup, const uint32_t first, const uint32_t count, const Segment& seg,
+        const bool ignoreFromBack, SegTriBatchResult& result);
+
+    // Bit i of returned mask is set if box i intersects the box. Result is the same as isIntersecting(const AABB&, const AABB&).
+    uint32_t intersectAABB4(const AABB4& boxes, const AABB& aabb);
+    uint32_t intersectAABB4_scalar(const AABB4& boxes, const AABB& aabb);
+
+    // Name of instruction set batch functions are using.
+    const char* getTriBatchBackendName(void);
+
+}
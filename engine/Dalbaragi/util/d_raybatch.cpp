@@ -0,0 +1,124 @@
+#include "d_raybatch.h"
+
+#include <algorithm>
+
+#include "d_geometrysimd.h"
+
+
+namespace {
+
+    constexpr unsigned MORTON_BITS = 10;
+
+
+    // Spreads lower 10 bits so that there are 2 zero bits between each of them.
+    uint32_t spreadBits(uint32_t x) {
+        x &= 0x3FF;
+        x = (x | (x << 16)) & 0x030000FF;
+        x = (x | (x << 8)) & 0x0300F00F;
+        x = (x | (x << 4)) & 0x030C30C3;
+        x = (x | (x << 2)) & 0x09249249;
+        return x;
+    }
+
+    uint32_t quantize(const float value, const float min, const float scale) {
+        const auto q = static_cast<int64_t>((value - min) * scale);
+        return static_cast<uint32_t>(std::clamp<int64_t>(q, 0, (1 << MORTON_BITS) - 1));
+    }
+
+}
+
+
+namespace dal {
+
+    void sortSegmentsCoherent(const Segment* const segs, const size_t count, std::vector<uint32_t>& out_order) {
+        out_order.resize(count);
+        if ( 0 == count ) {
+            return;
+        }
+
+        glm::vec3 boxMin = segs[0].pos(), boxMax = segs[0].pos();
+        for ( size_t i = 1; i < count; ++i ) {
+            boxMin = glm::min(boxMin, segs[i].pos());
+            boxMax = glm::max(boxMax, segs[i].pos());
+        }
+
+        const auto extent = boxMax - boxMin;
+        const auto maxExtent = std::max(extent.x, std::max(extent.y, extent.z));
+        const auto scale = maxExtent > 0.f ? static_cast<float>(1 << MORTON_BITS) / maxExtent : 0.f;
+
+        // Direction octant goes first since segments going opposite ways share little of traversal.
+        std::vector<std::pair<uint64_t, uint32_t>> keys(count);
+        for ( size_t i = 0; i < count; ++i ) {
+            const auto& pos = segs[i].pos();
+            const auto& rel = segs[i].rel();
+
+            const uint64_t octant = (rel.x < 0.f ? 1 : 0) | (rel.y < 0.f ? 2 : 0) | (rel.z < 0.f ? 4 : 0);
+            const uint64_t morton =
+                (::spreadBits(::quantize(pos.x, boxMin.x, scale)) << 2) |
+                (::spreadBits(::quantize(pos.y, boxMin.y, scale)) << 1) |
+                ::spreadBits(::quantize(pos.z, boxMin.z, scale));
+
+            keys[i] = { (octant << 32) | morton, static_cast<uint32_t>(i) };
+        }
+
+        std::sort(keys.begin(), keys.end());
+
+        for ( size_t i = 0; i < count; ++i ) {
+            out_order[i] = keys[i].second;
+        }
+    }
+
+    void findIntersections(const Segment* const segs, const uint32_t count, const uint32_t mask, const TriangleSoupSoA& soup,
+        std::optional<SegIntersecInfo>* const results)
+    {
+        glm::vec3 pos[32], rel[32];
+        float lengths[32], tMax[32];
+        uint32_t active = 0;
+
+        for ( uint32_t i = 0; i < count; ++i ) {
+            pos[i] = segs[i].pos();
+            rel[i] = segs[i].rel();
+            lengths[i] = segs[i].length();
+            tMax[i] = 0.f;
+
+            if ( 0 == (mask & (1u << i)) || 0.f == lengths[i] ) {
+                continue;
+            }
+
+            tMax[i] = results[i] ? std::min(BVH::SEGMENT_T_LIMIT, results[i]->m_distance / lengths[i]) : BVH::SEGMENT_T_LIMIT;
+            active |= 1u << i;
+        }
+
+        const auto testRange = [&](const uint32_t first, const uint32_t numTriangles, const uint32_t rayMask) {
+            for ( uint32_t i = 0; i < count; ++i ) {
+                if ( 0 == (rayMask & (1u << i)) ) {
+                    continue;
+                }
+
+                for ( uint32_t batchFirst = first; batchFirst < first + numTriangles; batchFirst += TRI_BATCH_MAX ) {
+                    const auto batchCount = std::min(TRI_BATCH_MAX, first + numTriangles - batchFirst);
+
+                    SegTriBatchResult batch;
+                    dal::intersectSegTriBatch(soup, batchFirst, batchCount, segs[i], soup.isFaceCullSet(), batch);
+
+                    for ( uint32_t j = 0; j < batchCount; ++j ) {
+                        if ( 0 == (batch.m_hitMask & (1u << j)) || batch.m_t[j] >= tMax[i] ) {
+                            continue;
+                        }
+
+                        tMax[i] = batch.m_t[j];
+                        results[i] = SegIntersecInfo{ batch.m_t[j] * lengths[i], 0 != (batch.m_frontMask & (1u << j)) };
+                    }
+                }
+            }
+        };
+
+        if ( soup.bvh().isEmpty() ) {
+            testRange(0, static_cast<uint32_t>(soup.getSize()), active);
+        }
+        else {
+            soup.bvh().castSegmentPacket(pos, rel, count, tMax, active, testRange);
+        }
+    }
+
+}
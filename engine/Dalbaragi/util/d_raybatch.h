@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+#include "d_geometrymath.h"
+
+
+// Helpers for casting many segments at once.
+namespace dal {
+
+    // Number of segments traced together through BVHs. Must not exceed 32, which is the number of bits in packet masks.
+    constexpr uint32_t RAY_PACKET_SIZE = 8;
+    // Packets fewer than this per thread of a worker pool cost more to hand out than to trace.
+    constexpr size_t RAY_PACKET_MIN_RANGE_SIZE = 16;
+
+
+    // Indices of segments ordered so that neighbours start near each other and go towards similar directions.
+    void sortSegmentsCoherent(const Segment* const segs, const size_t count, std::vector<uint32_t>& out_order);
+
+    // Closest hits of segments whose bit is set in mask. Param count must not exceed 32.
+    // Existing results are only replaced by closer hits, so results of several soups can be accumulated.
+    void findIntersections(const Segment* const segs, const uint32_t count, const uint32_t mask, const TriangleSoupSoA& soup,
+        std::optional<SegIntersecInfo>* const results);
+
+}
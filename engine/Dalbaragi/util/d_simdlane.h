@@ -0,0 +1,213 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define DAL_SIMD_LANE_SSE 1
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    // 32 bit ARM has no vector division, square root nor horizontal add, so it uses scalar path.
+    #define DAL_SIMD_LANE_NEON 1
+    #include <arm_neon.h>
+#endif
+
+
+// Lane types for kernels which are templates over lane type, instantiated with float for scalar path and Float4 for 4 lanes.
+// So float and Float4 provide the same set of operations, and Float4 ones match their scalar counterparts bit by bit
+// for finite inputs. Sources using them must be built without fused multiply add for that to hold.
+namespace dal::simd {
+
+    template <typename F>
+    F splat(const float x);
+
+    template <>
+    inline float splat<float>(const float x) {
+        return x;
+    }
+
+    inline float vmin(const float a, const float b) {
+        return a < b ? a : b;
+    }
+    inline float vmax(const float a, const float b) {
+        return a > b ? a : b;
+    }
+    inline float vabs(const float a) {
+        return std::abs(a);
+    }
+    inline float vsqrt(const float a) {
+        return std::sqrt(a);
+    }
+    // Negates a where sign bit of b is set.
+    inline float flipSign(const float a, const float b) {
+        return std::signbit(b) ? -a : a;
+    }
+    inline bool allTrue(const bool m) {
+        return m;
+    }
+    inline uint32_t toBits(const bool m) {
+        return m ? 1 : 0;
+    }
+
+    inline void loadAt(const float* const p, float& out) {
+        out = *p;
+    }
+    inline void store(const float x, float* const out) {
+        *out = x;
+    }
+
+    // Loads as many floats as F has lanes.
+    template <typename F>
+    F load(const float* const p) {
+        F result;
+        loadAt(p, result);
+        return result;
+    }
+
+}
+
+
+#if DAL_SIMD_LANE_SSE
+
+namespace dal::simd {
+
+    struct Float4 {
+        __m128 m;
+    };
+
+    struct Mask4 {
+        __m128 m;
+    };
+
+    template <>
+    inline Float4 splat<Float4>(const float x) {
+        return Float4{ _mm_set1_ps(x) };
+    }
+
+    inline Float4 operator+(const Float4 a, const Float4 b) { return Float4{ _mm_add_ps(a.m, b.m) }; }
+    inline Float4 operator-(const Float4 a, const Float4 b) { return Float4{ _mm_sub_ps(a.m, b.m) }; }
+    inline Float4 operator*(const Float4 a, const Float4 b) { return Float4{ _mm_mul_ps(a.m, b.m) }; }
+    inline Float4 operator/(const Float4 a, const Float4 b) { return Float4{ _mm_div_ps(a.m, b.m) }; }
+    inline Float4 operator-(const Float4 a) { return Float4{ _mm_xor_ps(a.m, _mm_set1_ps(-0.f)) }; }
+
+    inline Mask4 operator>(const Float4 a, const Float4 b) { return Mask4{ _mm_cmpgt_ps(a.m, b.m) }; }
+    inline Mask4 operator<(const Float4 a, const Float4 b) { return Mask4{ _mm_cmplt_ps(a.m, b.m) }; }
+    inline Mask4 operator>=(const Float4 a, const Float4 b) { return Mask4{ _mm_cmpge_ps(a.m, b.m) }; }
+    inline Mask4 operator<=(const Float4 a, const Float4 b) { return Mask4{ _mm_cmple_ps(a.m, b.m) }; }
+    inline Mask4 operator&(const Mask4 a, const Mask4 b) { return Mask4{ _mm_and_ps(a.m, b.m) }; }
+    inline Mask4 operator|(const Mask4 a, const Mask4 b) { return Mask4{ _mm_or_ps(a.m, b.m) }; }
+
+    // minps and maxps return the second operand when equal, just like the scalar ones.
+    inline Float4 vmin(const Float4 a, const Float4 b) {
+        return Float4{ _mm_min_ps(a.m, b.m) };
+    }
+    inline Float4 vmax(const Float4 a, const Float4 b) {
+        return Float4{ _mm_max_ps(a.m, b.m) };
+    }
+    inline Float4 vabs(const Float4 a) {
+        return Float4{ _mm_andnot_ps(_mm_set1_ps(-0.f), a.m) };
+    }
+    inline Float4 vsqrt(const Float4 a) {
+        return Float4{ _mm_sqrt_ps(a.m) };
+    }
+    inline Float4 flipSign(const Float4 a, const Float4 b) {
+        return Float4{ _mm_xor_ps(a.m, _mm_and_ps(b.m, _mm_set1_ps(-0.f))) };
+    }
+    inline bool allTrue(const Mask4 m) {
+        return 0xF == _mm_movemask_ps(m.m);
+    }
+    inline uint32_t toBits(const Mask4 m) {
+        return static_cast<uint32_t>(_mm_movemask_ps(m.m));
+    }
+
+    inline void loadAt(const float* const p, Float4& out) {
+        out = Float4{ _mm_loadu_ps(p) };
+    }
+    inline void store(const Float4 x, float* const out) {
+        _mm_storeu_ps(out, x.m);
+    }
+
+}
+
+#elif DAL_SIMD_LANE_NEON
+
+namespace dal::simd {
+
+    struct Float4 {
+        float32x4_t m;
+    };
+
+    struct Mask4 {
+        uint32x4_t m;
+    };
+
+    template <>
+    inline Float4 splat<Float4>(const float x) {
+        return Float4{ vdupq_n_f32(x) };
+    }
+
+    inline Float4 operator+(const Float4 a, const Float4 b) { return Float4{ vaddq_f32(a.m, b.m) }; }
+    inline Float4 operator-(const Float4 a, const Float4 b) { return Float4{ vsubq_f32(a.m, b.m) }; }
+    inline Float4 operator*(const Float4 a, const Float4 b) { return Float4{ vmulq_f32(a.m, b.m) }; }
+    inline Float4 operator/(const Float4 a, const Float4 b) { return Float4{ vdivq_f32(a.m, b.m) }; }
+    inline Float4 operator-(const Float4 a) { return Float4{ vnegq_f32(a.m) }; }
+
+    inline Mask4 operator>(const Float4 a, const Float4 b) { return Mask4{ vcgtq_f32(a.m, b.m) }; }
+    inline Mask4 operator<(const Float4 a, const Float4 b) { return Mask4{ vcltq_f32(a.m, b.m) }; }
+    inline Mask4 operator>=(const Float4 a, const Float4 b) { return Mask4{ vcgeq_f32(a.m, b.m) }; }
+    inline Mask4 operator<=(const Float4 a, const Float4 b) { return Mask4{ vcleq_f32(a.m, b.m) }; }
+    inline Mask4 operator&(const Mask4 a, const Mask4 b) { return Mask4{ vandq_u32(a.m, b.m) }; }
+    inline Mask4 operator|(const Mask4 a, const Mask4 b) { return Mask4{ vorrq_u32(a.m, b.m) }; }
+
+    // Sign of zero may differ from the scalar ones, which never changes result of comparisons.
+    inline Float4 vmin(const Float4 a, const Float4 b) {
+        return Float4{ vminq_f32(a.m, b.m) };
+    }
+    inline Float4 vmax(const Float4 a, const Float4 b) {
+        return Float4{ vmaxq_f32(a.m, b.m) };
+    }
+    inline Float4 vabs(const Float4 a) {
+        return Float4{ vabsq_f32(a.m) };
+    }
+    inline Float4 vsqrt(const Float4 a) {
+        return Float4{ vsqrtq_f32(a.m) };
+    }
+    inline Float4 flipSign(const Float4 a, const Float4 b) {
+        const auto signBits = vandq_u32(vreinterpretq_u32_f32(b.m), vdupq_n_u32(0x80000000));
+        return Float4{ vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a.m), signBits)) };
+    }
+    inline bool allTrue(const Mask4 m) {
+        return 0 != vminvq_u32(m.m);
+    }
+    inline uint32_t toBits(const Mask4 m) {
+        const uint32x4_t weights{ 1, 2, 4, 8 };
+        return vaddvq_u32(vandq_u32(m.m, weights));
+    }
+
+    inline void loadAt(const float* const p, Float4& out) {
+        out = Float4{ vld1q_f32(p) };
+    }
+    inline void store(const Float4 x, float* const out) {
+        vst1q_f32(out, x.m);
+    }
+
+}
+
+#endif
+
+
+namespace dal::simd {
+
+    constexpr uint32_t FLOAT4_LANE_COUNT = 4;
+
+    inline const char* getLaneBackendName(void) {
+#if DAL_SIMD_LANE_SSE
+        return "SSE2";
+#elif DAL_SIMD_LANE_NEON
+        return "NEON";
+#else
+        return "scalar";
+#endif
+    }
+
+}
@@ -0,0 +1,108 @@
+#include "d_workerpool.h"
+
+#include <algorithm>
+
+
+namespace dal {
+
+    WorkerPool::WorkerPool(const unsigned numThreads) {
+        const auto numWorkers = std::max(1u, numThreads) - 1;
+        this->m_threads.reserve(numWorkers);
+
+        // Calling thread takes piece 0, so workers start from 1.
+        for ( unsigned i = 0; i < numWorkers; ++i ) {
+            this->m_threads.emplace_back([this, i](void) { this->workerMain(i + 1); });
+        }
+    }
+
+    WorkerPool::~WorkerPool(void) {
+        {
+            std::unique_lock<std::mutex> lck{ this->m_mut };
+            this->m_flagExit = true;
+        }
+        this->m_startCond.notify_all();
+
+        for ( auto& thread : this->m_threads ) {
+            thread.join();
+        }
+    }
+
+    size_t WorkerPool::calcPieceSize(const size_t count, const size_t minRangeSize) const {
+        const auto pieceSize = (count + this->numThreads() - 1) / this->numThreads();
+        return std::max<size_t>({ pieceSize, minRangeSize, 1 });
+    }
+
+    void WorkerPool::run(const size_t count, const size_t pieceSize, const rangeFunc_t& func) {
+        std::lock_guard<std::mutex> runLck{ this->m_runMut };
+
+        {
+            std::unique_lock<std::mutex> lck{ this->m_mut };
+            this->m_func = &func;
+            this->m_count = count;
+            this->m_pieceSize = pieceSize;
+            this->m_numPending = static_cast<unsigned>(this->m_threads.size());
+            ++this->m_generation;
+        }
+        this->m_startCond.notify_all();
+
+        // Workers still refer to func, so they must be waited for even if this piece throws.
+        std::exception_ptr error;
+        try {
+            func(0, std::min(count, pieceSize));
+        }
+        catch ( ... ) {
+            error = std::current_exception();
+        }
+
+        std::unique_lock<std::mutex> lck{ this->m_mut };
+        this->m_doneCond.wait(lck, [this](void) { return 0 == this->m_numPending; });
+        this->m_func = nullptr;
+
+        if ( nullptr == error ) {
+            error = this->m_error;
+        }
+        this->m_error = nullptr;
+        lck.unlock();
+
+        if ( nullptr != error ) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    void WorkerPool::workerMain(const unsigned pieceIndex) {
+        uint64_t lastGeneration = 0;
+
+        while ( true ) {
+            std::unique_lock<std::mutex> lck{ this->m_mut };
+            this->m_startCond.wait(lck, [&](void) { return this->m_flagExit || this->m_generation != lastGeneration; });
+            if ( this->m_flagExit ) {
+                return;
+            }
+
+            lastGeneration = this->m_generation;
+            const auto func = this->m_func;
+            const auto begin = pieceIndex * this->m_pieceSize;
+            const auto end = std::min(this->m_count, begin + this->m_pieceSize);
+            lck.unlock();
+
+            std::exception_ptr error;
+            if ( begin < end ) {
+                try {
+                    (*func)(begin, end);
+                }
+                catch ( ... ) {
+                    error = std::current_exception();
+                }
+            }
+
+            lck.lock();
+            if ( nullptr != error && nullptr == this->m_error ) {
+                this->m_error = error;
+            }
+            if ( 0 == --this->m_numPending ) {
+                this->m_doneCond.notify_one();
+            }
+        }
+    }
+
+}
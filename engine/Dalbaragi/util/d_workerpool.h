@@ -0,0 +1,76 @@
+#pragma once
+
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+
+namespace dal {
+
+    // Threads kept alive between calls, for splitting loops too short to afford spawning threads every time.
+    // Engine shares one of these among its systems, so that they don't oversubscribe the CPU with pools of their own.
+    // Calls from different threads take turns. So func must not call parallelFor of the same pool, which would deadlock.
+    class WorkerPool {
+
+    private:
+        using rangeFunc_t = std::function<void(size_t, size_t)>;
+
+    private:
+        std::vector<std::thread> m_threads;
+
+        std::mutex m_mut;
+        // Held by the calling thread for a whole parallelFor.
+        std::mutex m_runMut;
+        std::condition_variable m_startCond, m_doneCond;
+
+        const rangeFunc_t* m_func = nullptr;
+        size_t m_count = 0, m_pieceSize = 0;
+        uint64_t m_generation = 0;
+        // First exception thrown by a worker during current run, rethrown on the calling thread.
+        std::exception_ptr m_error;
+        unsigned m_numPending = 0;
+        bool m_flagExit = false;
+
+    public:
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+        WorkerPool(WorkerPool&&) = delete;
+        WorkerPool& operator=(WorkerPool&&) = delete;
+
+    public:
+        // Param numThreads includes the calling thread, so 1 means no extra threads at all.
+        WorkerPool(const unsigned numThreads);
+        ~WorkerPool(void);
+
+        unsigned numThreads(void) const {
+            return static_cast<unsigned>(this->m_threads.size()) + 1;
+        }
+
+        // Splits [0, count) into contiguous ranges of at least minRangeSize and calls func(begin, end) for each concurrently.
+        // Calling thread takes the first range, and this returns after all ranges are done, even if some of them throw.
+        // Then the first exception thrown is rethrown here.
+        // Ranges only depend on count, minRangeSize and numThreads(), never on timing.
+        template <typename F>
+        void parallelFor(const size_t count, const size_t minRangeSize, F&& func) {
+            const auto pieceSize = this->calcPieceSize(count, minRangeSize);
+            if ( pieceSize >= count ) {
+                func(size_t{ 0 }, count);
+                return;
+            }
+
+            const rangeFunc_t wrapped{ std::ref(func) };
+            this->run(count, pieceSize, wrapped);
+        }
+
+    private:
+        size_t calcPieceSize(const size_t count, const size_t minRangeSize) const;
+        void run(const size_t count, const size_t pieceSize, const rangeFunc_t& func);
+        void workerMain(const unsigned pieceIndex);
+
+    };
+
+}
@@ -111,6 +111,31 @@ namespace dal {
             float m_uiScale = 1;
         } m_ui;
 
+        struct Workers {
+            // Threads of the pool shared by animation, ray casting and physics, including main thread.
+            // 0 means one for each hardware thread.
+            unsigned m_threadCount = 0;
+        } m_workers;
+
+        struct Physics {
+            // Steps physics on a thread of its own, so that it keeps a steady rate while frames take long.
+            bool m_dedicatedThread = false;
+        } m_physics;
+
+        struct Animation {
+            // Sizes on screen are ratios of bounding radius of characters to their distance from camera.
+            // Characters smaller than these are sampled every 2nd or 4th frame.
+            float m_halfRateSize = 0.1f;
+            float m_quarterRateSize = 0.04f;
+            // Characters smaller than this keep last pose of minor joints like fingers and hair.
+            float m_minorJointSize = 0.06f;
+            // Characters out of sight only sample root joints. Their shadows may be seen in stale poses.
+            bool m_cullOutOfSight = true;
+            // Animated models loaded afterwards have every clip baked at this rate, for characters set to play baked ones.
+            // 0 means clips are not baked.
+            float m_bakeFramesPerSec = 0;
+        } m_animation;
+
     };
 
 }
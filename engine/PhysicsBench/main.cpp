@@ -0,0 +1,418 @@
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+
+#include <d_particle.h>
+#include <d_forcebatch.h>
+#include <d_workerpool.h>
+#include <d_strands.h>
+
+
+// Compares integrating particles stored as objects one by one with integrating ParticleStore arrays at once.
+// Both use the same semi-implicit Euler so that results can be compared too.
+// Stability of particle ids is checked by removing particles in random order.
+// Built-in modifiers applied through virtual calls are compared with their batches, on chains of particles like hair.
+// Whole steps split over threads must give bitwise identical results to a single thread.
+// Strands of StrandSolver are swung around a capsule like hair on a running character, and must keep their lengths out of it.
+
+namespace {
+
+    constexpr unsigned NUM_STEPS = 30;
+    constexpr size_t PARTICLE_COUNTS[] = { 10000, 100000, 1000000 };
+    const dal::vec3_t GRAVITY_FORCE{ 0, -9.8, 0 };
+    constexpr unsigned CHAIN_LENGTH = 16;
+    constexpr unsigned THREAD_COUNTS[] = { 1, 2, 4, 8 };
+    constexpr size_t STRAND_COUNTS[] = { 64, 1024, 16384 };
+    constexpr unsigned STRAND_FRAMES = 120;
+    constexpr dal::float_t STRAND_FRAME_TIME = 1.0 / 60.0;
+    constexpr dal::float_t STRAND_SEGMENT_LEN = 0.05;
+    constexpr dal::float_t STRAND_ROOT_RADIUS = 0.1, STRAND_ROOT_Y = 0.3;
+    // Constraints are solved with a single iteration per substep, so strands may end up this much longer or inside of colliders.
+    constexpr dal::float_t STRAND_MAX_STRETCH = 0.2, STRAND_MAX_PENETRATION = 0.05;
+
+
+    // Layout of particles before ParticleStore, which kept every attribute of a particle together.
+    struct ObjectParticle {
+        dal::vec3_t m_pos{ 0 }, m_vel{ 0 }, m_force{ 0 };
+        dal::MassValue m_mass{ 1 };
+        dal::float_t m_damping = 0.9;
+
+        void addForce(const dal::vec3_t& force) {
+            this->m_force += force;
+        }
+
+        void integrate(const dal::float_t dt) {
+            if ( this->m_mass.isInfinie() ) return;
+
+            this->m_vel += this->m_force * this->m_mass.getMassInv() * dt;
+            this->m_vel *= dal::pow(this->m_damping, dt);
+            if ( glm::length(this->m_vel) < 0.2 ) {
+                this->m_vel = dal::vec3_t{ 0 };
+            }
+            this->m_pos += this->m_vel * dt;
+
+            this->m_force = dal::vec3_t{ 0 };
+        }
+    };
+
+    template <typename F>
+    double measure(F func) {
+        const auto before = std::chrono::steady_clock::now();
+        func();
+        const auto after = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(after - before).count();
+    }
+
+    dal::vec3_t randomVec(std::mt19937& rng, const dal::float_t range) {
+        std::uniform_real_distribution<dal::float_t> dist{ -range, range };
+        return dal::vec3_t{ dist(rng), dist(rng), dist(rng) };
+    }
+
+    // Returns number of ids whose particle doesn't hold what was written for it.
+    size_t checkIDStability(const size_t count, std::mt19937& rng) {
+        dal::ParticleStore store;
+        std::vector<dal::ParticleStore::id_t> ids;
+
+        for ( size_t i = 0; i < count; ++i ) {
+            ids.push_back(store.add());
+            store.setPos(store.indexOf(ids.back()), dal::vec3_t{ static_cast<dal::float_t>(ids.back()) });
+        }
+
+        std::shuffle(ids.begin(), ids.end(), rng);
+        const auto numRemoved = count / 2;
+        for ( size_t i = 0; i < numRemoved; ++i ) {
+            store.remove(ids[i]);
+        }
+
+        size_t errors = store.size() == count - numRemoved ? 0 : 1;
+        for ( size_t i = 0; i < numRemoved; ++i ) {
+            errors += store.has(ids[i]) ? 1 : 0;
+        }
+        for ( size_t i = numRemoved; i < count; ++i ) {
+            const auto pos = store.pos(store.indexOf(ids[i]));
+            errors += pos.x == static_cast<dal::float_t>(ids[i]) ? 0 : 1;
+        }
+
+        return errors;
+    }
+
+
+    struct ModifierReport {
+        double m_virtual = 0, m_batched = 0;
+        size_t m_mismatches = 0;
+    };
+
+    // Every particle gets gravity and drag, and is pulled by the previous one in its chain.
+    ModifierReport compareModifiers(const size_t count, std::mt19937& rng) {
+        dal::ParticleStore storeVirtual, storeBatched;
+        std::vector<std::pair<std::shared_ptr<dal::UnaryPhyModifier>, dal::ParticleStore::id_t>> unaryMods;
+        std::vector<std::pair<std::shared_ptr<dal::BinaryPhyModifier>, std::pair<dal::ParticleStore::id_t, dal::ParticleStore::id_t>>> binaryMods;
+
+        dal::GravityBatch gravities;
+        dal::SpringBatch springs{ true };
+        dal::ParticleDrag drag;
+        const auto gravity = std::make_shared<dal::ParticleGravity>(3);
+        const auto spring = std::make_shared<dal::FixedPointSpringPulling>(10, 0.05);
+
+        for ( size_t i = 0; i < count; ++i ) {
+            const auto pos = randomVec(rng, 1);
+            const auto vel = randomVec(rng, 1);
+
+            const auto id = storeVirtual.add();
+            storeVirtual.setPos(storeVirtual.indexOf(id), pos);
+            storeVirtual.setVelocity(storeVirtual.indexOf(id), vel);
+
+            storeBatched.add();
+            storeBatched.setPos(storeBatched.indexOf(id), pos);
+            storeBatched.setVelocity(storeBatched.indexOf(id), vel);
+
+            unaryMods.emplace_back(gravity, id);
+            gravities.add(id, *gravity);
+
+            if ( 0 != i % CHAIN_LENGTH ) {
+                binaryMods.emplace_back(spring, std::pair{ id - 1, id });
+                springs.add(id - 1, id, *spring);
+            }
+        }
+
+        ModifierReport report;
+
+        report.m_virtual = measure([&]() {
+            for ( unsigned step = 0; step < NUM_STEPS; ++step ) {
+                for ( auto& [mod, id] : unaryMods ) {
+                    dal::PositionParticle particle{ storeVirtual, storeVirtual.indexOf(id) };
+                    mod->apply(dal::FIXED_DELTA_TIME, particle);
+                }
+                for ( auto& [mod, ids] : binaryMods ) {
+                    dal::PositionParticle one{ storeVirtual, storeVirtual.indexOf(ids.first) };
+                    dal::PositionParticle two{ storeVirtual, storeVirtual.indexOf(ids.second) };
+                    mod->apply(dal::FIXED_DELTA_TIME, one, two);
+                }
+                for ( uint32_t i = 0; i < storeVirtual.size(); ++i ) {
+                    dal::PositionParticle particle{ storeVirtual, i };
+                    drag.apply(dal::FIXED_DELTA_TIME, particle);
+                }
+            }
+        });
+
+        report.m_batched = measure([&]() {
+            for ( unsigned step = 0; step < NUM_STEPS; ++step ) {
+                gravities.apply(storeBatched, nullptr);
+                springs.apply(storeBatched, nullptr);
+                dal::DragBatch::applyToAll(storeBatched, drag, nullptr);
+            }
+        });
+
+        for ( unsigned axis = 0; axis < 3; ++axis ) {
+            const auto forcesVirtual = storeVirtual.forces(axis);
+            const auto forcesBatched = storeBatched.forces(axis);
+
+            for ( uint32_t i = 0; i < storeVirtual.size(); ++i ) {
+                if ( std::abs(forcesVirtual[i] - forcesBatched[i]) > 0.001 * std::max<dal::float_t>(1, std::abs(forcesVirtual[i])) ) {
+                    ++report.m_mismatches;
+                }
+            }
+        }
+
+        return report;
+    }
+
+
+    struct StepResult {
+        double m_time = 0;
+        std::vector<dal::float_t> m_positions;
+    };
+
+    // Runs full steps on chains of particles like PhysicsWorld::update does with built-in modifiers.
+    StepResult runSteps(const size_t count, const unsigned numThreads) {
+        std::mt19937 rng{ 5678 };
+        dal::ParticleStore store;
+        dal::GravityBatch gravities;
+        dal::SpringBatch springs{ true };
+        const dal::ParticleDrag drag;
+        const dal::ParticleGravity gravity{ 3 };
+        const dal::FixedPointSpringPulling spring{ 10, 0.05 };
+
+        for ( size_t i = 0; i < count; ++i ) {
+            const auto id = store.add();
+            store.setPos(store.indexOf(id), randomVec(rng, 1));
+
+            gravities.add(id, gravity);
+            if ( 0 != i % CHAIN_LENGTH ) {
+                springs.add(id - 1, id, spring);
+            }
+        }
+
+        std::unique_ptr<dal::WorkerPool> pool;
+        if ( numThreads > 1 ) {
+            pool.reset(new dal::WorkerPool{ numThreads });
+        }
+
+        StepResult result;
+        result.m_time = measure([&]() {
+            for ( unsigned step = 0; step < NUM_STEPS; ++step ) {
+                gravities.apply(store, pool.get());
+                springs.apply(store, pool.get());
+                dal::DragBatch::applyToAll(store, drag, pool.get());
+                store.integrate(dal::FIXED_DELTA_TIME, pool.get());
+            }
+        });
+
+        for ( unsigned axis = 0; axis < 3; ++axis ) {
+            result.m_positions.insert(result.m_positions.end(), store.positions(axis), store.positions(axis) + store.size());
+        }
+
+        return result;
+    }
+
+
+    struct StrandReport {
+        double m_time = 0;
+        dal::float_t m_maxStretch = 0, m_maxPenetration = 0;
+    };
+
+    // Body runs forward and back.
+    dal::vec3_t bodyOffset(const unsigned frame) {
+        return dal::vec3_t{ 0, 0, static_cast<dal::float_t>(0.3 * std::sin(frame * 0.1)) };
+    }
+
+    // Roots are pinned on a ring above a capsule like a head on shoulders, and strands hang down on the capsule.
+    StrandReport runStrands(const size_t numStrands) {
+        dal::StrandSolver solver;
+        std::vector<dal::StrandSolver::index_t> roots;
+        const dal::StrandCapsule body{ dal::vec3_t{ 0, -0.6, 0 }, dal::vec3_t{ 0, 0, 0 }, 0.25 };
+
+        for ( size_t i = 0; i < numStrands; ++i ) {
+            const auto angle = static_cast<dal::float_t>(6.2831853 * i / numStrands);
+            const dal::vec3_t dir{ std::cos(angle), 0, std::sin(angle) };
+
+            // Strands start sticking out sideways, so they fall and swing first.
+            dal::StrandSolver::index_t last = 0;
+            for ( unsigned k = 0; k < CHAIN_LENGTH; ++k ) {
+                const auto pos = dir * (STRAND_ROOT_RADIUS + STRAND_SEGMENT_LEN * k) + dal::vec3_t{ 0, STRAND_ROOT_Y, 0 };
+                const auto index = solver.addParticle(pos, 0 == k ? 0 : 1);
+
+                if ( 0 == k ) {
+                    roots.push_back(index);
+                }
+                else {
+                    solver.addStretch(last, index);
+                    if ( k > 1 ) {
+                        solver.addBend(last - 1, index);
+                    }
+                }
+                last = index;
+            }
+        }
+
+        StrandReport report;
+        report.m_time = measure([&]() {
+            for ( unsigned frame = 0; frame < STRAND_FRAMES; ++frame ) {
+                // Roots move along with body.
+                const auto offset = bodyOffset(frame);
+                auto capsule = body;
+                capsule.m_one += offset;
+                capsule.m_two += offset;
+
+                for ( size_t i = 0; i < numStrands; ++i ) {
+                    const auto angle = static_cast<dal::float_t>(6.2831853 * i / numStrands);
+                    const dal::vec3_t dir{ std::cos(angle), 0, std::sin(angle) };
+                    solver.movePinned(roots[i], dir * STRAND_ROOT_RADIUS + dal::vec3_t{ 0, STRAND_ROOT_Y, 0 } + offset);
+                }
+
+                solver.clearCapsules();
+                solver.addCapsule(capsule);
+                solver.update(STRAND_FRAME_TIME);
+            }
+        });
+
+        const auto offset = bodyOffset(STRAND_FRAMES - 1);
+        for ( dal::StrandSolver::index_t i = 0; i < solver.size(); ++i ) {
+            if ( 0 != i % CHAIN_LENGTH ) {
+                const auto len = glm::distance(solver.pos(i - 1), solver.pos(i));
+                report.m_maxStretch = std::max(report.m_maxStretch, (len - STRAND_SEGMENT_LEN) / STRAND_SEGMENT_LEN);
+            }
+
+            // Distance to the axis of capsule, which is vertical.
+            const auto p = solver.pos(i) - offset;
+            const auto closestY = std::min<dal::float_t>(body.m_two.y, std::max<dal::float_t>(body.m_one.y, p.y));
+            const auto dist = glm::length(p - dal::vec3_t{ 0, closestY, 0 });
+            report.m_maxPenetration = std::max(report.m_maxPenetration, (body.m_radius - dist) / body.m_radius);
+        }
+
+        return report;
+    }
+
+}
+
+
+int main(void) {
+    constexpr dal::float_t dt = dal::FIXED_DELTA_TIME;
+    std::mt19937 rng{ 1234 };
+    size_t mismatches = 0;
+
+    std::printf("%s precision, %u steps per run\n", sizeof(dal::float_t) == sizeof(double) ? "double" : "float", NUM_STEPS);
+    std::printf("%10s | %10s %12s | %10s %12s | %7s | %s\n", "particles", "objects", "per sec", "store", "per sec", "speedup", "mismatches");
+
+    for ( const auto count : PARTICLE_COUNTS ) {
+        std::vector<ObjectParticle> objects(count);
+        dal::ParticleStore store;
+
+        for ( size_t i = 0; i < count; ++i ) {
+            const auto pos = randomVec(rng, 100);
+            const auto vel = randomVec(rng, 10);
+
+            objects[i].m_pos = pos;
+            objects[i].m_vel = vel;
+
+            const auto index = store.indexOf(store.add());
+            store.setPos(index, pos);
+            store.setVelocity(index, vel);
+        }
+
+        const auto timeObjects = measure([&]() {
+            for ( unsigned step = 0; step < NUM_STEPS; ++step ) {
+                for ( auto& particle : objects ) {
+                    particle.addForce(GRAVITY_FORCE);
+                    particle.integrate(dt);
+                }
+            }
+        });
+
+        const auto timeStore = measure([&]() {
+            for ( unsigned step = 0; step < NUM_STEPS; ++step ) {
+                for ( uint32_t i = 0; i < store.size(); ++i ) {
+                    store.addForce(i, GRAVITY_FORCE);
+                }
+                store.integrate(dt);
+            }
+        });
+
+        size_t runMismatches = 0;
+        for ( uint32_t i = 0; i < store.size(); ++i ) {
+            if ( glm::length(store.pos(i) - objects[i].m_pos) > 0.001 ) {
+                ++runMismatches;
+            }
+        }
+        mismatches += runMismatches;
+
+        const auto perSec = [&](const double ms) { return static_cast<double>(count) * NUM_STEPS / (ms / 1000.0); };
+        std::printf(
+            "%10zu | %8.2fms %12.0f | %8.2fms %12.0f | %6.1fx | %zu\n",
+            count, timeObjects, perSec(timeObjects), timeStore, perSec(timeStore), timeObjects / timeStore, runMismatches
+        );
+    }
+
+    std::printf("\nbuilt-in modifiers, virtual calls against batches\n");
+    std::printf("%10s | %10s %12s | %10s %12s | %7s | %s\n", "particles", "virtual", "per sec", "batched", "per sec", "speedup", "mismatches");
+
+    for ( const auto count : PARTICLE_COUNTS ) {
+        const auto report = compareModifiers(count, rng);
+        mismatches += report.m_mismatches;
+
+        const auto perSec = [&](const double ms) { return static_cast<double>(count) * NUM_STEPS / (ms / 1000.0); };
+        std::printf(
+            "%10zu | %8.2fms %12.0f | %8.2fms %12.0f | %6.1fx | %zu\n",
+            count, report.m_virtual, perSec(report.m_virtual), report.m_batched, perSec(report.m_batched), report.m_virtual / report.m_batched, report.m_mismatches
+        );
+    }
+
+    std::printf("\nfull steps split over threads (%u hardware threads)\n", std::thread::hardware_concurrency());
+    std::printf("%10s | %7s | %10s %12s | %s\n", "particles", "threads", "time", "per sec", "same as 1 thread");
+
+    for ( const auto count : PARTICLE_COUNTS ) {
+        const auto reference = runSteps(count, 1);
+
+        for ( const auto numThreads : THREAD_COUNTS ) {
+            const auto result = 1 == numThreads ? reference : runSteps(count, numThreads);
+            const auto isSame = result.m_positions == reference.m_positions;
+            mismatches += isSame ? 0 : 1;
+
+            const auto perSec = static_cast<double>(count) * NUM_STEPS / (result.m_time / 1000.0);
+            std::printf("%10zu | %7u | %8.2fms %12.0f | %s\n", count, numThreads, result.m_time, perSec, isSame ? "yes" : "NO");
+        }
+    }
+
+    std::printf("\nstrands of %u particles, %u frames\n", CHAIN_LENGTH, STRAND_FRAMES);
+    std::printf("%10s | %12s | %12s | %s\n", "strands", "per frame", "max stretch", "max penetration");
+
+    for ( const auto numStrands : STRAND_COUNTS ) {
+        const auto report = runStrands(numStrands);
+        const auto isGood = report.m_maxStretch < STRAND_MAX_STRETCH && report.m_maxPenetration < STRAND_MAX_PENETRATION;
+        mismatches += isGood ? 0 : 1;
+
+        std::printf(
+            "%10zu | %10.1fus | %11.2f%% | %.2f%%\n", numStrands, report.m_time * 1000.0 / STRAND_FRAMES,
+            report.m_maxStretch * 100.0, std::max<dal::float_t>(0, report.m_maxPenetration) * 100.0
+        );
+    }
+
+    const auto idErrors = checkIDStability(100000, rng);
+    std::printf("id stability after removing half of particles: %zu errors\n", idErrors);
+    mismatches += idErrors;
+
+    return 0 == mismatches ? 0 : 1;
+}
@@ -0,0 +1,306 @@
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <d_frustum.h>
+#include <p_renderqueue.h>
+
+
+// Keys are sorted by radixSortKeys and by std::stable_sort, which must give the same order of items.
+// Ones like a render queue makes share their upper bytes, whose passes radix sort skips.
+// A sample scene of meshes sharing few materials is submitted from a render queue as pushed and as sorted,
+// where issued and skipped state changes are reported. Submitting is run against GL functions that only count calls.
+// This needs GL functions to be pointers like glad makes, which need no context then.
+
+namespace {
+
+    using SortItem = dal::RenderQueue::SortItem;
+
+    constexpr size_t SORT_SIZES[] = { 0, 1, 2, 100, 1000, 10000, 100000 };
+    constexpr unsigned NUM_SORT_REPEATS = 20;
+
+    constexpr unsigned NUM_SCENE_TEXTURES = 16;
+    constexpr unsigned NUM_SCENE_MATERIALS = 24;
+    constexpr unsigned NUM_SCENE_MESHES = 32;
+    constexpr unsigned NUM_SCENE_DRAWS = 2000;
+    // Half extent of the box scene objects are scattered in, in front of the camera.
+    constexpr float SCENE_EXTENT = 50.f;
+
+
+    template <typename F>
+    double measure(F func) {
+        const auto before = std::chrono::steady_clock::now();
+        func();
+        const auto after = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(after - before).count();
+    }
+
+
+    enum class KeyKind { random, sharedHigh, fewDistinct, allEqual };
+
+    const char* getKindName(const KeyKind kind) {
+        switch ( kind ) {
+        case KeyKind::random:
+            return "random";
+        case KeyKind::sharedHigh:
+            return "shared high bytes";
+        case KeyKind::fewDistinct:
+            return "few distinct";
+        default:
+            return "all equal";
+        }
+    }
+
+    std::vector<SortItem> makeItems(const KeyKind kind, const size_t count, std::mt19937_64& rng) {
+        std::vector<SortItem> result(count);
+
+        for ( size_t i = 0; i < count; ++i ) {
+            uint64_t key;
+            switch ( kind ) {
+            case KeyKind::random:
+                key = rng();
+                break;
+            case KeyKind::sharedHigh:
+                // Program and lights are the same in a view, and few envmaps are around.
+                key = (uint64_t{ 0x1A03 } << 48) | ((rng() % 3) << 44) | (rng() & 0xFFFFFFFFFFF);
+                break;
+            case KeyKind::fewDistinct:
+                key = rng() % 16;
+                break;
+            default:
+                key = 0x1234;
+                break;
+            }
+
+            result[i] = SortItem{ key, static_cast<uint32_t>(i) };
+        }
+
+        return result;
+    }
+
+    struct SortReport {
+        double m_radix = 0, m_stable = 0;
+        size_t m_mismatches = 0;
+    };
+
+    SortReport compareSorts(const KeyKind kind, const size_t count) {
+        SortReport result;
+        std::mt19937_64 rng{ count };
+        std::vector<SortItem> scratch;
+
+        for ( unsigned r = 0; r < NUM_SORT_REPEATS; ++r ) {
+            auto radix = ::makeItems(kind, count, rng);
+            auto stable = radix;
+
+            result.m_radix += ::measure([&]() {
+                dal::radixSortKeys(radix, scratch);
+            });
+            result.m_stable += ::measure([&]() {
+                std::stable_sort(stable.begin(), stable.end(), [](const SortItem& a, const SortItem& b) {
+                    return a.m_key < b.m_key;
+                });
+            });
+
+            const auto same = std::equal(radix.begin(), radix.end(), stable.begin(), stable.end(), [](const SortItem& a, const SortItem& b) {
+                return a.m_key == b.m_key && a.m_index == b.m_index;
+            });
+            result.m_mismatches += same ? 0 : 1;
+        }
+
+        result.m_radix /= NUM_SORT_REPEATS;
+        result.m_stable /= NUM_SORT_REPEATS;
+        return result;
+    }
+
+}
+
+
+#ifdef __glad_h_
+
+namespace {
+
+    struct SubmitCalls {
+        size_t m_draws = 0, m_uniforms = 0, m_textureBinds = 0;
+    };
+
+    SubmitCalls g_submitCalls;
+    GLuint g_nextName = 1;
+
+    void genNames(GLsizei n, GLuint* names) {
+        for ( GLsizei i = 0; i < n; ++i ) {
+            names[i] = g_nextName++;
+        }
+    }
+
+    void APIENTRY recordGenNames(GLsizei n, GLuint* names) {
+        ::genNames(n, names);
+    }
+    void APIENTRY recordDeleteNames(GLsizei, const GLuint*) {}
+    void APIENTRY recordBindBuffer(GLenum, GLuint) {}
+    void APIENTRY recordBindVertexArray(GLuint) {}
+    void APIENTRY recordBufferData(GLenum, GLsizeiptr, const void*, GLenum) {}
+    void APIENTRY recordVertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) {}
+    void APIENTRY recordEnableVertexAttribArray(GLuint) {}
+    void APIENTRY recordActiveTexture(GLenum) {}
+    void APIENTRY recordBindTexture(GLenum, GLuint) {
+        ++g_submitCalls.m_textureBinds;
+    }
+    void APIENTRY recordUniform1i(GLint, GLint) {
+        ++g_submitCalls.m_uniforms;
+    }
+    void APIENTRY recordUniform1f(GLint, GLfloat) {
+        ++g_submitCalls.m_uniforms;
+    }
+    void APIENTRY recordUniformMatrix4fv(GLint, GLsizei, GLboolean, const GLfloat*) {
+        ++g_submitCalls.m_uniforms;
+    }
+    void APIENTRY recordDrawArrays(GLenum, GLint, GLsizei) {
+        ++g_submitCalls.m_draws;
+    }
+
+    void setRecordingFunctions(const bool enable) {
+        glad_glGenTextures = enable ? recordGenNames : nullptr;
+        glad_glDeleteTextures = enable ? recordDeleteNames : nullptr;
+        glad_glGenVertexArrays = enable ? recordGenNames : nullptr;
+        glad_glDeleteVertexArrays = enable ? recordDeleteNames : nullptr;
+        glad_glGenBuffers = enable ? recordGenNames : nullptr;
+        glad_glDeleteBuffers = enable ? recordDeleteNames : nullptr;
+        glad_glBindBuffer = enable ? recordBindBuffer : nullptr;
+        glad_glBindVertexArray = enable ? recordBindVertexArray : nullptr;
+        glad_glBufferData = enable ? recordBufferData : nullptr;
+        glad_glVertexAttribPointer = enable ? recordVertexAttribPointer : nullptr;
+        glad_glEnableVertexAttribArray = enable ? recordEnableVertexAttribArray : nullptr;
+        glad_glActiveTexture = enable ? recordActiveTexture : nullptr;
+        glad_glBindTexture = enable ? recordBindTexture : nullptr;
+        glad_glUniform1i = enable ? recordUniform1i : nullptr;
+        glad_glUniform1f = enable ? recordUniform1f : nullptr;
+        glad_glUniformMatrix4fv = enable ? recordUniformMatrix4fv : nullptr;
+        glad_glDrawArrays = enable ? recordDrawArrays : nullptr;
+    }
+
+
+    struct SubmitReport {
+        dal::RenderQueueStats m_stats;
+        SubmitCalls m_calls;
+    };
+
+    struct SceneReport {
+        SubmitReport m_pushed, m_sorted;
+    };
+
+    // Objects have no lights nor envmap as if outside of every map chunk, so those are sent once.
+    // Uniform locations are all -1, which GL ignores, as if the program had none of them.
+    SceneReport recordSampleScene(void) {
+        ::setRecordingFunctions(true);
+        SceneReport result;
+
+        {
+            std::mt19937 rng{ 42 };
+            std::uniform_real_distribution<float> offset{ -SCENE_EXTENT, SCENE_EXTENT };
+
+            std::vector<std::shared_ptr<dal::Texture>> textures;
+            for ( unsigned i = 0; i < NUM_SCENE_TEXTURES; ++i ) {
+                auto& texture = textures.emplace_back(std::make_shared<dal::Texture>());
+                texture->genTexture("RenderQueueBench");
+            }
+
+            std::vector<dal::Material> materials(NUM_SCENE_MATERIALS);
+            for ( auto& material : materials ) {
+                material.m_diffuseMap = textures[rng() % NUM_SCENE_TEXTURES];
+                material.m_roughnessMap = textures[rng() % NUM_SCENE_TEXTURES];
+                material.m_roughness = static_cast<float>(rng() % 4) * 0.25f;
+                material.m_metallic = static_cast<float>(rng() % 2);
+            }
+
+            const float vertices[] = { 0, 0, 0, 1, 0, 0, 0, 1, 0 };
+            const float texcoords[] = { 0, 0, 1, 0, 0, 1 };
+            const float normals[] = { 0, 0, 1, 0, 0, 1, 0, 0, 1 };
+            std::vector<dal::MeshStatic> meshes(NUM_SCENE_MESHES);
+            for ( auto& mesh : meshes ) {
+                mesh.buildData(vertices, texcoords, normals, 3);
+            }
+
+            struct Draw {
+                glm::mat4 m_modelMat;
+                glm::vec3 m_center;
+                unsigned m_mesh, m_material;
+            };
+
+            std::vector<Draw> draws(NUM_SCENE_DRAWS);
+            for ( auto& draw : draws ) {
+                draw.m_center = glm::vec3{ offset(rng), offset(rng), offset(rng) - SCENE_EXTENT * 2.f };
+                draw.m_modelMat = glm::translate(glm::mat4{ 1 }, draw.m_center);
+                draw.m_mesh = rng() % NUM_SCENE_MESHES;
+                draw.m_material = rng() % NUM_SCENE_MATERIALS;
+            }
+
+            const auto proj = glm::perspective(glm::radians(90.f), 1.f, 0.1f, SCENE_EXTENT * 4.f);
+            const dal::Frustum frustum{ proj };
+            const dal::UniRender_Static uniloc;
+
+            dal::RenderQueue queue;
+            queue.begin(0, frustum, true);
+            for ( const auto& draw : draws ) {
+                queue.push(meshes[draw.m_mesh], materials[draw.m_material], draw.m_modelMat, nullptr, nullptr, draw.m_center);
+            }
+
+            g_submitCalls = SubmitCalls{};
+            queue.submit(uniloc, result.m_pushed.m_stats);
+            result.m_pushed.m_calls = g_submitCalls;
+
+            queue.sort();
+            g_submitCalls = SubmitCalls{};
+            queue.submit(uniloc, result.m_sorted.m_stats);
+            result.m_sorted.m_calls = g_submitCalls;
+        }
+
+        // No context was ever loaded, so they were null before.
+        ::setRecordingFunctions(false);
+        return result;
+    }
+
+}
+
+#endif
+
+
+int main(void) {
+    size_t mismatches = 0;
+
+    std::printf("%-18s %8s | %10s %10s\n", "keys", "count", "radix ms", "stable ms");
+    for ( const auto kind : { KeyKind::random, KeyKind::sharedHigh, KeyKind::fewDistinct, KeyKind::allEqual } ) {
+        for ( const auto count : SORT_SIZES ) {
+            const auto report = ::compareSorts(kind, count);
+            std::printf("%-18s %8zu | %10.3f %10.3f\n", ::getKindName(kind), count, report.m_radix, report.m_stable);
+            mismatches += report.m_mismatches;
+        }
+    }
+
+#ifdef __glad_h_
+    {
+        const auto report = ::recordSampleScene();
+        const auto& pushed = report.m_pushed;
+        const auto& sorted = report.m_sorted;
+
+        // Both orders compare the same states for the same draws, only fewer of them differ from the previous one when sorted.
+        mismatches += NUM_SCENE_DRAWS == pushed.m_stats.m_draws && NUM_SCENE_DRAWS == sorted.m_stats.m_draws ? 0 : 1;
+        mismatches += pushed.m_calls.m_draws == pushed.m_stats.m_draws && sorted.m_calls.m_draws == sorted.m_stats.m_draws ? 0 : 1;
+        mismatches += pushed.m_stats.m_stateChanges + pushed.m_stats.m_stateSkipped == sorted.m_stats.m_stateChanges + sorted.m_stats.m_stateSkipped ? 0 : 1;
+        mismatches += sorted.m_stats.m_stateChanges <= pushed.m_stats.m_stateChanges ? 0 : 1;
+
+        std::printf("\n%-18s | %8s %14s %14s %10s %14s\n", "sample scene", "draws", "state changes", "state skipped", "uniforms", "texture binds");
+        for ( const auto& [name, submit] : { std::make_pair("as pushed", &pushed), std::make_pair("sorted", &sorted) } ) {
+            std::printf("%-18s | %8zu %14zu %14zu %10zu %14zu\n", name, submit->m_stats.m_draws, submit->m_stats.m_stateChanges,
+                submit->m_stats.m_stateSkipped, submit->m_calls.m_uniforms, submit->m_calls.m_textureBinds);
+        }
+    }
+#endif
+
+    std::printf("mismatches: %zu\n", mismatches);
+    return 0 == mismatches ? 0 : 2;
+}
@@ -0,0 +1,162 @@
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include <d_mapparser.h>
+#include <d_mapbuilder.h>
+
+#include "parser_corpus.h"
+
+
+// Allocation counter
+// Every allocation in this executable goes through these, including ones made by parsers.
+
+namespace {
+
+    std::atomic<size_t> g_allocCount{ 0 };
+
+}
+
+void* operator new(const size_t size) {
+    ++g_allocCount;
+
+    if ( auto p = std::malloc(size == 0 ? 1 : size) ) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* const p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* const p, const size_t) noexcept {
+    std::free(p);
+}
+
+
+namespace {
+
+    struct BenchResult {
+        double m_seconds = 0;
+        size_t m_bytes = 0;
+        size_t m_allocs = 0;
+        size_t m_failures = 0;
+    };
+
+    template <typename F>
+    BenchResult runBench(const std::vector<dal::ParserInput>& inputs, const int iterations, F parseFunc) {
+        BenchResult result;
+
+        const auto allocBefore = g_allocCount.load();
+        const auto timeBefore = std::chrono::steady_clock::now();
+
+        for ( int i = 0; i < iterations; ++i ) {
+            for ( auto& input : inputs ) {
+                if ( !parseFunc(input.m_data.data(), input.m_data.size()) ) {
+                    ++result.m_failures;
+                }
+                result.m_bytes += input.m_data.size();
+            }
+        }
+
+        const auto timeAfter = std::chrono::steady_clock::now();
+
+        result.m_seconds = std::chrono::duration<double>(timeAfter - timeBefore).count();
+        result.m_allocs = g_allocCount.load() - allocBefore;
+
+        return result;
+    }
+
+    void printResult(const char* const name, const BenchResult& result, const size_t numChunks) {
+        const auto megaBytes = static_cast<double>(result.m_bytes) / (1024.0 * 1024.0);
+        const auto allocPerChunk = numChunks > 0 ? static_cast<double>(result.m_allocs) / numChunks : 0.0;
+
+        std::printf(
+            "%-24s %10.2f MB/s %12.1f allocs/chunk %8.3f s %6zu failed\n",
+            name, megaBytes / result.m_seconds, allocPerChunk, result.m_seconds, result.m_failures
+        );
+    }
+
+    std::vector<dal::ParserInput> convertToV2(const std::vector<dal::ParserInput>& inputs, const bool compress) {
+        std::vector<dal::ParserInput> result;
+
+        for ( auto& input : inputs ) {
+            auto chunk = dal::parseMapChunk(input.m_data.data(), input.m_data.size());
+            if ( !chunk ) {
+                std::printf("failed to parse: %s\n", input.m_name.c_str());
+                continue;
+            }
+
+            auto& output = result.emplace_back();
+            output.m_name = input.m_name.substr(0, input.m_name.size() - 4) + (compress ? ".v2.dmc" : ".v2raw.dmc");
+            output.m_data = dal::buildMapChunk_v2(*chunk, compress);
+        }
+
+        return result;
+    }
+
+}
+
+
+// Usage: resparser_bench <map folder> [iterations] [--emit-v2 <output folder>]
+int main(int argc, char* args[]) {
+    if ( argc < 2 ) {
+        std::printf("usage: %s <map folder> [iterations] [--emit-v2 <output folder>]\n", args[0]);
+        return 1;
+    }
+
+    const std::string mapDir = args[1];
+    int iterations = 20;
+    std::string emitDir;
+
+    for ( int i = 2; i < argc; ++i ) {
+        const std::string arg = args[i];
+        if ( "--emit-v2" == arg && i + 1 < argc ) {
+            emitDir = args[++i];
+        }
+        else {
+            iterations = std::max(1, std::atoi(args[i]));
+        }
+    }
+
+    const auto levels = dal::loadParserInputs(mapDir, ".dlb");
+    const auto chunks = dal::loadParserInputs(mapDir, ".dmc");
+    if ( chunks.empty() ) {
+        std::printf("no map chunk found in: %s\n", mapDir.c_str());
+        return 1;
+    }
+
+    const auto chunks_v2 = convertToV2(chunks, true);
+    const auto chunks_v2raw = convertToV2(chunks, false);
+
+    if ( !emitDir.empty() ) {
+        for ( auto& list : { &chunks_v2, &chunks_v2raw } ) {
+            for ( auto& chunk : *list ) {
+                const auto path = emitDir + '/' + chunk.m_name;
+                if ( !dal::writeFileBuffer(path, chunk.m_data) ) {
+                    std::printf("failed to write: %s\n", path.c_str());
+                }
+            }
+        }
+    }
+
+    std::printf("%zu levels, %zu chunks, %d iterations\n", levels.size(), chunks.size(), iterations);
+
+    const auto numChunks = chunks.size() * iterations;
+    const auto numLevels = levels.size() * iterations;
+
+    printResult("parseLevel_v1", runBench(levels, iterations, [](auto buf, auto size) { return dal::parseLevel_v1(buf, size).has_value(); }), numLevels);
+    printResult("parseMapChunk_v1", runBench(chunks, iterations, [](auto buf, auto size) { return dal::parseMapChunk_v1(buf, size).has_value(); }), numChunks);
+    printResult("parseMapChunk_v2 zip", runBench(chunks_v2, iterations, [](auto buf, auto size) { return dal::parseMapChunk_v2(buf, size).has_value(); }), numChunks);
+    printResult("parseMapChunk_v2 raw", runBench(chunks_v2raw, iterations, [](auto buf, auto size) { return dal::parseMapChunk_v2(buf, size).has_value(); }), numChunks);
+
+    const auto colliderOnly = dal::v2::sectionBit(dal::v2::ChunkSection::colliders);
+    printResult("v2 colliders only", runBench(chunks_v2, iterations, [colliderOnly](auto buf, auto size) { return dal::parseMapChunk_v2(buf, size, colliderOnly).has_value(); }), numChunks);
+
+    return 0;
+}
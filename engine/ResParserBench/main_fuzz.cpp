@@ -0,0 +1,12 @@
+#include <d_mapparser.h>
+
+
+// Parsers must reject any input by returning nullopt, never crash or read out of bounds.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    dal::parseLevel_v1(data, size);
+    dal::parseMapChunk_v1(data, size);
+    dal::parseMapChunk_v2(data, size);
+    dal::parseMapChunk_v2(data, size, dal::v2::sectionBit(dal::v2::ChunkSection::colliders));
+
+    return 0;
+}
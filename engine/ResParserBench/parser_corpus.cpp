@@ -0,0 +1,45 @@
+#include "parser_corpus.h"
+
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+
+
+namespace dal {
+
+    std::vector<ParserInput> loadParserInputs(const std::string& dirPath, const std::string& extension) {
+        std::vector<ParserInput> result;
+
+        std::error_code err;
+        for ( auto& entry : std::filesystem::directory_iterator{ dirPath, err } ) {
+            if ( !entry.is_regular_file() || entry.path().extension() != extension ) {
+                continue;
+            }
+
+            std::ifstream file{ entry.path(), std::ios::binary };
+            if ( !file ) {
+                continue;
+            }
+
+            auto& input = result.emplace_back();
+            input.m_name = entry.path().filename().string();
+            input.m_data.assign(std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{});
+        }
+
+        // directory_iterator doesn't guarantee any order.
+        std::sort(result.begin(), result.end(), [](const ParserInput& a, const ParserInput& b) { return a.m_name < b.m_name; });
+        return result;
+    }
+
+    bool writeFileBuffer(const std::string& path, const std::vector<uint8_t>& data) {
+        std::ofstream file{ path, std::ios::binary };
+        if ( !file ) {
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        return static_cast<bool>(file);
+    }
+
+}
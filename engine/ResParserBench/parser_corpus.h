@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+namespace dal {
+
+    struct ParserInput {
+        std::string m_name;
+        std::vector<uint8_t> m_data;
+    };
+
+    // Reads all files with given extension in the directory, not recursively.
+    std::vector<ParserInput> loadParserInputs(const std::string& dirPath, const std::string& extension);
+
+    bool writeFileBuffer(const std::string& path, const std::vector<uint8_t>& data);
+
+}